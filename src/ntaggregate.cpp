@@ -4,11 +4,15 @@
  * found in the file LICENSE that is included with the distribution
  */
 
+#include <epicsThread.h>
+
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/ntaggregate.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -21,6 +25,18 @@ namespace detail {
 
 StructureConstPtr NTAggregateBuilder::createStructure()
 {
+    StructureKey key(NTAggregate::URI);
+    key.add(dispersion).add(first).add(firstTimeStamp).add(last).
+        add(lastTimeStamp).add(max).add(min).add(descriptor).add(alarm).add(timeStamp).
+        add(extraFieldNames, extraFields);
+
+    StructureConstPtr s = StructureCache::find(key);
+    if (s)
+    {
+        reset();
+        return s;
+    }
+
     FieldBuilderPtr builder =
             getFieldCreate()->createFieldBuilder()->
                setId(NTAggregate::URI)->
@@ -62,7 +78,7 @@ StructureConstPtr NTAggregateBuilder::createStructure()
         builder->add(extraFieldNames[i], extraFields[i]);
 
 
-    StructureConstPtr s = builder->createStructure();
+    s = StructureCache::insert(key, builder->createStructure());
 
     reset();
     return s;
@@ -133,6 +149,11 @@ PVStructurePtr NTAggregateBuilder::createPVStructure()
     return getPVDataCreate()->createPVStructure(createStructure());
 }
 
+NTPrototypePtr NTAggregateBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTAggregatePtr NTAggregateBuilder::create()
 {
     return NTAggregatePtr(new NTAggregate(createPVStructure()));
@@ -171,10 +192,12 @@ NTAggregateBuilder::shared_pointer NTAggregateBuilder::add(string const & name,
 }
 
 const std::string NTAggregate::URI("epics:nt/NTAggregate:1.0");
+static const NTTypeKey uriKey(NTAggregate::URI);
 
 NTAggregate::shared_pointer NTAggregate::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntAggregate, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -185,7 +208,7 @@ NTAggregate::shared_pointer NTAggregate::wrapUnsafe(PVStructurePtr const & pvStr
 
 bool NTAggregate::is_a(StructureConstPtr const & structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTAggregate::is_a(PVStructurePtr const & pvStructure)
@@ -194,13 +217,8 @@ bool NTAggregate::is_a(PVStructurePtr const & pvStructure)
 }
 
 
-bool NTAggregate::isCompatible(StructureConstPtr const &structure)
+Result& NTAggregate::isCompatible(Result& result)
 {
-    if (!structure)
-        return false;
-
-    Result result(structure);
-
     return result
         .is<Structure>()
         .has<Scalar>("value")
@@ -214,20 +232,54 @@ bool NTAggregate::isCompatible(StructureConstPtr const &structure)
         .maybeHas<Scalar>("min")
         .maybeHas<Scalar>("descriptor")
         .maybeHas<&NTField::isAlarm, Structure>("alarm")
-        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp")
-        .valid();
+        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp");
+}
+
+bool NTAggregate::isCompatible(StructureConstPtr const &structure)
+{
+    NTStatistics::Probe probe(ntAggregate, NTStatistics::opIsCompatible);
+
+    if (!structure)
+        return probe.result(false);
+
+    static const ValidationPlan plan(&NTAggregate::isCompatible);
+
+    return probe.result(plan.validate(structure));
+}
+
+bool NTAggregate::isCompatible(StructureConstPtr const &structure, std::string &diagnostics)
+{
+    return diagnose(structure, &NTAggregate::isCompatible, diagnostics);
 }
 
 bool NTAggregate::isCompatible(PVStructurePtr const & pvStructure)
 {
     if(!pvStructure) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTAggregate::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTAggregate::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 bool NTAggregate::isValid()
 {
-    return true;
+    NTStatistics::Probe probe(ntAggregate, NTStatistics::opIsValid);
+
+    return probe.result(true);
 }
 
 NTAggregateBuilderPtr NTAggregate::createBuilder()
@@ -260,17 +312,17 @@ PVStructurePtr NTAggregate::getPVStructure() const
 
 PVStringPtr NTAggregate::getDescriptor() const
 {
-    return pvNTAggregate->getSubField<PVString>("descriptor");
+    return pvDescriptor;
 }
 
 PVStructurePtr NTAggregate::getTimeStamp() const
 {
-    return pvNTAggregate->getSubField<PVStructure>("timeStamp");
+    return pvTimeStamp;
 }
 
 PVStructurePtr NTAggregate::getAlarm() const
 {
-    return pvNTAggregate->getSubField<PVStructure>("alarm");
+    return pvAlarm;
 }
 
 PVDoublePtr NTAggregate::getValue() const
@@ -280,46 +332,57 @@ PVDoublePtr NTAggregate::getValue() const
 
 PVLongPtr NTAggregate::getN() const
 {
-    return pvNTAggregate->getSubField<PVLong>("N");
+    return pvN;
 }
 
 PVDoublePtr NTAggregate::getDispersion() const
 {
-    return pvNTAggregate->getSubField<PVDouble>("dispersion");
+    return pvDispersion;
 }
 
 PVDoublePtr NTAggregate::getFirst() const
 {
-    return pvNTAggregate->getSubField<PVDouble>("first");
+    return pvFirst;
 }
 
 PVStructurePtr NTAggregate::getFirstTimeStamp() const
 {
-    return pvNTAggregate->getSubField<PVStructure>("firstTimeStamp");
+    return pvFirstTimeStamp;
 }
 
 PVDoublePtr NTAggregate::getLast() const
 {
-    return pvNTAggregate->getSubField<PVDouble>("last");
+    return pvLast;
 }
 
 PVStructurePtr NTAggregate::getLastTimeStamp() const
 {
-    return pvNTAggregate->getSubField<PVStructure>("lastTimeStamp");
+    return pvLastTimeStamp;
 }
 
 PVDoublePtr NTAggregate::getMax() const
 {
-    return pvNTAggregate->getSubField<PVDouble>("max");
+    return pvMax;
 }
 
 PVDoublePtr NTAggregate::getMin() const
 {
-    return pvNTAggregate->getSubField<PVDouble>("min");
+    return pvMin;
 }
 
 NTAggregate::NTAggregate(PVStructurePtr const & pvStructure) :
-    pvNTAggregate(pvStructure), pvValue(pvNTAggregate->getSubField<PVDouble>("value"))
+    pvNTAggregate(pvStructure), pvValue(pvNTAggregate->getSubField<PVDouble>("value")),
+    pvDescriptor(pvNTAggregate->getSubField<PVString>("descriptor")),
+    pvTimeStamp(pvNTAggregate->getSubField<PVStructure>("timeStamp")),
+    pvAlarm(pvNTAggregate->getSubField<PVStructure>("alarm")),
+    pvN(pvNTAggregate->getSubField<PVLong>("N")),
+    pvDispersion(pvNTAggregate->getSubField<PVDouble>("dispersion")),
+    pvFirst(pvNTAggregate->getSubField<PVDouble>("first")),
+    pvFirstTimeStamp(pvNTAggregate->getSubField<PVStructure>("firstTimeStamp")),
+    pvLast(pvNTAggregate->getSubField<PVDouble>("last")),
+    pvLastTimeStamp(pvNTAggregate->getSubField<PVStructure>("lastTimeStamp")),
+    pvMax(pvNTAggregate->getSubField<PVDouble>("max")),
+    pvMin(pvNTAggregate->getSubField<PVDouble>("min"))
 {}
 
 
@@ -4,11 +4,15 @@
  * found in the file LICENSE that is included with the distribution
  */
 
+#include <epicsThread.h>
+
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/ntattribute.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -22,6 +26,17 @@ namespace detail {
 
 StructureConstPtr NTAttributeBuilder::createStructure()
 {
+    StructureKey key(NTAttribute::URI);
+    key.add(tags).add(descriptor).add(alarm).add(timeStamp).
+        add(extraFieldNames, extraFields);
+
+    StructureConstPtr s = StructureCache::find(key);
+    if (s)
+    {
+        reset();
+        return s;
+    }
+
     FieldBuilderPtr builder =
             getFieldCreate()->createFieldBuilder()->
                setId(NTAttribute::URI)->
@@ -45,7 +60,7 @@ StructureConstPtr NTAttributeBuilder::createStructure()
         builder->add(extraFieldNames[i], extraFields[i]);
 
 
-    StructureConstPtr s = builder->createStructure();
+    s = StructureCache::insert(key, builder->createStructure());
 
     reset();
     return s;
@@ -80,6 +95,11 @@ PVStructurePtr NTAttributeBuilder::createPVStructure()
     return getPVDataCreate()->createPVStructure(createStructure());
 }
 
+NTPrototypePtr NTAttributeBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTAttributePtr NTAttributeBuilder::create()
 {
     return NTAttributePtr(new NTAttribute(createPVStructure()));
@@ -108,10 +128,12 @@ NTAttributeBuilder::shared_pointer NTAttributeBuilder::add(string const & name,
 }
 
 const std::string NTAttribute::URI("epics:nt/NTAttribute:1.0");
+static const NTTypeKey uriKey(NTAttribute::URI);
 
 NTAttribute::shared_pointer NTAttribute::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntAttribute, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -122,7 +144,7 @@ NTAttribute::shared_pointer NTAttribute::wrapUnsafe(PVStructurePtr const & pvStr
 
 bool NTAttribute::is_a(StructureConstPtr const & structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTAttribute::is_a(PVStructurePtr const & pvStructure)
@@ -130,13 +152,8 @@ bool NTAttribute::is_a(PVStructurePtr const & pvStructure)
     return is_a(pvStructure->getStructure());
 }
 
-bool NTAttribute::isCompatible(StructureConstPtr const & structure)
+Result& NTAttribute::isCompatible(Result& result)
 {
-    if (!structure)
-        return false;
-
-    Result result(structure);
-
     return result
        .is<Structure>()
        .has<Scalar>("name")
@@ -144,20 +161,54 @@ bool NTAttribute::isCompatible(StructureConstPtr const & structure)
        .maybeHas<ScalarArray>("tags")
        .maybeHas<Scalar>("descriptor")
        .maybeHas<&NTField::isAlarm, Structure>("alarm")
-       .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp")
-       .valid();
+       .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp");
+}
+
+bool NTAttribute::isCompatible(StructureConstPtr const & structure)
+{
+    NTStatistics::Probe probe(ntAttribute, NTStatistics::opIsCompatible);
+
+    if (!structure)
+        return probe.result(false);
+
+    static const ValidationPlan plan(&NTAttribute::isCompatible);
+
+    return probe.result(plan.validate(structure));
+}
+
+bool NTAttribute::isCompatible(StructureConstPtr const & structure, std::string & diagnostics)
+{
+    return diagnose(structure, &NTAttribute::isCompatible, diagnostics);
 }
 
 bool NTAttribute::isCompatible(PVStructurePtr const & pvStructure)
 {
     if(!pvStructure) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTAttribute::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTAttribute::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 bool NTAttribute::isValid()
 {
-    return true;
+    NTStatistics::Probe probe(ntAttribute, NTStatistics::opIsValid);
+
+    return probe.result(true);
 }
 
 NTAttributeBuilderPtr NTAttribute::createBuilder()
@@ -190,23 +241,23 @@ PVStructurePtr NTAttribute::getPVStructure() const
 
 PVStringPtr NTAttribute::getDescriptor() const
 {
-    return pvNTAttribute->getSubField<PVString>("descriptor");
+    return pvDescriptor;
 }
 
 PVStructurePtr NTAttribute::getTimeStamp() const
 {
-    return pvNTAttribute->getSubField<PVStructure>("timeStamp");
+    return pvTimeStamp;
 }
 
 PVStructurePtr NTAttribute::getAlarm() const
 {
-    return pvNTAttribute->getSubField<PVStructure>("alarm");
+    return pvAlarm;
 }
 
 
 PVStringPtr NTAttribute::getName() const
 {
-    return pvNTAttribute->getSubField<PVString>("name");
+    return pvName;
 }
 
 PVUnionPtr NTAttribute::getValue() const
@@ -216,11 +267,16 @@ PVUnionPtr NTAttribute::getValue() const
 
 PVStringArrayPtr NTAttribute::getTags() const
 {
-    return pvNTAttribute->getSubField<PVStringArray>("tags");
+    return pvTags;
 }
 
 NTAttribute::NTAttribute(PVStructurePtr const & pvStructure) :
-    pvNTAttribute(pvStructure), pvValue(pvNTAttribute->getSubField<PVUnion>("value"))
+    pvNTAttribute(pvStructure), pvValue(pvNTAttribute->getSubField<PVUnion>("value")),
+    pvDescriptor(pvNTAttribute->getSubField<PVString>("descriptor")),
+    pvTimeStamp(pvNTAttribute->getSubField<PVStructure>("timeStamp")),
+    pvAlarm(pvNTAttribute->getSubField<PVStructure>("alarm")),
+    pvName(pvNTAttribute->getSubField<PVString>("name")),
+    pvTags(pvNTAttribute->getSubField<PVStringArray>("tags"))
 {
 }
 
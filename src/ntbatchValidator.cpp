@@ -0,0 +1,149 @@
+/* ntbatchValidator.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <map>
+#include <stdexcept>
+
+#define epicsExportSharedSymbols
+#include <pv/ntbatchValidator.h>
+#include <pv/ntfingerprint.h>
+
+#include "parallel.h"
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+const size_t NTBatchValidator::MIN_PARALLEL;
+
+namespace {
+
+// the distinct structures of a batch and their verdicts
+struct Batch : public detail::ParallelJob
+{
+    Batch(NTBatchValidator::check_t check, NTBatchValidator::diagnose_t diagnose)
+    : check(check), diagnose(diagnose) {}
+
+    NTBatchValidator::check_t check;
+    NTBatchValidator::diagnose_t diagnose;
+
+    std::vector<StructureConstPtr> structures;
+    std::vector<char> verdicts;
+    std::vector<std::string> diagnostics;
+
+    // checks one structure, a check which throws fails it
+    virtual void run(size_t i)
+    {
+        try {
+            verdicts[i] = diagnose ?
+                diagnose(structures[i], diagnostics[i]) : check(structures[i]);
+        } catch (std::exception & e) {
+            fail(i, e.what());
+        } catch (...) {
+            fail(i, "unknown exception");
+        }
+    }
+
+    void fail(size_t i, const char * message)
+    {
+        verdicts[i] = false;
+        if (diagnose)
+            diagnostics[i] = message;
+    }
+};
+
+void runBatch(Batch & batch, unsigned threads)
+{
+    size_t count = batch.structures.size();
+    if (count < NTBatchValidator::MIN_PARALLEL)
+        threads = 1;
+
+    detail::runParallel(batch, count, threads);
+}
+
+// index of a structure in the batch, adding it if no structurally
+// identical one is there yet
+size_t add(Batch & batch, StructureConstPtr const & structure,
+    std::map<Structure const *, size_t> & same,
+    std::map<NTFingerprint, size_t> & equal)
+{
+    // the same introspection interface
+    std::map<Structure const *, size_t>::const_iterator it = same.find(structure.get());
+    if (it != same.end())
+        return it->second;
+
+    // a structurally identical one, created independently
+    size_t index = batch.structures.size();
+    std::pair<std::map<NTFingerprint, size_t>::iterator, bool> inserted =
+        equal.insert(std::make_pair(NTFingerprint::compute(structure), index));
+    if (!inserted.second && *batch.structures[inserted.first->second] == *structure)
+        index = inserted.first->second;
+    else
+        batch.structures.push_back(structure);
+
+    same[structure.get()] = index;
+    return index;
+}
+
+size_t validate(std::vector<StructureConstPtr> const & structures,
+    NTBatchValidator::check_t check, NTBatchValidator::diagnose_t diagnose,
+    std::vector<bool> & verdicts, std::vector<std::string> * diagnostics,
+    unsigned threads)
+{
+    Batch batch(check, diagnose);
+
+    // index of each structure in the batch
+    std::vector<size_t> items(structures.size());
+    std::map<Structure const *, size_t> same;
+    std::map<NTFingerprint, size_t> equal;
+
+    for (size_t i = 0; i < structures.size(); ++i)
+        if (structures[i])
+            items[i] = add(batch, structures[i], same, equal);
+
+    batch.verdicts.resize(batch.structures.size());
+    if (diagnose)
+        batch.diagnostics.resize(batch.structures.size());
+
+    runBatch(batch, threads);
+
+    verdicts.resize(structures.size());
+    if (diagnostics)
+        diagnostics->resize(structures.size());
+
+    for (size_t i = 0; i < structures.size(); ++i) {
+        if (!structures[i]) {
+            verdicts[i] = false;
+            if (diagnostics)
+                (*diagnostics)[i] = "null structure";
+            continue;
+        }
+        verdicts[i] = batch.verdicts[items[i]] != 0;
+        if (diagnostics)
+            (*diagnostics)[i] = batch.diagnostics[items[i]];
+    }
+
+    return batch.structures.size();
+}
+
+}
+
+size_t NTBatchValidator::isCompatible(
+    std::vector<StructureConstPtr> const & structures,
+    check_t check, std::vector<bool> & verdicts, unsigned threads)
+{
+    return validate(structures, check, NULL, verdicts, NULL, threads);
+}
+
+size_t NTBatchValidator::isCompatible(
+    std::vector<StructureConstPtr> const & structures,
+    diagnose_t check, std::vector<bool> & verdicts,
+    std::vector<std::string> & diagnostics, unsigned threads)
+{
+    return validate(structures, NULL, check, verdicts, &diagnostics, threads);
+}
+
+}}
@@ -0,0 +1,444 @@
+/* ntbitshuffle.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "simd.h"
+
+#define epicsExportSharedSymbols
+#include <pv/ntbitshuffle.h>
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+const size_t NTBitshuffle::DEFAULT_BLOCK_BYTES;
+
+namespace {
+
+/*
+ * A block of n elements of e bytes is first split into e planes of n
+ * bytes, the byte b of all elements, then the bits of each plane are
+ * transposed into 8 rows of n/8 bytes, the bit j of all bytes.
+ */
+
+// transposes an 8x8 bit matrix, the bit j of byte k becomes the bit k of byte j
+inline uint64 transpose8(uint64 x)
+{
+    uint64 t;
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+    x = x ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+    x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+    x = x ^ t ^ (t << 28);
+    return x;
+}
+
+// the bits of the plane of n bytes, from the group of 8 bytes first
+void transposeBitsScalar(uint8 const * in, uint8 * out, size_t n, size_t first)
+{
+    size_t rowSize = n / 8;
+    for (size_t i = first; i < rowSize; ++i)
+    {
+        uint64 x = 0;
+        for (size_t k = 0; k < 8; ++k)
+            x |= static_cast<uint64>(in[8 * i + k]) << (8 * k);
+        x = transpose8(x);
+        for (size_t j = 0; j < 8; ++j)
+            out[j * rowSize + i] = static_cast<uint8>(x >> (8 * j));
+    }
+}
+
+void untransposeBitsScalar(uint8 const * in, uint8 * out, size_t n, size_t first)
+{
+    size_t rowSize = n / 8;
+    for (size_t i = first; i < rowSize; ++i)
+    {
+        uint64 x = 0;
+        for (size_t j = 0; j < 8; ++j)
+            x |= static_cast<uint64>(in[j * rowSize + i]) << (8 * j);
+        x = transpose8(x);
+        for (size_t k = 0; k < 8; ++k)
+            out[8 * i + k] = static_cast<uint8>(x >> (8 * k));
+    }
+}
+
+template<size_t E>
+void transposeBytesScalar(uint8 const * in, uint8 * out, size_t n, size_t first)
+{
+    for (size_t i = first; i < n; ++i)
+        for (size_t b = 0; b < E; ++b)
+            out[b * n + i] = in[i * E + b];
+}
+
+template<size_t E>
+void untransposeBytesScalar(uint8 const * in, uint8 * out, size_t n, size_t first)
+{
+    for (size_t i = first; i < n; ++i)
+        for (size_t b = 0; b < E; ++b)
+            out[i * E + b] = in[b * n + i];
+}
+
+void transposeBytesScalar(uint8 const * in, uint8 * out, size_t n, size_t e)
+{
+    switch (e)
+    {
+    case 2: transposeBytesScalar<2>(in, out, n, 0); break;
+    case 4: transposeBytesScalar<4>(in, out, n, 0); break;
+    case 8: transposeBytesScalar<8>(in, out, n, 0); break;
+    default:
+        for (size_t i = 0; i < n; ++i)
+            for (size_t b = 0; b < e; ++b)
+                out[b * n + i] = in[i * e + b];
+    }
+}
+
+void untransposeBytesScalar(uint8 const * in, uint8 * out, size_t n, size_t e)
+{
+    switch (e)
+    {
+    case 2: untransposeBytesScalar<2>(in, out, n, 0); break;
+    case 4: untransposeBytesScalar<4>(in, out, n, 0); break;
+    case 8: untransposeBytesScalar<8>(in, out, n, 0); break;
+    default:
+        for (size_t i = 0; i < n; ++i)
+            for (size_t b = 0; b < e; ++b)
+                out[i * e + b] = in[b * n + i];
+    }
+}
+
+#ifdef NT_SSE2
+
+/*
+ * movemask collects the bit 7 of 16 bytes, the bits of a row for 16
+ * bytes of a plane. Shifting 16-bit lanes left by one moves the next
+ * bit to bit 7 of each byte, bits crossing bytes only reach their bit 0.
+ */
+size_t transposeBitsSse2(uint8 const * in, uint8 * out, size_t n, size_t first)
+{
+    size_t rowSize = n / 8;
+    size_t i = first;
+    for (; i + 2 <= rowSize; i += 2)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + 8 * i));
+        for (int j = 7; j >= 0; --j)
+        {
+            int mask = _mm_movemask_epi8(v);
+            out[j * rowSize + i] = static_cast<uint8>(mask);
+            out[j * rowSize + i + 1] = static_cast<uint8>(mask >> 8);
+            v = _mm_slli_epi16(v, 1);
+        }
+    }
+    return i;
+}
+
+/*
+ * The 8 row bytes of 16 groups of 8 bytes are transposed to 8 vectors
+ * of 2 groups, each byte holding the 8 bits of an element for one bit,
+ * which movemask then gathers, as above.
+ */
+size_t untransposeBitsSse2(uint8 const * in, uint8 * out, size_t n, size_t first)
+{
+    size_t rowSize = n / 8;
+    size_t i = first;
+    for (; i + 16 <= rowSize; i += 16)
+    {
+        __m128i r[8];
+        for (size_t j = 0; j < 8; ++j)
+            r[j] = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + j * rowSize + i));
+
+        __m128i a[8], b[8], d[8];
+        for (size_t j = 0; j < 4; ++j) {
+            a[2 * j] = _mm_unpacklo_epi8(r[2 * j], r[2 * j + 1]);
+            a[2 * j + 1] = _mm_unpackhi_epi8(r[2 * j], r[2 * j + 1]);
+        }
+        for (size_t j = 0; j < 2; ++j) {
+            // rows 0-3 and 4-7 of groups 0-7 then 8-15
+            b[4 * j] = _mm_unpacklo_epi16(a[4 * j], a[4 * j + 2]);
+            b[4 * j + 1] = _mm_unpackhi_epi16(a[4 * j], a[4 * j + 2]);
+            b[4 * j + 2] = _mm_unpacklo_epi16(a[4 * j + 1], a[4 * j + 3]);
+            b[4 * j + 3] = _mm_unpackhi_epi16(a[4 * j + 1], a[4 * j + 3]);
+        }
+        for (size_t j = 0; j < 4; ++j) {
+            d[2 * j] = _mm_unpacklo_epi32(b[j], b[4 + j]);
+            d[2 * j + 1] = _mm_unpackhi_epi32(b[j], b[4 + j]);
+        }
+
+        for (size_t m = 0; m < 8; ++m)
+        {
+            uint8 * group = out + 8 * (i + 2 * m);
+            __m128i v = d[m];
+            for (int k = 7; k >= 0; --k)
+            {
+                int mask = _mm_movemask_epi8(v);
+                group[k] = static_cast<uint8>(mask);
+                group[8 + k] = static_cast<uint8>(mask >> 8);
+                v = _mm_slli_epi16(v, 1);
+            }
+        }
+    }
+    return i;
+}
+
+size_t transposeBytes2Sse2(uint8 const * in, uint8 * out, size_t n)
+{
+    __m128i const low = _mm_set1_epi16(0x00ff);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v0 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + 2 * i));
+        __m128i v1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + 2 * i + 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+            _mm_packus_epi16(_mm_and_si128(v0, low), _mm_and_si128(v1, low)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + n + i),
+            _mm_packus_epi16(_mm_srli_epi16(v0, 8), _mm_srli_epi16(v1, 8)));
+    }
+    return i;
+}
+
+size_t untransposeBytes2Sse2(uint8 const * in, uint8 * out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i p0 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+        __m128i p1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + n + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i), _mm_unpacklo_epi8(p0, p1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i + 16), _mm_unpackhi_epi8(p0, p1));
+    }
+    return i;
+}
+
+// even and odd bytes of a pair of vectors
+inline void splitBytes(__m128i v0, __m128i v1, __m128i & even, __m128i & odd)
+{
+    __m128i const low = _mm_set1_epi16(0x00ff);
+    even = _mm_packus_epi16(_mm_and_si128(v0, low), _mm_and_si128(v1, low));
+    odd = _mm_packus_epi16(_mm_srli_epi16(v0, 8), _mm_srli_epi16(v1, 8));
+}
+
+size_t transposeBytes4Sse2(uint8 const * in, uint8 * out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v[4];
+        for (size_t k = 0; k < 4; ++k)
+            v[k] = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + 4 * i + 16 * k));
+
+        // bytes 0 and 2, 1 and 3, of elements 0-7 then 8-15
+        __m128i even0, odd0, even1, odd1;
+        splitBytes(v[0], v[1], even0, odd0);
+        splitBytes(v[2], v[3], even1, odd1);
+
+        __m128i p0, p1, p2, p3;
+        splitBytes(even0, even1, p0, p2);
+        splitBytes(odd0, odd1, p1, p3);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), p0);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + n + i), p1);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * n + i), p2);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 3 * n + i), p3);
+    }
+    return i;
+}
+
+size_t untransposeBytes4Sse2(uint8 const * in, uint8 * out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i p0 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+        __m128i p1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + n + i));
+        __m128i p2 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + 2 * n + i));
+        __m128i p3 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + 3 * n + i));
+
+        __m128i low01 = _mm_unpacklo_epi8(p0, p1);
+        __m128i high01 = _mm_unpackhi_epi8(p0, p1);
+        __m128i low23 = _mm_unpacklo_epi8(p2, p3);
+        __m128i high23 = _mm_unpackhi_epi8(p2, p3);
+
+        __m128i * o = reinterpret_cast<__m128i *>(out + 4 * i);
+        _mm_storeu_si128(o, _mm_unpacklo_epi16(low01, low23));
+        _mm_storeu_si128(o + 1, _mm_unpackhi_epi16(low01, low23));
+        _mm_storeu_si128(o + 2, _mm_unpacklo_epi16(high01, high23));
+        _mm_storeu_si128(o + 3, _mm_unpackhi_epi16(high01, high23));
+    }
+    return i;
+}
+
+#endif
+
+#ifdef NT_AVX2
+
+__attribute__((target("avx2")))
+size_t transposeBitsAvx2(uint8 const * in, uint8 * out, size_t n)
+{
+    size_t rowSize = n / 8;
+    size_t i = 0;
+    for (; i + 4 <= rowSize; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(in + 8 * i));
+        for (int j = 7; j >= 0; --j)
+        {
+            uint32 mask = static_cast<uint32>(_mm256_movemask_epi8(v));
+            std::memcpy(out + j * rowSize + i, &mask, sizeof(mask));
+            v = _mm256_slli_epi16(v, 1);
+        }
+    }
+    return i;
+}
+
+bool hasAvx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+void transposeBits(uint8 const * in, uint8 * out, size_t n, NTBitshuffle::Kernel kernel)
+{
+    size_t first = 0;
+#ifdef NT_AVX2
+    if (kernel == NTBitshuffle::avx2)
+        first = transposeBitsAvx2(in, out, n);
+#endif
+#ifdef NT_SSE2
+    if (kernel != NTBitshuffle::scalar)
+        first = transposeBitsSse2(in, out, n, first);
+#endif
+    transposeBitsScalar(in, out, n, first);
+}
+
+// there is no AVX2 version, the 128-bit lanes of unpack do not help
+void untransposeBits(uint8 const * in, uint8 * out, size_t n, NTBitshuffle::Kernel kernel)
+{
+    size_t first = 0;
+#ifdef NT_SSE2
+    if (kernel != NTBitshuffle::scalar)
+        first = untransposeBitsSse2(in, out, n, first);
+#endif
+    untransposeBitsScalar(in, out, n, first);
+}
+
+void transposeBytes(uint8 const * in, uint8 * out, size_t n, size_t e, NTBitshuffle::Kernel kernel)
+{
+#ifdef NT_SSE2
+    if (kernel != NTBitshuffle::scalar && e == 2) {
+        transposeBytesScalar<2>(in, out, n, transposeBytes2Sse2(in, out, n));
+        return;
+    }
+    if (kernel != NTBitshuffle::scalar && e == 4) {
+        transposeBytesScalar<4>(in, out, n, transposeBytes4Sse2(in, out, n));
+        return;
+    }
+#endif
+    transposeBytesScalar(in, out, n, e);
+}
+
+void untransposeBytes(uint8 const * in, uint8 * out, size_t n, size_t e, NTBitshuffle::Kernel kernel)
+{
+#ifdef NT_SSE2
+    if (kernel != NTBitshuffle::scalar && e == 2) {
+        untransposeBytesScalar<2>(in, out, n, untransposeBytes2Sse2(in, out, n));
+        return;
+    }
+    if (kernel != NTBitshuffle::scalar && e == 4) {
+        untransposeBytesScalar<4>(in, out, n, untransposeBytes4Sse2(in, out, n));
+        return;
+    }
+#endif
+    untransposeBytesScalar(in, out, n, e);
+}
+
+// a block of n elements, n a multiple of 8
+void shuffleBlock(uint8 const * in, uint8 * out, size_t n, size_t e,
+    uint8 * scratch, NTBitshuffle::Kernel kernel)
+{
+    uint8 const * planes = in;
+    if (e > 1) {
+        transposeBytes(in, scratch, n, e, kernel);
+        planes = scratch;
+    }
+    for (size_t b = 0; b < e; ++b)
+        transposeBits(planes + b * n, out + b * n, n, kernel);
+}
+
+void unshuffleBlock(uint8 const * in, uint8 * out, size_t n, size_t e,
+    uint8 * scratch, NTBitshuffle::Kernel kernel)
+{
+    if (e == 1) {
+        untransposeBits(in, out, n, kernel);
+        return;
+    }
+    for (size_t b = 0; b < e; ++b)
+        untransposeBits(in + b * n, scratch + b * n, n, kernel);
+    untransposeBytes(scratch, out, n, e, kernel);
+}
+
+typedef void (*block_t)(uint8 const *, uint8 *, size_t, size_t, uint8 *, NTBitshuffle::Kernel);
+
+void transform(block_t block, uint8 const * in, uint8 * out, size_t count,
+    size_t elementSize, size_t blockSize, NTBitshuffle::Kernel kernel)
+{
+    if (blockSize == 0 || blockSize % 8 != 0)
+        throw std::runtime_error("bitshuffle block size is not a positive multiple of 8");
+    kernel = std::min(kernel, NTBitshuffle::getKernel());
+
+    std::vector<uint8> scratch;
+    if (count >= 8 && elementSize > 1)
+        scratch.resize(std::min(blockSize, count / 8 * 8) * elementSize);
+
+    size_t done = 0;
+    while (count - done >= 8)
+    {
+        size_t n = std::min(blockSize, (count - done) / 8 * 8);
+        block(in + done * elementSize, out + done * elementSize, n, elementSize,
+            scratch.empty() ? 0 : &scratch[0], kernel);
+        done += n;
+    }
+    std::memcpy(out + done * elementSize, in + done * elementSize,
+        (count - done) * elementSize);
+}
+
+}
+
+NTBitshuffle::Kernel NTBitshuffle::getKernel()
+{
+#ifdef NT_AVX2
+    static const bool avx2Supported = hasAvx2();
+    if (avx2Supported)
+        return avx2;
+#endif
+#ifdef NT_SSE2
+    return sse2;
+#else
+    return scalar;
+#endif
+}
+
+size_t NTBitshuffle::getDefaultBlockSize(size_t elementSize)
+{
+    return std::max<size_t>(DEFAULT_BLOCK_BYTES / elementSize / 8, 1) * 8;
+}
+
+void NTBitshuffle::shuffle(uint8 const * in, uint8 * out, size_t count,
+    size_t elementSize, size_t blockSize, Kernel kernel)
+{
+    transform(&shuffleBlock, in, out, count, elementSize, blockSize, kernel);
+}
+
+void NTBitshuffle::unshuffle(uint8 const * in, uint8 * out, size_t count,
+    size_t elementSize, size_t blockSize, Kernel kernel)
+{
+    transform(&unshuffleBlock, in, out, count, elementSize, blockSize, kernel);
+}
+
+}}
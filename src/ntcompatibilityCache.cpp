@@ -0,0 +1,106 @@
+/* ntcompatibilityCache.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#define epicsExportSharedSymbols
+#include <pv/ntcompatibilityCache.h>
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+const size_t NTCompatibilityCache::DEFAULT_CAPACITY;
+
+NTCompatibilityCache::NTCompatibilityCache(check_t check, size_t capacity)
+: check(check),
+  capacity(capacity),
+  hits(0),
+  misses(0)
+{
+}
+
+bool NTCompatibilityCache::isCompatible(StructureConstPtr const & structure)
+{
+    if (!structure)
+        return false;
+
+    {
+        Lock xx(mutex);
+        entries_t::const_iterator it = entries.find(structure.get());
+        if (it != entries.end()) {
+            ++hits;
+            return it->second.second;
+        }
+        ++misses;
+    }
+
+    // run the check unlocked so that misses on different
+    // structures do not serialize
+    bool compatible = check(structure);
+
+    Lock xx(mutex);
+    if (capacity != 0 && entries.find(structure.get()) == entries.end()) {
+        evict(capacity - 1);
+        entries[structure.get()] = entry_t(structure, compatible);
+        order.push_back(structure.get());
+    }
+
+    return compatible;
+}
+
+size_t NTCompatibilityCache::getHits() const
+{
+    Lock xx(mutex);
+    return hits;
+}
+
+size_t NTCompatibilityCache::getMisses() const
+{
+    Lock xx(mutex);
+    return misses;
+}
+
+size_t NTCompatibilityCache::size() const
+{
+    Lock xx(mutex);
+    return entries.size();
+}
+
+size_t NTCompatibilityCache::getCapacity() const
+{
+    Lock xx(mutex);
+    return capacity;
+}
+
+void NTCompatibilityCache::setCapacity(size_t capacity)
+{
+    Lock xx(mutex);
+    this->capacity = capacity;
+    evict(capacity);
+}
+
+void NTCompatibilityCache::clear()
+{
+    Lock xx(mutex);
+    entries.clear();
+    order.clear();
+}
+
+void NTCompatibilityCache::resetCounters()
+{
+    Lock xx(mutex);
+    hits = 0;
+    misses = 0;
+}
+
+void NTCompatibilityCache::evict(size_t maxSize)
+{
+    while (entries.size() > maxSize) {
+        entries.erase(order.front());
+        order.pop_front();
+    }
+}
+
+}}
@@ -4,11 +4,15 @@
  * found in the file LICENSE that is included with the distribution
  */
 
+#include <epicsThread.h>
+
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/ntcontinuum.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -21,6 +25,17 @@ namespace detail {
 
 StructureConstPtr NTContinuumBuilder::createStructure()
 {
+    StructureKey key(NTContinuum::URI);
+    key.add(descriptor).add(alarm).add(timeStamp).
+        add(extraFieldNames, extraFields);
+
+    StructureConstPtr s = StructureCache::find(key);
+    if (s)
+    {
+        reset();
+        return s;
+    }
+
     FieldBuilderPtr builder =
             getFieldCreate()->createFieldBuilder()->
                setId(NTContinuum::URI)->
@@ -42,7 +57,7 @@ StructureConstPtr NTContinuumBuilder::createStructure()
         builder->add(extraFieldNames[i], extraFields[i]);
 
 
-    StructureConstPtr s = builder->createStructure();
+    s = StructureCache::insert(key, builder->createStructure());
 
     reset();
     return s;
@@ -72,6 +87,11 @@ PVStructurePtr NTContinuumBuilder::createPVStructure()
     return getPVDataCreate()->createPVStructure(createStructure());
 }
 
+NTPrototypePtr NTContinuumBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTContinuumPtr NTContinuumBuilder::create()
 {
     return NTContinuumPtr(new NTContinuum(createPVStructure()));
@@ -100,10 +120,12 @@ NTContinuumBuilder::shared_pointer NTContinuumBuilder::add(string const & name,
 }
 
 const std::string NTContinuum::URI("epics:nt/NTContinuum:1.0");
+static const NTTypeKey uriKey(NTContinuum::URI);
 
 NTContinuum::shared_pointer NTContinuum::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntContinuum, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -114,7 +136,7 @@ NTContinuum::shared_pointer NTContinuum::wrapUnsafe(PVStructurePtr const & pvStr
 
 bool NTContinuum::is_a(StructureConstPtr const & structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTContinuum::is_a(PVStructurePtr const & pvStructure)
@@ -122,13 +144,8 @@ bool NTContinuum::is_a(PVStructurePtr const & pvStructure)
     return is_a(pvStructure->getStructure());
 }
 
-bool NTContinuum::isCompatible(StructureConstPtr const & structure)
+Result& NTContinuum::isCompatible(Result& result)
 {
-    if (!structure)
-        return false;
-
-    Result result(structure);
-
     return result
         .is<Structure>()
         .has<ScalarArray>("base")
@@ -136,19 +153,53 @@ bool NTContinuum::isCompatible(StructureConstPtr const & structure)
         .has<ScalarArray>("units")
         .maybeHas<Scalar>("descriptor")
         .maybeHas<&NTField::isAlarm, Structure>("alarm")
-        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp")
-        .valid();
+        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp");
+}
+
+bool NTContinuum::isCompatible(StructureConstPtr const & structure)
+{
+    NTStatistics::Probe probe(ntContinuum, NTStatistics::opIsCompatible);
+
+    if (!structure)
+        return probe.result(false);
+
+    static const ValidationPlan plan(&NTContinuum::isCompatible);
+
+    return probe.result(plan.validate(structure));
+}
+
+bool NTContinuum::isCompatible(StructureConstPtr const & structure, std::string & diagnostics)
+{
+    return diagnose(structure, &NTContinuum::isCompatible, diagnostics);
 }
 
 bool NTContinuum::isCompatible(PVStructurePtr const & pvStructure)
 {
     if(!pvStructure) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTContinuum::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTContinuum::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 bool NTContinuum::isValid()
 {
+    NTStatistics::Probe probe(ntContinuum, NTStatistics::opIsValid);
+
     return ((getUnits()->getLength()-1)*getBase()->getLength() ==
             getValue()->getLength());
 }
@@ -183,22 +234,22 @@ PVStructurePtr NTContinuum::getPVStructure() const
 
 PVStringPtr NTContinuum::getDescriptor() const
 {
-    return pvNTContinuum->getSubField<PVString>("descriptor");
+    return pvDescriptor;
 }
 
 PVStructurePtr NTContinuum::getTimeStamp() const
 {
-    return pvNTContinuum->getSubField<PVStructure>("timeStamp");
+    return pvTimeStamp;
 }
 
 PVStructurePtr NTContinuum::getAlarm() const
 {
-    return pvNTContinuum->getSubField<PVStructure>("alarm");
+    return pvAlarm;
 }
 
 PVDoubleArrayPtr NTContinuum::getBase() const
 {
-    return pvNTContinuum->getSubField<PVDoubleArray>("base");
+    return pvBase;
 }
 
 PVDoubleArrayPtr NTContinuum::getValue() const
@@ -208,12 +259,17 @@ PVDoubleArrayPtr NTContinuum::getValue() const
 
 PVStringArrayPtr NTContinuum::getUnits() const
 {
-    return pvNTContinuum->getSubField<PVStringArray>("units");
+    return pvUnits;
 }
 
 NTContinuum::NTContinuum(PVStructurePtr const & pvStructure) :
     pvNTContinuum(pvStructure),
-    pvValue(pvNTContinuum->getSubField<PVDoubleArray>("value"))
+    pvValue(pvNTContinuum->getSubField<PVDoubleArray>("value")),
+    pvDescriptor(pvNTContinuum->getSubField<PVString>("descriptor")),
+    pvTimeStamp(pvNTContinuum->getSubField<PVStructure>("timeStamp")),
+    pvAlarm(pvNTContinuum->getSubField<PVStructure>("alarm")),
+    pvBase(pvNTContinuum->getSubField<PVDoubleArray>("base")),
+    pvUnits(pvNTContinuum->getSubField<PVStringArray>("units"))
 {}
 
 
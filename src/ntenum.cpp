@@ -4,11 +4,15 @@
  * found in the file LICENSE that is included with the distribution
  */
 
+#include <epicsThread.h>
+
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/ntenum.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -22,6 +26,17 @@ namespace detail {
 
 StructureConstPtr NTEnumBuilder::createStructure()
 {
+    StructureKey key(NTEnum::URI);
+    key.add(descriptor).add(alarm).add(timeStamp).
+        add(extraFieldNames, extraFields);
+
+    StructureConstPtr s = StructureCache::find(key);
+    if (s)
+    {
+        reset();
+        return s;
+    }
+
     FieldBuilderPtr builder =
             getFieldCreate()->createFieldBuilder()->
                setId(NTEnum::URI)->
@@ -41,7 +56,7 @@ StructureConstPtr NTEnumBuilder::createStructure()
         builder->add(extraFieldNames[i], extraFields[i]);
 
 
-    StructureConstPtr s = builder->createStructure();
+    s = StructureCache::insert(key, builder->createStructure());
 
     reset();
     return s;
@@ -70,6 +85,11 @@ PVStructurePtr NTEnumBuilder::createPVStructure()
     return getPVDataCreate()->createPVStructure(createStructure());
 }
 
+NTPrototypePtr NTEnumBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTEnumPtr NTEnumBuilder::create()
 {
     return NTEnumPtr(new NTEnum(createPVStructure()));
@@ -99,10 +119,12 @@ NTEnumBuilder::shared_pointer NTEnumBuilder::add(string const & name, FieldConst
 }
 
 const std::string NTEnum::URI("epics:nt/NTEnum:1.0");
+static const NTTypeKey uriKey(NTEnum::URI);
 
 NTEnum::shared_pointer NTEnum::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntEnum, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -113,7 +135,7 @@ NTEnum::shared_pointer NTEnum::wrapUnsafe(PVStructurePtr const & pvStructure)
 
 bool NTEnum::is_a(StructureConstPtr const & structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTEnum::is_a(PVStructurePtr const & pvStructure)
@@ -121,32 +143,61 @@ bool NTEnum::is_a(PVStructurePtr const & pvStructure)
     return is_a(pvStructure->getStructure());
 }
 
-bool NTEnum::isCompatible(StructureConstPtr const &structure)
+Result& NTEnum::isCompatible(Result& result)
 {
-    if (!structure)
-        return false;
-
-    Result result(structure);
-
     return result
         .is<Structure>()
         .has<&NTField::isEnumerated, Structure>("value")
         .maybeHas<Scalar>("descriptor")
         .maybeHas<&NTField::isAlarm, Structure>("alarm")
-        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp")
-        .valid();
+        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp");
+}
+
+bool NTEnum::isCompatible(StructureConstPtr const &structure)
+{
+    NTStatistics::Probe probe(ntEnum, NTStatistics::opIsCompatible);
+
+    if (!structure)
+        return probe.result(false);
+
+    static const ValidationPlan plan(&NTEnum::isCompatible);
+
+    return probe.result(plan.validate(structure));
+}
+
+bool NTEnum::isCompatible(StructureConstPtr const &structure, std::string &diagnostics)
+{
+    return diagnose(structure, &NTEnum::isCompatible, diagnostics);
 }
 
 bool NTEnum::isCompatible(PVStructurePtr const & pvStructure)
 {
     if(!pvStructure) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTEnum::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTEnum::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 bool NTEnum::isValid()
 {
-    return true;
+    NTStatistics::Probe probe(ntEnum, NTStatistics::opIsValid);
+
+    return probe.result(true);
 }
 
 NTEnumBuilderPtr NTEnum::createBuilder()
@@ -179,17 +230,17 @@ PVStructurePtr NTEnum::getPVStructure() const
 
 PVStringPtr NTEnum::getDescriptor() const
 {
-    return pvNTEnum->getSubField<PVString>("descriptor");
+    return pvDescriptor;
 }
 
 PVStructurePtr NTEnum::getTimeStamp() const
 {
-    return pvNTEnum->getSubField<PVStructure>("timeStamp");
+    return pvTimeStamp;
 }
 
 PVStructurePtr NTEnum::getAlarm() const
 {
-    return pvNTEnum->getSubField<PVStructure>("alarm");
+    return pvAlarm;
 }
 
 PVStructurePtr NTEnum::getValue() const
@@ -198,7 +249,10 @@ PVStructurePtr NTEnum::getValue() const
 }
 
 NTEnum::NTEnum(PVStructurePtr const & pvStructure) :
-    pvNTEnum(pvStructure), pvValue(pvNTEnum->getSubField<PVStructure>("value"))
+    pvNTEnum(pvStructure), pvValue(pvNTEnum->getSubField<PVStructure>("value")),
+    pvDescriptor(pvNTEnum->getSubField<PVString>("descriptor")),
+    pvTimeStamp(pvNTEnum->getSubField<PVStructure>("timeStamp")),
+    pvAlarm(pvNTEnum->getSubField<PVStructure>("alarm"))
 {}
 
 
@@ -41,8 +41,8 @@ Result& NTField::isEnumerated(Result& result)
 
 bool NTField::isEnumerated(FieldConstPtr const & field)
 {
-    Result result(field);
-    return isEnumerated(result.is<Structure>()).valid();
+    static const ValidationPlan plan(&isA<Structure, &NTField::isEnumerated>);
+    return plan.validate(field);
 }
 
 Result& NTField::isTimeStamp(Result& result)
@@ -55,8 +55,8 @@ Result& NTField::isTimeStamp(Result& result)
 
 bool NTField::isTimeStamp(FieldConstPtr const & field)
 {
-    Result result(field);
-    return isTimeStamp(result.is<Structure>()).valid();
+    static const ValidationPlan plan(&isA<Structure, &NTField::isTimeStamp>);
+    return plan.validate(field);
 }
 
 Result& NTField::isAlarm(Result& result)
@@ -69,8 +69,8 @@ Result& NTField::isAlarm(Result& result)
 
 bool NTField::isAlarm(FieldConstPtr const & field)
 {
-    Result result(field);
-    return isAlarm(result.is<Structure>()).valid();
+    static const ValidationPlan plan(&isA<Structure, &NTField::isAlarm>);
+    return plan.validate(field);
 }
 
 Result& NTField::isDisplay(Result& result)
@@ -86,8 +86,8 @@ Result& NTField::isDisplay(Result& result)
 
 bool NTField::isDisplay(FieldConstPtr const & field)
 {
-    Result result(field);
-    return isDisplay(result.is<Structure>()).valid();
+    static const ValidationPlan plan(&isA<Structure, &NTField::isDisplay>);
+    return plan.validate(field);
 }
 
 Result& NTField::isAlarmLimit(Result& result)
@@ -107,8 +107,8 @@ Result& NTField::isAlarmLimit(Result& result)
 
 bool NTField::isAlarmLimit(FieldConstPtr const & field)
 {
-    Result result(field);
-    return isAlarmLimit(result.is<Structure>()).valid();
+    static const ValidationPlan plan(&isA<Structure, &NTField::isAlarmLimit>);
+    return plan.validate(field);
 }
 
 Result& NTField::isControl(Result& result)
@@ -121,8 +121,8 @@ Result& NTField::isControl(Result& result)
 
 bool NTField::isControl(FieldConstPtr const & field)
 {
-    Result result(field);
-    return isControl(result.is<Structure>()).valid();
+    static const ValidationPlan plan(&isA<Structure, &NTField::isControl>);
+    return plan.validate(field);
 }
 
 StructureConstPtr NTField::createEnumerated()
@@ -0,0 +1,198 @@
+/* ntfingerprint.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <map>
+#include <stdio.h>
+
+#include <epicsThread.h>
+#include <pv/lock.h>
+
+#define epicsExportSharedSymbols
+#include <pv/ntfingerprint.h>
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+const size_t NTFingerprint::CACHE_CAPACITY;
+
+namespace {
+
+/*
+ * FNV-1a with 128-bit state. The prime is 2^88 + 0x13B, so the product
+ * is the state times 0x13B plus the low half shifted left by 88 bits.
+ */
+class Hasher
+{
+public:
+    Hasher()
+    : high(word(0x6c62272eu, 0x07bb0142u)), low(word(0x62b82175u, 0x6295c58du)) {}
+
+    void add(unsigned char byte)
+    {
+        low ^= byte;
+
+        epicsUInt64 p0 = (low & 0xffffffffu) * 0x13B;
+        epicsUInt64 p1 = (low >> 32) * 0x13B + (p0 >> 32);
+        epicsUInt64 newLow = (p0 & 0xffffffffu) | (p1 << 32);
+        high = high * 0x13B + (p1 >> 32) + (low << 24);
+        low = newLow;
+    }
+
+    void add(size_t value)
+    {
+        epicsUInt64 v = value;
+        for (int i = 0; i < 8; ++i, v >>= 8)
+            add(static_cast<unsigned char>(v & 0xff));
+    }
+
+    // length prefixed, so that adjacent strings can not run into each other
+    void add(std::string const & s)
+    {
+        add(s.size());
+        for (size_t i = 0; i < s.size(); ++i)
+            add(static_cast<unsigned char>(s[i]));
+    }
+
+    NTFingerprint get() const { return NTFingerprint(high, low); }
+
+private:
+    static epicsUInt64 word(epicsUInt32 high, epicsUInt32 low)
+    {
+        return (static_cast<epicsUInt64>(high) << 32) | low;
+    }
+
+    epicsUInt64 high;
+    epicsUInt64 low;
+};
+
+void hashField(Hasher & hasher, Field const & field)
+{
+    Type type = field.getType();
+    hasher.add(static_cast<unsigned char>(type));
+    hasher.add(field.getID());
+
+    switch (type)
+    {
+    case scalar:
+        hasher.add(static_cast<unsigned char>(
+            static_cast<Scalar const &>(field).getScalarType()));
+        break;
+    case scalarArray:
+        hasher.add(static_cast<unsigned char>(
+            static_cast<ScalarArray const &>(field).getElementType()));
+        break;
+    case structure:
+    {
+        Structure const & s = static_cast<Structure const &>(field);
+        size_t n = s.getNumberFields();
+        hasher.add(n);
+        for (size_t i = 0; i < n; ++i) {
+            hasher.add(s.getFieldName(i));
+            hashField(hasher, *s.getField(i));
+        }
+        break;
+    }
+    case structureArray:
+        hashField(hasher, *static_cast<StructureArray const &>(field).getStructure());
+        break;
+    case union_:
+    {
+        Union const & u = static_cast<Union const &>(field);
+        size_t n = u.getNumberFields();
+        hasher.add(n);
+        for (size_t i = 0; i < n; ++i) {
+            hasher.add(u.getFieldName(i));
+            hashField(hasher, *u.getField(i));
+        }
+        break;
+    }
+    case unionArray:
+        hashField(hasher, *static_cast<UnionArray const &>(field).getUnion());
+        break;
+    }
+}
+
+typedef std::map<Field const *, std::pair<FieldConstPtr, NTFingerprint> > fingerprints_t;
+
+struct FingerprintCache
+{
+    Mutex mutex;
+    fingerprints_t fingerprints;
+};
+
+FingerprintCache * fingerprintCache = 0;
+epicsThreadOnceId fingerprintCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+void createFingerprintCache(void *)
+{
+    fingerprintCache = new FingerprintCache();
+}
+
+FingerprintCache & getFingerprintCache()
+{
+    epicsThreadOnce(&fingerprintCacheOnce, &createFingerprintCache, 0);
+    return *fingerprintCache;
+}
+
+}
+
+NTFingerprint NTFingerprint::compute(FieldConstPtr const & field)
+{
+    if (!field)
+        return NTFingerprint();
+
+    Hasher hasher;
+    hashField(hasher, *field);
+    return hasher.get();
+}
+
+NTFingerprint NTFingerprint::get(FieldConstPtr const & field)
+{
+    if (!field)
+        return NTFingerprint();
+
+    FingerprintCache & cache = getFingerprintCache();
+    {
+        Lock xx(cache.mutex);
+        fingerprints_t::const_iterator it = cache.fingerprints.find(field.get());
+        if (it != cache.fingerprints.end())
+            return it->second.second;
+    }
+
+    NTFingerprint fingerprint = compute(field);
+
+    Lock xx(cache.mutex);
+    if (cache.fingerprints.size() < CACHE_CAPACITY)
+        cache.fingerprints.insert(fingerprints_t::value_type(field.get(),
+            std::make_pair(field, fingerprint)));
+    return fingerprint;
+}
+
+size_t NTFingerprint::getCacheSize()
+{
+    FingerprintCache & cache = getFingerprintCache();
+    Lock xx(cache.mutex);
+    return cache.fingerprints.size();
+}
+
+void NTFingerprint::clearCache()
+{
+    FingerprintCache & cache = getFingerprintCache();
+    Lock xx(cache.mutex);
+    cache.fingerprints.clear();
+}
+
+std::string NTFingerprint::toString() const
+{
+    char buffer[33];
+    sprintf(buffer, "%08x%08x%08x%08x",
+        static_cast<unsigned>(high >> 32), static_cast<unsigned>(high & 0xffffffffu),
+        static_cast<unsigned>(low >> 32), static_cast<unsigned>(low & 0xffffffffu));
+    return buffer;
+}
+
+}}
@@ -4,11 +4,15 @@
  * found in the file LICENSE that is included with the distribution
  */
 
+#include <epicsThread.h>
+
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/nthistogram.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -34,6 +38,17 @@ StructureConstPtr NTHistogramBuilder::createStructure()
     if (!valueTypeSet)
         throw std::runtime_error("value array element type not set");
 
+    StructureKey key(NTHistogram::URI);
+    key.add(valueType).add(descriptor).add(alarm).add(timeStamp).
+        add(extraFieldNames, extraFields);
+
+    StructureConstPtr s = StructureCache::find(key);
+    if (s)
+    {
+        reset();
+        return s;
+    }
+
     FieldBuilderPtr builder =
             getFieldCreate()->createFieldBuilder()->
                setId(NTHistogram::URI)->
@@ -54,7 +69,7 @@ StructureConstPtr NTHistogramBuilder::createStructure()
         builder->add(extraFieldNames[i], extraFields[i]);
 
 
-    StructureConstPtr s = builder->createStructure();
+    s = StructureCache::insert(key, builder->createStructure());
 
     reset();
     return s;
@@ -84,6 +99,11 @@ PVStructurePtr NTHistogramBuilder::createPVStructure()
     return getPVDataCreate()->createPVStructure(createStructure());
 }
 
+NTPrototypePtr NTHistogramBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTHistogramPtr NTHistogramBuilder::create()
 {
     return NTHistogramPtr(new NTHistogram(createPVStructure()));
@@ -113,10 +133,12 @@ NTHistogramBuilder::shared_pointer NTHistogramBuilder::add(string const & name,
 }
 
 const std::string NTHistogram::URI("epics:nt/NTHistogram:1.0");
+static const NTTypeKey uriKey(NTHistogram::URI);
 
 NTHistogram::shared_pointer NTHistogram::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntHistogram, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -127,7 +149,7 @@ NTHistogram::shared_pointer NTHistogram::wrapUnsafe(PVStructurePtr const & pvStr
 
 bool NTHistogram::is_a(StructureConstPtr const & structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTHistogram::is_a(PVStructurePtr const & pvStructure)
@@ -135,33 +157,62 @@ bool NTHistogram::is_a(PVStructurePtr const & pvStructure)
     return is_a(pvStructure->getStructure());
 }
 
-bool NTHistogram::isCompatible(StructureConstPtr const &structure)
+Result& NTHistogram::isCompatible(Result& result)
 {
-    if (!structure)
-        return false;
-
-    Result result(structure);
-
     return result
         .is<Structure>()
         .has<ScalarArray>("ranges")
         .has<ScalarArray>("value")
         .maybeHas<Scalar>("descriptor")
         .maybeHas<&NTField::isAlarm, Structure>("alarm")
-        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp")
-        .valid();
+        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp");
+}
+
+bool NTHistogram::isCompatible(StructureConstPtr const &structure)
+{
+    NTStatistics::Probe probe(ntHistogram, NTStatistics::opIsCompatible);
+
+    if (!structure)
+        return probe.result(false);
+
+    static const ValidationPlan plan(&NTHistogram::isCompatible);
+
+    return probe.result(plan.validate(structure));
+}
+
+bool NTHistogram::isCompatible(StructureConstPtr const &structure, std::string &diagnostics)
+{
+    return diagnose(structure, &NTHistogram::isCompatible, diagnostics);
 }
 
 bool NTHistogram::isCompatible(PVStructurePtr const & pvStructure)
 {
     if(!pvStructure.get()) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTHistogram::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTHistogram::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 bool NTHistogram::isValid()
 {
-    return (getValue()->getLength()+1 == getRanges()->getLength());
+    NTStatistics::Probe probe(ntHistogram, NTStatistics::opIsValid);
+
+    return probe.result((getValue()->getLength()+1 == getRanges()->getLength()));
 }
 
 NTHistogramBuilderPtr NTHistogram::createBuilder()
@@ -194,22 +245,22 @@ PVStructurePtr NTHistogram::getPVStructure() const
 
 PVStringPtr NTHistogram::getDescriptor() const
 {
-    return pvNTHistogram->getSubField<PVString>("descriptor");
+    return pvDescriptor;
 }
 
 PVStructurePtr NTHistogram::getTimeStamp() const
 {
-    return pvNTHistogram->getSubField<PVStructure>("timeStamp");
+    return pvTimeStamp;
 }
 
 PVStructurePtr NTHistogram::getAlarm() const
 {
-    return pvNTHistogram->getSubField<PVStructure>("alarm");
+    return pvAlarm;
 }
 
 PVDoubleArrayPtr NTHistogram::getRanges() const
 {
-    return pvNTHistogram->getSubField<PVDoubleArray>("ranges");
+    return pvRanges;
 }
 
 PVScalarArrayPtr NTHistogram::getValue() const
@@ -219,7 +270,11 @@ PVScalarArrayPtr NTHistogram::getValue() const
 
 NTHistogram::NTHistogram(PVStructurePtr const & pvStructure) :
     pvNTHistogram(pvStructure),
-    pvValue(pvNTHistogram->getSubField<PVScalarArray>("value"))
+    pvValue(pvNTHistogram->getSubField<PVScalarArray>("value")),
+    pvDescriptor(pvNTHistogram->getSubField<PVString>("descriptor")),
+    pvTimeStamp(pvNTHistogram->getSubField<PVStructure>("timeStamp")),
+    pvAlarm(pvNTHistogram->getSubField<PVStructure>("alarm")),
+    pvRanges(pvNTHistogram->getSubField<PVDoubleArray>("ranges"))
 {}
 
 
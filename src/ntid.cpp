@@ -4,8 +4,15 @@
  * found in the file LICENSE that is included with the distribution
  */
 
-#include <pv/ntid.h>
+#include <map>
+
+#include <epicsThread.h>
+
 #include <pv/typeCast.h>
+#include <pv/lock.h>
+
+#define epicsExportSharedSymbols
+#include <pv/ntid.h>
 
 namespace epics {
 
@@ -185,4 +192,120 @@ namespace nt {
     }
 
 
+    namespace {
+
+        bool parseVersion(const std::string & str, int & value)
+        {
+            try {
+                using pvData::detail::parseToPOD;
+                uint32_t v;
+                parseToPOD(str, &v);
+                value = static_cast<int>(v);
+                return true;
+            } catch (...) {
+                return false;
+            }
+        }
+
+        typedef std::map<std::string, NTParsedID::const_shared_pointer> parsedIDs_t;
+
+        struct ParsedIDCache
+        {
+            pvData::Mutex mutex;
+            parsedIDs_t ids;
+        };
+
+        ParsedIDCache * parsedIDCache = 0;
+        epicsThreadOnceId parsedIDCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+        void createParsedIDCache(void *)
+        {
+            parsedIDCache = new ParsedIDCache();
+        }
+
+        ParsedIDCache & getParsedIDCache()
+        {
+            epicsThreadOnce(&parsedIDCacheOnce, &createParsedIDCache, 0);
+            return *parsedIDCache;
+        }
+    }
+
+    const size_t NTParsedID::CACHE_CAPACITY;
+
+    NTParsedID::NTParsedID(const std::string & id)
+    : fullName(id),
+      hasMajor(false),
+      majorVersion(0),
+      hasMinor(false),
+      minorVersion(0)
+    {
+        size_t nsSepIndex = id.find('/');
+        bool nsQualified = nsSepIndex != std::string::npos;
+        size_t startIndex = nsQualified ? nsSepIndex+1 : 0;
+        size_t versionSepIndex = id.find(':', startIndex);
+        bool hasVersion = versionSepIndex != std::string::npos;
+
+        if (nsQualified)
+            namespaceStr = Part(0, nsSepIndex);
+
+        if (hasVersion)
+        {
+            qualifiedName = Part(0, versionSepIndex);
+            name = Part(startIndex, versionSepIndex-startIndex);
+            version = Part(versionSepIndex+1, id.size()-(versionSepIndex+1));
+
+            size_t endMajorIndex = id.find('.', versionSepIndex+1);
+            majorVersionStr = Part(versionSepIndex+1,
+                ((endMajorIndex != std::string::npos) ? endMajorIndex : id.size())-(versionSepIndex+1));
+            hasMajor = parseVersion(substr(majorVersionStr), majorVersion);
+
+            if (endMajorIndex != std::string::npos)
+            {
+                size_t endMinorIndex = id.find('.', endMajorIndex+1);
+                minorVersionStr = Part(endMajorIndex+1,
+                    ((endMinorIndex != std::string::npos) ? endMinorIndex : id.size())-(endMajorIndex+1));
+            }
+            hasMinor = parseVersion(substr(minorVersionStr), minorVersion);
+        }
+        else
+        {
+            qualifiedName = Part(0, id.size());
+            name = Part(startIndex, id.size()-startIndex);
+        }
+    }
+
+    NTParsedID::const_shared_pointer NTParsedID::get(const std::string & id)
+    {
+        ParsedIDCache & cache = getParsedIDCache();
+        {
+            pvData::Lock xx(cache.mutex);
+            parsedIDs_t::const_iterator it = cache.ids.find(id);
+            if (it != cache.ids.end())
+                return it->second;
+        }
+
+        const_shared_pointer parsed(new NTParsedID(id));
+
+        pvData::Lock xx(cache.mutex);
+        // another thread may have cached the ID meanwhile
+        if (cache.ids.size() < CACHE_CAPACITY)
+            return cache.ids.insert(parsedIDs_t::value_type(id, parsed)).first->second;
+        return parsed;
+    }
+
+    size_t NTParsedID::getCacheSize()
+    {
+        ParsedIDCache & cache = getParsedIDCache();
+        pvData::Lock xx(cache.mutex);
+        return cache.ids.size();
+    }
+
+    void NTParsedID::clearCache()
+    {
+        ParsedIDCache & cache = getParsedIDCache();
+        pvData::Lock xx(cache.mutex);
+        cache.ids.clear();
+    }
+
+
 }}
@@ -4,11 +4,15 @@
  * found in the file LICENSE that is included with the distribution
  */
 
+#include <epicsThread.h>
+
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/ntmatrix.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -21,6 +25,17 @@ namespace detail {
 
 StructureConstPtr NTMatrixBuilder::createStructure()
 {
+    StructureKey key(NTMatrix::URI);
+    key.add(dim).add(descriptor).add(alarm).add(timeStamp).add(display).
+        add(extraFieldNames, extraFields);
+
+    StructureConstPtr s = StructureCache::find(key);
+    if (s)
+    {
+        reset();
+        return s;
+    }
+
     FieldBuilderPtr builder =
             getFieldCreate()->createFieldBuilder()->
                setId(NTMatrix::URI)->
@@ -46,7 +61,7 @@ StructureConstPtr NTMatrixBuilder::createStructure()
         builder->add(extraFieldNames[i], extraFields[i]);
 
 
-    StructureConstPtr s = builder->createStructure();
+    s = StructureCache::insert(key, builder->createStructure());
 
     reset();
     return s;
@@ -87,6 +102,11 @@ PVStructurePtr NTMatrixBuilder::createPVStructure()
     return getPVDataCreate()->createPVStructure(createStructure());
 }
 
+NTPrototypePtr NTMatrixBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTMatrixPtr NTMatrixBuilder::create()
 {
     return NTMatrixPtr(new NTMatrix(createPVStructure()));
@@ -117,10 +137,12 @@ NTMatrixBuilder::shared_pointer NTMatrixBuilder::add(string const & name, FieldC
 }
 
 const std::string NTMatrix::URI("epics:nt/NTMatrix:1.0");
+static const NTTypeKey uriKey(NTMatrix::URI);
 
 NTMatrix::shared_pointer NTMatrix::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntMatrix, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -131,7 +153,7 @@ NTMatrix::shared_pointer NTMatrix::wrapUnsafe(PVStructurePtr const & pvStructure
 
 bool NTMatrix::is_a(StructureConstPtr const & structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTMatrix::is_a(PVStructurePtr const & pvStructure)
@@ -139,13 +161,8 @@ bool NTMatrix::is_a(PVStructurePtr const & pvStructure)
     return is_a(pvStructure->getStructure());
 }
 
-bool NTMatrix::isCompatible(StructureConstPtr const & structure)
+Result& NTMatrix::isCompatible(Result& result)
 {
-    if (!structure)
-        return false;
-
-    Result result(structure);
-
     return result
         .is<Structure>()
         .has<ScalarArray>("value")
@@ -153,29 +170,63 @@ bool NTMatrix::isCompatible(StructureConstPtr const & structure)
         .maybeHas<Scalar>("descriptor")
         .maybeHas<&NTField::isAlarm, Structure>("alarm")
         .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp")
-        .maybeHas<&NTField::isDisplay, Structure>("display")
-        .valid();
+        .maybeHas<&NTField::isDisplay, Structure>("display");
+}
+
+bool NTMatrix::isCompatible(StructureConstPtr const & structure)
+{
+    NTStatistics::Probe probe(ntMatrix, NTStatistics::opIsCompatible);
+
+    if (!structure)
+        return probe.result(false);
+
+    static const ValidationPlan plan(&NTMatrix::isCompatible);
+
+    return probe.result(plan.validate(structure));
+}
+
+bool NTMatrix::isCompatible(StructureConstPtr const & structure, std::string & diagnostics)
+{
+    return diagnose(structure, &NTMatrix::isCompatible, diagnostics);
 }
 
 bool NTMatrix::isCompatible(PVStructurePtr const & pvStructure)
 {
     if(!pvStructure) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTMatrix::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTMatrix::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 bool NTMatrix::isValid()
 {
+    NTStatistics::Probe probe(ntMatrix, NTStatistics::opIsValid);
+
     int valueLength = getValue()->getLength();
     if (valueLength == 0)
-        return false;
+        return probe.result(false);
 
     PVIntArrayPtr pvDim = getDim();
     if (pvDim.get())
     {
         int length = pvDim->getLength();
         if (length != 1 && length !=2)
-            return false;
+            return probe.result(false);
 
         PVIntArray::const_svector data = pvDim->view();
         int expectedLength = 1;
@@ -185,9 +236,9 @@ bool NTMatrix::isValid()
              expectedLength *= *it;
         }
         if (expectedLength != valueLength)
-        return false;
+        return probe.result(false);
     }
-    return true;
+    return probe.result(true);
 }
 
 NTMatrixBuilderPtr NTMatrix::createBuilder()
@@ -229,22 +280,22 @@ PVStructurePtr NTMatrix::getPVStructure() const
 
 PVStringPtr NTMatrix::getDescriptor() const
 {
-    return pvNTMatrix->getSubField<PVString>("descriptor");
+    return pvDescriptor;
 }
 
 PVStructurePtr NTMatrix::getTimeStamp() const
 {
-    return pvNTMatrix->getSubField<PVStructure>("timeStamp");
+    return pvTimeStamp;
 }
 
 PVStructurePtr NTMatrix::getAlarm() const
 {
-    return pvNTMatrix->getSubField<PVStructure>("alarm");
+    return pvAlarm;
 }
 
 PVStructurePtr NTMatrix::getDisplay() const
 {
-    return pvNTMatrix->getSubField<PVStructure>("display");
+    return pvDisplay;
 }
 
 PVDoubleArrayPtr NTMatrix::getValue() const
@@ -254,12 +305,17 @@ PVDoubleArrayPtr NTMatrix::getValue() const
 
 PVIntArrayPtr NTMatrix::getDim() const
 {
-    return pvNTMatrix->getSubField<PVIntArray>("dim");
+    return pvDim;
 }
 
 NTMatrix::NTMatrix(PVStructurePtr const & pvStructure) :
     pvNTMatrix(pvStructure),
-    pvValue(pvNTMatrix->getSubField<PVDoubleArray>("value"))
+    pvValue(pvNTMatrix->getSubField<PVDoubleArray>("value")),
+    pvDescriptor(pvNTMatrix->getSubField<PVString>("descriptor")),
+    pvTimeStamp(pvNTMatrix->getSubField<PVStructure>("timeStamp")),
+    pvAlarm(pvNTMatrix->getSubField<PVStructure>("alarm")),
+    pvDisplay(pvNTMatrix->getSubField<PVStructure>("display")),
+    pvDim(pvNTMatrix->getSubField<PVIntArray>("dim"))
 {}
 
 
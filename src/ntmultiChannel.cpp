@@ -6,11 +6,15 @@
 
 #include <algorithm>
 
+#include <epicsThread.h>
+
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/ntmultiChannel.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -93,6 +97,19 @@ NTMultiChannelBuilder::shared_pointer NTMultiChannelBuilder::addIsConnected()
 
 StructureConstPtr NTMultiChannelBuilder::createStructure()
 {
+    StructureKey key(NTMultiChannel::URI);
+    key.add(valueType).add(descriptor).add(alarm).add(timeStamp).
+        add(severity).add(status).add(message).add(secondsPastEpoch).
+        add(nanoseconds).add(userTag).add(isConnected).
+        add(extraFieldNames, extraFields);
+
+    StructureConstPtr st = StructureCache::find(key);
+    if (st)
+    {
+        reset();
+        return st;
+    }
+
     StandardFieldPtr standardField = getStandardField();
     size_t nfields = 2;
     size_t extraCount = extraFieldNames.size();
@@ -163,7 +180,8 @@ StructureConstPtr NTMultiChannelBuilder::createStructure()
         fields[ind++] = extraFields[i];
     }
 
-    StructureConstPtr st = fieldCreate->createStructure(NTMultiChannel::URI,names,fields);
+    st = StructureCache::insert(key,
+        fieldCreate->createStructure(NTMultiChannel::URI,names,fields));
     reset();
     return st;
 }
@@ -173,6 +191,11 @@ PVStructurePtr NTMultiChannelBuilder::createPVStructure()
     return pvDataCreate->createPVStructure(createStructure());
 }
 
+NTPrototypePtr NTMultiChannelBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTMultiChannelPtr NTMultiChannelBuilder::create()
 {
     return NTMultiChannelPtr(new NTMultiChannel(createPVStructure()));
@@ -210,10 +233,12 @@ NTMultiChannelBuilder::shared_pointer NTMultiChannelBuilder::add(string const &
 }
 
 const std::string NTMultiChannel::URI("epics:nt/NTMultiChannel:1.0");
+static const NTTypeKey uriKey(NTMultiChannel::URI);
 
 NTMultiChannel::shared_pointer NTMultiChannel::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntMultiChannel, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -224,7 +249,7 @@ NTMultiChannel::shared_pointer NTMultiChannel::wrapUnsafe(PVStructurePtr const &
 
 bool NTMultiChannel::is_a(StructureConstPtr const &structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTMultiChannel::is_a(PVStructurePtr const & pvStructure)
@@ -232,13 +257,8 @@ bool NTMultiChannel::is_a(PVStructurePtr const & pvStructure)
     return is_a(pvStructure->getStructure());
 }
 
-bool NTMultiChannel::isCompatible(StructureConstPtr const & structure)
+Result& NTMultiChannel::isCompatible(Result& result)
 {
-    if (!structure)
-        return false;
-
-    Result result(structure);
-
     return result
         .is<Structure>()
         .has<UnionArray>("value")
@@ -251,22 +271,56 @@ bool NTMultiChannel::isCompatible(StructureConstPtr const & structure)
         .maybeHas<ScalarArray>("userTag")
         .maybeHas<Scalar>("descriptor")
         .maybeHas<&NTField::isAlarm, Structure>("alarm")
-        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp")
-        .valid();
+        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp");
+}
+
+bool NTMultiChannel::isCompatible(StructureConstPtr const & structure)
+{
+    NTStatistics::Probe probe(ntMultiChannel, NTStatistics::opIsCompatible);
+
+    if (!structure)
+        return probe.result(false);
+
+    static const ValidationPlan plan(&NTMultiChannel::isCompatible);
+
+    return probe.result(plan.validate(structure));
+}
+
+bool NTMultiChannel::isCompatible(StructureConstPtr const & structure, std::string & diagnostics)
+{
+    return diagnose(structure, &NTMultiChannel::isCompatible, diagnostics);
 }
 
 bool NTMultiChannel::isCompatible(PVStructurePtr const &pvStructure)
 {
     if(!pvStructure.get()) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTMultiChannel::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTMultiChannel::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 
 bool NTMultiChannel::isValid()
 {
+    NTStatistics::Probe probe(ntMultiChannel, NTStatistics::opIsValid);
+
     size_t valueLength = getValue()->getLength();
-    if (getChannelName()->getLength() != valueLength) return false;
+    if (getChannelName()->getLength() != valueLength) return probe.result(false);
 
     PVScalarArrayPtr arrayFields[] = {
           getSeverity(), getStatus(), getMessage(),
@@ -279,9 +333,9 @@ bool NTMultiChannel::isValid()
     {
         arrayField = *pa;
         if (arrayField.get() && arrayField->getLength() != valueLength)
-            return false;
+            return probe.result(false);
     }
-    return true;
+    return probe.result(true);
 }
 
 
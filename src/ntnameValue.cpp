@@ -4,11 +4,15 @@
  * found in the file LICENSE that is included with the distribution
  */
 
+#include <epicsThread.h>
+
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/ntnameValue.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -34,6 +38,17 @@ StructureConstPtr NTNameValueBuilder::createStructure()
     if (!valueTypeSet)
         throw std::runtime_error("value type not set");
 
+    StructureKey key(NTNameValue::URI);
+    key.add(valueType).add(descriptor).add(alarm).add(timeStamp).
+        add(extraFieldNames, extraFields);
+
+    StructureConstPtr s = StructureCache::find(key);
+    if (s)
+    {
+        reset();
+        return s;
+    }
+
     FieldBuilderPtr builder =
             getFieldCreate()->createFieldBuilder()->
                setId(NTNameValue::URI)->
@@ -53,7 +68,7 @@ StructureConstPtr NTNameValueBuilder::createStructure()
     for (size_t i = 0; i< extraCount; i++)
         builder->add(extraFieldNames[i], extraFields[i]);
 
-    StructureConstPtr s = builder->createStructure();
+    s = StructureCache::insert(key, builder->createStructure());
 
     reset();
     return s;
@@ -82,6 +97,11 @@ PVStructurePtr NTNameValueBuilder::createPVStructure()
     return getPVDataCreate()->createPVStructure(createStructure());
 }
 
+NTPrototypePtr NTNameValueBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTNameValuePtr NTNameValueBuilder::create()
 {
     return NTNameValuePtr(new NTNameValue(createPVStructure()));
@@ -112,10 +132,12 @@ NTNameValueBuilder::shared_pointer NTNameValueBuilder::add(string const & name,
 }
 
 const std::string NTNameValue::URI("epics:nt/NTNameValue:1.0");
+static const NTTypeKey uriKey(NTNameValue::URI);
 
 NTNameValue::shared_pointer NTNameValue::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntNameValue, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -126,7 +148,7 @@ NTNameValue::shared_pointer NTNameValue::wrapUnsafe(PVStructurePtr const & struc
 
 bool NTNameValue::is_a(StructureConstPtr const & structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTNameValue::is_a(PVStructurePtr const & pvStructure)
@@ -134,33 +156,62 @@ bool NTNameValue::is_a(PVStructurePtr const & pvStructure)
     return is_a(pvStructure->getStructure());
 }
 
-bool NTNameValue::isCompatible(StructureConstPtr const & structure)
+Result& NTNameValue::isCompatible(Result& result)
 {
-    if (!structure)
-        return false;
-
-    Result result(structure);
-
     return result
         .is<Structure>()
         .has<ScalarArray>("name")
         .has<ScalarArray>("value")
         .maybeHas<Scalar>("descriptor")
         .maybeHas<&NTField::isAlarm, Structure>("alarm")
-        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp")
-        .valid();
+        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp");
+}
+
+bool NTNameValue::isCompatible(StructureConstPtr const & structure)
+{
+    NTStatistics::Probe probe(ntNameValue, NTStatistics::opIsCompatible);
+
+    if (!structure)
+        return probe.result(false);
+
+    static const ValidationPlan plan(&NTNameValue::isCompatible);
+
+    return probe.result(plan.validate(structure));
+}
+
+bool NTNameValue::isCompatible(StructureConstPtr const & structure, std::string & diagnostics)
+{
+    return diagnose(structure, &NTNameValue::isCompatible, diagnostics);
 }
 
 bool NTNameValue::isCompatible(PVStructurePtr const & pvStructure)
 {
     if(!pvStructure) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTNameValue::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTNameValue::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 bool NTNameValue::isValid()
 {
-    return (getValue<PVScalarArray>()->getLength() == getName()->getLength());
+    NTStatistics::Probe probe(ntNameValue, NTStatistics::opIsValid);
+
+    return probe.result((getValue<PVScalarArray>()->getLength() == getName()->getLength()));
 }
 
 NTNameValueBuilderPtr NTNameValue::createBuilder()
@@ -193,31 +244,36 @@ PVStructurePtr NTNameValue::getPVStructure() const
 
 PVStringPtr NTNameValue::getDescriptor() const
 {
-    return pvNTNameValue->getSubField<PVString>("descriptor");
+    return pvDescriptor;
 }
 
 PVStructurePtr NTNameValue::getTimeStamp() const
 {
-    return pvNTNameValue->getSubField<PVStructure>("timeStamp");
+    return pvTimeStamp;
 }
 
 PVStructurePtr NTNameValue::getAlarm() const
 {
-    return pvNTNameValue->getSubField<PVStructure>("alarm");
+    return pvAlarm;
 }
 
 PVStringArrayPtr NTNameValue::getName() const
 {
-    return pvNTNameValue->getSubField<PVStringArray>("name");
+    return pvName;
 }
 
 PVFieldPtr NTNameValue::getValue() const
 {
-    return pvNTNameValue->getSubField("value");
+    return pvValue;
 }
 
 NTNameValue::NTNameValue(PVStructurePtr const & pvStructure) :
-    pvNTNameValue(pvStructure)
+    pvNTNameValue(pvStructure),
+    pvDescriptor(pvNTNameValue->getSubField<PVString>("descriptor")),
+    pvTimeStamp(pvNTNameValue->getSubField<PVStructure>("timeStamp")),
+    pvAlarm(pvNTNameValue->getSubField<PVStructure>("alarm")),
+    pvName(pvNTNameValue->getSubField<PVStringArray>("name")),
+    pvValue(pvNTNameValue->getSubField("value"))
 {}
 
 
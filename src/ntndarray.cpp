@@ -8,13 +8,17 @@
 
 #include <pv/lock.h>
 #include <pv/sharedPtr.h>
+#include <epicsAtomic.h>
+#include <epicsThread.h>
 
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/ntndarray.h>
 #include <pv/ntndarrayAttribute.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -28,6 +32,19 @@ static PVDataCreatePtr pvDataCreate = getPVDataCreate();
 
 static Mutex mutex;
 
+/*
+ * The structures without extra fields, indexed by their optional fields.
+ * Each entry points to a StructureConstPtr which, once published under
+ * the mutex, is never changed or freed, so that it can be read without
+ * locking.
+ */
+static EpicsAtomicPtrT ntndarrayStruc[1 << 4];
+
+static StructureConstPtr const * getPublished(size_t index)
+{
+    return static_cast<StructureConstPtr const *>(epics::atomic::get(ntndarrayStruc[index]));
+}
+
 StructureConstPtr NTNDArrayBuilder::createStructure()
 {
     enum
@@ -38,18 +55,21 @@ StructureConstPtr NTNDArrayBuilder::createStructure()
         DISPLAY_INDEX
     };
 
-    const size_t NUMBER_OF_INDICES = DISPLAY_INDEX+1;
-    const size_t NUMBER_OF_STRUCTURES = 1 << NUMBER_OF_INDICES;
+    // extended structures are keyed on their extra fields in the
+    // structure cache shared by all builders
+    if (!extraFieldNames.empty())
+    {
+        StructureKey key(NTNDArray::URI);
+        key.add(descriptor).add(timeStamp).add(alarm).add(display).
+            add(extraFieldNames, extraFields);
 
-    Lock xx(mutex);
+        StructureConstPtr cached = StructureCache::find(key);
+        if (cached)
+            return cached;
 
-    static StructureConstPtr ntndarrayStruc[NUMBER_OF_STRUCTURES];
-    static UnionConstPtr valueType;
-    static StructureConstPtr codecStruc;
-    static StructureConstPtr dimensionStruc;
-    static StructureConstPtr attributeStruc;
-
-    StructureConstPtr returnedStruc;
+        Lock xx(mutex);
+        return StructureCache::insert(key, buildStructure());
+    }
 
     size_t index = 0;
     if (descriptor) index  |= 1 << DISCRIPTOR_INDEX;
@@ -57,84 +77,92 @@ StructureConstPtr NTNDArrayBuilder::createStructure()
     if (alarm)      index  |= 1 << ALARM_INDEX;
     if (display)    index  |= 1 << DISPLAY_INDEX;
 
-    bool isExtended = !extraFieldNames.empty();
-
-    if (isExtended || !ntndarrayStruc[index])
+    if (!getPublished(index))
     {
-        StandardFieldPtr standardField = getStandardField();
-        FieldBuilderPtr fb = fieldCreate->createFieldBuilder();
+        Lock xx(mutex);
 
-        if (!valueType)
-        {
-            for (int i = pvBoolean; i < pvString; ++i)
-            {
-                ScalarType st = static_cast<ScalarType>(i);
-                fb->addArray(std::string(ScalarTypeFunc::name(st)) + "Value", st);
-            }
-            valueType = fb->createUnion();
-        }
+        // another thread may have published the structure meanwhile
+        if (!getPublished(index))
+            // publish, with a full barrier after the StructureConstPtr is constructed
+            epics::atomic::compareAndSwap(ntndarrayStruc[index], EpicsAtomicPtrT(0),
+                new StructureConstPtr(buildStructure()));
+    }
 
-        if (!codecStruc)
-        {
-            codecStruc = fb->setId("codec_t")->
-                add("name", pvString)->
-                add("parameters", fieldCreate->createVariantUnion())->
-                createStructure();
-        }
+    return *getPublished(index);
+}
 
-        if (!dimensionStruc)
-        {
-            dimensionStruc = fb->setId("dimension_t")->
-                add("size", pvInt)->
-                add("offset",  pvInt)->
-                add("fullSize",  pvInt)->
-                add("binning",  pvInt)->
-                add("reverse",  pvBoolean)->
-                createStructure();
-        }
+// called with the mutex locked, which guards the shared member types
+StructureConstPtr NTNDArrayBuilder::buildStructure()
+{
+    static UnionConstPtr valueType;
+    static StructureConstPtr codecStruc;
+    static StructureConstPtr dimensionStruc;
+    static StructureConstPtr attributeStruc;
+
+    StandardFieldPtr standardField = getStandardField();
+    FieldBuilderPtr fb = fieldCreate->createFieldBuilder();
 
-        if (!attributeStruc)
+    if (!valueType)
+    {
+        for (int i = pvBoolean; i < pvString; ++i)
         {
-            attributeStruc = NTNDArrayAttribute::createBuilder()->createStructure();
+            ScalarType st = static_cast<ScalarType>(i);
+            fb->addArray(std::string(ScalarTypeFunc::name(st)) + "Value", st);
         }
+        valueType = fb->createUnion();
+    }
 
-        fb->setId(NTNDArray::URI)->
-            add("value", valueType)->
-            add("codec", codecStruc)->
-            add("compressedSize", pvLong)->
-            add("uncompressedSize", pvLong)->
-            addArray("dimension", dimensionStruc)->
-            add("uniqueId", pvInt)->
-            add("dataTimeStamp", standardField->timeStamp())->
-            addArray("attribute", attributeStruc);
+    if (!codecStruc)
+    {
+        codecStruc = fb->setId("codec_t")->
+            add("name", pvString)->
+            add("parameters", fieldCreate->createVariantUnion())->
+            createStructure();
+    }
 
-        if (descriptor)
-            fb->add("descriptor", pvString);
+    if (!dimensionStruc)
+    {
+        dimensionStruc = fb->setId("dimension_t")->
+            add("size", pvInt)->
+            add("offset",  pvInt)->
+            add("fullSize",  pvInt)->
+            add("binning",  pvInt)->
+            add("reverse",  pvBoolean)->
+            createStructure();
+    }
 
-        if (alarm)
-            fb->add("alarm", standardField->alarm());
+    if (!attributeStruc)
+    {
+        attributeStruc = NTNDArrayAttribute::createBuilder()->createStructure();
+    }
 
-        if (timeStamp)
-            fb->add("timeStamp", standardField->timeStamp());
+    fb->setId(NTNDArray::URI)->
+        add("value", valueType)->
+        add("codec", codecStruc)->
+        add("compressedSize", pvLong)->
+        add("uncompressedSize", pvLong)->
+        addArray("dimension", dimensionStruc)->
+        add("uniqueId", pvInt)->
+        add("dataTimeStamp", standardField->timeStamp())->
+        addArray("attribute", attributeStruc);
 
-        if (display)
-            fb->add("display", standardField->display());
+    if (descriptor)
+        fb->add("descriptor", pvString);
 
-        size_t extraCount = extraFieldNames.size();
-        for (size_t i = 0; i< extraCount; i++)
-            fb->add(extraFieldNames[i], extraFields[i]);
+    if (alarm)
+        fb->add("alarm", standardField->alarm());
 
-        returnedStruc = fb->createStructure();
+    if (timeStamp)
+        fb->add("timeStamp", standardField->timeStamp());
 
-        if (!isExtended)
-            ntndarrayStruc[index] = returnedStruc;
-    }
-    else
-    {
-        return ntndarrayStruc[index];
-    }
+    if (display)
+        fb->add("display", standardField->display());
 
-    return returnedStruc;
+    size_t extraCount = extraFieldNames.size();
+    for (size_t i = 0; i< extraCount; i++)
+        fb->add(extraFieldNames[i], extraFields[i]);
+
+    return fb->createStructure();
 }
 
 NTNDArrayBuilder::shared_pointer NTNDArrayBuilder::addDescriptor()
@@ -166,6 +194,11 @@ PVStructurePtr NTNDArrayBuilder::createPVStructure()
     return getPVDataCreate()->createPVStructure(createStructure());
 }
 
+NTPrototypePtr NTNDArrayBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTNDArrayPtr NTNDArrayBuilder::create()
 {
     return NTNDArrayPtr(new NTNDArray(createPVStructure()));
@@ -195,11 +228,13 @@ NTNDArrayBuilder::shared_pointer NTNDArrayBuilder::add(string const & name, Fiel
 }
 
 const std::string NTNDArray::URI("epics:nt/NTNDArray:1.0");
+static const NTTypeKey uriKey(NTNDArray::URI);
 const std::string ntAttrStr("epics:nt/NTAttribute:1.0");
 
 NTNDArray::shared_pointer NTNDArray::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntNDArray, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -210,7 +245,7 @@ NTNDArray::shared_pointer NTNDArray::wrapUnsafe(PVStructurePtr const & pvStructu
 
 bool NTNDArray::is_a(StructureConstPtr const & structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTNDArray::is_a(PVStructurePtr const & pvStructure)
@@ -252,13 +287,8 @@ namespace {
     }
 }
 
-bool NTNDArray::isCompatible(StructureConstPtr const &structure)
+Result& NTNDArray::isCompatible(Result& result)
 {
-    if (!structure)
-        return false;
-
-    Result result(structure);
-
     return result
         .is<Structure>()
         .has<&isValue>("value")
@@ -272,8 +302,24 @@ bool NTNDArray::isCompatible(StructureConstPtr const &structure)
         .maybeHas<Scalar>("descriptor")
         .maybeHas<&NTField::isAlarm, Structure>("alarm")
         .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp")
-        .maybeHas<&NTField::isDisplay, Structure>("display")
-        .valid();
+        .maybeHas<&NTField::isDisplay, Structure>("display");
+}
+
+bool NTNDArray::isCompatible(StructureConstPtr const &structure)
+{
+    NTStatistics::Probe probe(ntNDArray, NTStatistics::opIsCompatible);
+
+    if (!structure)
+        return probe.result(false);
+
+    static const ValidationPlan plan(&NTNDArray::isCompatible);
+
+    return probe.result(plan.validate(structure));
+}
+
+bool NTNDArray::isCompatible(StructureConstPtr const &structure, std::string &diagnostics)
+{
+    return diagnose(structure, &NTNDArray::isCompatible, diagnostics);
 }
 
 
@@ -281,26 +327,44 @@ bool NTNDArray::isCompatible(PVStructurePtr const & pvStructure)
 {
     if(!pvStructure.get()) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTNDArray::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTNDArray::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 bool NTNDArray::isValid()
 {
+    NTStatistics::Probe probe(ntNDArray, NTStatistics::opIsValid);
+
     int64 valueSize = getValueSize();
     int64 compressedSize = getCompressedDataSize()->get();
     if (valueSize != compressedSize)
-        return false;
+        return probe.result(false);
 
     long expectedUncompressed = getExpectedUncompressedSize();
     long uncompressedSize = getUncompressedDataSize()->get();
     if (uncompressedSize != expectedUncompressed)
-        return false;
+        return probe.result(false);
 
     std::string codecName = getCodec()->getSubField<PVString>("name")->get();
     if (codecName == "" && valueSize < uncompressedSize)
-        return false;
+        return probe.result(false);
 
-    return true;
+    return probe.result(true);
 }
 
 int64 NTNDArray::getExpectedUncompressedSize()
@@ -419,67 +483,79 @@ PVStructurePtr NTNDArray::getPVStructure() const
 
 PVUnionPtr NTNDArray::getValue() const
 {
-    return pvNTNDArray->getSubField<PVUnion>("value");
+    return pvValue;
 }
 
 PVStructurePtr NTNDArray::getCodec() const
 {
-    return pvNTNDArray->getSubField<PVStructure>("codec");
+    return pvCodec;
 }
 
 PVLongPtr NTNDArray::getCompressedDataSize() const
 {
-    return pvNTNDArray->getSubField<PVLong>("compressedSize");
+    return pvCompressedSize;
 }
 
 PVLongPtr NTNDArray::getUncompressedDataSize() const
 {
-    return pvNTNDArray->getSubField<PVLong>("uncompressedSize");
+    return pvUncompressedSize;
 }
 
 PVStructureArrayPtr NTNDArray::getDimension() const
 {
-    return pvNTNDArray->getSubField<PVStructureArray>("dimension");
+    return pvDimension;
 }
 
 PVIntPtr NTNDArray::getUniqueId() const
 {
-    return pvNTNDArray->getSubField<PVInt>("uniqueId");
+    return pvUniqueId;
 }
 
 PVStructurePtr NTNDArray::getDataTimeStamp() const
 {
-    return pvNTNDArray->getSubField<PVStructure>("dataTimeStamp");
+    return pvDataTimeStamp;
 }
 
 PVStructureArrayPtr NTNDArray::getAttribute() const
 {
-    return pvNTNDArray->getSubField<PVStructureArray>("attribute");
+    return pvAttribute;
 }
 
 PVStringPtr NTNDArray::getDescriptor() const
 {
-    return pvNTNDArray->getSubField<PVString>("descriptor");
+    return pvDescriptor;
 }
 
 PVStructurePtr NTNDArray::getTimeStamp() const
 {
-    return pvNTNDArray->getSubField<PVStructure>("timeStamp");
+    return pvTimeStamp;
 }
 
 PVStructurePtr NTNDArray::getAlarm() const
 {
-    return pvNTNDArray->getSubField<PVStructure>("alarm");
+    return pvAlarm;
 }
 
 PVStructurePtr NTNDArray::getDisplay() const
 {
-    return pvNTNDArray->getSubField<PVStructure>("display");
+    return pvDisplay;
 }
 
 
 NTNDArray::NTNDArray(PVStructurePtr const & pvStructure) :
-    pvNTNDArray(pvStructure)
+    pvNTNDArray(pvStructure),
+    pvValue(pvNTNDArray->getSubField<PVUnion>("value")),
+    pvCodec(pvNTNDArray->getSubField<PVStructure>("codec")),
+    pvCompressedSize(pvNTNDArray->getSubField<PVLong>("compressedSize")),
+    pvUncompressedSize(pvNTNDArray->getSubField<PVLong>("uncompressedSize")),
+    pvDimension(pvNTNDArray->getSubField<PVStructureArray>("dimension")),
+    pvUniqueId(pvNTNDArray->getSubField<PVInt>("uniqueId")),
+    pvDataTimeStamp(pvNTNDArray->getSubField<PVStructure>("dataTimeStamp")),
+    pvAttribute(pvNTNDArray->getSubField<PVStructureArray>("attribute")),
+    pvDescriptor(pvNTNDArray->getSubField<PVString>("descriptor")),
+    pvTimeStamp(pvNTNDArray->getSubField<PVStructure>("timeStamp")),
+    pvAlarm(pvNTNDArray->getSubField<PVStructure>("alarm")),
+    pvDisplay(pvNTNDArray->getSubField<PVStructure>("display"))
 {}
 
 
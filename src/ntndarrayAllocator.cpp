@@ -0,0 +1,101 @@
+/* ntndarrayAllocator.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <map>
+#include <new>
+#include <vector>
+
+#include <pv/lock.h>
+
+#define epicsExportSharedSymbols
+#include <pv/ntndarrayAllocator.h>
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+const size_t NTNDArrayAllocator::DEFAULT_CAPACITY;
+
+namespace {
+
+class BufferPool : public NTNDArrayAllocator
+{
+public:
+    explicit BufferPool(size_t capacity) : capacity(capacity), count(0) {}
+
+    virtual ~BufferPool()
+    {
+        for (Buffers::iterator it = buffers.begin(); it != buffers.end(); ++it)
+            ::operator delete(it->second);
+    }
+
+    virtual std::tr1::shared_ptr<void> allocate(size_t size)
+    {
+        void * buffer = 0;
+        {
+            Lock xx(mutex);
+            Buffers::iterator it = buffers.find(size);
+            if (it != buffers.end()) {
+                buffer = it->second;
+                buffers.erase(it);
+                --count;
+            }
+        }
+        if (!buffer)
+            buffer = ::operator new(size);
+        return std::tr1::shared_ptr<void>(buffer, Recycler(self, size));
+    }
+
+    /*
+     * The deleter of the buffers handed out, which gives them back
+     * to the pool if it still exists.
+     */
+    struct Recycler
+    {
+        Recycler(std::tr1::weak_ptr<BufferPool> const & pool, size_t size)
+        : pool(pool), size(size)
+        {}
+
+        void operator()(void * buffer)
+        {
+            std::tr1::shared_ptr<BufferPool> p(pool.lock());
+            if (!p || !p->recycle(buffer, size))
+                ::operator delete(buffer);
+        }
+
+        std::tr1::weak_ptr<BufferPool> pool;
+        size_t size;
+    };
+
+    bool recycle(void * buffer, size_t size)
+    {
+        Lock xx(mutex);
+        if (count >= capacity)
+            return false;
+        buffers.insert(std::make_pair(size, buffer));
+        ++count;
+        return true;
+    }
+
+    typedef std::multimap<size_t, void *> Buffers;
+
+    size_t capacity;
+    size_t count;
+    Buffers buffers;
+    Mutex mutex;
+    std::tr1::weak_ptr<BufferPool> self;
+};
+
+}
+
+NTNDArrayAllocator::shared_pointer NTNDArrayAllocator::createPool(size_t capacity)
+{
+    std::tr1::shared_ptr<BufferPool> pool(new BufferPool(capacity));
+    pool->self = pool;
+    return pool;
+}
+
+}}
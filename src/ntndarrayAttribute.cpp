@@ -4,12 +4,16 @@
  * found in the file LICENSE that is included with the distribution
  */
 
+#include <epicsThread.h>
+
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/ntndarrayAttribute.h>
 #include <pv/ntattribute.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -22,6 +26,17 @@ namespace detail {
 
 StructureConstPtr NTNDArrayAttributeBuilder::createStructure()
 {
+    StructureKey key(NTNDArrayAttribute::URI);
+    key.add(tags).add(alarm).add(timeStamp).
+        add(extraFieldNames, extraFields);
+
+    StructureConstPtr s = StructureCache::find(key);
+    if (s)
+    {
+        reset();
+        return s;
+    }
+
     FieldBuilderPtr builder =
             getFieldCreate()->createFieldBuilder()->
                setId(NTNDArrayAttribute::URI)->
@@ -48,7 +63,7 @@ StructureConstPtr NTNDArrayAttributeBuilder::createStructure()
         builder->add(extraFieldNames[i], extraFields[i]);
 
 
-    StructureConstPtr s = builder->createStructure();
+    s = StructureCache::insert(key, builder->createStructure());
 
     reset();
     return s;
@@ -83,6 +98,11 @@ PVStructurePtr NTNDArrayAttributeBuilder::createPVStructure()
     return getPVDataCreate()->createPVStructure(createStructure());
 }
 
+NTPrototypePtr NTNDArrayAttributeBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTNDArrayAttributePtr NTNDArrayAttributeBuilder::create()
 {
     return NTNDArrayAttributePtr(new NTNDArrayAttribute(createPVStructure()));
@@ -112,10 +132,12 @@ NTNDArrayAttributeBuilder::shared_pointer NTNDArrayAttributeBuilder::add(string
 }
 
 const std::string NTNDArrayAttribute::URI("epics:nt/NTAttribute:1.0");
+static const NTTypeKey uriKey(NTNDArrayAttribute::URI);
 
 NTNDArrayAttribute::shared_pointer NTNDArrayAttribute::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntNDArrayAttribute, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -126,7 +148,7 @@ NTNDArrayAttribute::shared_pointer NTNDArrayAttribute::wrapUnsafe(PVStructurePtr
 
 bool NTNDArrayAttribute::is_a(StructureConstPtr const & structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTNDArrayAttribute::is_a(PVStructurePtr const & pvStructure)
@@ -146,25 +168,56 @@ Result& NTNDArrayAttribute::isAttribute(Result& result) {
         .has<Scalar>("source");
 }
 
+Result& NTNDArrayAttribute::isCompatible(Result& result)
+{
+    return isAttribute(result.is<Structure>());
+}
+
 bool NTNDArrayAttribute::isCompatible(StructureConstPtr const & structure)
 {
+    NTStatistics::Probe probe(ntNDArrayAttribute, NTStatistics::opIsCompatible);
+
     if (!structure)
-        return false;
+        return probe.result(false);
 
-    Result result(structure);
-    return isAttribute(result.is<Structure>()).valid();
+    static const ValidationPlan plan(&NTNDArrayAttribute::isCompatible);
+
+    return probe.result(plan.validate(structure));
+}
+
+bool NTNDArrayAttribute::isCompatible(StructureConstPtr const & structure, std::string & diagnostics)
+{
+    return diagnose(structure, &NTNDArrayAttribute::isCompatible, diagnostics);
 }
 
 bool NTNDArrayAttribute::isCompatible(PVStructurePtr const & pvStructure)
 {
     if(!pvStructure) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTNDArrayAttribute::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTNDArrayAttribute::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 bool NTNDArrayAttribute::isValid()
 {
-    return true;
+    NTStatistics::Probe probe(ntNDArrayAttribute, NTStatistics::opIsValid);
+
+    return probe.result(true);
 }
 
 NTNDArrayAttributeBuilderPtr NTNDArrayAttribute::createBuilder()
@@ -197,23 +250,23 @@ PVStructurePtr NTNDArrayAttribute::getPVStructure() const
 
 PVStringPtr NTNDArrayAttribute::getDescriptor() const
 {
-    return pvNTNDArrayAttribute->getSubField<PVString>("descriptor");
+    return pvDescriptor;
 }
 
 PVStructurePtr NTNDArrayAttribute::getTimeStamp() const
 {
-    return pvNTNDArrayAttribute->getSubField<PVStructure>("timeStamp");
+    return pvTimeStamp;
 }
 
 PVStructurePtr NTNDArrayAttribute::getAlarm() const
 {
-    return pvNTNDArrayAttribute->getSubField<PVStructure>("alarm");
+    return pvAlarm;
 }
 
 
 PVStringPtr NTNDArrayAttribute::getName() const
 {
-    return pvNTNDArrayAttribute->getSubField<PVString>("name");
+    return pvName;
 }
 
 PVUnionPtr NTNDArrayAttribute::getValue() const
@@ -223,21 +276,28 @@ PVUnionPtr NTNDArrayAttribute::getValue() const
 
 PVStringArrayPtr NTNDArrayAttribute::getTags() const
 {
-    return pvNTNDArrayAttribute->getSubField<PVStringArray>("tags");
+    return pvTags;
 }
 
 PVIntPtr NTNDArrayAttribute::getSourceType() const
 {
-    return pvNTNDArrayAttribute->getSubField<PVInt>("sourceType");
+    return pvSourceType;
 }
 
 PVStringPtr NTNDArrayAttribute::getSource() const
 {
-    return pvNTNDArrayAttribute->getSubField<PVString>("source");
+    return pvSource;
 }
 
 NTNDArrayAttribute::NTNDArrayAttribute(PVStructurePtr const & pvStructure) :
-    pvNTNDArrayAttribute(pvStructure), pvValue(pvNTNDArrayAttribute->getSubField<PVUnion>("value"))
+    pvNTNDArrayAttribute(pvStructure), pvValue(pvNTNDArrayAttribute->getSubField<PVUnion>("value")),
+    pvDescriptor(pvNTNDArrayAttribute->getSubField<PVString>("descriptor")),
+    pvTimeStamp(pvNTNDArrayAttribute->getSubField<PVStructure>("timeStamp")),
+    pvAlarm(pvNTNDArrayAttribute->getSubField<PVStructure>("alarm")),
+    pvName(pvNTNDArrayAttribute->getSubField<PVString>("name")),
+    pvTags(pvNTNDArrayAttribute->getSubField<PVStringArray>("tags")),
+    pvSourceType(pvNTNDArrayAttribute->getSubField<PVInt>("sourceType")),
+    pvSource(pvNTNDArrayAttribute->getSubField<PVString>("source"))
 {
 }
 
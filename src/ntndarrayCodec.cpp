@@ -0,0 +1,743 @@
+/* ntndarrayCodec.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+
+#include <epicsThread.h>
+#include <pv/lock.h>
+
+#include "parallel.h"
+
+#define epicsExportSharedSymbols
+#include <pv/ntndarrayCodec.h>
+#include <pv/ntbitshuffle.h>
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+const size_t NTNDArrayCodec::DEFAULT_CHUNK_SIZE;
+
+namespace {
+
+typedef std::vector<uint8> bytes_t;
+
+/*
+ * LZ4 block format: sequences of literals followed by a match
+ * (an offset back into the decompressed bytes and a length).
+ */
+const size_t MIN_MATCH = 4;
+const size_t LAST_LITERALS = 5;
+const size_t MATCH_FIND_LIMIT = 12;
+const size_t MAX_OFFSET = 65535;
+const unsigned HASH_BITS = 12;
+
+inline uint32 read32(uint8 const * p)
+{
+    uint32 value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline size_t hash(uint32 sequence)
+{
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+void putLength(bytes_t & out, size_t length)
+{
+    for (; length >= 255; length -= 255)
+        out.push_back(255);
+    out.push_back(static_cast<uint8>(length));
+}
+
+// a sequence without a match (matchLength 0) ends the block
+void putSequence(bytes_t & out, uint8 const * literals, size_t literalLength,
+    size_t matchLength, size_t offset)
+{
+    uint8 token = static_cast<uint8>(std::min<size_t>(literalLength, 15) << 4);
+    if (matchLength)
+        token |= static_cast<uint8>(std::min<size_t>(matchLength - MIN_MATCH, 15));
+    out.push_back(token);
+    if (literalLength >= 15)
+        putLength(out, literalLength - 15);
+    out.insert(out.end(), literals, literals + literalLength);
+
+    if (!matchLength)
+        return;
+    out.push_back(static_cast<uint8>(offset));
+    out.push_back(static_cast<uint8>(offset >> 8));
+    if (matchLength - MIN_MATCH >= 15)
+        putLength(out, matchLength - MIN_MATCH - 15);
+}
+
+void lz4Compress(uint8 const * in, size_t size, bytes_t & out)
+{
+    size_t anchor = 0;
+    if (size > MATCH_FIND_LIMIT)
+    {
+        // 1 + the position of the last sequence of each hash, 0 if none
+        std::vector<uint32> table(1 << HASH_BITS, 0);
+        size_t limit = size - MATCH_FIND_LIMIT;
+        size_t matchLimit = size - LAST_LITERALS;
+        size_t ip = 0;
+        while (ip < limit)
+        {
+            uint32 sequence = read32(in + ip);
+            uint32 & entry = table[hash(sequence)];
+            size_t ref = entry;
+            entry = static_cast<uint32>(ip + 1);
+            if (ref == 0 || ip + 1 - ref > MAX_OFFSET || read32(in + ref - 1) != sequence)
+            {
+                // skip faster through incompressible data
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            size_t match = ref - 1;
+            size_t length = MIN_MATCH;
+            while (ip + length < matchLimit && in[match + length] == in[ip + length])
+                ++length;
+            putSequence(out, in + anchor, ip - anchor, length, ip - match);
+            ip += length;
+            anchor = ip;
+        }
+    }
+    putSequence(out, in + anchor, size - anchor, 0, 0);
+}
+
+void corrupt(const char * codec)
+{
+    throw std::runtime_error(std::string("corrupt ") + codec + " chunk");
+}
+
+size_t getLength(uint8 const * in, size_t size, size_t & ip)
+{
+    size_t length = 0;
+    uint8 byte;
+    do {
+        if (ip >= size)
+            corrupt("nt-lz4");
+        byte = in[ip++];
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+void lz4Decompress(uint8 const * in, size_t size, uint8 * out, size_t outSize)
+{
+    size_t ip = 0;
+    size_t op = 0;
+    while (true)
+    {
+        if (ip >= size)
+            corrupt("nt-lz4");
+        uint8 token = in[ip++];
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15)
+            literalLength += getLength(in, size, ip);
+        if (literalLength > size - ip || literalLength > outSize - op)
+            corrupt("nt-lz4");
+        std::memcpy(out + op, in + ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        if (ip == size)
+            break;
+
+        if (size - ip < 2)
+            corrupt("nt-lz4");
+        size_t offset = in[ip] | (in[ip + 1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op)
+            corrupt("nt-lz4");
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15)
+            matchLength += getLength(in, size, ip);
+        matchLength += MIN_MATCH;
+        if (matchLength > outSize - op)
+            corrupt("nt-lz4");
+
+        uint8 const * match = out + op - offset;
+        if (offset >= matchLength) {
+            std::memcpy(out + op, match, matchLength);
+        } else {
+            // overlapping, repeats the last offset bytes
+            for (size_t i = 0; i < matchLength; ++i)
+                out[op + i] = match[i];
+        }
+        op += matchLength;
+    }
+    if (op != outSize)
+        corrupt("nt-lz4");
+}
+
+class Lz4Codec : public NTNDArrayCodec
+{
+public:
+    virtual std::string getName() const { return "nt-lz4"; }
+
+    virtual void compress(uint8 const * in, size_t size,
+        size_t /*elementSize*/, bytes_t & out) const
+    {
+        lz4Compress(in, size, out);
+    }
+
+    virtual void decompress(uint8 const * in, size_t size,
+        size_t /*elementSize*/, uint8 * out, size_t outSize) const
+    {
+        lz4Decompress(in, size, out, outSize);
+    }
+};
+
+/*
+ * Run length encoding of elements: a control byte c < 128 is followed
+ * by c + 1 literal elements, c >= 128 by one element repeated c - 126 times.
+ */
+const size_t MAX_LITERALS = 128;
+const size_t MAX_RUN = 129;
+
+class RleCodec : public NTNDArrayCodec
+{
+public:
+    virtual std::string getName() const { return "nt-rle"; }
+
+    virtual void compress(uint8 const * in, size_t size,
+        size_t elementSize, bytes_t & out) const
+    {
+        size_t count = size / elementSize;
+        size_t i = 0;
+        while (i < count)
+        {
+            uint8 const * element = in + i * elementSize;
+
+            size_t run = 1;
+            while (i + run < count && run < MAX_RUN &&
+                   std::memcmp(element, element + run * elementSize, elementSize) == 0)
+                ++run;
+            if (run > 1) {
+                out.push_back(static_cast<uint8>(run + 126));
+                out.insert(out.end(), element, element + elementSize);
+                i += run;
+                continue;
+            }
+
+            // literals, up to the start of the next run
+            size_t literals = 0;
+            while (i < count && literals < MAX_LITERALS)
+            {
+                uint8 const * next = in + (i + 1) * elementSize;
+                if (i + 1 < count && std::memcmp(next - elementSize, next, elementSize) == 0)
+                    break;
+                ++i;
+                ++literals;
+            }
+            out.push_back(static_cast<uint8>(literals - 1));
+            out.insert(out.end(), element, element + literals * elementSize);
+        }
+    }
+
+    virtual void decompress(uint8 const * in, size_t size,
+        size_t elementSize, uint8 * out, size_t outSize) const
+    {
+        size_t ip = 0;
+        size_t op = 0;
+        while (ip < size)
+        {
+            uint8 control = in[ip++];
+            if (control < 128) {
+                size_t length = (control + 1) * elementSize;
+                if (length > size - ip || length > outSize - op)
+                    corrupt("nt-rle");
+                std::memcpy(out + op, in + ip, length);
+                ip += length;
+                op += length;
+            } else {
+                size_t run = control - 126;
+                if (elementSize > size - ip || run * elementSize > outSize - op)
+                    corrupt("nt-rle");
+                for (size_t i = 0; i < run; ++i, op += elementSize)
+                    std::memcpy(out + op, in + ip, elementSize);
+                ip += elementSize;
+            }
+        }
+        if (op != outSize)
+            corrupt("nt-rle");
+    }
+};
+
+/*
+ * The differences between successive elements, as unsigned integers
+ * of the element size, compressed by LZ4.
+ */
+template<typename U>
+void encodeDelta(uint8 const * in, size_t count, uint8 * out)
+{
+    U previous = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        U value;
+        std::memcpy(&value, in + i * sizeof(U), sizeof(U));
+        U delta = static_cast<U>(value - previous);
+        std::memcpy(out + i * sizeof(U), &delta, sizeof(U));
+        previous = value;
+    }
+}
+
+template<typename U>
+void decodeDelta(uint8 * data, size_t count)
+{
+    U previous = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        U delta;
+        std::memcpy(&delta, data + i * sizeof(U), sizeof(U));
+        previous = static_cast<U>(previous + delta);
+        std::memcpy(data + i * sizeof(U), &previous, sizeof(U));
+    }
+}
+
+class DeltaCodec : public NTNDArrayCodec
+{
+public:
+    virtual std::string getName() const { return "nt-delta"; }
+
+    virtual void compress(uint8 const * in, size_t size,
+        size_t elementSize, bytes_t & out) const
+    {
+        if (size == 0) {
+            lz4Compress(in, size, out);
+            return;
+        }
+        bytes_t deltas(size);
+        size_t count = size / elementSize;
+        switch (elementSize)
+        {
+        case 1: encodeDelta<uint8>(in, count, &deltas[0]); break;
+        case 2: encodeDelta<uint16>(in, count, &deltas[0]); break;
+        case 4: encodeDelta<uint32>(in, count, &deltas[0]); break;
+        case 8: encodeDelta<uint64>(in, count, &deltas[0]); break;
+        default:
+            throw std::runtime_error("nt-delta: unsupported element size");
+        }
+        lz4Compress(&deltas[0], size, out);
+    }
+
+    virtual void decompress(uint8 const * in, size_t size,
+        size_t elementSize, uint8 * out, size_t outSize) const
+    {
+        lz4Decompress(in, size, out, outSize);
+        size_t count = outSize / elementSize;
+        switch (elementSize)
+        {
+        case 1: decodeDelta<uint8>(out, count); break;
+        case 2: decodeDelta<uint16>(out, count); break;
+        case 4: decodeDelta<uint32>(out, count); break;
+        case 8: decodeDelta<uint64>(out, count); break;
+        default:
+            throw std::runtime_error("nt-delta: unsupported element size");
+        }
+    }
+};
+
+/*
+ * Blocks of elements bit transposed, then compressed by LZ4. A chunk
+ * starts with the number of elements of a block, as a 32-bit little
+ * endian integer.
+ */
+class BitshuffleLz4Codec : public NTNDArrayCodec
+{
+public:
+    BitshuffleLz4Codec()
+    : parameters(getFieldCreate()->createFieldBuilder()->
+          add("chunkSize", pvInt)->
+          add("elementSize", pvInt)->
+          add("blockSize", pvInt)->
+          createStructure())
+    {}
+
+    virtual std::string getName() const { return "nt-bslz4"; }
+
+    virtual void compress(uint8 const * in, size_t size,
+        size_t elementSize, bytes_t & out) const
+    {
+        size_t blockSize = NTBitshuffle::getDefaultBlockSize(elementSize);
+        for (size_t i = 0; i < 4; ++i)
+            out.push_back(static_cast<uint8>(blockSize >> (8 * i)));
+
+        if (size == 0) {
+            lz4Compress(in, size, out);
+            return;
+        }
+        bytes_t shuffled(size);
+        NTBitshuffle::shuffle(in, &shuffled[0], size / elementSize, elementSize, blockSize);
+        lz4Compress(&shuffled[0], size, out);
+    }
+
+    virtual void decompress(uint8 const * in, size_t size,
+        size_t elementSize, uint8 * out, size_t outSize) const
+    {
+        if (size < 4)
+            corrupt("nt-bslz4");
+        size_t blockSize = 0;
+        for (size_t i = 0; i < 4; ++i)
+            blockSize |= static_cast<size_t>(in[i]) << (8 * i);
+        if (blockSize == 0 || blockSize % 8 != 0)
+            corrupt("nt-bslz4");
+
+        if (outSize == 0) {
+            lz4Decompress(in + 4, size - 4, out, outSize);
+            return;
+        }
+        bytes_t shuffled(outSize);
+        lz4Decompress(in + 4, size - 4, &shuffled[0], outSize);
+        NTBitshuffle::unshuffle(&shuffled[0], out, outSize / elementSize, elementSize, blockSize);
+    }
+
+    virtual StructureConstPtr getParametersStructure() const
+    {
+        return parameters;
+    }
+
+    virtual void putParameters(PVStructure & parameters) const
+    {
+        PVIntPtr elementSize = parameters.getSubFieldT<PVInt>("elementSize");
+        parameters.getSubFieldT<PVInt>("blockSize")->put(static_cast<int32>(
+            NTBitshuffle::getDefaultBlockSize(elementSize->get())));
+    }
+
+private:
+    StructureConstPtr parameters;
+};
+
+struct Registry
+{
+    Registry()
+    : parameters(getFieldCreate()->createFieldBuilder()->
+          add("chunkSize", pvInt)->
+          add("elementSize", pvInt)->
+          createStructure())
+    {}
+
+    Mutex mutex;
+    std::map<std::string, NTNDArrayCodecPtr> codecs;
+
+    // the structure of codec.parameters
+    StructureConstPtr parameters;
+};
+
+Registry * registry = 0;
+epicsThreadOnceId registryOnce = EPICS_THREAD_ONCE_INIT;
+
+void createRegistry(void *)
+{
+    registry = new Registry();
+    NTNDArrayCodecPtr builtins[] = {
+        NTNDArrayCodecPtr(new Lz4Codec()),
+        NTNDArrayCodecPtr(new RleCodec()),
+        NTNDArrayCodecPtr(new DeltaCodec()),
+        NTNDArrayCodecPtr(new BitshuffleLz4Codec())
+    };
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); ++i)
+        registry->codecs[builtins[i]->getName()] = builtins[i];
+}
+
+Registry & getRegistry()
+{
+    epicsThreadOnce(&registryOnce, &createRegistry, 0);
+    return *registry;
+}
+
+/*
+ * The compressed value: the compressed chunks, each preceded by its size
+ * as a 32-bit little endian integer, zero padded to a whole element.
+ */
+const size_t SIZE_BYTES = 4;
+
+void putSize(uint8 * out, size_t size)
+{
+    for (size_t i = 0; i < SIZE_BYTES; ++i)
+        out[i] = static_cast<uint8>(size >> (8 * i));
+}
+
+size_t getSize(uint8 const * in)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < SIZE_BYTES; ++i)
+        size |= static_cast<size_t>(in[i]) << (8 * i);
+    return size;
+}
+
+class CompressJob : public detail::ParallelJob
+{
+public:
+    CompressJob(NTNDArrayCodec const & codec, uint8 const * in, size_t size,
+        size_t chunkSize, size_t elementSize)
+    : codec(codec), in(in), size(size), chunkSize(chunkSize),
+      elementSize(elementSize), chunks((size + chunkSize - 1) / chunkSize)
+    {}
+
+    virtual void run(size_t item)
+    {
+        size_t start = item * chunkSize;
+        codec.compress(in + start, std::min(chunkSize, size - start),
+            elementSize, chunks[item]);
+    }
+
+    NTNDArrayCodec const & codec;
+    uint8 const * in;
+    size_t size;
+    size_t chunkSize;
+    size_t elementSize;
+    std::vector<bytes_t> chunks;
+};
+
+class DecompressJob : public detail::ParallelJob
+{
+public:
+    DecompressJob(NTNDArrayCodec const & codec, uint8 * out, size_t size,
+        size_t chunkSize, size_t elementSize)
+    : codec(codec), out(out), size(size), chunkSize(chunkSize),
+      elementSize(elementSize),
+      chunks((size + chunkSize - 1) / chunkSize), chunkSizes(chunks.size())
+    {}
+
+    virtual void run(size_t item)
+    {
+        size_t start = item * chunkSize;
+        codec.decompress(chunks[item], chunkSizes[item], elementSize,
+            out + start, std::min(chunkSize, size - start));
+    }
+
+    NTNDArrayCodec const & codec;
+    uint8 * out;
+    size_t size;
+    size_t chunkSize;
+    size_t elementSize;
+    std::vector<uint8 const *> chunks;
+    std::vector<size_t> chunkSizes;
+};
+
+// compresses or decompresses the value, of element type T
+class Transcoder
+{
+public:
+    Transcoder(NTNDArray const & ndarray, NTNDArrayCodec const & codec,
+        size_t chunkSize, unsigned threads)
+    : ndarray(ndarray), codec(codec), chunkSize(chunkSize), threads(threads),
+      elementSize(0)
+    {}
+
+    template<typename T>
+    void compress()
+    {
+        typedef PVValueArray<T> PVArray;
+        std::tr1::shared_ptr<PVArray> value = ndarray.getValue()->get<PVArray>();
+        typename PVArray::const_svector data(value->view());
+
+        size_t size = data.size() * sizeof(T);
+        elementSize = sizeof(T);
+        chunkSize = std::max<size_t>(chunkSize / sizeof(T), 1) * sizeof(T);
+        CompressJob job(codec, reinterpret_cast<uint8 const *>(data.data()),
+            size, chunkSize, sizeof(T));
+        detail::runParallel(job, job.chunks.size(), threads);
+
+        size_t compressedSize = 0;
+        for (size_t i = 0; i < job.chunks.size(); ++i)
+            compressedSize += SIZE_BYTES + job.chunks[i].size();
+
+        typename PVArray::svector compressed((compressedSize + sizeof(T) - 1) / sizeof(T));
+        uint8 * out = reinterpret_cast<uint8 *>(compressed.data());
+        for (size_t i = 0; i < job.chunks.size(); ++i)
+        {
+            bytes_t const & chunk = job.chunks[i];
+            putSize(out, chunk.size());
+            out += SIZE_BYTES;
+            if (!chunk.empty())
+                std::memcpy(out, &chunk[0], chunk.size());
+            out += chunk.size();
+        }
+        std::memset(out, 0, compressed.size() * sizeof(T) - compressedSize);
+
+        int64 valueSize = static_cast<int64>(compressed.size() * sizeof(T));
+        value->replace(freeze(compressed));
+        ndarray.getUncompressedDataSize()->put(static_cast<int64>(size));
+        ndarray.getCompressedDataSize()->put(valueSize);
+    }
+
+    template<typename T>
+    void decompress()
+    {
+        typedef PVValueArray<T> PVArray;
+        std::tr1::shared_ptr<PVArray> value = ndarray.getValue()->get<PVArray>();
+        typename PVArray::const_svector data(value->view());
+
+        int64 uncompressedSize = ndarray.getUncompressedDataSize()->get();
+        if (uncompressedSize < 0 || uncompressedSize % sizeof(T) != 0)
+            throw std::runtime_error("NTNDArray uncompressedSize is not a number of elements");
+        if (chunkSize % sizeof(T) != 0)
+            throw std::runtime_error("NTNDArray codec chunkSize is not a number of elements");
+
+        size_t size = static_cast<size_t>(uncompressedSize);
+        typename PVArray::svector decompressed(size / sizeof(T));
+        DecompressJob job(codec, reinterpret_cast<uint8 *>(decompressed.data()),
+            size, chunkSize, sizeof(T));
+
+        uint8 const * in = reinterpret_cast<uint8 const *>(data.data());
+        size_t inSize = data.size() * sizeof(T);
+        size_t offset = 0;
+        for (size_t i = 0; i < job.chunks.size(); ++i)
+        {
+            if (inSize - offset < SIZE_BYTES)
+                corrupt(codec.getName().c_str());
+            size_t compressedSize = getSize(in + offset);
+            offset += SIZE_BYTES;
+            if (compressedSize > inSize - offset)
+                corrupt(codec.getName().c_str());
+            job.chunks[i] = in + offset;
+            job.chunkSizes[i] = compressedSize;
+            offset += compressedSize;
+        }
+        if (inSize - offset >= sizeof(T))
+            corrupt(codec.getName().c_str());
+
+        detail::runParallel(job, job.chunks.size(), threads);
+
+        value->replace(freeze(decompressed));
+        ndarray.getCompressedDataSize()->put(uncompressedSize);
+    }
+
+    NTNDArray const & ndarray;
+    NTNDArrayCodec const & codec;
+    size_t chunkSize;
+    unsigned threads;
+    size_t elementSize;
+};
+
+void transcode(Transcoder & transcoder, ScalarType type, bool compress)
+{
+    switch (type)
+    {
+#define NT_TRANSCODE(TYPE, T) \
+    case TYPE: \
+        if (compress) transcoder.compress<T>(); else transcoder.decompress<T>(); \
+        break;
+    NT_TRANSCODE(pvBoolean, boolean)
+    NT_TRANSCODE(pvByte, int8)
+    NT_TRANSCODE(pvUByte, uint8)
+    NT_TRANSCODE(pvShort, int16)
+    NT_TRANSCODE(pvUShort, uint16)
+    NT_TRANSCODE(pvInt, int32)
+    NT_TRANSCODE(pvUInt, uint32)
+    NT_TRANSCODE(pvLong, int64)
+    NT_TRANSCODE(pvULong, uint64)
+    NT_TRANSCODE(pvFloat, float)
+    NT_TRANSCODE(pvDouble, double)
+#undef NT_TRANSCODE
+    default:
+        throw std::runtime_error("NTNDArray value has no numeric type");
+    }
+}
+
+}
+
+StructureConstPtr NTNDArrayCodec::getParametersStructure() const
+{
+    return getRegistry().parameters;
+}
+
+void NTNDArrayCodec::putParameters(PVStructure & /*parameters*/) const
+{
+}
+
+void NTNDArrayCodec::add(NTNDArrayCodecPtr const & codec)
+{
+    Registry & r = getRegistry();
+    Lock xx(r.mutex);
+    r.codecs[codec->getName()] = codec;
+}
+
+NTNDArrayCodecPtr NTNDArrayCodec::find(std::string const & name)
+{
+    Registry & r = getRegistry();
+    Lock xx(r.mutex);
+    std::map<std::string, NTNDArrayCodecPtr>::const_iterator it = r.codecs.find(name);
+    return it != r.codecs.end() ? it->second : NTNDArrayCodecPtr();
+}
+
+std::vector<std::string> NTNDArrayCodec::getNames()
+{
+    Registry & r = getRegistry();
+    Lock xx(r.mutex);
+    std::vector<std::string> names;
+    names.reserve(r.codecs.size());
+    for (std::map<std::string, NTNDArrayCodecPtr>::const_iterator it = r.codecs.begin();
+         it != r.codecs.end(); ++it)
+        names.push_back(it->first);
+    return names;
+}
+
+void NTNDArrayCodec::compress(NTNDArray const & ndarray, std::string const & name,
+    size_t chunkSize, unsigned threads)
+{
+    PVStringPtr pvName = ndarray.getCodec()->getSubFieldT<PVString>("name");
+    if (!pvName->get().empty())
+        throw std::runtime_error("NTNDArray is already compressed by " + pvName->get());
+
+    NTNDArrayCodecPtr codec = find(name);
+    if (!codec)
+        throw std::runtime_error("unknown NTNDArray codec " + name);
+
+    PVScalarArrayPtr value = ndarray.getValue()->get<PVScalarArray>();
+    if (!value)
+        throw std::runtime_error("NTNDArray has no value");
+
+    // the chunk size must fit codec.parameters.chunkSize
+    Transcoder transcoder(ndarray, *codec, std::min<size_t>(chunkSize, 1 << 30), threads);
+    transcode(transcoder, value->getScalarArray()->getElementType(), true);
+
+    PVStructurePtr parameters = getPVDataCreate()->createPVStructure(codec->getParametersStructure());
+    parameters->getSubFieldT<PVInt>("chunkSize")->put(static_cast<int32>(transcoder.chunkSize));
+    parameters->getSubFieldT<PVInt>("elementSize")->put(static_cast<int32>(transcoder.elementSize));
+    codec->putParameters(*parameters);
+    ndarray.getCodec()->getSubFieldT<PVUnion>("parameters")->set(parameters);
+    pvName->put(name);
+}
+
+void NTNDArrayCodec::decompress(NTNDArray const & ndarray, unsigned threads)
+{
+    PVStringPtr pvName = ndarray.getCodec()->getSubFieldT<PVString>("name");
+    std::string name = pvName->get();
+    if (name.empty())
+        return;
+
+    NTNDArrayCodecPtr codec = find(name);
+    if (!codec)
+        throw std::runtime_error("unknown NTNDArray codec " + name);
+
+    PVUnionPtr pvParameters = ndarray.getCodec()->getSubFieldT<PVUnion>("parameters");
+    PVStructurePtr parameters = pvParameters->get<PVStructure>();
+    PVIntPtr chunkSize = parameters ? parameters->getSubField<PVInt>("chunkSize") : PVIntPtr();
+    if (!chunkSize || chunkSize->get() <= 0)
+        throw std::runtime_error("NTNDArray codec has no chunkSize parameter");
+
+    PVScalarArrayPtr value = ndarray.getValue()->get<PVScalarArray>();
+    if (!value)
+        throw std::runtime_error("NTNDArray has no value");
+
+    Transcoder transcoder(ndarray, *codec, chunkSize->get(), threads);
+    transcode(transcoder, value->getScalarArray()->getElementType(), false);
+
+    pvParameters->set(PVFieldPtr());
+    pvName->put("");
+}
+
+}}
@@ -0,0 +1,440 @@
+/* ntndarrayConverter.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "parallel.h"
+#include "simd.h"
+
+#define epicsExportSharedSymbols
+#include <pv/ntndarrayConverter.h>
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+const size_t NTNDArrayConverter::MIN_PARALLEL_ELEMENTS;
+
+namespace {
+
+// the number of elements converted by a thread at a time
+const size_t CHUNK_ELEMENTS = 1 << 16;
+
+struct Parameters
+{
+    double scale;
+    double offset;
+    bool scaled;
+    bool saturate;
+};
+
+template<typename T> struct IsFloat { enum { value = 0 }; };
+template<> struct IsFloat<float> { enum { value = 1 }; };
+template<> struct IsFloat<double> { enum { value = 1 }; };
+
+// whether float is not precise enough for the elements
+template<typename T> struct IsWide { enum { value = 0 }; };
+template<> struct IsWide<int32> { enum { value = 1 }; };
+template<> struct IsWide<uint32> { enum { value = 1 }; };
+template<> struct IsWide<int64> { enum { value = 1 }; };
+template<> struct IsWide<uint64> { enum { value = 1 }; };
+template<> struct IsWide<double> { enum { value = 1 }; };
+
+// the type scaled elements are computed in
+template<bool Wide> struct WorkType { typedef float type; };
+template<> struct WorkType<true> { typedef double type; };
+
+template<bool Signed> struct Sign
+{
+    template<typename T>
+    static bool negative(T x) { return x < 0; }
+};
+
+template<> struct Sign<false>
+{
+    template<typename T>
+    static bool negative(T) { return false; }
+};
+
+template<typename D, typename S>
+inline D saturateInteger(S x)
+{
+    typedef std::numeric_limits<D> limits;
+    if (Sign<std::numeric_limits<S>::is_signed>::negative(x))
+    {
+        if (!limits::is_signed || static_cast<int64>(x) < static_cast<int64>(limits::min()))
+            return limits::min();
+        return static_cast<D>(x);
+    }
+    return static_cast<uint64>(x) > static_cast<uint64>(limits::max()) ?
+        limits::max() : static_cast<D>(x);
+}
+
+// truncated, clamped to the range of D, NaN to its minimum
+template<typename D, typename S>
+inline D clampFloat(S x)
+{
+    typedef std::numeric_limits<D> limits;
+    if (!(x > static_cast<S>(limits::min())))
+        return limits::min();
+    if (x >= static_cast<S>(limits::max()))
+        return limits::max();
+    return static_cast<D>(x);
+}
+
+template<typename S, typename D,
+    bool FromFloat = IsFloat<S>::value, bool ToFloat = IsFloat<D>::value>
+struct Cast
+{
+    static D get(S x, bool saturate)
+    {
+        return saturate ? saturateInteger<D>(x) : static_cast<D>(x);
+    }
+};
+
+template<typename S, typename D, bool FromFloat>
+struct Cast<S, D, FromFloat, true>
+{
+    static D get(S x, bool) { return static_cast<D>(x); }
+};
+
+template<typename S, typename D>
+struct Cast<S, D, true, false>
+{
+    static D get(S x, bool) { return clampFloat<D>(x); }
+};
+
+template<typename S, typename D>
+struct Convert
+{
+    static D get(S x, bool saturate) { return Cast<S, D>::get(x, saturate); }
+};
+
+template<typename S>
+struct Convert<S, boolean>
+{
+    static boolean get(S x, bool) { return x != 0; }
+};
+
+template<typename S, typename D>
+void convertScalar(S const * in, D * out, size_t count, Parameters const & p)
+{
+    if (p.scaled)
+    {
+        typedef typename WorkType<IsWide<S>::value || IsWide<D>::value>::type W;
+        W scale = static_cast<W>(p.scale);
+        W offset = static_cast<W>(p.offset);
+        for (size_t i = 0; i < count; ++i)
+            out[i] = Convert<W, D>::get(static_cast<W>(in[i]) * scale + offset, true);
+    }
+    else
+    {
+        for (size_t i = 0; i < count; ++i)
+            out[i] = Convert<S, D>::get(in[i], p.saturate);
+    }
+}
+
+/*
+ * The SSE2 kernels convert the elements up to a multiple of their vector
+ * size and return how many they converted; convertScalar() does the rest.
+ * They compute as convertScalar(), in float, to give the same results.
+ */
+template<typename S, typename D>
+inline size_t convertVector(S const *, D *, size_t, Parameters const &)
+{
+    return 0;
+}
+
+#ifdef NT_SSE2
+
+inline __m128 scaleVector(__m128 x, Parameters const & p)
+{
+    if (!p.scaled)
+        return x;
+    return _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(static_cast<float>(p.scale))),
+        _mm_set1_ps(static_cast<float>(p.offset)));
+}
+
+// truncated, clamped to [min, max], NaN to min as MAXPS returns its second operand
+inline __m128i clampVector(__m128 x, __m128 min, __m128 max)
+{
+    return _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(x, min), max));
+}
+
+inline void storeFloats(float * out, __m128i x, Parameters const & p)
+{
+    __m128i zero = _mm_setzero_si128();
+    _mm_storeu_ps(out, scaleVector(_mm_cvtepi32_ps(_mm_unpacklo_epi16(x, zero)), p));
+    _mm_storeu_ps(out + 4, scaleVector(_mm_cvtepi32_ps(_mm_unpackhi_epi16(x, zero)), p));
+}
+
+inline size_t convertVector(uint16 const * in, float * out, size_t count, Parameters const & p)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+        storeFloats(out + i, _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i)), p);
+    return i;
+}
+
+inline size_t convertVector(int16 const * in, float * out, size_t count, Parameters const & p)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+        // sign extended by shifting the high halves of the duplicated elements
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(out + i, scaleVector(_mm_cvtepi32_ps(low), p));
+        _mm_storeu_ps(out + i + 4, scaleVector(_mm_cvtepi32_ps(high), p));
+    }
+    return i;
+}
+
+inline size_t convertVector(uint8 const * in, float * out, size_t count, Parameters const & p)
+{
+    __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+        storeFloats(out + i, _mm_unpacklo_epi8(x, zero), p);
+        storeFloats(out + i + 8, _mm_unpackhi_epi8(x, zero), p);
+    }
+    return i;
+}
+
+inline __m128i loadBytes(float const * in, Parameters const & p)
+{
+    __m128 min = _mm_setzero_ps();
+    __m128 max = _mm_set1_ps(255.0f);
+    __m128i a = clampVector(scaleVector(_mm_loadu_ps(in), p), min, max);
+    __m128i b = clampVector(scaleVector(_mm_loadu_ps(in + 4), p), min, max);
+    // 8 16-bit elements, as bytes by _mm_packus_epi16()
+    return _mm_packs_epi32(a, b);
+}
+
+inline size_t convertVector(float const * in, uint8 * out, size_t count, Parameters const & p)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+            _mm_packus_epi16(loadBytes(in + i, p), loadBytes(in + i + 8, p)));
+    return i;
+}
+
+inline size_t convertVector(float const * in, uint16 * out, size_t count, Parameters const & p)
+{
+    __m128 min = _mm_setzero_ps();
+    __m128 max = _mm_set1_ps(65535.0f);
+    // without _mm_packus_epi32(), packed as signed with the sign bit flipped
+    __m128i bias = _mm_set1_epi32(32768);
+    __m128i flip = _mm_set1_epi16(static_cast<short>(0x8000));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i a = clampVector(scaleVector(_mm_loadu_ps(in + i), p), min, max);
+        __m128i b = clampVector(scaleVector(_mm_loadu_ps(in + i + 4), p), min, max);
+        __m128i x = _mm_packs_epi32(_mm_sub_epi32(a, bias), _mm_sub_epi32(b, bias));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_xor_si128(x, flip));
+    }
+    return i;
+}
+
+inline size_t convertVector(uint16 const * in, uint8 * out, size_t count, Parameters const & p)
+{
+    size_t i = 0;
+    if (p.scaled)
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128 min = _mm_setzero_ps();
+        __m128 max = _mm_set1_ps(255.0f);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+            __m128i a = clampVector(scaleVector(_mm_cvtepi32_ps(_mm_unpacklo_epi16(x, zero)), p), min, max);
+            __m128i b = clampVector(scaleVector(_mm_cvtepi32_ps(_mm_unpackhi_epi16(x, zero)), p), min, max);
+            __m128i bytes = _mm_packs_epi32(a, b);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(bytes, bytes));
+        }
+        return i;
+    }
+
+    __m128i max = _mm_set1_epi16(255);
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i + 8));
+        if (p.saturate)
+        {
+            // min(x, 255) = x - (x -sat 255)
+            a = _mm_sub_epi16(a, _mm_subs_epu16(a, max));
+            b = _mm_sub_epi16(b, _mm_subs_epu16(b, max));
+        }
+        else
+        {
+            a = _mm_and_si128(a, max);
+            b = _mm_and_si128(b, max);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(a, b));
+    }
+    return i;
+}
+
+#endif
+
+template<typename S, typename D>
+class ConvertJob : public detail::ParallelJob
+{
+public:
+    ConvertJob(S const * in, D * out, size_t count, Parameters const & parameters)
+    : in(in), out(out), count(count), parameters(parameters)
+    {}
+
+    virtual void run(size_t item)
+    {
+        size_t begin = item * CHUNK_ELEMENTS;
+        size_t size = std::min(CHUNK_ELEMENTS, count - begin);
+        size_t done = convertVector(in + begin, out + begin, size, parameters);
+        convertScalar(in + begin + done, out + begin + done, size - done, parameters);
+    }
+
+    S const * in;
+    D * out;
+    size_t count;
+    Parameters const & parameters;
+};
+
+class Converter
+{
+public:
+    Converter(NTNDArray const & ndarray, Parameters const & parameters,
+        ScalarType type, unsigned threads)
+    : ndarray(ndarray), parameters(parameters), type(type), threads(threads)
+    {}
+
+    template<typename S>
+    void from()
+    {
+        switch (type)
+        {
+#define NT_CONVERT(TYPE, T) \
+        case TYPE: \
+            convert<S, T>(); \
+            break;
+        NT_CONVERT(pvBoolean, boolean)
+        NT_CONVERT(pvByte, int8)
+        NT_CONVERT(pvUByte, uint8)
+        NT_CONVERT(pvShort, int16)
+        NT_CONVERT(pvUShort, uint16)
+        NT_CONVERT(pvInt, int32)
+        NT_CONVERT(pvUInt, uint32)
+        NT_CONVERT(pvLong, int64)
+        NT_CONVERT(pvULong, uint64)
+        NT_CONVERT(pvFloat, float)
+        NT_CONVERT(pvDouble, double)
+#undef NT_CONVERT
+        default:
+            throw std::runtime_error("NTNDArray value has no numeric type");
+        }
+    }
+
+    template<typename S, typename D>
+    void convert()
+    {
+        PVUnionPtr value = ndarray.getValue();
+        typename PVValueArray<S>::const_svector data(value->get<PVValueArray<S> >()->view());
+
+        typename PVValueArray<D>::svector converted(data.size());
+        ConvertJob<S, D> job(data.data(), converted.data(), data.size(), parameters);
+        size_t chunks = (data.size() + CHUNK_ELEMENTS - 1) / CHUNK_ELEMENTS;
+        detail::runParallel(job, chunks,
+            data.size() < NTNDArrayConverter::MIN_PARALLEL_ELEMENTS ? 1 : threads);
+
+        int64 size = static_cast<int64>(converted.size() * sizeof(D));
+        value->select<PVValueArray<D> >(std::string(ScalarTypeFunc::name(type)) + "Value")->
+            replace(freeze(converted));
+        ndarray.getCompressedDataSize()->put(size);
+        ndarray.getUncompressedDataSize()->put(size);
+    }
+
+    NTNDArray const & ndarray;
+    Parameters const & parameters;
+    ScalarType type;
+    unsigned threads;
+};
+
+}
+
+NTNDArrayConverter::NTNDArrayConverter(ScalarType type)
+: type(type), scaleFactor(1.0), offset(0.0), scaled(false),
+  saturating(false), threadCount(0)
+{
+    if (type == pvString)
+        throw std::runtime_error("NTNDArray value type must be numeric");
+}
+
+NTNDArrayConverter & NTNDArrayConverter::scale(double scale, double offset)
+{
+    scaleFactor = scale;
+    this->offset = offset;
+    scaled = true;
+    return *this;
+}
+
+NTNDArrayConverter & NTNDArrayConverter::saturate(bool saturate)
+{
+    saturating = saturate;
+    return *this;
+}
+
+NTNDArrayConverter & NTNDArrayConverter::threads(unsigned threads)
+{
+    threadCount = threads;
+    return *this;
+}
+
+void NTNDArrayConverter::convert(NTNDArray const & ndarray) const
+{
+    if (!ndarray.getCodec()->getSubFieldT<PVString>("name")->get().empty())
+        throw std::runtime_error("NTNDArray value is compressed");
+
+    PVScalarArrayPtr value = ndarray.getValue()->get<PVScalarArray>();
+    if (!value)
+        throw std::runtime_error("NTNDArray has no value");
+
+    ScalarType from = value->getScalarArray()->getElementType();
+    if (from == type && !scaled)
+        return;
+
+    Parameters parameters = { scaleFactor, offset, scaled, saturating };
+    Converter converter(ndarray, parameters, type, threadCount);
+    switch (from)
+    {
+#define NT_CONVERT(TYPE, T) \
+    case TYPE: \
+        converter.from<T>(); \
+        break;
+    NT_CONVERT(pvBoolean, boolean)
+    NT_CONVERT(pvByte, int8)
+    NT_CONVERT(pvUByte, uint8)
+    NT_CONVERT(pvShort, int16)
+    NT_CONVERT(pvUShort, uint16)
+    NT_CONVERT(pvInt, int32)
+    NT_CONVERT(pvUInt, uint32)
+    NT_CONVERT(pvLong, int64)
+    NT_CONVERT(pvULong, uint64)
+    NT_CONVERT(pvFloat, float)
+    NT_CONVERT(pvDouble, double)
+#undef NT_CONVERT
+    default:
+        throw std::runtime_error("NTNDArray value has no numeric type");
+    }
+}
+
+}}
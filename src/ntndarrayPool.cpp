@@ -0,0 +1,250 @@
+/* ntndarrayPool.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <stdexcept>
+
+#include <epicsAtomic.h>
+
+#define epicsExportSharedSymbols
+#include <pv/ntndarrayPool.h>
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+const size_t NTNDArrayPool::DEFAULT_CAPACITY;
+
+static PVDataCreatePtr pvDataCreate = getPVDataCreate();
+
+/*
+ * The free instances returned by one thread. Only taken from by
+ * other threads when their own list is empty, so its mutex is
+ * rarely contended.
+ */
+struct NTNDArrayPool::FreeList
+{
+    Mutex mutex;
+    std::vector<PVStructure *> instances;
+};
+
+/*
+ * The deleter of the PVStructure of the instances handed out. When the
+ * last reference to it, held by the NTNDArray wrapping it or by any other
+ * holder, is released, it gives the PVStructure back to the pool, or
+ * deletes it if the pool no longer exists. Each time an instance is
+ * handed out, it is owned by a new shared_ptr with this deleter, so it
+ * is never owned by two at once.
+ */
+struct NTNDArrayPool::Recycler
+{
+    explicit Recycler(NTNDArrayPool::weak_pointer const & pool)
+    : pool(pool)
+    {}
+
+    void operator()(PVStructure * instance)
+    {
+        NTNDArrayPool::shared_pointer p(pool.lock());
+        if (p)
+            p->recycle(instance);
+        else
+            delete instance;
+    }
+
+    NTNDArrayPool::weak_pointer pool;
+};
+
+NTNDArrayPool::shared_pointer NTNDArrayPool::create(
+    StructureConstPtr const & structure, size_t capacity)
+{
+    if (!NTNDArray::isCompatible(structure))
+        throw std::runtime_error("structure not compatible with NTNDArray");
+
+    shared_pointer pool(new NTNDArrayPool(structure, capacity));
+    pool->self = pool;
+    return pool;
+}
+
+NTNDArrayPool::NTNDArrayPool(StructureConstPtr const & structure, size_t capacity)
+: structure(structure),
+  capacity(capacity),
+  defaults(pvDataCreate->createPVStructure(structure)),
+  count(0),
+  hits(0),
+  misses(0),
+  discarded(0),
+  key(epicsThreadPrivateCreate())
+{
+    StringArray const & names = structure->getFieldNames();
+    for (size_t i = 0; i < names.size(); ++i)
+        if (names[i] != "value" && names[i] != "dimension" && names[i] != "attribute")
+            resetFields.push_back(i);
+}
+
+NTNDArrayPool::~NTNDArrayPool()
+{
+    // the key is not reused before the values of all threads are cleared
+    epicsThreadPrivateDelete(key);
+    for (size_t i = 0; i < lists.size(); ++i) {
+        for (size_t j = 0; j < lists[i]->instances.size(); ++j)
+            delete lists[i]->instances[j];
+        delete lists[i];
+    }
+}
+
+NTNDArrayPool::FreeList & NTNDArrayPool::getFreeList()
+{
+    FreeList * list = static_cast<FreeList *>(epicsThreadPrivateGet(key));
+    if (!list) {
+        list = new FreeList();
+        epicsThreadPrivateSet(key, list);
+        Lock xx(mutex);
+        lists.push_back(list);
+    }
+    return *list;
+}
+
+PVStructure * NTNDArrayPool::take(FreeList & own)
+{
+    PVStructure * instance = 0;
+    {
+        Lock xx(own.mutex);
+        if (!own.instances.empty()) {
+            instance = own.instances.back();
+            own.instances.pop_back();
+        }
+    }
+
+    if (!instance && epics::atomic::get(count) != 0) {
+        Lock xx(mutex);
+        for (size_t i = 0; i < lists.size() && !instance; ++i) {
+            if (lists[i] == &own)
+                continue;
+            Lock yy(lists[i]->mutex);
+            if (!lists[i]->instances.empty()) {
+                instance = lists[i]->instances.back();
+                lists[i]->instances.pop_back();
+            }
+        }
+    }
+
+    if (instance)
+        epics::atomic::decrement(count);
+    return instance;
+}
+
+NTNDArrayPtr NTNDArrayPool::get()
+{
+    PVStructure * instance = take(getFreeList());
+    if (instance) {
+        epics::atomic::increment(hits);
+    } else {
+        epics::atomic::increment(misses);
+        instance = new PVStructure(structure);
+    }
+
+    return NTNDArray::wrapUnsafe(PVStructurePtr(instance, Recycler(self)));
+}
+
+NTNDArrayPtr NTNDArrayPool::get(std::vector<int32> const & shape)
+{
+    NTNDArrayPtr instance = get();
+
+    // the elements of a recycled instance may be shared by copies of it,
+    // so they are replaced, not updated
+    PVStructureArrayPtr dimension = instance->getDimension();
+    StructureConstPtr element = dimension->getStructureArray()->getStructure();
+    PVStructureArray::svector elements(shape.size());
+    for (size_t i = 0; i < shape.size(); ++i) {
+        PVStructurePtr d = pvDataCreate->createPVStructure(element);
+        d->getSubFieldT<PVInt>("size")->put(shape[i]);
+        d->getSubFieldT<PVInt>("fullSize")->put(shape[i]);
+        d->getSubFieldT<PVInt>("binning")->put(1);
+        elements[i] = d;
+    }
+    dimension->replace(freeze(elements));
+
+    return instance;
+}
+
+void NTNDArrayPool::recycle(PVStructure * instance)
+{
+    if (epics::atomic::increment(count) > capacity) {
+        epics::atomic::decrement(count);
+        epics::atomic::increment(discarded);
+        delete instance;
+        return;
+    }
+
+    reset(*instance);
+
+    FreeList & own = getFreeList();
+    Lock xx(own.mutex);
+    own.instances.push_back(instance);
+}
+
+void NTNDArrayPool::reset(PVStructure & instance) const
+{
+    PVFieldPtrArray const & fields = instance.getPVFields();
+    PVFieldPtrArray const & defaultFields = defaults->getPVFields();
+    for (size_t i = 0; i < resetFields.size(); ++i)
+        fields[resetFields[i]]->copyUnchecked(*defaultFields[resetFields[i]]);
+
+    // release the data, but keep the selected array
+    PVUnionPtr value = instance.getSubFieldT<PVUnion>("value");
+    PVFieldPtr selected = value->get();
+    if (selected) {
+        if (selected->getField()->getType() == scalarArray)
+            static_cast<PVScalarArray &>(*selected).putFrom(shared_vector<const int8>());
+        else
+            value->select(PVUnion::UNDEFINED_INDEX);
+    }
+}
+
+size_t NTNDArrayPool::getHits() const
+{
+    return epics::atomic::get(hits);
+}
+
+size_t NTNDArrayPool::getMisses() const
+{
+    return epics::atomic::get(misses);
+}
+
+size_t NTNDArrayPool::getDiscarded() const
+{
+    return epics::atomic::get(discarded);
+}
+
+size_t NTNDArrayPool::size() const
+{
+    return epics::atomic::get(count);
+}
+
+void NTNDArrayPool::clear()
+{
+    // free the instances outside of the locks
+    std::vector<PVStructure *> freed;
+    {
+        Lock xx(mutex);
+        for (size_t i = 0; i < lists.size(); ++i) {
+            Lock yy(lists[i]->mutex);
+            epics::atomic::subtract(count, lists[i]->instances.size());
+            freed.insert(freed.end(), lists[i]->instances.begin(), lists[i]->instances.end());
+            lists[i]->instances.clear();
+        }
+    }
+    for (size_t i = 0; i < freed.size(); ++i)
+        delete freed[i];
+}
+
+void NTNDArrayPool::resetCounters()
+{
+    epics::atomic::set(hits, 0);
+    epics::atomic::set(misses, 0);
+    epics::atomic::set(discarded, 0);
+}
+
+}}
@@ -0,0 +1,439 @@
+/* ntndarrayRegion.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "parallel.h"
+
+#define epicsExportSharedSymbols
+#include <pv/ntndarrayRegion.h>
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+const size_t NTNDArrayRegion::MIN_PARALLEL_ELEMENTS;
+
+namespace {
+
+// the number of source elements processed by a thread at a time
+const size_t CHUNK_ELEMENTS = 1 << 16;
+
+// the maximum number of rows binned into one, for 8 and 16-bit elements
+const size_t MAX_BINNED_ROWS = 1 << 16;
+
+/*
+ * The types rows of elements are summed in, and rows of them are
+ * binned in.
+ */
+template<typename T> struct Accumulator;
+
+#define NT_ACCUMULATOR(T, ROW, SUM) \
+template<> struct Accumulator<T> \
+{ \
+    typedef ROW row_type; \
+    typedef SUM sum_type; \
+};
+NT_ACCUMULATOR(boolean, uint32, uint64)
+NT_ACCUMULATOR(int8, int32, int64)
+NT_ACCUMULATOR(uint8, uint32, uint64)
+NT_ACCUMULATOR(int16, int32, int64)
+NT_ACCUMULATOR(uint16, uint32, uint64)
+NT_ACCUMULATOR(int32, int64, int64)
+NT_ACCUMULATOR(uint32, uint64, uint64)
+NT_ACCUMULATOR(int64, int64, int64)
+NT_ACCUMULATOR(uint64, uint64, uint64)
+NT_ACCUMULATOR(float, double, double)
+NT_ACCUMULATOR(double, double, double)
+#undef NT_ACCUMULATOR
+
+/*
+ * The number of elements binned into one, with a shift replacing
+ * the division of their sum when it is a power of 2.
+ */
+template<typename S>
+struct Divisor
+{
+    explicit Divisor(S count) : count(count), shift(-1)
+    {
+        for (int i = 0; i < 63; ++i)
+            if (static_cast<uint64>(count) == static_cast<uint64>(1) << i)
+                shift = i;
+    }
+
+    S count;
+    int shift;
+};
+
+// rounded to the nearest, halves away from zero
+inline int64 divide(int64 sum, Divisor<int64> const & divisor)
+{
+    if (divisor.shift >= 0) {
+        int64 half = divisor.count >> 1;
+        return sum < 0 ? -((half - sum) >> divisor.shift) : (sum + half) >> divisor.shift;
+    }
+    int64 quotient = sum / divisor.count;
+    int64 remainder = sum % divisor.count;
+    if (2 * (remainder < 0 ? -remainder : remainder) >= divisor.count)
+        quotient += sum < 0 ? -1 : 1;
+    return quotient;
+}
+
+inline uint64 divide(uint64 sum, Divisor<uint64> const & divisor)
+{
+    if (divisor.shift >= 0)
+        return (sum + (divisor.count >> 1)) >> divisor.shift;
+    return sum / divisor.count + (2 * (sum % divisor.count) >= divisor.count ? 1 : 0);
+}
+
+inline double divide(double sum, Divisor<double> const & divisor)
+{
+    return sum / divisor.count;
+}
+
+template<bool Signed> struct Minimum
+{
+    template<typename S, typename T>
+    static bool below(S sum, T min) { return sum < static_cast<S>(min); }
+};
+
+template<> struct Minimum<false>
+{
+    template<typename S, typename T>
+    static bool below(S, T) { return false; }
+};
+
+template<typename T>
+struct Store
+{
+    template<typename S>
+    static T get(S sum)
+    {
+        typedef std::numeric_limits<T> limits;
+        if (Minimum<limits::is_signed>::below(sum, limits::min()))
+            return limits::min();
+        if (sum > static_cast<S>(limits::max()))
+            return limits::max();
+        return static_cast<T>(sum);
+    }
+};
+
+template<> struct Store<float>
+{
+    static float get(double sum) { return static_cast<float>(sum); }
+};
+
+template<> struct Store<double>
+{
+    static double get(double sum) { return sum; }
+};
+
+template<typename T>
+struct Finish
+{
+    template<typename S>
+    static T get(S sum, Divisor<S> const & divisor, bool average)
+    {
+        return Store<T>::get(average ? divide(sum, divisor) : sum);
+    }
+};
+
+template<> struct Finish<boolean>
+{
+    template<typename S>
+    static boolean get(S sum, Divisor<S> const &, bool) { return sum != 0; }
+};
+
+inline size_t product(std::vector<size_t> const & sizes, size_t first)
+{
+    size_t n = 1;
+    for (size_t d = first; d < sizes.size(); ++d)
+        n *= sizes[d];
+    return n;
+}
+
+/*
+ * Computes rows of the result: the source rows binned into a result row
+ * are summed into a row of accumulators, whose elements are then
+ * binned along dimension 0.
+ */
+template<typename T>
+class RegionJob : public detail::ParallelJob
+{
+public:
+    typedef typename Accumulator<T>::row_type row_type;
+    typedef typename Accumulator<T>::sum_type sum_type;
+
+    RegionJob(NTNDArrayView<T> const & view, std::vector<size_t> const & shape,
+        std::vector<size_t> const & binning, bool reverse, bool average,
+        T * out, size_t rowsPerItem)
+    : view(view), shape(shape), binning(binning), reverse(reverse),
+      average(average), out(out), rowsPerItem(rowsPerItem),
+      rows(product(shape, 1)), binnedRows(product(binning, 1)),
+      divisor(static_cast<sum_type>(product(binning, 0)))
+    {}
+
+    virtual void run(size_t item)
+    {
+        size_t rank = shape.size();
+        size_t width = shape[0];
+        size_t binX = binning[0];
+        bool copy = binnedRows == 1 && binX == 1;
+
+        std::vector<size_t> outIndex(rank, 0);
+        std::vector<size_t> index(rank, 0);
+        std::vector<row_type> sums(copy ? 0 : width * binX);
+
+        size_t end = std::min(rows, (item + 1) * rowsPerItem);
+        for (size_t r = item * rowsPerItem; r < end; ++r)
+        {
+            size_t rest = r;
+            for (size_t d = 1; d < rank; ++d) {
+                outIndex[d] = rest % shape[d];
+                rest /= shape[d];
+            }
+            T * outRow = out + r * width;
+
+            if (copy) {
+                for (size_t d = 1; d < rank; ++d)
+                    index[d] = outIndex[d];
+                T const * in = &view.at(index);
+                if (reverse) {
+                    for (size_t x = 0; x < width; ++x)
+                        outRow[width - 1 - x] = in[x];
+                } else {
+                    std::memcpy(outRow, in, width * sizeof(T));
+                }
+                continue;
+            }
+
+            for (size_t b = 0; b < binnedRows; ++b)
+            {
+                rest = b;
+                for (size_t d = 1; d < rank; ++d) {
+                    index[d] = outIndex[d] * binning[d] + rest % binning[d];
+                    rest /= binning[d];
+                }
+                addRow(&view.at(index), &sums[0], width * binX, b == 0);
+            }
+
+            // constant binnings for the compiler to unroll
+            switch (binX)
+            {
+            case 1: binRow<1>(&sums[0], outRow, width, binX); break;
+            case 2: binRow<2>(&sums[0], outRow, width, binX); break;
+            case 4: binRow<4>(&sums[0], outRow, width, binX); break;
+            default: binRow<0>(&sums[0], outRow, width, binX); break;
+            }
+        }
+    }
+
+    template<size_t Binning>
+    void binRow(row_type const * sums, T * outRow, size_t width, size_t binX) const
+    {
+        size_t n = Binning ? Binning : binX;
+        ptrdiff_t step = reverse ? -1 : 1;
+        T * o = reverse ? outRow + width - 1 : outRow;
+        for (size_t x = 0; x < width; ++x, o += step)
+        {
+            sum_type sum = 0;
+            for (size_t i = 0; i < n; ++i)
+                sum += sums[x * n + i];
+            *o = Finish<T>::get(sum, divisor, average);
+        }
+    }
+
+    static void addRow(T const * in, row_type * sums, size_t size, bool first)
+    {
+        if (first) {
+            for (size_t x = 0; x < size; ++x)
+                sums[x] = static_cast<row_type>(in[x]);
+        } else {
+            for (size_t x = 0; x < size; ++x)
+                sums[x] += static_cast<row_type>(in[x]);
+        }
+    }
+
+    NTNDArrayView<T> const & view;
+    std::vector<size_t> const & shape;
+    std::vector<size_t> const & binning;
+    bool reverse;
+    bool average;
+    T * out;
+    size_t rowsPerItem;
+    size_t rows;
+    size_t binnedRows;
+    Divisor<sum_type> divisor;
+};
+
+class Extractor
+{
+public:
+    Extractor(NTNDArrayRegion const & region, bool average,
+        NTNDArrayAllocator * allocator, unsigned threads,
+        NTNDArray const & source, NTNDArray const & result)
+    : region(region), average(average), allocator(allocator), threads(threads),
+      source(source), result(result)
+    {}
+
+    template<typename T>
+    void extract()
+    {
+        NTNDArrayView<T> view(source);
+        std::vector<NTNDArrayDimension> resultDimensions;
+        region.getResultDimensions(view.getDimensions(), resultDimensions);
+
+        std::vector<NTNDArrayDimension> const & dimensions = region.getDimensions();
+        size_t rank = view.getRank();
+        std::vector<size_t> shape(rank);
+        std::vector<size_t> binning(rank, 1);
+        size_t count = 1;
+        size_t binnedRows = 1;
+        for (size_t d = 0; d < rank; ++d)
+        {
+            shape[d] = static_cast<size_t>(resultDimensions[d].size);
+            count *= shape[d];
+            if (d >= dimensions.size())
+                continue;
+            binning[d] = static_cast<size_t>(dimensions[d].binning);
+            if (d > 0)
+                binnedRows *= binning[d];
+            view = view.subView(d, static_cast<size_t>(dimensions[d].offset), shape[d] * binning[d]);
+            // dimension 0 is reversed when storing the result
+            if (d > 0 && dimensions[d].reverse)
+                view = view.flip(d);
+        }
+        if (sizeof(T) <= 2 && binnedRows > MAX_BINNED_ROWS)
+            throw std::runtime_error("NTNDArray region binning too large for the element type");
+
+        typename PVValueArray<T>::svector out(
+            NTNDArrayAllocator::allocateArray<T>(allocator, count));
+        if (count > 0)
+        {
+            bool reverse = !dimensions.empty() && dimensions[0].reverse;
+            size_t rowElements = shape[0] * binning[0] * binnedRows;
+            size_t rowsPerItem = std::max<size_t>(CHUNK_ELEMENTS / rowElements, 1);
+            RegionJob<T> job(view, shape, binning, reverse, average, out.data(), rowsPerItem);
+            size_t items = (job.rows + rowsPerItem - 1) / rowsPerItem;
+            detail::runParallel(job, items,
+                rowElements * job.rows < NTNDArrayRegion::MIN_PARALLEL_ELEMENTS ? 1 : threads);
+        }
+
+        int64 size = static_cast<int64>(count * sizeof(T));
+        PVUnionPtr value = result.getValue();
+        value->select<PVValueArray<T> >(std::string(ScalarTypeFunc::name(
+            static_cast<ScalarType>(ScalarTypeID<T>::value))) + "Value")->replace(freeze(out));
+        NTNDArrayDimension::put(result, resultDimensions);
+        result.getCompressedDataSize()->put(size);
+        result.getUncompressedDataSize()->put(size);
+    }
+
+    NTNDArrayRegion const & region;
+    bool average;
+    NTNDArrayAllocator * allocator;
+    unsigned threads;
+    NTNDArray const & source;
+    NTNDArray const & result;
+};
+
+}
+
+NTNDArrayRegion::NTNDArrayRegion()
+: averaging(false), threadCount(0)
+{}
+
+NTNDArrayRegion::NTNDArrayRegion(std::vector<NTNDArrayDimension> const & dimensions)
+: dimensions(dimensions), averaging(false), threadCount(0)
+{}
+
+NTNDArrayRegion & NTNDArrayRegion::average(bool average)
+{
+    averaging = average;
+    return *this;
+}
+
+NTNDArrayRegion & NTNDArrayRegion::allocator(NTNDArrayAllocatorPtr const & allocator)
+{
+    elementAllocator = allocator;
+    return *this;
+}
+
+NTNDArrayRegion & NTNDArrayRegion::threads(unsigned threads)
+{
+    threadCount = threads;
+    return *this;
+}
+
+void NTNDArrayRegion::getResultDimensions(std::vector<NTNDArrayDimension> const & source,
+    std::vector<NTNDArrayDimension> & result) const
+{
+    if (dimensions.size() > source.size())
+        throw std::runtime_error("NTNDArray region has more dimensions than the frame");
+
+    result = source;
+    for (size_t d = 0; d < dimensions.size(); ++d)
+    {
+        NTNDArrayDimension const & region = dimensions[d];
+        NTNDArrayDimension & dim = result[d];
+        int32 size = region.size == 0 ? dim.size - region.offset : region.size;
+        if (region.offset < 0 || size < 0 || region.binning < 1 ||
+            region.offset > dim.size - size)
+            throw std::runtime_error("NTNDArray region does not fit the frame");
+
+        int32 binnedSize = size / region.binning;
+        int32 after = dim.size - region.offset - binnedSize * region.binning;
+        dim.offset += (dim.reverse ? after : region.offset) * dim.binning;
+        dim.size = binnedSize;
+        dim.binning *= region.binning;
+        dim.reverse = dim.reverse != region.reverse;
+    }
+}
+
+void NTNDArrayRegion::extract(NTNDArray const & source, NTNDArray const & result) const
+{
+    PVScalarArrayPtr value = source.getValue()->get<PVScalarArray>();
+    if (!value)
+        throw std::runtime_error("NTNDArray has no value");
+
+    Extractor extractor(*this, averaging, elementAllocator.get(), threadCount, source, result);
+    switch (value->getScalarArray()->getElementType())
+    {
+#define NT_EXTRACT(TYPE, T) \
+    case TYPE: \
+        extractor.extract<T>(); \
+        break;
+    NT_EXTRACT(pvBoolean, boolean)
+    NT_EXTRACT(pvByte, int8)
+    NT_EXTRACT(pvUByte, uint8)
+    NT_EXTRACT(pvShort, int16)
+    NT_EXTRACT(pvUShort, uint16)
+    NT_EXTRACT(pvInt, int32)
+    NT_EXTRACT(pvUInt, uint32)
+    NT_EXTRACT(pvLong, int64)
+    NT_EXTRACT(pvULong, uint64)
+    NT_EXTRACT(pvFloat, float)
+    NT_EXTRACT(pvDouble, double)
+#undef NT_EXTRACT
+    default:
+        throw std::runtime_error("NTNDArray value has no numeric type");
+    }
+
+    PVStructurePtr codec = result.getCodec();
+    codec->getSubFieldT<PVString>("name")->put("");
+    codec->getSubFieldT<PVUnion>("parameters")->set(PVFieldPtr());
+
+    if (result.getPVStructure() != source.getPVStructure())
+    {
+        result.getUniqueId()->put(source.getUniqueId()->get());
+        result.getDataTimeStamp()->copyUnchecked(*source.getDataTimeStamp());
+        result.getAttribute()->copyUnchecked(*source.getAttribute());
+    }
+}
+
+}}
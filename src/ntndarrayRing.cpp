@@ -0,0 +1,770 @@
+/* ntndarrayRing.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <epicsAtomic.h>
+#include <epicsThread.h>
+#include <epicsTime.h>
+
+#include <pv/byteBuffer.h>
+#include <pv/serialize.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  define NT_RING_SHM
+#  include <errno.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
+#define epicsExportSharedSymbols
+#include <pv/ntndarrayRing.h>
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+const size_t NTNDArrayRing::DEFAULT_METADATA_SIZE;
+
+namespace {
+
+const epicsUInt32 MAGIC = 0x4e54524e;   // "NTRN"
+const epicsUInt32 VERSION = 1;
+
+// the alignment of the parts of the shared memory, a cache line
+const size_t ALIGNMENT = 64;
+
+const size_t NO_SLOT = static_cast<size_t>(-1);
+
+// seconds between the polls of a consumer waiting for a frame
+const double POLL_PERIOD = 1e-4;
+
+// the start of the shared memory, written by create() before the magic
+struct Header
+{
+    epicsUInt32 magic;
+    epicsUInt32 version;
+    epicsUInt32 wordSize;
+    epicsUInt32 reserved;
+    epicsUInt64 fingerprintHigh;
+    epicsUInt64 fingerprintLow;
+    size_t slots;
+    size_t entries;
+    size_t payloadSize;
+    size_t metadataSize;
+    // the number of frames published
+    size_t head;
+};
+
+/*
+ * The slot of the frame of a sequence number, at entries[sequence % entries].
+ * sequence is the sequence number plus one, and 0 while the entry is
+ * written, so that a consumer detects an entry overwritten as it reads it.
+ */
+struct Entry
+{
+    size_t sequence;
+    size_t slot;
+    size_t generation;
+};
+
+/*
+ * The state of a slot, followed by its payload and metadata.
+ * The generation is odd while the producer writes the slot, and even
+ * once published, so that the consumers only take the slot of an entry
+ * if its generation is that of the entry. refs counts the values read
+ * from the slot which the consumers hold: the producer only reuses the
+ * slot when there is none.
+ */
+struct Slot
+{
+    int refs;
+    size_t generation;
+    size_t type;
+    size_t count;
+    size_t metadataLength;
+};
+
+size_t alignUp(size_t size)
+{
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+// a + b, and whether it overflowed
+size_t add(size_t a, size_t b, bool & overflow)
+{
+    if (a > static_cast<size_t>(-1) - b)
+        overflow = true;
+    return a + b;
+}
+
+size_t multiply(size_t a, size_t b, bool & overflow)
+{
+    if (b != 0 && a > static_cast<size_t>(-1) / b)
+        overflow = true;
+    return a * b;
+}
+
+void checkName(std::string const & name)
+{
+    if (name.size() < 2 || name[0] != '/' || name.find('/', 1) != std::string::npos)
+        throw std::runtime_error("NTNDArrayRing name must be / followed by a name without /, not " + name);
+}
+
+void corrupt(std::string const & name)
+{
+    throw std::runtime_error("NTNDArrayRing " + name + " is corrupt");
+}
+
+/*
+ * Serializes the fields of a frame into the metadata of a slot, which
+ * cannot be flushed: a frame which does not fit is rejected.
+ */
+class Serializer : public SerializableControl
+{
+public:
+    explicit Serializer(ByteBuffer & buffer) : buffer(buffer) {}
+
+    virtual void flushSerializeBuffer()
+    {
+        full();
+    }
+
+    virtual void ensureBuffer(std::size_t size)
+    {
+        if (buffer.getRemaining() < size)
+            full();
+    }
+
+    virtual void alignBuffer(std::size_t alignment)
+    {
+        buffer.align(alignment);
+    }
+
+    virtual bool directSerialize(ByteBuffer *, const char *, std::size_t, std::size_t)
+    {
+        return false;
+    }
+
+    virtual void cachedSerialize(FieldConstPtr const & field, ByteBuffer * buffer)
+    {
+        field->serialize(buffer, this);
+    }
+
+private:
+    static void full()
+    {
+        throw std::runtime_error("NTNDArray fields exceed the metadataSize of the ring");
+    }
+
+    ByteBuffer & buffer;
+};
+
+class Deserializer : public DeserializableControl
+{
+public:
+    Deserializer(ByteBuffer & buffer, std::string const & name)
+    : buffer(buffer), name(name)
+    {}
+
+    virtual void ensureData(std::size_t size)
+    {
+        if (buffer.getRemaining() < size)
+            corrupt(name);
+    }
+
+    virtual void alignData(std::size_t alignment)
+    {
+        buffer.align(alignment);
+    }
+
+    virtual bool directDeserialize(ByteBuffer *, char *, std::size_t, std::size_t)
+    {
+        return false;
+    }
+
+    virtual FieldConstPtr cachedDeserialize(ByteBuffer * buffer)
+    {
+        return getFieldCreate()->deserialize(buffer, this);
+    }
+
+private:
+    ByteBuffer & buffer;
+    std::string const & name;
+};
+
+// the elements of a value
+struct Payload
+{
+    void const * data;
+    size_t count;
+    size_t elementSize;
+};
+
+template<typename T>
+Payload getPayload(PVScalarArray const & value)
+{
+    typename PVValueArray<T>::const_svector const & data(
+        static_cast<PVValueArray<T> const &>(value).view());
+    Payload payload = { data.data(), data.size(), sizeof(T) };
+    return payload;
+}
+
+Payload getPayload(PVScalarArray const & value)
+{
+    switch (value.getScalarArray()->getElementType())
+    {
+#define NT_PAYLOAD(TYPE, T) \
+    case TYPE: return getPayload<T>(value);
+    NT_PAYLOAD(pvBoolean, boolean)
+    NT_PAYLOAD(pvByte, int8)
+    NT_PAYLOAD(pvUByte, uint8)
+    NT_PAYLOAD(pvShort, int16)
+    NT_PAYLOAD(pvUShort, uint16)
+    NT_PAYLOAD(pvInt, int32)
+    NT_PAYLOAD(pvUInt, uint32)
+    NT_PAYLOAD(pvLong, int64)
+    NT_PAYLOAD(pvULong, uint64)
+    NT_PAYLOAD(pvFloat, float)
+    NT_PAYLOAD(pvDouble, double)
+#undef NT_PAYLOAD
+    default:
+        throw std::runtime_error("NTNDArray value has no numeric type");
+    }
+}
+
+}
+
+/*
+ * The shared memory of a ring: its header, the entries, then the state,
+ * payload and metadata of each slot, each part aligned on ALIGNMENT.
+ */
+struct NTNDArrayRing::Mapping
+{
+    Mapping(void * base, size_t size)
+    : base(static_cast<char *>(base)), size(size),
+      header(static_cast<Header *>(base)), entries(0), slots(0), stride(0)
+    {}
+
+    ~Mapping()
+    {
+#ifdef NT_RING_SHM
+        munmap(base, size);
+#endif
+    }
+
+    // the size of the shared memory of a ring, 0 if too large
+    static size_t getSize(size_t slots, size_t entries, size_t payloadSize, size_t metadataSize)
+    {
+        bool overflow = false;
+        size_t stride = add(alignUp(sizeof(Slot)), add(alignUp(payloadSize),
+            alignUp(metadataSize), overflow), overflow);
+        size_t size = add(alignUp(sizeof(Header)),
+            add(alignUp(multiply(entries, sizeof(Entry), overflow)),
+                multiply(slots, stride, overflow), overflow), overflow);
+        return overflow || payloadSize > size || metadataSize > size ? 0 : size;
+    }
+
+    // sets the parts from the header
+    void layout()
+    {
+        entries = reinterpret_cast<Entry *>(base + alignUp(sizeof(Header)));
+        slots = reinterpret_cast<char *>(entries) + alignUp(header->entries * sizeof(Entry));
+        stride = alignUp(sizeof(Slot)) + alignUp(header->payloadSize) + alignUp(header->metadataSize);
+    }
+
+    Slot & slot(size_t index)
+    {
+        return *reinterpret_cast<Slot *>(slots + index * stride);
+    }
+
+    char * payload(size_t index)
+    {
+        return slots + index * stride + alignUp(sizeof(Slot));
+    }
+
+    char * metadata(size_t index)
+    {
+        return payload(index) + alignUp(header->payloadSize);
+    }
+
+    // the slot whose payload starts at data, or NO_SLOT
+    size_t find(void const * data)
+    {
+        char const * p = static_cast<char const *>(data);
+        char const * first = payload(0);
+        if (p < first || p >= slots + header->slots * stride)
+            return NO_SLOT;
+        size_t offset = static_cast<size_t>(p - first);
+        return offset % stride == 0 ? offset / stride : NO_SLOT;
+    }
+
+    char * base;
+    size_t size;
+    Header * header;
+    Entry * entries;
+    char * slots;
+    size_t stride;
+};
+
+/*
+ * The deleter of a value in a slot: of a value read by a consumer,
+ * which releases its reference to the slot, or of one allocated by
+ * the producer, which can reuse the slot if it was not published.
+ */
+struct NTNDArrayRing::Releaser
+{
+    Releaser(std::tr1::weak_ptr<NTNDArrayRing> const & ring,
+        std::tr1::shared_ptr<Mapping> const & mapping, size_t slot, bool allocated)
+    : ring(ring), mapping(mapping), slot(slot), allocated(allocated)
+    {}
+
+    void operator()(void const *)
+    {
+        if (!allocated) {
+            epics::atomic::decrement(mapping->slot(slot).refs);
+            return;
+        }
+        NTNDArrayRingPtr r(ring.lock());
+        if (r)
+            r->release(slot);
+    }
+
+    std::tr1::weak_ptr<NTNDArrayRing> ring;
+    std::tr1::shared_ptr<Mapping> mapping;
+    size_t slot;
+    bool allocated;
+};
+
+struct NTNDArrayRing::Allocator : public NTNDArrayAllocator
+{
+    explicit Allocator(std::tr1::weak_ptr<NTNDArrayRing> const & ring) : ring(ring) {}
+
+    virtual std::tr1::shared_ptr<void> allocate(size_t size)
+    {
+        NTNDArrayRingPtr r(ring.lock());
+        if (!r || size > r->getPayloadSize())
+            throw std::bad_alloc();
+
+        size_t slot;
+        {
+            Lock xx(r->mutex);
+            slot = r->claim();
+        }
+        if (slot == NO_SLOT)
+            throw std::bad_alloc();
+        return std::tr1::shared_ptr<void>(r->mapping->payload(slot),
+            Releaser(ring, r->mapping, slot, true));
+    }
+
+    std::tr1::weak_ptr<NTNDArrayRing> ring;
+};
+
+bool NTNDArrayRing::isSupported()
+{
+#ifdef NT_RING_SHM
+    return true;
+#else
+    return false;
+#endif
+}
+
+NTNDArrayRing::shared_pointer NTNDArrayRing::create(std::string const & name,
+    StructureConstPtr const & structure, size_t slots, size_t payloadSize,
+    size_t metadataSize)
+{
+    if (!NTNDArray::isCompatible(structure))
+        throw std::runtime_error("structure not compatible with NTNDArray");
+    if (slots == 0)
+        throw std::runtime_error("NTNDArrayRing needs a slot");
+    checkName(name);
+
+    // the entries of the last frames published, at least one per slot
+    size_t entries = 2 * slots;
+    size_t size = Mapping::getSize(slots, entries, payloadSize, metadataSize);
+    if (size == 0 || entries < slots)
+        throw std::runtime_error("NTNDArrayRing " + name + " too large");
+
+    shared_pointer ring(new NTNDArrayRing(name, structure, true));
+    ring->self = ring;
+#ifdef NT_RING_SHM
+    // replaces any ring left by a producer which terminated
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+        throw std::runtime_error("cannot create NTNDArrayRing " + name + ": " + strerror(errno));
+    void * base = MAP_FAILED;
+    int error = ftruncate(fd, static_cast<off_t>(size)) == 0 ? 0 : errno;
+    if (!error) {
+        base = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED)
+            error = errno;
+    }
+    close(fd);
+    if (error) {
+        shm_unlink(name.c_str());
+        throw std::runtime_error("cannot create NTNDArrayRing " + name + ": " + strerror(error));
+    }
+    ring->mapping.reset(new Mapping(base, size));
+#else
+    throw std::runtime_error("NTNDArrayRing not supported on this platform");
+#endif
+
+    Header & header = *ring->mapping->header;
+    header.version = VERSION;
+    header.wordSize = sizeof(size_t);
+    header.fingerprintHigh = ring->fingerprint.getHigh();
+    header.fingerprintLow = ring->fingerprint.getLow();
+    header.slots = slots;
+    header.entries = entries;
+    header.payloadSize = payloadSize;
+    header.metadataSize = metadataSize;
+    ring->mapping->layout();
+    // the consumers only use the ring once they read its magic
+    epicsAtomicWriteMemoryBarrier();
+    header.magic = MAGIC;
+
+    ring->filling.assign(slots, false);
+    ring->held.assign(slots, false);
+    for (size_t i = 0; i < slots; ++i)
+        ring->published.push_back(i);
+    return ring;
+}
+
+NTNDArrayRing::shared_pointer NTNDArrayRing::open(std::string const & name,
+    StructureConstPtr const & structure)
+{
+    checkName(name);
+    shared_pointer ring(new NTNDArrayRing(name, structure, false));
+    ring->self = ring;
+#ifdef NT_RING_SHM
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+        throw std::runtime_error("cannot open NTNDArrayRing " + name + ": " + strerror(errno));
+    struct stat status;
+    void * base = MAP_FAILED;
+    int error = fstat(fd, &status) == 0 ? 0 : errno;
+    size_t size = error ? 0 : static_cast<size_t>(status.st_size);
+    if (!error && size >= sizeof(Header)) {
+        base = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED)
+            error = errno;
+    }
+    close(fd);
+    if (error)
+        throw std::runtime_error("cannot open NTNDArrayRing " + name + ": " + strerror(error));
+    if (base == MAP_FAILED)
+        throw std::runtime_error(name + " is not an NTNDArrayRing");
+    ring->mapping.reset(new Mapping(base, size));
+#else
+    throw std::runtime_error("NTNDArrayRing not supported on this platform");
+#endif
+
+    Header & header = *ring->mapping->header;
+    if (header.magic != MAGIC)
+        throw std::runtime_error(name + " is not an NTNDArrayRing");
+    epicsAtomicReadMemoryBarrier();
+    if (header.version != VERSION || header.wordSize != sizeof(size_t))
+        throw std::runtime_error("NTNDArrayRing " + name + " is of another version or platform");
+    if (NTFingerprint(header.fingerprintHigh, header.fingerprintLow) != ring->fingerprint)
+        throw std::runtime_error("NTNDArrayRing " + name + " is of another structure");
+    if (header.slots == 0 || header.entries < header.slots ||
+        Mapping::getSize(header.slots, header.entries, header.payloadSize,
+            header.metadataSize) != ring->mapping->size)
+        corrupt(name);
+    ring->mapping->layout();
+    ring->next = epics::atomic::get(header.head);
+    return ring;
+}
+
+NTNDArrayRing::NTNDArrayRing(std::string const & name,
+    StructureConstPtr const & structure, bool producer)
+: name(name),
+  structure(structure),
+  fingerprint(NTFingerprint::get(structure)),
+  producer(producer),
+  next(0),
+  lost(0)
+{}
+
+NTNDArrayRing::~NTNDArrayRing()
+{
+#ifdef NT_RING_SHM
+    // the consumers keep their mapping
+    if (producer && mapping)
+        shm_unlink(name.c_str());
+#endif
+}
+
+void NTNDArrayRing::checkStructure(NTNDArray const & frame) const
+{
+    if (NTFingerprint::get(frame.getPVStructure()->getStructure()) != fingerprint)
+        throw std::runtime_error("NTNDArray is not of the structure of NTNDArrayRing " + name);
+}
+
+size_t NTNDArrayRing::claim()
+{
+    if (!spare.empty()) {
+        size_t slot = spare.back();
+        spare.pop_back();
+        held[slot] = true;
+        return slot;
+    }
+
+    for (std::deque<size_t>::iterator it = published.begin(); it != published.end(); ++it)
+    {
+        size_t slot = *it;
+        if (held[slot])
+            continue;
+
+        // makes the generation odd, so that consumers no longer take the
+        // slot, then checks that none holds it, which a consumer does in
+        // the reverse order: with full barriers, one of them backs off
+        Slot & state = mapping->slot(slot);
+        size_t generation = epics::atomic::get(state.generation);
+        epics::atomic::compareAndSwap(state.generation, generation, generation + 1);
+        if (epics::atomic::get(state.refs) != 0) {
+            epics::atomic::set(state.generation, generation);
+            continue;
+        }
+
+        published.erase(it);
+        filling[slot] = true;
+        held[slot] = true;
+        return slot;
+    }
+    return NO_SLOT;
+}
+
+void NTNDArrayRing::release(size_t slot)
+{
+    Lock xx(mutex);
+    held[slot] = false;
+    if (filling[slot])
+        spare.push_back(slot);
+}
+
+NTNDArrayAllocatorPtr NTNDArrayRing::getAllocator()
+{
+    if (!producer)
+        throw std::runtime_error("NTNDArrayRing consumer cannot allocate");
+    return NTNDArrayAllocatorPtr(new Allocator(self));
+}
+
+bool NTNDArrayRing::publish(NTNDArray const & frame)
+{
+    if (!producer)
+        throw std::runtime_error("NTNDArrayRing consumer cannot publish");
+    checkStructure(frame);
+    PVScalarArrayPtr value = frame.getValue()->get<PVScalarArray>();
+    if (!value)
+        throw std::runtime_error("NTNDArray has no value");
+    Payload payload = getPayload(*value);
+    size_t bytes = payload.count * payload.elementSize;
+    if (bytes > mapping->header->payloadSize)
+        throw std::runtime_error("NTNDArray value exceeds the payloadSize of the ring");
+
+    Lock xx(mutex);
+    // a value allocated in a slot, not published yet, is not copied
+    size_t slot = bytes ? mapping->find(payload.data) : NO_SLOT;
+    bool copy = slot == NO_SLOT || !filling[slot] || !held[slot];
+    if (copy) {
+        slot = claim();
+        if (slot == NO_SLOT)
+            return false;
+        held[slot] = false;
+        spare.push_back(slot);
+        if (bytes)
+            std::memcpy(mapping->payload(slot), payload.data, bytes);
+    }
+
+    Slot & state = mapping->slot(slot);
+    state.type = value->getScalarArray()->getElementType();
+    state.count = payload.count;
+
+    ByteBuffer buffer(mapping->metadata(slot), mapping->header->metadataSize);
+    Serializer control(buffer);
+    PVFieldPtrArray const & fields = frame.getPVStructure()->getPVFields();
+    for (PVFieldPtrArray::const_iterator it = fields.begin(); it != fields.end(); ++it)
+    {
+        if ((*it)->getFieldName() != "value")
+            (*it)->serialize(&buffer, &control);
+    }
+    state.metadataLength = buffer.getPosition();
+
+    if (copy)
+        spare.pop_back();
+    filling[slot] = false;
+    published.push_back(slot);
+
+    // the slot, then its entry, then the head are visible to the consumers
+    Header & header = *mapping->header;
+    size_t generation = state.generation + 1;
+    epics::atomic::set(state.generation, generation);
+    size_t sequence = header.head;
+    Entry & entry = mapping->entries[sequence % header.entries];
+    epics::atomic::set(entry.sequence, 0);
+    epics::atomic::set(entry.slot, slot);
+    epics::atomic::set(entry.generation, generation);
+    epics::atomic::set(entry.sequence, sequence + 1);
+    epics::atomic::set(header.head, sequence + 1);
+    return true;
+}
+
+NTNDArrayRing::TakeResult NTNDArrayRing::take(size_t sequence, NTNDArray const & frame)
+{
+    Header & header = *mapping->header;
+    Entry & entry = mapping->entries[sequence % header.entries];
+    size_t first = epics::atomic::get(entry.sequence);
+    epicsAtomicReadMemoryBarrier();
+    size_t slot = epics::atomic::get(entry.slot);
+    size_t generation = epics::atomic::get(entry.generation);
+    epicsAtomicReadMemoryBarrier();
+    if (first != sequence + 1 || epics::atomic::get(entry.sequence) != first)
+        return Skipped;
+    if (slot >= header.slots)
+        corrupt(name);
+
+    // holds the slot, if the producer has not started to reuse it; while
+    // claim() checks the slot, its generation is odd until the producer
+    // either backs off or publishes another frame in it
+    Slot & state = mapping->slot(slot);
+    epics::atomic::increment(state.refs);
+    size_t current = epics::atomic::get(state.generation);
+    if (current != generation) {
+        epics::atomic::decrement(state.refs);
+        return current == generation + 1 ? Busy : Skipped;
+    }
+    epicsAtomicReadMemoryBarrier();
+    Releaser releaser(self, mapping, slot, false);
+
+    size_t count = state.count;
+    ScalarType type = static_cast<ScalarType>(state.type);
+    try {
+        if (state.type > pvDouble || type == pvString ||
+            count > header.payloadSize / ScalarTypeFunc::elementSize(type) ||
+            state.metadataLength > header.metadataSize)
+            corrupt(name);
+
+        ByteBuffer buffer(mapping->metadata(slot), state.metadataLength);
+        Deserializer control(buffer, name);
+        PVFieldPtrArray const & fields = frame.getPVStructure()->getPVFields();
+        for (PVFieldPtrArray::const_iterator it = fields.begin(); it != fields.end(); ++it)
+        {
+            if ((*it)->getFieldName() != "value")
+                (*it)->deserialize(&buffer, &control);
+        }
+    } catch (...) {
+        releaser(0);
+        throw;
+    }
+
+    // from here, the deleter of the value releases the slot
+    PVUnionPtr value = frame.getValue();
+    char * data = mapping->payload(slot);
+    switch (type)
+    {
+#define NT_TAKE(TYPE, T) \
+    case TYPE: \
+        value->select<PVValueArray<T> >(std::string(ScalarTypeFunc::name(type)) + "Value")-> \
+            replace(PVValueArray<T>::const_svector( \
+                std::tr1::shared_ptr<const T>(reinterpret_cast<const T *>(data), releaser), \
+                0, count)); \
+        break;
+    NT_TAKE(pvBoolean, boolean)
+    NT_TAKE(pvByte, int8)
+    NT_TAKE(pvUByte, uint8)
+    NT_TAKE(pvShort, int16)
+    NT_TAKE(pvUShort, uint16)
+    NT_TAKE(pvInt, int32)
+    NT_TAKE(pvUInt, uint32)
+    NT_TAKE(pvLong, int64)
+    NT_TAKE(pvULong, uint64)
+    NT_TAKE(pvFloat, float)
+    NT_TAKE(pvDouble, double)
+#undef NT_TAKE
+    default:
+        break;
+    }
+    return Taken;
+}
+
+bool NTNDArrayRing::read(NTNDArray const & frame, double timeout)
+{
+    if (producer)
+        throw std::runtime_error("NTNDArrayRing producer cannot read");
+    checkStructure(frame);
+
+    Header & header = *mapping->header;
+    epicsUInt64 start = epicsMonotonicGet();
+    for (;;)
+    {
+        {
+            Lock xx(mutex);
+            size_t head = epics::atomic::get(header.head);
+            epicsAtomicReadMemoryBarrier();
+            // the slots of older frames were reused
+            if (head - next > header.slots) {
+                lost += head - header.slots - next;
+                next = head - header.slots;
+            }
+            while (next != head)
+            {
+                TakeResult result = take(next, frame);
+                // retried at the next poll
+                if (result == Busy)
+                    break;
+                ++next;
+                if (result == Taken)
+                    return true;
+                ++lost;
+            }
+        }
+        if (timeout <= 0.0 || (epicsMonotonicGet() - start) * 1e-9 >= timeout)
+            return false;
+        epicsThreadSleep(POLL_PERIOD);
+    }
+}
+
+size_t NTNDArrayRing::getLost() const
+{
+    Lock xx(mutex);
+    return lost;
+}
+
+size_t NTNDArrayRing::getLag() const
+{
+    if (producer)
+        return 0;
+    Lock xx(mutex);
+    return epics::atomic::get(mapping->header->head) - next;
+}
+
+size_t NTNDArrayRing::getPublished() const
+{
+    return epics::atomic::get(mapping->header->head);
+}
+
+size_t NTNDArrayRing::getSlots() const
+{
+    return mapping->header->slots;
+}
+
+size_t NTNDArrayRing::getPayloadSize() const
+{
+    return mapping->header->payloadSize;
+}
+
+size_t NTNDArrayRing::getMetadataSize() const
+{
+    return mapping->header->metadataSize;
+}
+
+}}
@@ -0,0 +1,647 @@
+/* ntndarrayStatistics.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <epicsThread.h>
+
+#include "parallel.h"
+#include "simd.h"
+
+#define epicsExportSharedSymbols
+#include <pv/ntndarrayStatistics.h>
+#include <pv/ntndarrayView.h>
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+const size_t NTNDArrayStatistics::MIN_PARALLEL_ELEMENTS;
+
+namespace {
+
+// the number of elements whose moments are computed at a time
+const size_t CHUNK_ELEMENTS = 1 << 16;
+
+// the maximum number of elements of a part, counted in 32 bits
+const size_t MAX_PART_ELEMENTS = size_t(1) << 31;
+
+// the slot of the histogram of NaN, which is not counted
+const size_t NO_SLOT = size_t(-1);
+
+/*
+ * The count, sum, sum of squared deviations from the mean, minimum
+ * and maximum of elements, merged as by Chan et al.
+ */
+struct Moments
+{
+    Moments()
+    : count(0), sum(0.0), m2(0.0),
+      min(std::numeric_limits<double>::infinity()),
+      max(-std::numeric_limits<double>::infinity())
+    {}
+
+    Moments(size_t count, double sum, double m2, double min, double max)
+    : count(count), sum(sum), m2(m2), min(min), max(max)
+    {}
+
+    void add(Moments const & other)
+    {
+        if (other.count == 0)
+            return;
+        if (count > 0)
+        {
+            double delta = other.sum / other.count - sum / count;
+            m2 += delta * delta * (double(count) * other.count / (count + other.count));
+        }
+        count += other.count;
+        sum += other.sum;
+        m2 += other.m2;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+
+    size_t count;
+    double sum;
+    double m2;
+    double min;
+    double max;
+};
+
+template<typename T>
+double toDouble(T value) { return static_cast<double>(value); }
+
+template<>
+double toDouble(boolean value) { return value ? 1.0 : 0.0; }
+
+/*
+ * The initial minimum and maximum of elements, so that NaN are ignored.
+ */
+template<typename T>
+struct Limits
+{
+    static T highest()
+    {
+        return std::numeric_limits<T>::has_infinity ?
+            std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+    }
+
+    static T lowest()
+    {
+        return std::numeric_limits<T>::is_integer ?
+            std::numeric_limits<T>::min() : -highest();
+    }
+};
+
+/*
+ * The values of 8 and 16-bit integer elements, in increasing order,
+ * whose counts give their statistics and histogram.
+ */
+template<typename T> struct Values { enum { size = 0 }; };
+
+#define NT_VALUES(T, SIZE, INDEX, VALUE) \
+template<> struct Values<T> \
+{ \
+    enum { size = SIZE }; \
+    static size_t index(T v) { return INDEX; } \
+    static int value(size_t i) { return VALUE; } \
+    static int get(T v) { return value(index(v)); } \
+};
+NT_VALUES(boolean, 2, v ? 1 : 0, static_cast<int>(i))
+NT_VALUES(int8, 256, static_cast<uint8>(v) ^ 0x80u, static_cast<int>(i) - 128)
+NT_VALUES(uint8, 256, v, static_cast<int>(i))
+NT_VALUES(int16, 65536, static_cast<uint16>(v) ^ 0x8000u, static_cast<int>(i) - 32768)
+NT_VALUES(uint16, 65536, v, static_cast<int>(i))
+#undef NT_VALUES
+
+/*
+ * Sums the first elements of a chunk of 16-bit elements: xor-ing them
+ * with Bias makes them signed, so that the SSE2 signed instructions
+ * apply, and the sums of their pairs are 32-bit.
+ * Returns the number of elements summed.
+ */
+template<typename T>
+struct Vector
+{
+    static size_t sums(T const *, size_t, int64 &, uint64 &, int &, int &) { return 0; }
+};
+
+#ifdef NT_SSE2
+template<int Bias>
+size_t sums16(void const * data, size_t n, int64 & s1, uint64 & s2, int & min, int & max)
+{
+    __m128i const * in = static_cast<__m128i const *>(data);
+    __m128i bias = _mm_set1_epi16(static_cast<short>(Bias));
+    __m128i ones = _mm_set1_epi16(1);
+    __m128i zero = _mm_setzero_si128();
+    __m128i vmin = _mm_set1_epi16(0x7fff);
+    __m128i vmax = _mm_set1_epi16(-0x8000);
+    __m128i sum = zero;
+    __m128i squares = zero;
+    size_t vectors = n / 8;
+    for (size_t i = 0; i < vectors; ++i)
+    {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128(in + i), bias);
+        vmin = _mm_min_epi16(vmin, v);
+        vmax = _mm_max_epi16(vmax, v);
+        // at most 65536 per pair, 2^31 per chunk
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(v, ones));
+        // at most 2^31 per pair, unsigned
+        __m128i p = _mm_madd_epi16(v, v);
+        squares = _mm_add_epi64(squares, _mm_add_epi64(
+            _mm_unpacklo_epi32(p, zero), _mm_unpackhi_epi32(p, zero)));
+    }
+
+    int32 sums[4];
+    int64 squareSums[2];
+    int16 mins[8];
+    int16 maxs[8];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(sums), sum);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(squareSums), squares);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(mins), vmin);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(maxs), vmax);
+
+    int64 biased = int64(sums[0]) + sums[1] + sums[2] + sums[3];
+    int64 biasedSquares = squareSums[0] + squareSums[1];
+    int64 count = static_cast<int64>(vectors * 8);
+    for (int i = 0; i < 8; ++i) {
+        min = std::min(min, mins[i] + (Bias ? 32768 : 0));
+        max = std::max(max, maxs[i] + (Bias ? 32768 : 0));
+    }
+    if (Bias) {
+        // the sums of (v + 32768) and of its squares
+        s1 += biased + 32768 * count;
+        s2 += static_cast<uint64>(biasedSquares + 65536 * biased + (int64(1) << 30) * count);
+    } else {
+        s1 += biased;
+        s2 += static_cast<uint64>(biasedSquares);
+    }
+    return vectors * 8;
+}
+
+template<>
+struct Vector<uint16>
+{
+    static size_t sums(uint16 const * x, size_t n, int64 & s1, uint64 & s2, int & min, int & max)
+    {
+        return sums16<0x8000>(x, n, s1, s2, min, max);
+    }
+};
+
+template<>
+struct Vector<int16>
+{
+    static size_t sums(int16 const * x, size_t n, int64 & s1, uint64 & s2, int & min, int & max)
+    {
+        return sums16<0>(x, n, s1, s2, min, max);
+    }
+};
+#endif
+
+/*
+ * The moments of the n <= CHUNK_ELEMENTS elements of a chunk, summed
+ * as doubles shifted by the first element.
+ */
+template<typename T, bool Exact = (Values<T>::size != 0)>
+struct Chunk
+{
+    static Moments moments(T const * x, size_t n)
+    {
+        T min = Limits<T>::highest();
+        T max = Limits<T>::lowest();
+        double shift = static_cast<double>(x[0]);
+        if (!(shift - shift == 0.0))
+            shift = 0.0;
+        double s1 = 0.0;
+        double s2 = 0.0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            T v = x[i];
+            min = v < min ? v : min;
+            max = v > max ? v : max;
+            double d = static_cast<double>(v) - shift;
+            s1 += d;
+            s2 += d * d;
+        }
+        return Moments(n, shift * n + s1, s2 - s1 * s1 / n,
+            static_cast<double>(min), static_cast<double>(max));
+    }
+};
+
+/*
+ * The exact moments of the elements of a chunk of 8 or 16-bit integers.
+ */
+template<typename T>
+struct Chunk<T, true>
+{
+    static Moments moments(T const * x, size_t n)
+    {
+        int64 s1 = 0;
+        uint64 s2 = 0;
+        int min = std::numeric_limits<int>::max();
+        int max = std::numeric_limits<int>::min();
+        size_t i = Vector<T>::sums(x, n, s1, s2, min, max);
+        for (; i < n; ++i)
+        {
+            int v = Values<T>::get(x[i]);
+            s1 += v;
+            s2 += static_cast<uint64>(static_cast<int64>(v) * v);
+            min = std::min(min, v);
+            max = std::max(max, v);
+        }
+        // s2 - s1^2 / n, s1^2 fitting in 64 bits for a chunk
+        uint64 square = static_cast<uint64>(s1 < 0 ? -s1 : s1);
+        square *= square;
+        double m2 = double(s2 - square / n) - double(square % n) / n;
+        return Moments(n, double(s1), m2, min, max);
+    }
+};
+
+/*
+ * The bins of a histogram.
+ */
+class Bins
+{
+public:
+    Bins(std::vector<double> const & ranges, bool uniform)
+    : ranges(ranges), uniform(uniform), size(0), low(0.0), scale(0.0)
+    {
+        if (ranges.empty())
+            return;
+        size = ranges.size() - 1;
+        low = ranges.front();
+        scale = size / (ranges.back() - low);
+    }
+
+    /*
+     * Returns the slot of an element: 0 below the first range,
+     * 1 + its bin, or size + 1 from the last range.
+     */
+    size_t slot(double x) const
+    {
+        if (x != x)
+            return NO_SLOT;
+        if (x < low)
+            return 0;
+        if (x >= ranges.back())
+            return size + 1;
+        size_t bin;
+        if (uniform) {
+            bin = std::min(static_cast<size_t>(static_cast<ptrdiff_t>((x - low) * scale)), size - 1);
+            // the rounding of the ranges
+            while (bin > 0 && x < ranges[bin])
+                --bin;
+            while (bin + 1 < size && x >= ranges[bin + 1])
+                ++bin;
+        } else {
+            bin = std::upper_bound(ranges.begin(), ranges.end(), x) - ranges.begin() - 1;
+        }
+        return bin + 1;
+    }
+
+    std::vector<double> const & ranges;
+    bool uniform;
+    size_t size;
+    double low;
+    double scale;
+};
+
+/*
+ * Computes the moments of each chunk, and the histogram of each part,
+ * of consecutive chunks, of a frame.
+ */
+template<typename T>
+class MomentsJob : public detail::ParallelJob
+{
+public:
+    MomentsJob(T const * data, size_t count, size_t parts, Bins const * bins)
+    : data(data), count(count), parts(parts), bins(bins),
+      moments((count + CHUNK_ELEMENTS - 1) / CHUNK_ELEMENTS),
+      histograms(bins ? parts : 0, std::vector<int64>(bins ? bins->size + 2 : 0))
+    {}
+
+    virtual void run(size_t part)
+    {
+        size_t chunks = moments.size();
+        size_t end = (part + 1) * chunks / parts;
+        for (size_t c = part * chunks / parts; c < end; ++c)
+        {
+            T const * x = data + c * CHUNK_ELEMENTS;
+            size_t n = std::min(CHUNK_ELEMENTS, count - c * CHUNK_ELEMENTS);
+            moments[c] = Chunk<T>::moments(x, n);
+            if (!bins)
+                continue;
+            // a copy, whose members are not reloaded after each count
+            Bins const local(*bins);
+            int64 * histogram = &histograms[part][0];
+            for (size_t i = 0; i < n; ++i) {
+                size_t slot = local.slot(toDouble(x[i]));
+                if (slot != NO_SLOT)
+                    ++histogram[slot];
+            }
+        }
+    }
+
+    T const * data;
+    size_t count;
+    size_t parts;
+    Bins const * bins;
+    std::vector<Moments> moments;
+    std::vector<std::vector<int64> > histograms;
+};
+
+/*
+ * Counts the values of each part of a frame of 8 or 16-bit integers.
+ */
+template<typename T>
+class CountJob : public detail::ParallelJob
+{
+public:
+    CountJob(T const * data, size_t count, size_t parts)
+    : data(data), count(count), parts(parts), tables(parts)
+    {}
+
+    virtual void run(size_t part)
+    {
+        std::vector<uint32> & table = tables[part];
+        table.assign(Values<T>::size, 0);
+        size_t end = (part + 1) * count / parts;
+        for (size_t i = part * count / parts; i < end; ++i)
+            ++table[Values<T>::index(data[i])];
+    }
+
+    T const * data;
+    size_t count;
+    size_t parts;
+    std::vector<std::vector<uint32> > tables;
+};
+
+/*
+ * Computes the moments and the histogram of a frame of 8 or 16-bit
+ * integers from the counts of their values.
+ * Returns false for other elements.
+ */
+template<typename T, bool Countable = (Values<T>::size != 0)>
+struct Counter
+{
+    static bool count(T const *, size_t, size_t, unsigned, Bins const &,
+        Moments &, std::vector<int64> &)
+    {
+        return false;
+    }
+};
+
+template<typename T>
+struct Counter<T, true>
+{
+    static bool count(T const * data, size_t count, size_t parts, unsigned threads,
+        Bins const & bins, Moments & moments, std::vector<int64> & histogram)
+    {
+        CountJob<T> job(data, count, parts);
+        detail::runParallel(job, parts, threads);
+
+        std::vector<uint64> counts(Values<T>::size);
+        for (size_t p = 0; p < parts; ++p)
+            for (size_t i = 0; i < counts.size(); ++i)
+                counts[i] += job.tables[p][i];
+
+        int64 sum = 0;
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            if (!counts[i])
+                continue;
+            int value = Values<T>::value(i);
+            sum += value * static_cast<int64>(counts[i]);
+            moments.min = std::min(moments.min, double(value));
+            moments.max = std::max(moments.max, double(value));
+            histogram[bins.slot(value)] += static_cast<int64>(counts[i]);
+        }
+        moments.count = count;
+        moments.sum = double(sum);
+        double mean = count ? moments.sum / count : 0.0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            double d = Values<T>::value(i) - mean;
+            moments.m2 += d * d * double(counts[i]);
+        }
+        return true;
+    }
+};
+
+class Computer
+{
+public:
+    Computer(std::vector<double> const & ranges, bool uniform, unsigned threads,
+        NTNDArrayStatistics::Summary & summary)
+    : ranges(ranges), uniform(uniform), threads(threads), summary(summary)
+    {}
+
+    template<typename T>
+    void compute(NTNDArray const & frame)
+    {
+        NTNDArrayView<T> view(frame);
+        T const * data = view.getData().data();
+        size_t count = view.getData().size();
+
+        // the parts processed by each thread
+        size_t parts = (count + NTNDArrayStatistics::MIN_PARALLEL_ELEMENTS - 1) /
+            NTNDArrayStatistics::MIN_PARALLEL_ELEMENTS;
+        unsigned cpus = threads ? threads : static_cast<unsigned>(epicsThreadGetCPUs());
+        parts = std::min<size_t>(parts, cpus);
+        parts = std::max<size_t>(parts, (count + MAX_PART_ELEMENTS - 1) / MAX_PART_ELEMENTS);
+        parts = std::max<size_t>(parts, 1);
+
+        Bins bins(ranges, uniform);
+        std::vector<int64> histogram(ranges.empty() ? 0 : bins.size + 2);
+
+        Moments moments;
+        if (ranges.empty() ||
+            !Counter<T>::count(data, count, parts, threads, bins, moments, histogram))
+        {
+            MomentsJob<T> job(data, count, parts, ranges.empty() ? 0 : &bins);
+            detail::runParallel(job, parts, threads);
+
+            // in the same order for any number of threads
+            for (size_t c = 0; c < job.moments.size(); ++c)
+                moments.add(job.moments[c]);
+            for (size_t p = 0; p < job.histograms.size(); ++p)
+                for (size_t i = 0; i < histogram.size(); ++i)
+                    histogram[i] += job.histograms[p][i];
+        }
+
+        double nan = std::numeric_limits<double>::quiet_NaN();
+        summary.count = static_cast<int64>(count);
+        summary.total = moments.sum;
+        summary.mean = count ? moments.sum / count : nan;
+        summary.sigma = count ? std::sqrt(std::max(moments.m2, 0.0) / count) : nan;
+        bool found = moments.min <= moments.max;
+        summary.min = found ? moments.min : nan;
+        summary.max = found ? moments.max : nan;
+        summary.first = count ? toDouble(data[0]) : nan;
+        summary.last = count ? toDouble(data[count - 1]) : nan;
+        if (histogram.empty()) {
+            summary.histogram.clear();
+            summary.underflow = summary.overflow = 0;
+        } else {
+            summary.histogram.assign(histogram.begin() + 1, histogram.end() - 1);
+            summary.underflow = histogram.front();
+            summary.overflow = histogram.back();
+        }
+    }
+
+    std::vector<double> const & ranges;
+    bool uniform;
+    unsigned threads;
+    NTNDArrayStatistics::Summary & summary;
+};
+
+}
+
+NTNDArrayStatistics::Summary::Summary()
+: count(0), total(0.0),
+  mean(std::numeric_limits<double>::quiet_NaN()),
+  sigma(std::numeric_limits<double>::quiet_NaN()),
+  min(std::numeric_limits<double>::quiet_NaN()),
+  max(std::numeric_limits<double>::quiet_NaN()),
+  first(std::numeric_limits<double>::quiet_NaN()),
+  last(std::numeric_limits<double>::quiet_NaN()),
+  underflow(0), overflow(0)
+{}
+
+NTNDArrayStatistics::NTNDArrayStatistics()
+: uniform(false), threadCount(0)
+{}
+
+NTNDArrayStatistics & NTNDArrayStatistics::histogram(double low, double high, size_t bins)
+{
+    if (bins == 0 || !(low < high) || !(high - low < std::numeric_limits<double>::infinity()))
+        throw std::runtime_error("NTNDArray histogram has no bin or invalid limits");
+
+    std::vector<double> uniformRanges(bins + 1);
+    for (size_t i = 0; i < bins; ++i)
+        uniformRanges[i] = low + (high - low) * i / bins;
+    uniformRanges[bins] = high;
+    histogram(uniformRanges);
+    uniform = true;
+    return *this;
+}
+
+NTNDArrayStatistics & NTNDArrayStatistics::histogram(std::vector<double> const & ranges)
+{
+    if (ranges.size() == 1)
+        throw std::runtime_error("NTNDArray histogram has no bin");
+    for (size_t i = 1; i < ranges.size(); ++i)
+        if (!(ranges[i - 1] < ranges[i]))
+            throw std::runtime_error("NTNDArray histogram ranges are not increasing");
+
+    this->ranges = ranges;
+    uniform = false;
+    return *this;
+}
+
+NTNDArrayStatistics & NTNDArrayStatistics::threads(unsigned threads)
+{
+    threadCount = threads;
+    return *this;
+}
+
+void NTNDArrayStatistics::compute(NTNDArray const & frame, Summary & summary) const
+{
+    PVScalarArrayPtr value = frame.getValue()->get<PVScalarArray>();
+    if (!value)
+        throw std::runtime_error("NTNDArray has no value");
+
+    Computer computer(ranges, uniform, threadCount, summary);
+    switch (value->getScalarArray()->getElementType())
+    {
+#define NT_COMPUTE(TYPE, T) \
+    case TYPE: \
+        computer.compute<T>(frame); \
+        break;
+    NT_COMPUTE(pvBoolean, boolean)
+    NT_COMPUTE(pvByte, int8)
+    NT_COMPUTE(pvUByte, uint8)
+    NT_COMPUTE(pvShort, int16)
+    NT_COMPUTE(pvUShort, uint16)
+    NT_COMPUTE(pvInt, int32)
+    NT_COMPUTE(pvUInt, uint32)
+    NT_COMPUTE(pvLong, int64)
+    NT_COMPUTE(pvULong, uint64)
+    NT_COMPUTE(pvFloat, float)
+    NT_COMPUTE(pvDouble, double)
+#undef NT_COMPUTE
+    default:
+        throw std::runtime_error("NTNDArray value has no numeric type");
+    }
+}
+
+void NTNDArrayStatistics::compute(NTNDArray const & frame, NTAggregate const & aggregate) const
+{
+    Summary summary;
+    compute(frame, summary);
+    put(frame, summary, aggregate);
+}
+
+void NTNDArrayStatistics::compute(NTNDArray const & frame, NTAggregate const & aggregate,
+    NTHistogram const & histogram) const
+{
+    Summary summary;
+    compute(frame, summary);
+    put(frame, summary, aggregate);
+    put(summary, histogram);
+}
+
+void NTNDArrayStatistics::put(NTNDArray const & frame, Summary const & summary,
+    NTAggregate const & aggregate)
+{
+    aggregate.getValue()->put(summary.mean);
+    aggregate.getN()->put(summary.count);
+
+    PVDoublePtr field = aggregate.getDispersion();
+    if (field)
+        field->put(summary.sigma);
+    field = aggregate.getFirst();
+    if (field)
+        field->put(summary.first);
+    field = aggregate.getLast();
+    if (field)
+        field->put(summary.last);
+    field = aggregate.getMin();
+    if (field)
+        field->put(summary.min);
+    field = aggregate.getMax();
+    if (field)
+        field->put(summary.max);
+
+    PVStructurePtr time = aggregate.getFirstTimeStamp();
+    if (time)
+        time->copyUnchecked(*frame.getDataTimeStamp());
+    time = aggregate.getLastTimeStamp();
+    if (time)
+        time->copyUnchecked(*frame.getDataTimeStamp());
+    time = aggregate.getTimeStamp();
+    PVStructurePtr frameTime = frame.getTimeStamp();
+    if (time && frameTime)
+        time->copyUnchecked(*frameTime);
+}
+
+void NTNDArrayStatistics::put(Summary const & summary, NTHistogram const & histogram) const
+{
+    if (summary.histogram.size() + (ranges.empty() ? 0 : 1) != ranges.size())
+        throw std::runtime_error("NTNDArray statistics do not match the histogram ranges");
+
+    PVDoubleArray::svector histogramRanges(ranges.size());
+    std::copy(ranges.begin(), ranges.end(), histogramRanges.begin());
+    histogram.getRanges()->replace(freeze(histogramRanges));
+
+    PVLongArray::svector counts(summary.histogram.size());
+    std::copy(summary.histogram.begin(), summary.histogram.end(), counts.begin());
+    histogram.getValue()->putFrom(freeze(counts));
+}
+
+}}
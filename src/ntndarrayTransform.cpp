@@ -0,0 +1,473 @@
+/* ntndarrayTransform.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "parallel.h"
+#include "simd.h"
+
+#define epicsExportSharedSymbols
+#include <pv/ntndarrayTransform.h>
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+const size_t NTNDArrayTransform::MIN_PARALLEL_ELEMENTS;
+
+namespace {
+
+// the size of the square tiles of pixels transformed at a time
+const size_t TILE = 64;
+
+/*
+ * An operation as x and y of the image swapped or not, then x and y
+ * of the result reversed or not.
+ */
+struct Geometry
+{
+    bool swap;
+    bool reverseX;
+    bool reverseY;
+};
+
+Geometry getGeometry(NTNDArrayTransform::Operation operation)
+{
+    Geometry geometry = { false, false, false };
+    switch (operation)
+    {
+    case NTNDArrayTransform::none:
+        break;
+    case NTNDArrayTransform::rotate90:
+        geometry.swap = geometry.reverseX = true;
+        break;
+    case NTNDArrayTransform::rotate180:
+        geometry.reverseX = geometry.reverseY = true;
+        break;
+    case NTNDArrayTransform::rotate270:
+        geometry.swap = geometry.reverseY = true;
+        break;
+    case NTNDArrayTransform::flipHorizontal:
+        geometry.reverseX = true;
+        break;
+    case NTNDArrayTransform::flipVertical:
+        geometry.reverseY = true;
+        break;
+    case NTNDArrayTransform::transpose:
+        geometry.swap = true;
+        break;
+    case NTNDArrayTransform::transverse:
+        geometry.swap = geometry.reverseX = geometry.reverseY = true;
+        break;
+    default:
+        throw std::runtime_error("unknown NTNDArrayTransform operation");
+    }
+    return geometry;
+}
+
+/*
+ * The pixels of an RGB1 image, moved as a whole.
+ */
+template<typename T>
+struct Pixel3
+{
+    T value[3];
+};
+
+/*
+ * Transposes square blocks of pixels of Size bytes: the pixels of
+ * a block of the result are read from columns of the source, of
+ * stride 1 or -1.
+ * in points to the source pixel of the first pixel of the block,
+ * sx is the step in the source between pixels of a row of the result,
+ * sy (1 or -1) between its rows, oy the step between rows of the result.
+ */
+template<size_t Size>
+struct Block
+{
+    enum { size = 0 };
+
+    template<typename P>
+    static void transpose(P const *, ptrdiff_t, ptrdiff_t, P *, ptrdiff_t) {}
+};
+
+#ifdef NT_SSE2
+template<>
+struct Block<2>
+{
+    enum { size = 8 };
+
+    template<typename P>
+    static void transpose(P const * in, ptrdiff_t sx, ptrdiff_t sy, P * out, ptrdiff_t oy)
+    {
+        P const * first = sy > 0 ? in : in - 7;
+        __m128i a0 = load(first), a1 = load(first + sx),
+                a2 = load(first + 2 * sx), a3 = load(first + 3 * sx),
+                a4 = load(first + 4 * sx), a5 = load(first + 5 * sx),
+                a6 = load(first + 6 * sx), a7 = load(first + 7 * sx);
+
+        __m128i b0 = _mm_unpacklo_epi16(a0, a1), b1 = _mm_unpackhi_epi16(a0, a1),
+                b2 = _mm_unpacklo_epi16(a2, a3), b3 = _mm_unpackhi_epi16(a2, a3),
+                b4 = _mm_unpacklo_epi16(a4, a5), b5 = _mm_unpackhi_epi16(a4, a5),
+                b6 = _mm_unpacklo_epi16(a6, a7), b7 = _mm_unpackhi_epi16(a6, a7);
+
+        __m128i c0 = _mm_unpacklo_epi32(b0, b2), c1 = _mm_unpackhi_epi32(b0, b2),
+                c2 = _mm_unpacklo_epi32(b1, b3), c3 = _mm_unpackhi_epi32(b1, b3),
+                c4 = _mm_unpacklo_epi32(b4, b6), c5 = _mm_unpackhi_epi32(b4, b6),
+                c6 = _mm_unpacklo_epi32(b5, b7), c7 = _mm_unpackhi_epi32(b5, b7);
+
+        // row i of the transpose of the 8 rows read
+        __m128i rows[8] = {
+            _mm_unpacklo_epi64(c0, c4), _mm_unpackhi_epi64(c0, c4),
+            _mm_unpacklo_epi64(c1, c5), _mm_unpackhi_epi64(c1, c5),
+            _mm_unpacklo_epi64(c2, c6), _mm_unpackhi_epi64(c2, c6),
+            _mm_unpacklo_epi64(c3, c7), _mm_unpackhi_epi64(c3, c7)
+        };
+        for (int i = 0; i < 8; ++i)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + (sy > 0 ? i : 7 - i) * oy), rows[i]);
+    }
+
+    template<typename P>
+    static __m128i load(P const * p)
+    {
+        return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+    }
+};
+
+template<>
+struct Block<4>
+{
+    enum { size = 4 };
+
+    template<typename P>
+    static void transpose(P const * in, ptrdiff_t sx, ptrdiff_t sy, P * out, ptrdiff_t oy)
+    {
+        P const * first = sy > 0 ? in : in - 3;
+        __m128i a0 = load(first), a1 = load(first + sx),
+                a2 = load(first + 2 * sx), a3 = load(first + 3 * sx);
+
+        __m128i b0 = _mm_unpacklo_epi32(a0, a1), b1 = _mm_unpackhi_epi32(a0, a1),
+                b2 = _mm_unpacklo_epi32(a2, a3), b3 = _mm_unpackhi_epi32(a2, a3);
+
+        __m128i rows[4] = {
+            _mm_unpacklo_epi64(b0, b2), _mm_unpackhi_epi64(b0, b2),
+            _mm_unpacklo_epi64(b1, b3), _mm_unpackhi_epi64(b1, b3)
+        };
+        for (int i = 0; i < 4; ++i)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + (sy > 0 ? i : 3 - i) * oy), rows[i]);
+    }
+
+    template<typename P>
+    static __m128i load(P const * p)
+    {
+        return _mm_loadu_si128(reinterpret_cast<__m128i const *>(p));
+    }
+};
+#endif
+
+/*
+ * Transforms the pixels [x0, x1) of the rows [y0, y1) of the result.
+ */
+template<typename P>
+void transformTile(P const * in, ptrdiff_t sx, ptrdiff_t sy, P * out, ptrdiff_t ox, ptrdiff_t oy,
+    size_t x0, size_t x1, size_t y0, size_t y1)
+{
+    for (size_t y = y0; y < y1; ++y)
+    {
+        P const * src = in + static_cast<ptrdiff_t>(y) * sy;
+        P * dst = out + static_cast<ptrdiff_t>(y) * oy;
+        for (size_t x = x0; x < x1; ++x)
+            dst[static_cast<ptrdiff_t>(x) * ox] = src[static_cast<ptrdiff_t>(x) * sx];
+    }
+}
+
+/*
+ * Transforms the rows [y0, y1) of the result, of width pixels:
+ * the pixel (x, y) of the result, out[x * ox + y * oy], is in[x * sx + y * sy].
+ */
+template<typename P>
+void transformRows(P const * in, ptrdiff_t sx, ptrdiff_t sy, P * out, ptrdiff_t ox, ptrdiff_t oy,
+    size_t width, size_t y0, size_t y1)
+{
+    // the rows of the source are rows or reversed rows of the result
+    if (sx == 1 && ox == 1) {
+        for (size_t y = y0; y < y1; ++y)
+            std::memcpy(out + static_cast<ptrdiff_t>(y) * oy,
+                in + static_cast<ptrdiff_t>(y) * sy, width * sizeof(P));
+        return;
+    }
+    if (sx == 1 || sx == -1) {
+        transformTile(in, sx, sy, out, ox, oy, 0, width, y0, y1);
+        return;
+    }
+
+    // the columns of the source are the rows of the result, transposed by tiles
+    typedef Block<sizeof(P)> B;
+    size_t block = ox == 1 && (sy == 1 || sy == -1) ? B::size : 0;
+    for (size_t x0 = 0; x0 < width; x0 += TILE)
+    {
+        size_t x1 = std::min(width, x0 + TILE);
+        size_t xb = x0;
+        size_t yb = y0;
+        if (block)
+        {
+            xb = x0 + (x1 - x0) / block * block;
+            yb = y0 + (y1 - y0) / block * block;
+            for (size_t y = y0; y < yb; y += block)
+                for (size_t x = x0; x < xb; x += block)
+                    B::transpose(in + static_cast<ptrdiff_t>(x) * sx + static_cast<ptrdiff_t>(y) * sy,
+                        sx, sy, out + x + static_cast<ptrdiff_t>(y) * oy, oy);
+        }
+        // the pixels outside whole blocks
+        transformTile(in, sx, sy, out, ox, oy, xb, x1, y0, y1);
+        transformTile(in, sx, sy, out, ox, oy, x0, xb, yb, y1);
+    }
+}
+
+/*
+ * Transforms bands of TILE rows of the planes of an image.
+ */
+template<typename P>
+class TransformJob : public detail::ParallelJob
+{
+public:
+    TransformJob(P const * in, ptrdiff_t sx, ptrdiff_t sy, ptrdiff_t inPlane,
+        P * out, ptrdiff_t ox, ptrdiff_t oy, ptrdiff_t outPlane,
+        size_t width, size_t height)
+    : in(in), sx(sx), sy(sy), inPlane(inPlane),
+      out(out), ox(ox), oy(oy), outPlane(outPlane),
+      width(width), height(height), bands((height + TILE - 1) / TILE)
+    {}
+
+    virtual void run(size_t item)
+    {
+        ptrdiff_t plane = static_cast<ptrdiff_t>(item / bands);
+        size_t y0 = item % bands * TILE;
+        transformRows(in + plane * inPlane, sx, sy, out + plane * outPlane, ox, oy,
+            width, y0, std::min(height, y0 + TILE));
+    }
+
+    P const * in;
+    ptrdiff_t sx;
+    ptrdiff_t sy;
+    ptrdiff_t inPlane;
+    P * out;
+    ptrdiff_t ox;
+    ptrdiff_t oy;
+    ptrdiff_t outPlane;
+    size_t width;
+    size_t height;
+    size_t bands;
+};
+
+class Transformer
+{
+public:
+    Transformer(NTNDArrayTransform const & transform,
+        NTNDArrayAllocator * allocator, unsigned threads,
+        NTNDArray const & source, NTNDArray const & result)
+    : transform(transform), allocator(allocator), threads(threads),
+      source(source), result(result)
+    {}
+
+    template<typename T>
+    void apply()
+    {
+        NTNDArrayView<T> view(source);
+        std::vector<NTNDArrayDimension> resultDimensions;
+        transform.getResultDimensions(view.getDimensions(), resultDimensions);
+
+        // the view of the source in the order of the result
+        size_t x, y;
+        transform.getAxes(view.getDimensions(), x, y);
+        Geometry geometry = getGeometry(transform.getOperation());
+        if (geometry.swap)
+            view = view.swap(x, y);
+        if (geometry.reverseX)
+            view = view.flip(x);
+        if (geometry.reverseY)
+            view = view.flip(y);
+
+        size_t rank = view.getRank();
+        size_t count = view.getNumberOfElements();
+        typename PVValueArray<T>::svector out(
+            NTNDArrayAllocator::allocateArray<T>(allocator, count));
+        if (count > 0)
+        {
+            std::vector<ptrdiff_t> strides(rank);
+            ptrdiff_t stride = 1;
+            for (size_t d = 0; d < rank; ++d) {
+                strides[d] = stride;
+                stride *= static_cast<ptrdiff_t>(view.getSize(d));
+            }
+            std::vector<size_t> origin(rank, 0);
+            T const * in = &view.at(origin);
+            size_t color = rank == 3 ? 3 - x - y : 0;
+            size_t width = view.getSize(x);
+            size_t height = view.getSize(y);
+
+            if (rank == 3 && color == 0 && view.getSize(0) == 3 && view.getStride(0) == 1)
+            {
+                // RGB1, moving whole pixels
+                typedef Pixel3<T> P;
+                run(TransformJob<P>(reinterpret_cast<P const *>(in),
+                    view.getStride(x) / 3, view.getStride(y) / 3, 0,
+                    reinterpret_cast<P *>(out.data()), strides[x] / 3, strides[y] / 3, 0,
+                    width, height), 1, count);
+            }
+            else
+            {
+                size_t planes = rank == 3 ? view.getSize(color) : 1;
+                run(TransformJob<T>(in, view.getStride(x), view.getStride(y),
+                    rank == 3 ? view.getStride(color) : 0,
+                    out.data(), strides[x], strides[y], rank == 3 ? strides[color] : 0,
+                    width, height), planes, count);
+            }
+        }
+
+        int64 size = static_cast<int64>(count * sizeof(T));
+        PVUnionPtr value = result.getValue();
+        value->select<PVValueArray<T> >(std::string(ScalarTypeFunc::name(
+            static_cast<ScalarType>(ScalarTypeID<T>::value))) + "Value")->replace(freeze(out));
+        NTNDArrayDimension::put(result, resultDimensions);
+        result.getCompressedDataSize()->put(size);
+        result.getUncompressedDataSize()->put(size);
+    }
+
+    template<typename P>
+    void run(TransformJob<P> job, size_t planes, size_t count)
+    {
+        detail::runParallel(job, planes * job.bands,
+            count < NTNDArrayTransform::MIN_PARALLEL_ELEMENTS ? 1 : threads);
+    }
+
+    NTNDArrayTransform const & transform;
+    NTNDArrayAllocator * allocator;
+    unsigned threads;
+    NTNDArray const & source;
+    NTNDArray const & result;
+};
+
+}
+
+NTNDArrayTransform::NTNDArrayTransform(Operation operation)
+: operation(operation), axesSet(false), xAxis(0), yAxis(1), threadCount(0)
+{
+    getGeometry(operation);
+}
+
+NTNDArrayTransform & NTNDArrayTransform::axes(size_t x, size_t y)
+{
+    axesSet = true;
+    xAxis = x;
+    yAxis = y;
+    return *this;
+}
+
+NTNDArrayTransform & NTNDArrayTransform::allocator(NTNDArrayAllocatorPtr const & allocator)
+{
+    elementAllocator = allocator;
+    return *this;
+}
+
+NTNDArrayTransform & NTNDArrayTransform::threads(unsigned threads)
+{
+    threadCount = threads;
+    return *this;
+}
+
+void NTNDArrayTransform::getAxes(std::vector<NTNDArrayDimension> const & source,
+    size_t & x, size_t & y) const
+{
+    size_t rank = source.size();
+    if (rank != 2 && rank != 3)
+        throw std::runtime_error("NTNDArray image is not 2-D nor 3-D");
+
+    if (axesSet)
+    {
+        if (xAxis >= rank || yAxis >= rank || xAxis == yAxis)
+            throw std::runtime_error("NTNDArrayTransform axes do not fit the image");
+        x = xAxis;
+        y = yAxis;
+        return;
+    }
+
+    // the color dimension of a 3-D image, the last one if none has size 3
+    size_t color = rank;
+    if (rank == 3)
+    {
+        color = 2;
+        for (size_t d = 0; d < rank; ++d) {
+            if (source[d].size == 3) {
+                color = d;
+                break;
+            }
+        }
+    }
+    x = color == 0 ? 1 : 0;
+    y = color <= 1 ? 2 : 1;
+}
+
+void NTNDArrayTransform::getResultDimensions(std::vector<NTNDArrayDimension> const & source,
+    std::vector<NTNDArrayDimension> & result) const
+{
+    size_t x, y;
+    getAxes(source, x, y);
+    Geometry geometry = getGeometry(operation);
+
+    result = source;
+    if (geometry.swap)
+        std::swap(result[x], result[y]);
+    if (geometry.reverseX)
+        result[x].reverse = !result[x].reverse;
+    if (geometry.reverseY)
+        result[y].reverse = !result[y].reverse;
+}
+
+void NTNDArrayTransform::apply(NTNDArray const & source, NTNDArray const & result) const
+{
+    PVScalarArrayPtr value = source.getValue()->get<PVScalarArray>();
+    if (!value)
+        throw std::runtime_error("NTNDArray has no value");
+
+    Transformer transformer(*this, elementAllocator.get(), threadCount, source, result);
+    switch (value->getScalarArray()->getElementType())
+    {
+#define NT_TRANSFORM(TYPE, T) \
+    case TYPE: \
+        transformer.apply<T>(); \
+        break;
+    NT_TRANSFORM(pvBoolean, boolean)
+    NT_TRANSFORM(pvByte, int8)
+    NT_TRANSFORM(pvUByte, uint8)
+    NT_TRANSFORM(pvShort, int16)
+    NT_TRANSFORM(pvUShort, uint16)
+    NT_TRANSFORM(pvInt, int32)
+    NT_TRANSFORM(pvUInt, uint32)
+    NT_TRANSFORM(pvLong, int64)
+    NT_TRANSFORM(pvULong, uint64)
+    NT_TRANSFORM(pvFloat, float)
+    NT_TRANSFORM(pvDouble, double)
+#undef NT_TRANSFORM
+    default:
+        throw std::runtime_error("NTNDArray value has no numeric type");
+    }
+
+    PVStructurePtr codec = result.getCodec();
+    codec->getSubFieldT<PVString>("name")->put("");
+    codec->getSubFieldT<PVUnion>("parameters")->set(PVFieldPtr());
+
+    if (result.getPVStructure() != source.getPVStructure())
+    {
+        result.getUniqueId()->put(source.getUniqueId()->get());
+        result.getDataTimeStamp()->copyUnchecked(*source.getDataTimeStamp());
+        result.getAttribute()->copyUnchecked(*source.getAttribute());
+    }
+}
+
+}}
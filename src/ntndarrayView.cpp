@@ -0,0 +1,53 @@
+/* ntndarrayView.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#define epicsExportSharedSymbols
+#include <pv/ntndarrayView.h>
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+void NTNDArrayDimension::get(NTNDArray const & ndarray,
+                             std::vector<NTNDArrayDimension> & dimensions)
+{
+    PVStructureArray::const_svector elements(ndarray.getDimension()->view());
+    dimensions.resize(elements.size());
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        PVStructure const & element = *elements[i];
+        NTNDArrayDimension & dimension = dimensions[i];
+        dimension.size = element.getSubFieldT<PVInt>("size")->get();
+        dimension.offset = element.getSubFieldT<PVInt>("offset")->get();
+        dimension.fullSize = element.getSubFieldT<PVInt>("fullSize")->get();
+        dimension.binning = element.getSubFieldT<PVInt>("binning")->get();
+        dimension.reverse = element.getSubFieldT<PVBoolean>("reverse")->get();
+    }
+}
+
+void NTNDArrayDimension::put(NTNDArray const & ndarray,
+                             std::vector<NTNDArrayDimension> const & dimensions)
+{
+    PVStructureArrayPtr pvDimension = ndarray.getDimension();
+    StructureConstPtr structure = pvDimension->getStructureArray()->getStructure();
+
+    // the frozen elements may be shared, so they are replaced, not updated
+    PVStructureArray::svector elements(dimensions.size());
+    for (size_t i = 0; i < dimensions.size(); ++i)
+    {
+        PVStructurePtr element = getPVDataCreate()->createPVStructure(structure);
+        NTNDArrayDimension const & dimension = dimensions[i];
+        element->getSubFieldT<PVInt>("size")->put(dimension.size);
+        element->getSubFieldT<PVInt>("offset")->put(dimension.offset);
+        element->getSubFieldT<PVInt>("fullSize")->put(dimension.fullSize);
+        element->getSubFieldT<PVInt>("binning")->put(dimension.binning);
+        element->getSubFieldT<PVBoolean>("reverse")->put(dimension.reverse);
+        elements[i] = element;
+    }
+    pvDimension->replace(freeze(elements));
+}
+
+}}
@@ -0,0 +1,161 @@
+/* ntprototype.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <epicsAtomic.h>
+
+#include <pv/lock.h>
+
+#define epicsExportSharedSymbols
+#include <pv/ntprototype.h>
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+static PVDataCreatePtr pvDataCreate = getPVDataCreate();
+
+namespace {
+
+PVFieldPtr clone(PVField const & from);
+
+// the elements of the arrays are not frozen, so each instance gets its own
+void cloneElements(PVStructureArray & to, PVStructureArray const & from)
+{
+    PVStructureArray::const_svector elements(from.view());
+    PVStructureArray::svector clones(elements.size());
+    for (size_t i = 0; i < elements.size(); ++i)
+        if (elements[i])
+            clones[i] = std::tr1::static_pointer_cast<PVStructure>(clone(*elements[i]));
+    to.replace(freeze(clones));
+}
+
+void cloneElements(PVUnionArray & to, PVUnionArray const & from)
+{
+    PVUnionArray::const_svector elements(from.view());
+    PVUnionArray::svector clones(elements.size());
+    for (size_t i = 0; i < elements.size(); ++i)
+        if (elements[i])
+            clones[i] = std::tr1::static_pointer_cast<PVUnion>(clone(*elements[i]));
+    to.replace(freeze(clones));
+}
+
+// a field which is not a structure, with the value of another
+PVFieldPtr cloneLeaf(PVField const & from)
+{
+    PVFieldPtr to = pvDataCreate->createPVField(from.getField());
+    switch (from.getField()->getType())
+    {
+    case structureArray:
+        cloneElements(static_cast<PVStructureArray &>(*to),
+            static_cast<PVStructureArray const &>(from));
+        break;
+    case unionArray:
+        cloneElements(static_cast<PVUnionArray &>(*to),
+            static_cast<PVUnionArray const &>(from));
+        break;
+    case union_:
+    {
+        PVUnion const & value = static_cast<PVUnion const &>(from);
+        PVFieldPtr selected = value.get();
+        if (selected)
+            static_cast<PVUnion &>(*to).set(value.getSelectedIndex(), clone(*selected));
+        break;
+    }
+    default:
+        // scalar arrays share their frozen data
+        to->copyUnchecked(from);
+        break;
+    }
+    return to;
+}
+
+// a field with the value of another, in a single walk of its tree
+PVFieldPtr clone(PVField const & from)
+{
+    if (from.getField()->getType() != structure)
+        return cloneLeaf(from);
+
+    PVStructure const & pvStructure = static_cast<PVStructure const &>(from);
+    PVFieldPtrArray const & fields = pvStructure.getPVFields();
+    PVFieldPtrArray clones(fields.size());
+    for (size_t i = 0; i < fields.size(); ++i)
+        clones[i] = clone(*fields[i]);
+    return PVStructurePtr(new PVStructure(pvStructure.getStructure(), clones));
+}
+
+}
+
+NTPrototype::NTPrototype(PVStructurePtr const & pvStructure)
+: prototype(pvDataCreate->createPVStructure(pvStructure)),
+  count(0),
+  prepared(0)
+{
+}
+
+void NTPrototype::prepare()
+{
+    if (epics::atomic::get(prepared))
+        return;
+
+    Lock xx(mutex);
+    if (prepared)
+        return;
+
+    // find the fields which do not hold their default values
+    PVStructurePtr defaults = pvDataCreate->createPVStructure(prototype->getStructure());
+    copied.assign(prototype->getNumberFields(), false);
+    size_t offset = 1;
+    while (offset < prototype->getNumberFields())
+    {
+        PVFieldPtr field = prototype->getSubFieldT(offset);
+        if (field->getField()->getType() == structure)
+        {
+            ++offset;
+            continue;
+        }
+
+        if (!(*field == *defaults->getSubFieldT(offset)))
+        {
+            copied[offset] = true;
+            ++count;
+        }
+        offset = field->getNextFieldOffset();
+    }
+
+    // full barrier, the fields to copy are visible before the flag
+    epics::atomic::compareAndSwap(prepared, 0, 1);
+}
+
+PVFieldPtr NTPrototype::create(PVField const & from) const
+{
+    if (from.getField()->getType() == structure)
+    {
+        PVStructure const & pvStructure = static_cast<PVStructure const &>(from);
+        PVFieldPtrArray const & fields = pvStructure.getPVFields();
+        PVFieldPtrArray created(fields.size());
+        for (size_t i = 0; i < fields.size(); ++i)
+            created[i] = create(*fields[i]);
+        return PVStructurePtr(new PVStructure(pvStructure.getStructure(), created));
+    }
+
+    if (copied[from.getFieldOffset()])
+        return cloneLeaf(from);
+    return pvDataCreate->createPVField(from.getField());
+}
+
+PVStructurePtr NTPrototype::create()
+{
+    prepare();
+    return std::tr1::static_pointer_cast<PVStructure>(create(*prototype));
+}
+
+size_t NTPrototype::getCopiedFieldCount()
+{
+    prepare();
+    return count;
+}
+
+}}
@@ -0,0 +1,226 @@
+/* ntregistry.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <epicsThread.h>
+
+#define epicsExportSharedSymbols
+#include <pv/ntregistry.h>
+#include <pv/ntutils.h>
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+const size_t NTRegistry::TYPE_COUNT;
+
+namespace {
+
+template<typename NT>
+bool isCompatibleCached(StructureConstPtr const & structure)
+{
+    return NT::getCompatibilityCache().isCompatible(structure);
+}
+
+template<typename NT>
+bool wrapAs(PVStructurePtr const & pvStructure, NTVisitor & visitor, bool checkCompatible)
+{
+    typename NT::shared_pointer nt(checkCompatible ?
+        NT::wrap(pvStructure) : NT::wrapUnsafe(pvStructure));
+    if (!nt)
+        return false;
+    visitor.visit(nt);
+    return true;
+}
+
+#define NT_REGISTRY_ENTRY(type, NT) \
+    { type, #NT, &NT::URI, &NT::isCompatible, &isCompatibleCached<NT>, &wrapAs<NT>, \
+      &NT::getCompatibilityCache }
+
+// in the order of NTType, starting at ntScalar
+const NTRegistry::Entry entries[NTRegistry::TYPE_COUNT - 1] = {
+    NT_REGISTRY_ENTRY(ntScalar, NTScalar),
+    NT_REGISTRY_ENTRY(ntScalarArray, NTScalarArray),
+    NT_REGISTRY_ENTRY(ntNameValue, NTNameValue),
+    NT_REGISTRY_ENTRY(ntTable, NTTable),
+    NT_REGISTRY_ENTRY(ntNDArray, NTNDArray),
+    NT_REGISTRY_ENTRY(ntMultiChannel, NTMultiChannel),
+    NT_REGISTRY_ENTRY(ntScalarMultiChannel, NTScalarMultiChannel),
+    NT_REGISTRY_ENTRY(ntMatrix, NTMatrix),
+    NT_REGISTRY_ENTRY(ntEnum, NTEnum),
+    NT_REGISTRY_ENTRY(ntUnion, NTUnion),
+    NT_REGISTRY_ENTRY(ntAggregate, NTAggregate),
+    NT_REGISTRY_ENTRY(ntAttribute, NTAttribute),
+    NT_REGISTRY_ENTRY(ntContinuum, NTContinuum),
+    NT_REGISTRY_ENTRY(ntHistogram, NTHistogram),
+    NT_REGISTRY_ENTRY(ntURI, NTURI),
+    NT_REGISTRY_ENTRY(ntNDArrayAttribute, NTNDArrayAttribute),
+};
+
+#undef NT_REGISTRY_ENTRY
+
+const size_t entryCount = NTRegistry::TYPE_COUNT - 1;
+
+// length of the part of an ID that must match, i.e. without the minor version
+inline size_t keyLength(std::string const & id)
+{
+    return NTUtils::majorLength(id.data(), id.size());
+}
+
+// FNV-1a
+inline size_t hash(const char * key, size_t length)
+{
+    uint32 h = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        h ^= static_cast<unsigned char>(key[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/*
+ * Open addressing hash table from the ID (without minor version) to
+ * the entries. Entries sharing an ID are probed in the order of NTType.
+ */
+class Index
+{
+public:
+    static const size_t SLOTS = 64; // power of two, well above entryCount
+
+    Index()
+    {
+        for (size_t i = 0; i < SLOTS; ++i)
+            slots[i] = -1;
+
+        for (size_t e = 0; e < entryCount; ++e) {
+            std::string const & uri = *entries[e].uri;
+            length[e] = keyLength(uri);
+            size_t i = hash(uri.data(), length[e]) & (SLOTS - 1);
+            while (slots[i] != -1)
+                i = (i + 1) & (SLOTS - 1);
+            slots[i] = static_cast<int>(e);
+        }
+    }
+
+    // all entries matching an ID, returns the number of matches
+    size_t lookup(std::string const & id, NTRegistry::Entry const ** matches,
+                  size_t maxMatches) const
+    {
+        size_t len = keyLength(id);
+        size_t n = 0;
+        for (size_t i = hash(id.data(), len) & (SLOTS - 1);
+             slots[i] != -1 && n < maxMatches;
+             i = (i + 1) & (SLOTS - 1)) {
+            size_t e = static_cast<size_t>(slots[i]);
+            if (length[e] == len && entries[e].uri->compare(0, len, id, 0, len) == 0)
+                matches[n++] = &entries[e];
+        }
+        return n;
+    }
+
+private:
+    int slots[SLOTS];
+    size_t length[entryCount];
+};
+
+Index * registryIndex = 0;
+epicsThreadOnceId registryIndexOnce = EPICS_THREAD_ONCE_INIT;
+
+void createIndex(void *)
+{
+    registryIndex = new Index();
+}
+
+Index const & getIndex()
+{
+    epicsThreadOnce(&registryIndexOnce, &createIndex, 0);
+    return *registryIndex;
+}
+
+// no ID is shared by more than two normative types
+const size_t maxMatches = 2;
+
+NTRegistry::Entry const * identifyEntry(StructureConstPtr const & structure)
+{
+    if (!structure)
+        return NULL;
+
+    NTRegistry::Entry const * matches[maxMatches];
+    size_t n = getIndex().lookup(structure->getID(), matches, maxMatches);
+    if (n == 0)
+        return NULL;
+
+    // prefer the more specific type sharing the ID, if compatible
+    for (size_t i = n - 1; i > 0; --i) {
+        if (matches[i]->isCompatibleCached(structure))
+            return matches[i];
+    }
+    return matches[0];
+}
+
+}
+
+NTRegistry::Entry const * NTRegistry::getEntry(NTType type)
+{
+    if (type <= ntUnknown || static_cast<size_t>(type) >= TYPE_COUNT)
+        return NULL;
+    return &entries[type - 1];
+}
+
+const char * NTRegistry::getName(NTType type)
+{
+    Entry const * entry = getEntry(type);
+    return entry ? entry->name : "unknown";
+}
+
+NTRegistry::Entry const * NTRegistry::find(std::string const & id)
+{
+    Entry const * match;
+    return getIndex().lookup(id, &match, 1) ? match : NULL;
+}
+
+NTType NTRegistry::identify(std::string const & id)
+{
+    Entry const * entry = find(id);
+    return entry ? entry->type : ntUnknown;
+}
+
+NTType NTRegistry::identify(StructureConstPtr const & structure)
+{
+    Entry const * entry = identifyEntry(structure);
+    return entry ? entry->type : ntUnknown;
+}
+
+NTType NTRegistry::identify(PVStructurePtr const & pvStructure)
+{
+    if (!pvStructure)
+        return ntUnknown;
+    return identify(pvStructure->getStructure());
+}
+
+NTType NTRegistry::identifyCompatible(StructureConstPtr const & structure, bool cached)
+{
+    Entry const * entry = identifyEntry(structure);
+    if (!entry)
+        return ntUnknown;
+
+    bool compatible = cached ?
+        entry->isCompatibleCached(structure) : entry->isCompatible(structure);
+    return compatible ? entry->type : ntUnknown;
+}
+
+NTType NTRegistry::wrap(PVStructurePtr const & pvStructure,
+    NTVisitor & visitor, bool checkCompatible)
+{
+    if (!pvStructure)
+        return ntUnknown;
+
+    Entry const * entry = identifyEntry(pvStructure->getStructure());
+    if (!entry || !entry->wrap(pvStructure, visitor, checkCompatible))
+        return ntUnknown;
+    return entry->type;
+}
+
+}}
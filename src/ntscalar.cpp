@@ -4,11 +4,15 @@
  * found in the file LICENSE that is included with the distribution
  */
 
+#include <epicsThread.h>
+
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/ntscalar.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -34,6 +38,18 @@ StructureConstPtr NTScalarBuilder::createStructure()
     if (!valueTypeSet)
         throw std::runtime_error("value type not set");
 
+    StructureKey key(NTScalar::URI);
+    key.add(valueType).add(descriptor).add(alarm).add(timeStamp).
+        add(display).add(control).
+        add(extraFieldNames, extraFields);
+
+    StructureConstPtr s = StructureCache::find(key);
+    if (s)
+    {
+        reset();
+        return s;
+    }
+
     FieldBuilderPtr builder =
             getFieldCreate()->createFieldBuilder()->
                setId(NTScalar::URI)->
@@ -59,7 +75,7 @@ StructureConstPtr NTScalarBuilder::createStructure()
         builder->add(extraFieldNames[i], extraFields[i]);
 
 
-    StructureConstPtr s = builder->createStructure();
+    s = StructureCache::insert(key, builder->createStructure());
 
     reset();
     return s;
@@ -100,6 +116,11 @@ PVStructurePtr NTScalarBuilder::createPVStructure()
     return getPVDataCreate()->createPVStructure(createStructure());
 }
 
+NTPrototypePtr NTScalarBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTScalarPtr NTScalarBuilder::create()
 {
     return NTScalarPtr(new NTScalar(createPVStructure()));
@@ -130,10 +151,12 @@ NTScalarBuilder::shared_pointer NTScalarBuilder::add(string const & name, FieldC
 }
 
 const std::string NTScalar::URI("epics:nt/NTScalar:1.0");
+static const NTTypeKey uriKey(NTScalar::URI);
 
 NTScalar::shared_pointer NTScalar::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntScalar, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -144,7 +167,7 @@ NTScalar::shared_pointer NTScalar::wrapUnsafe(PVStructurePtr const & pvStructure
 
 bool NTScalar::is_a(StructureConstPtr const & structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTScalar::is_a(PVStructurePtr const & pvStructure)
@@ -152,13 +175,8 @@ bool NTScalar::is_a(PVStructurePtr const & pvStructure)
     return is_a(pvStructure->getStructure());
 }
 
-bool NTScalar::isCompatible(StructureConstPtr const &structure)
+Result& NTScalar::isCompatible(Result& result)
 {
-    if (!structure)
-        return false;
-
-    Result result(structure);
-
     return result
         .is<Structure>()
         .has<Scalar>("value")
@@ -166,20 +184,54 @@ bool NTScalar::isCompatible(StructureConstPtr const &structure)
         .maybeHas<&NTField::isAlarm, Structure>("alarm")
         .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp")
         .maybeHas<&NTField::isDisplay, Structure>("display")
-        .maybeHas<&NTField::isControl, Structure>("control")
-        .valid();
+        .maybeHas<&NTField::isControl, Structure>("control");
+}
+
+bool NTScalar::isCompatible(StructureConstPtr const &structure)
+{
+    NTStatistics::Probe probe(ntScalar, NTStatistics::opIsCompatible);
+
+    if (!structure)
+        return probe.result(false);
+
+    static const ValidationPlan plan(&NTScalar::isCompatible);
+
+    return probe.result(plan.validate(structure));
+}
+
+bool NTScalar::isCompatible(StructureConstPtr const &structure, std::string &diagnostics)
+{
+    return diagnose(structure, &NTScalar::isCompatible, diagnostics);
 }
 
 bool NTScalar::isCompatible(PVStructurePtr const & pvStructure)
 {
     if(!pvStructure) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTScalar::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTScalar::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 bool NTScalar::isValid()
 {
-    return true;
+    NTStatistics::Probe probe(ntScalar, NTStatistics::opIsValid);
+
+    return probe.result(true);
 }
 
 NTScalarBuilderPtr NTScalar::createBuilder()
@@ -230,27 +282,27 @@ PVStructurePtr NTScalar::getPVStructure() const
 
 PVStringPtr NTScalar::getDescriptor() const
 {
-    return pvNTScalar->getSubField<PVString>("descriptor");
+    return pvDescriptor;
 }
 
 PVStructurePtr NTScalar::getTimeStamp() const
 {
-    return pvNTScalar->getSubField<PVStructure>("timeStamp");
+    return pvTimeStamp;
 }
 
 PVStructurePtr NTScalar::getAlarm() const
 {
-    return pvNTScalar->getSubField<PVStructure>("alarm");
+    return pvAlarm;
 }
 
 PVStructurePtr NTScalar::getDisplay() const
 {
-    return pvNTScalar->getSubField<PVStructure>("display");
+    return pvDisplay;
 }
 
 PVStructurePtr NTScalar::getControl() const
 {
-    return pvNTScalar->getSubField<PVStructure>("control");
+    return pvControl;
 }
 
 PVFieldPtr NTScalar::getValue() const
@@ -259,7 +311,12 @@ PVFieldPtr NTScalar::getValue() const
 }
 
 NTScalar::NTScalar(PVStructurePtr const & pvStructure) :
-    pvNTScalar(pvStructure), pvValue(pvNTScalar->getSubField("value"))
+    pvNTScalar(pvStructure), pvValue(pvNTScalar->getSubField("value")),
+    pvDescriptor(pvNTScalar->getSubField<PVString>("descriptor")),
+    pvTimeStamp(pvNTScalar->getSubField<PVStructure>("timeStamp")),
+    pvAlarm(pvNTScalar->getSubField<PVStructure>("alarm")),
+    pvDisplay(pvNTScalar->getSubField<PVStructure>("display")),
+    pvControl(pvNTScalar->getSubField<PVStructure>("control"))
 {}
 
 
@@ -4,11 +4,15 @@
  * found in the file LICENSE that is included with the distribution
  */
 
+#include <epicsThread.h>
+
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/ntscalarArray.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -44,6 +48,18 @@ StructureConstPtr NTScalarArrayBuilder::createStructure()
     if (!valueTypeSet)
         throw std::runtime_error("value array element type not set");
 
+    StructureKey key(NTScalarArray::URI);
+    key.add(valueType).add(descriptor).add(alarm).add(timeStamp).
+        add(display).add(control).
+        add(extraFieldNames, extraFields);
+
+    StructureConstPtr s = StructureCache::find(key);
+    if (s)
+    {
+        reset();
+        return s;
+    }
+
     FieldBuilderPtr builder =
             getFieldCreate()->createFieldBuilder()->
                setId(NTScalarArray::URI)->
@@ -69,7 +85,7 @@ StructureConstPtr NTScalarArrayBuilder::createStructure()
         builder->add(extraFieldNames[i], extraFields[i]);
 
 
-    StructureConstPtr s = builder->createStructure();
+    s = StructureCache::insert(key, builder->createStructure());
 
     reset();
     return s;
@@ -110,6 +126,11 @@ PVStructurePtr NTScalarArrayBuilder::createPVStructure()
     return getPVDataCreate()->createPVStructure(createStructure());
 }
 
+NTPrototypePtr NTScalarArrayBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTScalarArrayPtr NTScalarArrayBuilder::create()
 {
     return NTScalarArrayPtr(new NTScalarArray(createPVStructure()));
@@ -139,10 +160,12 @@ NTScalarArrayBuilder::shared_pointer NTScalarArrayBuilder::add(string const & na
 }
 
 const std::string NTScalarArray::URI("epics:nt/NTScalarArray:1.0");
+static const NTTypeKey uriKey(NTScalarArray::URI);
 
 NTScalarArray::shared_pointer NTScalarArray::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntScalarArray, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -153,7 +176,7 @@ NTScalarArray::shared_pointer NTScalarArray::wrapUnsafe(PVStructurePtr const & p
 
 bool NTScalarArray::is_a(StructureConstPtr const & structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTScalarArray::is_a(PVStructurePtr const & pvStructure)
@@ -161,13 +184,8 @@ bool NTScalarArray::is_a(PVStructurePtr const & pvStructure)
     return is_a(pvStructure->getStructure());
 }
 
-bool NTScalarArray::isCompatible(StructureConstPtr const & structure)
+Result& NTScalarArray::isCompatible(Result& result)
 {
-    if (!structure)
-        return false;
-
-    Result result(structure);
-
     return result
         .is<Structure>()
         .has<ScalarArray>("value")
@@ -175,20 +193,54 @@ bool NTScalarArray::isCompatible(StructureConstPtr const & structure)
         .maybeHas<&NTField::isAlarm, Structure>("alarm")
         .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp")
         .maybeHas<&NTField::isDisplay, Structure>("display")
-        .maybeHas<&NTField::isControl, Structure>("control")
-        .valid();
+        .maybeHas<&NTField::isControl, Structure>("control");
+}
+
+bool NTScalarArray::isCompatible(StructureConstPtr const & structure)
+{
+    NTStatistics::Probe probe(ntScalarArray, NTStatistics::opIsCompatible);
+
+    if (!structure)
+        return probe.result(false);
+
+    static const ValidationPlan plan(&NTScalarArray::isCompatible);
+
+    return probe.result(plan.validate(structure));
+}
+
+bool NTScalarArray::isCompatible(StructureConstPtr const & structure, std::string & diagnostics)
+{
+    return diagnose(structure, &NTScalarArray::isCompatible, diagnostics);
 }
 
 bool NTScalarArray::isCompatible(PVStructurePtr const & pvStructure)
 {
     if(!pvStructure) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTScalarArray::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTScalarArray::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 bool NTScalarArray::isValid()
 {
-    return true;
+    NTStatistics::Probe probe(ntScalarArray, NTStatistics::opIsValid);
+
+    return probe.result(true);
 }
 
 NTScalarArrayBuilderPtr NTScalarArray::createBuilder()
@@ -239,27 +291,27 @@ PVStructurePtr NTScalarArray::getPVStructure() const
 
 PVStringPtr NTScalarArray::getDescriptor() const
 {
-    return pvNTScalarArray->getSubField<PVString>("descriptor");
+    return pvDescriptor;
 }
 
 PVStructurePtr NTScalarArray::getTimeStamp() const
 {
-    return pvNTScalarArray->getSubField<PVStructure>("timeStamp");
+    return pvTimeStamp;
 }
 
 PVStructurePtr NTScalarArray::getAlarm() const
 {
-    return pvNTScalarArray->getSubField<PVStructure>("alarm");
+    return pvAlarm;
 }
 
 PVStructurePtr NTScalarArray::getDisplay() const
 {
-    return pvNTScalarArray->getSubField<PVStructure>("display");
+    return pvDisplay;
 }
 
 PVStructurePtr NTScalarArray::getControl() const
 {
-    return pvNTScalarArray->getSubField<PVStructure>("control");
+    return pvControl;
 }
 
 PVFieldPtr NTScalarArray::getValue() const
@@ -268,7 +320,12 @@ PVFieldPtr NTScalarArray::getValue() const
 }
 
 NTScalarArray::NTScalarArray(PVStructurePtr const & pvStructure) :
-    pvNTScalarArray(pvStructure), pvValue(pvNTScalarArray->getSubField("value"))
+    pvNTScalarArray(pvStructure), pvValue(pvNTScalarArray->getSubField("value")),
+    pvDescriptor(pvNTScalarArray->getSubField<PVString>("descriptor")),
+    pvTimeStamp(pvNTScalarArray->getSubField<PVStructure>("timeStamp")),
+    pvAlarm(pvNTScalarArray->getSubField<PVStructure>("alarm")),
+    pvDisplay(pvNTScalarArray->getSubField<PVStructure>("display")),
+    pvControl(pvNTScalarArray->getSubField<PVStructure>("control"))
 {}
 
 
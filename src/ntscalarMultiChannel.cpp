@@ -4,11 +4,16 @@
  * found in the file LICENSE that is included with the distribution
  */
 #include <algorithm>
+
+#include <epicsThread.h>
+
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/ntscalarMultiChannel.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -91,6 +96,19 @@ NTScalarMultiChannelBuilder::shared_pointer NTScalarMultiChannelBuilder::addIsCo
 
 StructureConstPtr NTScalarMultiChannelBuilder::createStructure()
 {
+    StructureKey key(NTScalarMultiChannel::URI);
+    key.add(valueType).add(descriptor).add(alarm).add(timeStamp).
+        add(severity).add(status).add(message).add(secondsPastEpoch).
+        add(nanoseconds).add(userTag).add(isConnected).
+        add(extraFieldNames, extraFields);
+
+    StructureConstPtr st = StructureCache::find(key);
+    if (st)
+    {
+        reset();
+        return st;
+    }
+
     StandardFieldPtr standardField = getStandardField();
     size_t nfields = 2;
     size_t extraCount = extraFieldNames.size();
@@ -157,7 +175,8 @@ StructureConstPtr NTScalarMultiChannelBuilder::createStructure()
         fields[ind++] = extraFields[i];
     }
 
-    StructureConstPtr st = fieldCreate->createStructure(NTScalarMultiChannel::URI,names,fields);
+    st = StructureCache::insert(key,
+        fieldCreate->createStructure(NTScalarMultiChannel::URI,names,fields));
     reset();
     return st;
 }
@@ -167,6 +186,11 @@ PVStructurePtr NTScalarMultiChannelBuilder::createPVStructure()
     return pvDataCreate->createPVStructure(createStructure());
 }
 
+NTPrototypePtr NTScalarMultiChannelBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTScalarMultiChannelPtr NTScalarMultiChannelBuilder::create()
 {
     return NTScalarMultiChannelPtr(new NTScalarMultiChannel(createPVStructure()));
@@ -205,10 +229,12 @@ NTScalarMultiChannelBuilder::shared_pointer NTScalarMultiChannelBuilder::add(str
 }
 
 const std::string NTScalarMultiChannel::URI("epics:nt/NTScalarMultiChannel:1.0");
+static const NTTypeKey uriKey(NTScalarMultiChannel::URI);
 
 NTScalarMultiChannel::shared_pointer NTScalarMultiChannel::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntScalarMultiChannel, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -219,7 +245,7 @@ NTScalarMultiChannel::shared_pointer NTScalarMultiChannel::wrapUnsafe(PVStructur
 
 bool NTScalarMultiChannel::is_a(StructureConstPtr const &structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTScalarMultiChannel::is_a(PVStructurePtr const & pvStructure)
@@ -227,13 +253,8 @@ bool NTScalarMultiChannel::is_a(PVStructurePtr const & pvStructure)
     return is_a(pvStructure->getStructure());
 }
 
-bool NTScalarMultiChannel::isCompatible(StructureConstPtr const & structure)
+Result& NTScalarMultiChannel::isCompatible(Result& result)
 {
-    if (!structure)
-        return false;
-
-    Result result(structure);
-
     return result
         .is<Structure>()
         .has<ScalarArray>("value")
@@ -246,21 +267,55 @@ bool NTScalarMultiChannel::isCompatible(StructureConstPtr const & structure)
         .maybeHas<ScalarArray>("userTag")
         .maybeHas<Scalar>("descriptor")
         .maybeHas<&NTField::isAlarm, Structure>("alarm")
-        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp")
-        .valid();
+        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp");
+}
+
+bool NTScalarMultiChannel::isCompatible(StructureConstPtr const & structure)
+{
+    NTStatistics::Probe probe(ntScalarMultiChannel, NTStatistics::opIsCompatible);
+
+    if (!structure)
+        return probe.result(false);
+
+    static const ValidationPlan plan(&NTScalarMultiChannel::isCompatible);
+
+    return probe.result(plan.validate(structure));
+}
+
+bool NTScalarMultiChannel::isCompatible(StructureConstPtr const & structure, std::string & diagnostics)
+{
+    return diagnose(structure, &NTScalarMultiChannel::isCompatible, diagnostics);
 }
 
 bool NTScalarMultiChannel::isCompatible(PVStructurePtr const &pvStructure)
 {
     if(!pvStructure.get()) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTScalarMultiChannel::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTScalarMultiChannel::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 bool NTScalarMultiChannel::isValid()
 {
+    NTStatistics::Probe probe(ntScalarMultiChannel, NTStatistics::opIsValid);
+
     size_t valueLength = getValue()->getLength();
-    if (getChannelName()->getLength() != valueLength) return false;
+    if (getChannelName()->getLength() != valueLength) return probe.result(false);
 
     PVScalarArrayPtr arrayFields[] = {
           getSeverity(), getStatus(), getMessage(),
@@ -273,9 +328,9 @@ bool NTScalarMultiChannel::isValid()
     {
         arrayField = *pa;
         if (arrayField.get() && arrayField->getLength() != valueLength)
-            return false;
+            return probe.result(false);
     }
-    return true;
+    return probe.result(true);
 }
 
 NTScalarMultiChannelBuilderPtr NTScalarMultiChannel::createBuilder()
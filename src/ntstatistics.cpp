@@ -0,0 +1,302 @@
+/* ntstatistics.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <epicsThread.h>
+#include <epicsExit.h>
+
+#include <pv/lock.h>
+#include <pv/pvTimeStamp.h>
+
+#define epicsExportSharedSymbols
+#include <pv/ntstatistics.h>
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+const size_t NTStatistics::OPERATION_COUNT;
+
+int NTStatistics::enabled = 0;
+
+namespace {
+
+enum Counter { calls, failures, nanoseconds, COUNTER_COUNT };
+
+const char * const operationNames[NTStatistics::OPERATION_COUNT] = {
+    "wrap", "isCompatible", "isValid"
+};
+
+const char * const counterNames[COUNTER_COUNT] = {
+    "Calls", "Failures", "Nanoseconds"
+};
+
+typedef epicsUInt64 Totals[NTRegistry::TYPE_COUNT][NTStatistics::OPERATION_COUNT][COUNTER_COUNT];
+
+void clear(Totals & totals)
+{
+    for (size_t t = 0; t < NTRegistry::TYPE_COUNT; ++t)
+        for (size_t o = 0; o < NTStatistics::OPERATION_COUNT; ++o)
+            for (size_t c = 0; c < COUNTER_COUNT; ++c)
+                totals[t][o][c] = 0;
+}
+
+void add(Totals & totals, Totals const & other)
+{
+    for (size_t t = 0; t < NTRegistry::TYPE_COUNT; ++t)
+        for (size_t o = 0; o < NTStatistics::OPERATION_COUNT; ++o)
+            for (size_t c = 0; c < COUNTER_COUNT; ++c)
+                totals[t][o][c] += other[t][o][c];
+}
+
+/*
+ * The counters of a thread. Only the owning thread writes them, so
+ * updating them does not contend. Other threads read them under a
+ * seqlock: sequence is odd while the owner updates them.
+ */
+struct Block
+{
+    Block() : sequence(0) { clear(counters); }
+
+    void record(size_t type, size_t operation, bool failed, epicsUInt64 ns)
+    {
+        epicsUInt64 * c = counters[type][operation];
+        epics::atomic::increment(sequence);
+        ++c[calls];
+        if (failed)
+            ++c[failures];
+        c[nanoseconds] += ns;
+        epics::atomic::increment(sequence);
+    }
+
+    // adds a consistent copy of the counters to totals
+    void read(Totals & totals) const
+    {
+        Totals copy;
+        for (;;) {
+            size_t before = epics::atomic::get(sequence);
+            epicsAtomicReadMemoryBarrier();
+            if (before % 2 == 0) {
+                for (size_t t = 0; t < NTRegistry::TYPE_COUNT; ++t)
+                    for (size_t o = 0; o < NTStatistics::OPERATION_COUNT; ++o)
+                        for (size_t c = 0; c < COUNTER_COUNT; ++c)
+                            copy[t][o][c] = counters[t][o][c];
+                epicsAtomicReadMemoryBarrier();
+                if (epics::atomic::get(sequence) == before)
+                    break;
+            }
+            epicsThreadSleep(0.0);
+        }
+        add(totals, copy);
+    }
+
+    size_t sequence;
+    Totals counters;
+};
+
+/*
+ * The blocks of the threads which record calls. When an EPICS thread
+ * exits, its counters are added to retired and its block is kept in
+ * spare, for the next thread which records a call. reset() does not
+ * write the blocks, it sets baseline to the totals instead, which
+ * getSnapshot() subtracts.
+ */
+struct Blocks
+{
+    Blocks() : key(epicsThreadPrivateCreate())
+    {
+        clear(retired);
+        clear(baseline);
+    }
+
+    // the totals of all blocks, the mutex being locked
+    void sum(Totals & totals) const
+    {
+        for (size_t t = 0; t < NTRegistry::TYPE_COUNT; ++t)
+            for (size_t o = 0; o < NTStatistics::OPERATION_COUNT; ++o)
+                for (size_t c = 0; c < COUNTER_COUNT; ++c)
+                    totals[t][o][c] = retired[t][o][c];
+        for (size_t i = 0; i < all.size(); ++i)
+            all[i]->read(totals);
+    }
+
+    epicsThreadPrivateId key;
+    Mutex mutex;
+    std::vector<Block *> all;
+    std::vector<Block *> spare;
+    Totals retired;
+    Totals baseline;
+};
+
+Blocks * blocks = 0;
+epicsThreadOnceId blocksOnce = EPICS_THREAD_ONCE_INIT;
+
+void createBlocks(void *)
+{
+    blocks = new Blocks();
+}
+
+Blocks & getBlocks()
+{
+    epicsThreadOnce(&blocksOnce, &createBlocks, 0);
+    return *blocks;
+}
+
+// called by an exiting thread, which no longer writes its block
+void retireBlock(void * arg)
+{
+    Block * block = static_cast<Block *>(arg);
+    Blocks & b = getBlocks();
+    epicsThreadPrivateSet(b.key, 0);
+
+    Lock xx(b.mutex);
+    std::vector<Block *>::iterator it = std::find(b.all.begin(), b.all.end(), block);
+    if (it != b.all.end())
+        b.all.erase(it);
+    add(b.retired, block->counters);
+    clear(block->counters);
+    b.spare.push_back(block);
+}
+
+Block & getBlock()
+{
+    Blocks & b = getBlocks();
+    Block * block = static_cast<Block *>(epicsThreadPrivateGet(b.key));
+    if (!block) {
+        {
+            Lock xx(b.mutex);
+            if (b.spare.empty()) {
+                block = new Block();
+            } else {
+                block = b.spare.back();
+                b.spare.pop_back();
+            }
+            b.all.push_back(block);
+        }
+        epicsThreadPrivateSet(b.key, block);
+        // only EPICS threads run their exit handlers, the blocks of
+        // other threads are kept until the process exits
+        epicsAtThreadExit(&retireBlock, block);
+    }
+    return *block;
+}
+
+}
+
+NTStatistics::Snapshot::Snapshot()
+{
+    for (size_t t = 0; t < NTRegistry::TYPE_COUNT; ++t)
+        cacheHits[t] = cacheMisses[t] = 0;
+}
+
+void NTStatistics::setEnabled(bool enable)
+{
+    epics::atomic::set(enabled, enable ? 1 : 0);
+}
+
+void NTStatistics::record(NTType type, Operation operation, bool failed,
+                          epicsUInt64 ns)
+{
+    getBlock().record(type, operation, failed, ns);
+}
+
+void NTStatistics::getSnapshot(Snapshot & snapshot)
+{
+    snapshot = Snapshot();
+
+    Totals totals;
+    Blocks & b = getBlocks();
+    {
+        Lock xx(b.mutex);
+        b.sum(totals);
+        for (size_t t = 0; t < NTRegistry::TYPE_COUNT; ++t) {
+            for (size_t o = 0; o < OPERATION_COUNT; ++o) {
+                Counters & c = snapshot.counters[t][o];
+                c.calls = totals[t][o][calls] - b.baseline[t][o][calls];
+                c.failures = totals[t][o][failures] - b.baseline[t][o][failures];
+                c.nanoseconds = totals[t][o][nanoseconds] - b.baseline[t][o][nanoseconds];
+            }
+        }
+    }
+
+    for (size_t t = 0; t < NTRegistry::TYPE_COUNT; ++t) {
+        NTRegistry::Entry const * entry = NTRegistry::getEntry(static_cast<NTType>(t));
+        if (!entry)
+            continue;
+        NTCompatibilityCache & cache = entry->getCompatibilityCache();
+        snapshot.cacheHits[t] = cache.getHits();
+        snapshot.cacheMisses[t] = cache.getMisses();
+    }
+}
+
+void NTStatistics::reset()
+{
+    Blocks & b = getBlocks();
+    {
+        Lock xx(b.mutex);
+        b.sum(b.baseline);
+    }
+
+    for (size_t t = 0; t < NTRegistry::TYPE_COUNT; ++t) {
+        NTRegistry::Entry const * entry = NTRegistry::getEntry(static_cast<NTType>(t));
+        if (entry)
+            entry->getCompatibilityCache().resetCounters();
+    }
+}
+
+NTTablePtr NTStatistics::createTable(Snapshot const & snapshot)
+{
+    NTTableBuilderPtr builder = NTTable::createBuilder();
+    builder->addColumn("type", pvString);
+    for (size_t o = 0; o < OPERATION_COUNT; ++o)
+        for (size_t c = 0; c < COUNTER_COUNT; ++c)
+            builder->addColumn(std::string(operationNames[o]) + counterNames[c], pvULong);
+    builder->addColumn("cacheHits", pvULong);
+    builder->addColumn("cacheMisses", pvULong);
+    NTTablePtr table = builder->addTimeStamp()->create();
+
+    // one row per type, ntUnknown excluded
+    const size_t rows = NTRegistry::TYPE_COUNT - 1;
+
+    PVStringArray::svector types(rows);
+    for (size_t r = 0; r < rows; ++r)
+        types[r] = NTRegistry::getName(static_cast<NTType>(r + 1));
+    table->getColumn<PVStringArray>("type")->replace(freeze(types));
+
+    for (size_t o = 0; o < OPERATION_COUNT; ++o) {
+        for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+            PVULongArray::svector values(rows);
+            for (size_t r = 0; r < rows; ++r) {
+                Counters const & counters = snapshot.counters[r + 1][o];
+                values[r] = c == calls ? counters.calls :
+                            c == failures ? counters.failures : counters.nanoseconds;
+            }
+            table->getColumn<PVULongArray>(std::string(operationNames[o]) +
+                counterNames[c])->replace(freeze(values));
+        }
+    }
+
+    PVULongArray::svector hits(rows), misses(rows);
+    for (size_t r = 0; r < rows; ++r) {
+        hits[r] = snapshot.cacheHits[r + 1];
+        misses[r] = snapshot.cacheMisses[r + 1];
+    }
+    table->getColumn<PVULongArray>("cacheHits")->replace(freeze(hits));
+    table->getColumn<PVULongArray>("cacheMisses")->replace(freeze(misses));
+
+    PVTimeStamp pvTimeStamp;
+    if (table->attachTimeStamp(pvTimeStamp)) {
+        TimeStamp timeStamp;
+        timeStamp.getCurrent();
+        pvTimeStamp.set(timeStamp);
+    }
+
+    return table;
+}
+
+}}
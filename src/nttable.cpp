@@ -5,11 +5,16 @@
  */
 
 #include <algorithm>
+
+#include <epicsThread.h>
+
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/nttable.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -18,6 +23,8 @@ namespace epics { namespace nt {
 
 static NTFieldPtr ntField = NTField::get();
 
+const size_t NTTable::npos;
+
 namespace detail {
 
 NTTableBuilder::shared_pointer NTTableBuilder::addColumn(
@@ -35,6 +42,17 @@ NTTableBuilder::shared_pointer NTTableBuilder::addColumn(
 
 StructureConstPtr NTTableBuilder::createStructure()
 {
+    StructureKey key(NTTable::URI);
+    key.add(columnNames, types).add(descriptor).add(alarm).add(timeStamp).
+        add(extraFieldNames, extraFields);
+
+    StructureConstPtr s = StructureCache::find(key);
+    if (s)
+    {
+        reset();
+        return s;
+    }
+
     FieldBuilderPtr builder = getFieldCreate()->createFieldBuilder();
 
     FieldBuilderPtr nestedBuilder =
@@ -62,7 +80,7 @@ StructureConstPtr NTTableBuilder::createStructure()
     for (size_t i = 0; i< extraCount; i++)
         builder->add(extraFieldNames[i], extraFields[i]);
 
-    StructureConstPtr s = builder->createStructure();
+    s = StructureCache::insert(key, builder->createStructure());
 
     reset();
     return s;
@@ -97,6 +115,11 @@ PVStructurePtr NTTableBuilder::createPVStructure()
     return s;
 }
 
+NTPrototypePtr NTTableBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTTablePtr NTTableBuilder::create()
 {
     return NTTablePtr(new NTTable(createPVStructure()));
@@ -126,10 +149,12 @@ NTTableBuilder::shared_pointer NTTableBuilder::add(string const & name, FieldCon
 }
 
 const std::string NTTable::URI("epics:nt/NTTable:1.0");
+static const NTTypeKey uriKey(NTTable::URI);
 
 NTTable::shared_pointer NTTable::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntTable, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -140,7 +165,7 @@ NTTable::shared_pointer NTTable::wrapUnsafe(PVStructurePtr const & pvStructure)
 
 bool NTTable::is_a(StructureConstPtr const & structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTTable::is_a(PVStructurePtr const & pvStructure)
@@ -148,55 +173,78 @@ bool NTTable::is_a(PVStructurePtr const & pvStructure)
     return is_a(pvStructure->getStructure());
 }
 
-bool NTTable::isCompatible(StructureConstPtr const & structure)
-{
-    if (!structure)
-        return false;
-
-    Result result(structure);
+namespace {
+    Result& isColumns(Result& result)
+    {
+        return result.each<ScalarArray>();
+    }
+}
 
-    result
+Result& NTTable::isCompatible(Result& result)
+{
+    return result
         .is<Structure>()
-        .has<Structure>("value")
+        .has<&isColumns, Structure>("value")
         .has<ScalarArray>("labels")
         .maybeHas<Scalar>("descriptor")
         .maybeHas<&NTField::isAlarm, Structure>("alarm")
         .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp");
+}
+
+bool NTTable::isCompatible(StructureConstPtr const & structure)
+{
+    NTStatistics::Probe probe(ntTable, NTStatistics::opIsCompatible);
 
-    StructureConstPtr value(structure->getField<Structure>("value"));
-    if (value) {
-        Result r(value);
-        StringArray const & names(value->getFieldNames());
-        StringArray::const_iterator it;
+    if (!structure)
+        return probe.result(false);
 
-        for (it = names.begin(); it != names.end(); ++it)
-            r.has<ScalarArray>(*it);
+    static const ValidationPlan plan(&NTTable::isCompatible);
 
-        result |= r;
-    }
+    return probe.result(plan.validate(structure));
+}
 
-    return result.valid();
+bool NTTable::isCompatible(StructureConstPtr const & structure, std::string & diagnostics)
+{
+    return diagnose(structure, &NTTable::isCompatible, diagnostics);
 }
 
 bool NTTable::isCompatible(PVStructurePtr const & pvStructure)
 {
     if(!pvStructure) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTTable::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTTable::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 bool NTTable::isValid()
 {
+    NTStatistics::Probe probe(ntTable, NTStatistics::opIsValid);
+
     PVFieldPtrArray const & columns = pvValue->getPVFields();
 
-    if (getLabels()->getLength() != columns.size()) return false;
+    if (getLabels()->getLength() != columns.size()) return probe.result(false);
     bool first = true;
     int length = 0;
     for (PVFieldPtrArray::const_iterator it = columns.begin();
         it != columns.end();++it)
     {
         PVScalarArrayPtr column = std::tr1::dynamic_pointer_cast<PVScalarArray>(*it);
-        if (!column.get()) return false;
+        if (!column.get()) return probe.result(false);
         int colLength = column->getLength();
         if (first)
         {
@@ -204,10 +252,10 @@ bool NTTable::isValid()
             first = false;
         }
         else if (length != colLength)
-            return false;
+            return probe.result(false);
     }
 
-    return true;
+    return probe.result(true);
 }
 
 
@@ -241,22 +289,22 @@ PVStructurePtr NTTable::getPVStructure() const
 
 PVStringPtr NTTable::getDescriptor() const
 {
-    return pvNTTable->getSubField<PVString>("descriptor");
+    return pvDescriptor;
 }
 
 PVStructurePtr NTTable::getTimeStamp() const
 {
-    return pvNTTable->getSubField<PVStructure>("timeStamp");
+    return pvTimeStamp;
 }
 
 PVStructurePtr NTTable::getAlarm() const
 {
-    return pvNTTable->getSubField<PVStructure>("alarm");
+    return pvAlarm;
 }
 
 PVStringArrayPtr NTTable::getLabels() const
 {
-    return pvNTTable->getSubField<PVStringArray>("labels");
+    return pvLabels;
 }
 
 StringArray const & NTTable::getColumnNames() const
@@ -266,12 +314,59 @@ StringArray const & NTTable::getColumnNames() const
 
 PVFieldPtr NTTable::getColumn(std::string const & columnName) const
 {
-    return pvValue->getSubField(columnName);
+    return getColumn(getColumnIndex(columnName));
+}
+
+namespace {
+
+typedef std::pair<std::string const *, size_t> column_t;
+
+struct ColumnNameLess
+{
+    bool operator()(column_t const & a, column_t const & b) const
+    {
+        return *a.first < *b.first;
+    }
+
+    bool operator()(column_t const & a, std::string const & name) const
+    {
+        return *a.first < name;
+    }
+
+    bool operator()(std::string const & name, column_t const & b) const
+    {
+        return name < *b.first;
+    }
+};
+
+}
+
+size_t NTTable::getColumnIndex(std::string const & columnName) const
+{
+    std::vector<column_t>::const_iterator it = std::lower_bound(
+        columnIndex.begin(), columnIndex.end(), columnName, ColumnNameLess());
+    if (it != columnIndex.end() && *it->first == columnName)
+        return it->second;
+    return npos;
 }
 
 NTTable::NTTable(PVStructurePtr const & pvStructure) :
-    pvNTTable(pvStructure), pvValue(pvNTTable->getSubField<PVStructure>("value"))
-{}
+    pvNTTable(pvStructure), pvValue(pvNTTable->getSubField<PVStructure>("value")),
+    pvDescriptor(pvNTTable->getSubField<PVString>("descriptor")),
+    pvTimeStamp(pvNTTable->getSubField<PVStructure>("timeStamp")),
+    pvAlarm(pvNTTable->getSubField<PVStructure>("alarm")),
+    pvLabels(pvNTTable->getSubField<PVStringArray>("labels"))
+{
+    if (!pvValue)
+        return;
+
+    // the names are owned by the structure of the value field
+    StringArray const & names = pvValue->getStructure()->getFieldNames();
+    columnIndex.reserve(names.size());
+    for (size_t i = 0; i < names.size(); ++i)
+        columnIndex.push_back(column_t(&names[i], i));
+    std::sort(columnIndex.begin(), columnIndex.end(), ColumnNameLess());
+}
 
 
 }}
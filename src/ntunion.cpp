@@ -4,11 +4,15 @@
  * found in the file LICENSE that is included with the distribution
  */
 
+#include <epicsThread.h>
+
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/ntunion.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -28,6 +32,17 @@ NTUnionBuilder::shared_pointer NTUnionBuilder::value(UnionConstPtr unionType)
 
 StructureConstPtr NTUnionBuilder::createStructure()
 {
+    StructureKey key(NTUnion::URI);
+    key.add(valueType).add(descriptor).add(alarm).add(timeStamp).
+        add(extraFieldNames, extraFields);
+
+    StructureConstPtr s = StructureCache::find(key);
+    if (s)
+    {
+        reset();
+        return s;
+    }
+
     FieldBuilderPtr builder =
             getFieldCreate()->createFieldBuilder()->
                setId(NTUnion::URI)->
@@ -47,7 +62,7 @@ StructureConstPtr NTUnionBuilder::createStructure()
         builder->add(extraFieldNames[i], extraFields[i]);
 
 
-    StructureConstPtr s = builder->createStructure();
+    s = StructureCache::insert(key, builder->createStructure());
 
     reset();
     return s;
@@ -76,6 +91,11 @@ PVStructurePtr NTUnionBuilder::createPVStructure()
     return getPVDataCreate()->createPVStructure(createStructure());
 }
 
+NTPrototypePtr NTUnionBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTUnionPtr NTUnionBuilder::create()
 {
     return NTUnionPtr(new NTUnion(createPVStructure()));
@@ -106,10 +126,12 @@ NTUnionBuilder::shared_pointer NTUnionBuilder::add(string const & name, FieldCon
 }
 
 const std::string NTUnion::URI("epics:nt/NTUnion:1.0");
+static const NTTypeKey uriKey(NTUnion::URI);
 
 NTUnion::shared_pointer NTUnion::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntUnion, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -120,7 +142,7 @@ NTUnion::shared_pointer NTUnion::wrapUnsafe(PVStructurePtr const & pvStructure)
 
 bool NTUnion::is_a(StructureConstPtr const & structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTUnion::is_a(PVStructurePtr const & pvStructure)
@@ -128,32 +150,61 @@ bool NTUnion::is_a(PVStructurePtr const & pvStructure)
     return is_a(pvStructure->getStructure());
 }
 
-bool NTUnion::isCompatible(StructureConstPtr const &structure)
+Result& NTUnion::isCompatible(Result& result)
 {
-    if (!structure)
-        return false;
-
-    Result result(structure);
-
     return result
         .is<Structure>()
         .has<Union>("value")
         .maybeHas<Scalar>("descriptor")
         .maybeHas<&NTField::isAlarm, Structure>("alarm")
-        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp")
-        .valid();
+        .maybeHas<&NTField::isTimeStamp, Structure>("timeStamp");
+}
+
+bool NTUnion::isCompatible(StructureConstPtr const &structure)
+{
+    NTStatistics::Probe probe(ntUnion, NTStatistics::opIsCompatible);
+
+    if (!structure)
+        return probe.result(false);
+
+    static const ValidationPlan plan(&NTUnion::isCompatible);
+
+    return probe.result(plan.validate(structure));
+}
+
+bool NTUnion::isCompatible(StructureConstPtr const &structure, std::string &diagnostics)
+{
+    return diagnose(structure, &NTUnion::isCompatible, diagnostics);
 }
 
 bool NTUnion::isCompatible(PVStructurePtr const & pvStructure)
 {
     if(!pvStructure) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTUnion::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTUnion::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 bool NTUnion::isValid()
 {
-    return true;
+    NTStatistics::Probe probe(ntUnion, NTStatistics::opIsValid);
+
+    return probe.result(true);
 }
 
 NTUnionBuilderPtr NTUnion::createBuilder()
@@ -186,17 +237,17 @@ PVStructurePtr NTUnion::getPVStructure() const
 
 PVStringPtr NTUnion::getDescriptor() const
 {
-    return pvNTUnion->getSubField<PVString>("descriptor");
+    return pvDescriptor;
 }
 
 PVStructurePtr NTUnion::getTimeStamp() const
 {
-    return pvNTUnion->getSubField<PVStructure>("timeStamp");
+    return pvTimeStamp;
 }
 
 PVStructurePtr NTUnion::getAlarm() const
 {
-    return pvNTUnion->getSubField<PVStructure>("alarm");
+    return pvAlarm;
 }
 
 PVUnionPtr NTUnion::getValue() const
@@ -205,7 +256,10 @@ PVUnionPtr NTUnion::getValue() const
 }
 
 NTUnion::NTUnion(PVStructurePtr const & pvStructure) :
-    pvNTUnion(pvStructure), pvValue(pvNTUnion->getSubField<PVUnion>("value"))
+    pvNTUnion(pvStructure), pvValue(pvNTUnion->getSubField<PVUnion>("value")),
+    pvDescriptor(pvNTUnion->getSubField<PVString>("descriptor")),
+    pvTimeStamp(pvNTUnion->getSubField<PVStructure>("timeStamp")),
+    pvAlarm(pvNTUnion->getSubField<PVStructure>("alarm"))
 {}
 
 
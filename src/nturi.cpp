@@ -5,11 +5,16 @@
  */
 
 #include <algorithm>
+
+#include <epicsThread.h>
+
 #include "validator.h"
+#include "structureCache.h"
 
 #define epicsExportSharedSymbols
 #include <pv/nturi.h>
 #include <pv/ntutils.h>
+#include <pv/ntstatistics.h>
 
 using namespace std;
 using namespace epics::pvData;
@@ -56,6 +61,17 @@ NTURIBuilder::shared_pointer NTURIBuilder::addQueryInt(std::string const & name)
 
 StructureConstPtr NTURIBuilder::createStructure()
 {
+    StructureKey key(NTURI::URI);
+    key.add(authority).add(queryFieldNames, queryTypes).
+        add(extraFieldNames, extraFields);
+
+    StructureConstPtr s = StructureCache::find(key);
+    if (s)
+    {
+        reset();
+        return s;
+    }
+
     FieldBuilderPtr builder = getFieldCreate()->
         createFieldBuilder()->
         setId(NTURI::URI)->
@@ -82,7 +98,7 @@ StructureConstPtr NTURIBuilder::createStructure()
     for (size_t i = 0; i< extraCount; i++)
         builder->add(extraFieldNames[i], extraFields[i]);
 
-    StructureConstPtr s = builder->createStructure();
+    s = StructureCache::insert(key, builder->createStructure());
 
     reset();
     return s;
@@ -99,6 +115,11 @@ PVStructurePtr NTURIBuilder::createPVStructure()
     return getPVDataCreate()->createPVStructure(createStructure());
 }
 
+NTPrototypePtr NTURIBuilder::createPrototype()
+{
+    return NTPrototypePtr(new NTPrototype(createPVStructure()));
+}
+
 NTURIPtr NTURIBuilder::create()
 {
     return NTURIPtr(new NTURI(createPVStructure()));
@@ -126,10 +147,12 @@ NTURIBuilder::shared_pointer NTURIBuilder::add(string const & name, FieldConstPt
 }
 
 const std::string NTURI::URI("epics:nt/NTURI:1.0");
+static const NTTypeKey uriKey(NTURI::URI);
 
 NTURI::shared_pointer NTURI::wrap(PVStructurePtr const & pvStructure)
 {
-    if(!isCompatible(pvStructure)) return shared_pointer();
+    NTStatistics::Probe probe(ntURI, NTStatistics::opWrap);
+    if(!probe.result(isCompatible(pvStructure))) return shared_pointer();
     return wrapUnsafe(pvStructure);
 }
 
@@ -140,7 +163,7 @@ NTURI::shared_pointer NTURI::wrapUnsafe(PVStructurePtr const & pvStructure)
 
 bool NTURI::is_a(StructureConstPtr const & structure)
 {
-    return NTUtils::is_a(structure->getID(), URI);
+    return uriKey.is_a(structure->getID());
 }
 
 bool NTURI::is_a(PVStructurePtr const & pvStructure)
@@ -148,33 +171,38 @@ bool NTURI::is_a(PVStructurePtr const & pvStructure)
     return is_a(pvStructure->getStructure());
 }
 
-bool NTURI::isCompatible(StructureConstPtr const & structure)
-{
-    if (!structure)
-        return false;
-
-    Result result(structure);
+namespace {
+    Result& isQuery(Result& result)
+    {
+        return result.each<Scalar>();
+    }
+}
 
-    result
+Result& NTURI::isCompatible(Result& result)
+{
+    return result
         .is<Structure>()
         .has<Scalar>("scheme")
         .has<Scalar>("path")
         .maybeHas<Scalar>("authority")
-        .maybeHas<Structure>("query");
+        .maybeHas<&isQuery, Structure>("query");
+}
 
-    StructureConstPtr query(structure->getField<Structure>("query"));
-    if (query) {
-        Result r(query);
-        StringArray const & names(query->getFieldNames());
-        StringArray::const_iterator it;
+bool NTURI::isCompatible(StructureConstPtr const & structure)
+{
+    NTStatistics::Probe probe(ntURI, NTStatistics::opIsCompatible);
 
-        for (it = names.begin(); it != names.end(); ++it)
-            r.has<ScalarArray>(*it);
+    if (!structure)
+        return probe.result(false);
 
-        result |= r;
-    }
+    static const ValidationPlan plan(&NTURI::isCompatible);
 
-    return result.valid();
+    return probe.result(plan.validate(structure));
+}
+
+bool NTURI::isCompatible(StructureConstPtr const & structure, std::string & diagnostics)
+{
+    return diagnose(structure, &NTURI::isCompatible, diagnostics);
 }
 
 
@@ -182,12 +210,30 @@ bool NTURI::isCompatible(PVStructurePtr const & pvStructure)
 {
     if(!pvStructure) return false;
 
-    return isCompatible(pvStructure->getStructure());
+    return getCompatibilityCache().isCompatible(pvStructure->getStructure());
+}
+
+namespace {
+    NTCompatibilityCache * compatibilityCache = 0;
+    epicsThreadOnceId compatibilityCacheOnce = EPICS_THREAD_ONCE_INIT;
+
+    void createCompatibilityCache(void *)
+    {
+        compatibilityCache = new NTCompatibilityCache(&NTURI::isCompatible);
+    }
+}
+
+NTCompatibilityCache & NTURI::getCompatibilityCache()
+{
+    epicsThreadOnce(&compatibilityCacheOnce, &createCompatibilityCache, 0);
+    return *compatibilityCache;
 }
 
 bool NTURI::isValid()
 {
-    return true;
+    NTStatistics::Probe probe(ntURI, NTStatistics::opIsValid);
+
+    return probe.result(true);
 }
 
 NTURIBuilderPtr NTURI::createBuilder()
@@ -204,36 +250,41 @@ PVStructurePtr NTURI::getPVStructure() const
 
 PVStringPtr NTURI::getScheme() const
 {
-    return pvNTURI->getSubField<PVString>("scheme");
+    return pvScheme;
 }
 
 PVStringPtr NTURI::getAuthority() const
 {
-    return pvNTURI->getSubField<PVString>("authority");
+    return pvAuthority;
 }
 
 PVStringPtr NTURI::getPath() const
 {
-    return pvNTURI->getSubField<PVString>("path");
+    return pvPath;
 }
 
 PVStructurePtr NTURI::getQuery() const
 {
-    return pvNTURI->getSubField<PVStructure>("query");
+    return pvQuery;
 }
 
 StringArray const & NTURI::getQueryNames() const
 {
-    return pvNTURI->getSubField<PVStructure>("query")->getStructure()->getFieldNames();
+    static const StringArray noNames;
+    return pvQuery ? pvQuery->getStructure()->getFieldNames() : noNames;
 }
 
 PVFieldPtr NTURI::getQueryField(std::string const & name) const
 {
-    return pvNTURI->getSubField("query." + name);
+    return pvQuery ? pvQuery->getSubField(name) : PVFieldPtr();
 }
 
 NTURI::NTURI(PVStructurePtr const & pvStructure) :
-    pvNTURI(pvStructure)
+    pvNTURI(pvStructure),
+    pvScheme(pvNTURI->getSubField<PVString>("scheme")),
+    pvAuthority(pvNTURI->getSubField<PVString>("authority")),
+    pvPath(pvNTURI->getSubField<PVString>("path")),
+    pvQuery(pvNTURI->getSubField<PVStructure>("query"))
 {}
 
 
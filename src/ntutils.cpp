@@ -13,15 +13,21 @@ namespace epics { namespace nt {
 
 bool NTUtils::is_a(const std::string &u1, const std::string &u2)
 {
-    // remove minor for the u1
-    size_t pos1 = u1.find_last_of('.');
-    std::string su1 = (pos1 == string::npos) ? u1 : u1.substr(0, pos1);
+    return is_a(u1.data(), u1.size(), u2.data(), u2.size());
+}
 
-    // remove minor for the u2
-    size_t pos2 = u2.find_last_of('.');
-    std::string su2 = (pos2 == string::npos) ? u2 : u2.substr(0, pos2);
+bool NTUtils::is_a(const char *u1, size_t n1, const char *u2, size_t n2)
+{
+    // compare without the minors
+    size_t m1 = majorLength(u1, n1);
+    size_t m2 = majorLength(u2, n2);
 
-    return su2 == su1;
+    return m1 == m2 && memcmp(u1, u2, m1) == 0;
+}
+
+NTTypeKey::NTTypeKey(const std::string &uri)
+: key(uri, 0, NTUtils::majorLength(uri.data(), uri.size()))
+{
 }
 
 }}
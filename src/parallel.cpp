@@ -0,0 +1,237 @@
+/* parallel.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <epicsThread.h>
+#include <epicsEvent.h>
+#include <epicsAtomic.h>
+#include <pv/lock.h>
+
+#include "parallel.h"
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+namespace detail {
+
+namespace {
+
+class Pool;
+
+/*
+ * The items of one call of runParallel(), run by the calling thread and
+ * the workers which joined it. It lives on the stack of the calling
+ * thread, which waits for the workers to leave it before returning.
+ */
+struct Batch
+{
+    Batch(ParallelJob & job, size_t count)
+    : job(job), count(count), next(0), workers(0), failed(false) {}
+
+    void run()
+    {
+        size_t i;
+        while ((i = epics::atomic::increment(next) - 1) < count)
+        {
+            try {
+                job.run(i);
+            } catch (std::exception & e) {
+                fail(e.what());
+            } catch (...) {
+                fail("unknown exception");
+            }
+        }
+    }
+
+    // keeps the message of the first item which failed
+    void fail(std::string const & message)
+    {
+        Lock guard(mutex);
+        if (!failed) {
+            failed = true;
+            error = message;
+        }
+    }
+
+    ParallelJob & job;
+    size_t count;
+
+    // index of the next item to run
+    size_t next;
+
+    // number of workers running the batch, guarded by the mutex of the pool
+    unsigned workers;
+    // signalled when the last worker leaves
+    epicsEvent left;
+
+    Mutex mutex;
+    bool failed;
+    std::string error;
+};
+
+class Worker : public epicsThreadRunable
+{
+public:
+    explicit Worker(Pool & pool)
+    : pool(pool), batch(0),
+      thread(*this, "ntParallel", epicsThreadGetStackSize(epicsThreadStackMedium))
+    {}
+
+    virtual void run();
+
+    Pool & pool;
+    // the batch to join, set by the pool before it wakes the worker
+    Batch * batch;
+    epicsEvent wakeup;
+    epicsThread thread;
+};
+
+/*
+ * The workers, started on demand and kept for the life of the process.
+ * An idle worker waits on its own event for a batch to join.
+ */
+class Pool
+{
+public:
+    Pool() : count(0), capacity(2 * static_cast<unsigned>(epicsThreadGetCPUs())) {}
+
+    // gives the batch to up to helpers workers, returns how many joined
+    unsigned join(Batch & batch, unsigned helpers)
+    {
+        unsigned joined = 0;
+        Lock guard(mutex);
+        while (joined < helpers)
+        {
+            Worker * worker;
+            if (!idle.empty()) {
+                worker = idle.back();
+                idle.pop_back();
+            } else if (count < capacity) {
+                worker = start();
+                if (!worker)
+                    break;
+            } else {
+                break;
+            }
+            worker->batch = &batch;
+            ++batch.workers;
+            ++joined;
+            worker->wakeup.signal();
+        }
+        return joined;
+    }
+
+    // called by a worker which ran its batch
+    void leave(Worker & worker)
+    {
+        Lock guard(mutex);
+        Batch & batch = *worker.batch;
+        worker.batch = 0;
+        idle.push_back(&worker);
+        // the calling thread checks workers under the mutex before it
+        // returns, so the batch outlives this signal
+        if (--batch.workers == 0)
+            batch.left.signal();
+    }
+
+    // waits for the workers which joined a batch to leave it
+    void wait(Batch & batch)
+    {
+        for (;;)
+        {
+            {
+                Lock guard(mutex);
+                if (batch.workers == 0)
+                    return;
+            }
+            batch.left.wait();
+        }
+    }
+
+    Mutex mutex;
+
+private:
+    // a new worker, or null if no thread can be started
+    Worker * start()
+    {
+        Worker * worker = 0;
+        try {
+            worker = new Worker(*this);
+            worker->thread.start();
+        } catch (...) {
+            delete worker;
+            return 0;
+        }
+        ++count;
+        return worker;
+    }
+
+    std::vector<Worker *> idle;
+    unsigned count;
+    unsigned capacity;
+};
+
+void Worker::run()
+{
+    for (;;)
+    {
+        wakeup.wait();
+        Batch * b;
+        {
+            Lock guard(pool.mutex);
+            b = batch;
+        }
+        if (b) {
+            b->run();
+            pool.leave(*this);
+        }
+    }
+}
+
+Pool * pool = 0;
+epicsThreadOnceId poolOnce = EPICS_THREAD_ONCE_INIT;
+
+void createPool(void *)
+{
+    pool = new Pool();
+}
+
+Pool & getPool()
+{
+    epicsThreadOnce(&poolOnce, &createPool, 0);
+    return *pool;
+}
+
+}
+
+void runParallel(ParallelJob & job, size_t count, unsigned threads)
+{
+    if (threads == 0)
+        threads = epicsThreadGetCPUs();
+    if (threads > count)
+        threads = static_cast<unsigned>(count);
+
+    Batch batch(job, count);
+    if (threads > 1) {
+        Pool & p = getPool();
+        p.join(batch, threads - 1);
+        batch.run();
+        p.wait(batch);
+    } else {
+        batch.run();
+    }
+
+    if (batch.failed)
+        throw std::runtime_error(batch.error);
+}
+
+}
+
+}}
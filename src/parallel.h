@@ -0,0 +1,47 @@
+/* parallel.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+
+namespace epics { namespace nt {
+
+namespace detail {
+
+    /**
+     * Independent items of work, e.g. the chunks of a frame.
+     */
+    class ParallelJob
+    {
+    public:
+        virtual ~ParallelJob() {}
+
+        /**
+         * Processes one item, may be called concurrently for other items.
+         * @param item the index of the item.
+         */
+        virtual void run(size_t item) = 0;
+    };
+
+    /**
+     * Runs the items [0, count) of a job on a number of threads,
+     * the calling thread being one of them, and waits for their completion.
+     * The other threads are the idle workers of a process-wide pool,
+     * which are started once and kept; if none is available, e.g. while
+     * other jobs run, the calling thread runs the remaining items itself.
+     * @param job the job.
+     * @param count the number of items.
+     * @param threads the maximum number of threads, 0 for the number of CPUs.
+     * @throws std::runtime_error with the message of the first exception
+     *         thrown by an item, once all items ran.
+     */
+    void runParallel(ParallelJob & job, size_t count, unsigned threads);
+}
+
+}}
+
+#endif  /* PARALLEL_H */
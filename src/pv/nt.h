@@ -26,6 +26,7 @@
 #include <pv/nthistogram.h>
 #include <pv/nturi.h>
 #include <pv/ntndarrayAttribute.h>
+#include <pv/ntregistry.h>
 
 #endif  /* NT_H */
 
@@ -17,6 +17,8 @@
 #endif
 
 #include <pv/ntfield.h>
+#include <pv/ntcompatibilityCache.h>
+#include <pv/ntprototype.h>
 
 #include <shareLib.h>
 
@@ -114,6 +116,14 @@ namespace detail {
          */
         epics::pvData::PVStructurePtr createPVStructure();
 
+        /**
+         * Creates a prototype of the <b>PVStructure</b> that represents NTAggregate,
+         * to be initialized once and cloned into many instances, see NTPrototype.
+         * This resets this instance state and allows new instance to be created.
+         * @return a new prototype.
+         */
+        NTPrototypePtr createPrototype();
+
         /**
          * Creates a <b>NTAggregate</b> instance.
          * This resets this instance state and allows new instance to be created.
@@ -232,6 +242,21 @@ public:
     static bool isCompatible(
         epics::pvData::StructureConstPtr const &structure);
 
+    /**
+     * Returns whether the specified Structure is compatible with NTAggregate
+     * and describes why not.
+     * <p>
+     * Checks the same as isCompatible(StructureConstPtr const &), but
+     * completely, collecting all the incompatibilities found.
+     *
+     * @param structure the Structure to test
+     * @param diagnostics set to the description of the incompatibilities, empty if none
+     * @return (false,true) if the specified Structure (is not, is) a compatible NTAggregate
+     */
+    static bool isCompatible(
+        epics::pvData::StructureConstPtr const &structure,
+        std::string &diagnostics);
+
     /**
      * Returns whether the specified PVStructure is compatible with NTAggregate.
      * <p>
@@ -244,6 +269,14 @@ public:
     static bool isCompatible(
         epics::pvData::PVStructurePtr const &pvStructure);
 
+    /**
+     * Returns the cache of compatibility verdicts used by
+     * isCompatible(PVStructurePtr const &) and hence by wrap().
+     *
+     * @return the NTAggregate compatibility cache
+     */
+    static NTCompatibilityCache & getCompatibilityCache();
+
     /**
      * Returns whether the wrapped PVStructure is valid with respect to this
      * version of NTAggregate.
@@ -362,8 +395,20 @@ public:
 
 private:
     NTAggregate(epics::pvData::PVStructurePtr const & pvStructure);
+    static Result& isCompatible(Result& result);
     epics::pvData::PVStructurePtr pvNTAggregate;
     epics::pvData::PVDoublePtr pvValue;
+    epics::pvData::PVStringPtr pvDescriptor;
+    epics::pvData::PVStructurePtr pvTimeStamp;
+    epics::pvData::PVStructurePtr pvAlarm;
+    epics::pvData::PVLongPtr pvN;
+    epics::pvData::PVDoublePtr pvDispersion;
+    epics::pvData::PVDoublePtr pvFirst;
+    epics::pvData::PVStructurePtr pvFirstTimeStamp;
+    epics::pvData::PVDoublePtr pvLast;
+    epics::pvData::PVStructurePtr pvLastTimeStamp;
+    epics::pvData::PVDoublePtr pvMax;
+    epics::pvData::PVDoublePtr pvMin;
 
     friend class detail::NTAggregateBuilder;
 };
@@ -17,6 +17,8 @@
 #endif
 
 #include <pv/ntfield.h>
+#include <pv/ntcompatibilityCache.h>
+#include <pv/ntprototype.h>
 
 #include <shareLib.h>
 
@@ -78,6 +80,14 @@ namespace detail {
          */
         epics::pvData::PVStructurePtr createPVStructure();
 
+        /**
+         * Creates a prototype of the <b>PVStructure</b> that represents NTAttribute,
+         * to be initialized once and cloned into many instances, see NTPrototype.
+         * This resets this instance state and allows new instance to be created.
+         * @return a new prototype.
+         */
+        NTPrototypePtr createPrototype();
+
         /**
          * Creates a <b>NTAttribute</b> instance.
          * This resets this instance state and allows new instance to be created.
@@ -190,6 +200,21 @@ public:
     static bool isCompatible(
         epics::pvData::StructureConstPtr const &structure);
 
+    /**
+     * Returns whether the specified Structure is compatible with NTAttribute
+     * and describes why not.
+     * <p>
+     * Checks the same as isCompatible(StructureConstPtr const &), but
+     * completely, collecting all the incompatibilities found.
+     *
+     * @param structure the Structure to test
+     * @param diagnostics set to the description of the incompatibilities, empty if none
+     * @return (false,true) if the specified Structure (is not, is) a compatible NTAttribute
+     */
+    static bool isCompatible(
+        epics::pvData::StructureConstPtr const &structure,
+        std::string &diagnostics);
+
     /**
      * Returns whether the specified PVStructure is compatible with NTAttribute.
      * <p>
@@ -202,6 +227,14 @@ public:
     static bool isCompatible(
         epics::pvData::PVStructurePtr const &pvStructure);
 
+    /**
+     * Returns the cache of compatibility verdicts used by
+     * isCompatible(PVStructurePtr const &) and hence by wrap().
+     *
+     * @return the NTAttribute compatibility cache
+     */
+    static NTCompatibilityCache & getCompatibilityCache();
+
     /**
      * Returns whether the wrapped PVStructure is valid with respect to this
      * version of NTAttribute.
@@ -284,8 +317,14 @@ public:
 
 private:
     NTAttribute(epics::pvData::PVStructurePtr const & pvStructure);
+    static Result& isCompatible(Result& result);
     epics::pvData::PVStructurePtr pvNTAttribute;
     epics::pvData::PVUnionPtr pvValue;
+    epics::pvData::PVStringPtr pvDescriptor;
+    epics::pvData::PVStructurePtr pvTimeStamp;
+    epics::pvData::PVStructurePtr pvAlarm;
+    epics::pvData::PVStringPtr pvName;
+    epics::pvData::PVStringArrayPtr pvTags;
 
     friend class detail::NTAttributeBuilder;
 };
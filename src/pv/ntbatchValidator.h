@@ -0,0 +1,100 @@
+/* ntbatchValidator.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTBATCHVALIDATOR_H
+#define NTBATCHVALIDATOR_H
+
+#include <vector>
+#include <string>
+
+#ifdef epicsExportSharedSymbols
+#   define ntbatchValidatorEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/pvIntrospect.h>
+
+#ifdef ntbatchValidatorEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntbatchValidatorEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+/**
+ * @brief Checks the compatibility of many structures at once.
+ *
+ * Structurally identical structures, whether the same introspection
+ * interface or created independently, are checked only once and the
+ * distinct ones are checked by a pool of worker threads, e.g.
+@code
+    std::vector<bool> verdicts;
+    NTBatchValidator::isCompatible(structures, &NTScalar::isCompatible, verdicts);
+@endcode
+ */
+class epicsShareClass NTBatchValidator
+{
+public:
+    /**
+     * A compatibility check, e.g. NTScalar::isCompatible.
+     */
+    typedef bool (*check_t)(epics::pvData::StructureConstPtr const &);
+
+    /**
+     * A compatibility check describing the incompatibilities,
+     * e.g. NTScalar::isCompatible.
+     */
+    typedef bool (*diagnose_t)(epics::pvData::StructureConstPtr const &, std::string &);
+
+    /**
+     * Below this number of distinct structures, the checks are run
+     * by the calling thread only.
+     */
+    static const size_t MIN_PARALLEL = 64;
+
+    /**
+     * Checks the compatibility of each of the specified structures.
+     *
+     * @param structures the structures to check, may contain nulls,
+     * which are not compatible.
+     * @param check the compatibility check, it must be thread safe.
+     * @param verdicts set to the verdict of each structure, in order.
+     * @param threads the maximum number of threads checking, including
+     * the calling thread, 0 for the number of CPUs.
+     * @return the number of distinct structures checked.
+     */
+    static size_t isCompatible(
+        std::vector<epics::pvData::StructureConstPtr> const & structures,
+        check_t check, std::vector<bool> & verdicts, unsigned threads = 0);
+
+    /**
+     * Checks the compatibility of each of the specified structures
+     * and describes the incompatibilities.
+     *
+     * @param structures the structures to check, may contain nulls,
+     * which are not compatible.
+     * @param check the compatibility check, it must be thread safe.
+     * @param verdicts set to the verdict of each structure, in order.
+     * @param diagnostics set to the description of the incompatibilities
+     * of each structure, in order, empty if compatible.
+     * @param threads the maximum number of threads checking, including
+     * the calling thread, 0 for the number of CPUs.
+     * @return the number of distinct structures checked.
+     */
+    static size_t isCompatible(
+        std::vector<epics::pvData::StructureConstPtr> const & structures,
+        diagnose_t check, std::vector<bool> & verdicts,
+        std::vector<std::string> & diagnostics, unsigned threads = 0);
+
+private:
+    // disable object creation
+    NTBatchValidator() {}
+};
+
+}}
+
+#endif  /* NTBATCHVALIDATOR_H */
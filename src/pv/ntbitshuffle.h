@@ -0,0 +1,108 @@
+/* ntbitshuffle.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTBITSHUFFLE_H
+#define NTBITSHUFFLE_H
+
+#include <cstddef>
+
+#ifdef epicsExportSharedSymbols
+#   define ntbitshuffleEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/pvType.h>
+
+#ifdef ntbitshuffleEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntbitshuffleEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+/**
+ * @brief Bit transposition of integer elements, as done by the
+ * bitshuffle filter.
+ *
+ * The elements are processed in blocks. The bits of a block are
+ * regrouped by significance: the bit 0 of the byte 0 of all elements
+ * first, then their bit 1, and so on up to the last bit of the last
+ * byte. For elements whose high bits vary little, e.g. detector counts,
+ * this produces long runs of zero bytes, which a fast LZ compressor
+ * then compresses well. The "nt-bslz4" NTNDArrayCodec does this.
+ * <p>
+ * The number of elements of a block is a multiple of 8; the
+ * count % 8 last elements of the last block are copied as they are.
+ * The transposition uses SSE2 or AVX2 instructions when available.
+ */
+class epicsShareClass NTBitshuffle
+{
+public:
+    /**
+     * The implementations of the transposition.
+     */
+    enum Kernel
+    {
+        scalar,
+        sse2,
+        avx2
+    };
+
+    /**
+     * The default size, in bytes, of a block.
+     */
+    static const size_t DEFAULT_BLOCK_BYTES = 8192;
+
+    /**
+     * Returns the fastest kernel supported by the CPU.
+     * @return the kernel.
+     */
+    static Kernel getKernel();
+
+    /**
+     * Returns the default number of elements of a block.
+     * @param elementSize the size in bytes of an element.
+     * @return DEFAULT_BLOCK_BYTES / elementSize, rounded down to a multiple of 8.
+     */
+    static size_t getDefaultBlockSize(size_t elementSize);
+
+    /**
+     * Transposes the bits of elements.
+     * @param in the elements.
+     * @param out set to the transposed elements, of the same size.
+     * @param count the number of elements.
+     * @param elementSize the size in bytes of an element.
+     * @param blockSize the number of elements of a block, a multiple of 8.
+     * @param kernel the implementation, the fastest one supported
+     *        if it is not supported.
+     * @throws std::runtime_error if blockSize is not a positive multiple of 8.
+     */
+    static void shuffle(epics::pvData::uint8 const * in, epics::pvData::uint8 * out,
+        size_t count, size_t elementSize, size_t blockSize, Kernel kernel = avx2);
+
+    /**
+     * Reverts shuffle().
+     * @param in the transposed elements.
+     * @param out set to the elements, of the same size.
+     * @param count the number of elements.
+     * @param elementSize the size in bytes of an element.
+     * @param blockSize the number of elements of a block, as given to shuffle().
+     * @param kernel the implementation, the fastest one supported
+     *        if it is not supported.
+     * @throws std::runtime_error if blockSize is not a positive multiple of 8.
+     */
+    static void unshuffle(epics::pvData::uint8 const * in, epics::pvData::uint8 * out,
+        size_t count, size_t elementSize, size_t blockSize, Kernel kernel = avx2);
+
+private:
+    // disable object creation
+    NTBitshuffle() {}
+};
+
+}}
+
+#endif  /* NTBITSHUFFLE_H */
@@ -0,0 +1,136 @@
+/* ntcompatibilityCache.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTCOMPATIBILITYCACHE_H
+#define NTCOMPATIBILITYCACHE_H
+
+#include <map>
+#include <deque>
+
+#ifdef epicsExportSharedSymbols
+#   define ntcompatibilityCacheEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/lock.h>
+#include <pv/pvIntrospect.h>
+
+#ifdef ntcompatibilityCacheEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntcompatibilityCacheEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+class NTCompatibilityCache;
+typedef std::tr1::shared_ptr<NTCompatibilityCache> NTCompatibilityCachePtr;
+
+/**
+ * @brief Bounded, thread-safe cache of isCompatible() verdicts.
+ *
+ * Verdicts are keyed on the identity of the introspection interface,
+ * so a repeated check of an already seen Structure costs one lookup.
+ * The cache holds a reference to each Structure it knows about, which
+ * guarantees that an entry can not be confused with a different
+ * Structure later allocated at the same address.
+ * When full, the oldest entry is evicted.
+ */
+class epicsShareClass NTCompatibilityCache
+{
+public:
+    POINTER_DEFINITIONS(NTCompatibilityCache);
+
+    /**
+     * The (uncached) compatibility check, e.g. NTScalar::isCompatible.
+     */
+    typedef bool (*check_t)(epics::pvData::StructureConstPtr const &);
+
+    /**
+     * Default maximum number of cached verdicts.
+     */
+    static const size_t DEFAULT_CAPACITY = 1024;
+
+    /**
+     * Creates a cache in front of the specified check.
+     * @param check the compatibility check whose verdicts are cached.
+     * @param capacity the maximum number of cached verdicts.
+     */
+    NTCompatibilityCache(check_t check, size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * Returns whether the specified Structure is compatible, running
+     * the check only if no verdict for it is cached.
+     * @param structure the Structure to test.
+     * @return (false,true) if the Structure (is not, is) compatible.
+     */
+    bool isCompatible(epics::pvData::StructureConstPtr const & structure);
+
+    /**
+     * Returns the number of checks answered from the cache.
+     * @return the number of hits.
+     */
+    size_t getHits() const;
+
+    /**
+     * Returns the number of checks which had to run the check.
+     * @return the number of misses.
+     */
+    size_t getMisses() const;
+
+    /**
+     * Returns the number of cached verdicts.
+     * @return the number of entries.
+     */
+    size_t size() const;
+
+    /**
+     * Returns the maximum number of cached verdicts.
+     * @return the capacity.
+     */
+    size_t getCapacity() const;
+
+    /**
+     * Sets the maximum number of cached verdicts, evicting the oldest
+     * entries if needed. A capacity of zero disables caching.
+     * @param capacity the new capacity.
+     */
+    void setCapacity(size_t capacity);
+
+    /**
+     * Drops all cached verdicts. The counters are not affected.
+     */
+    void clear();
+
+    /**
+     * Resets the hit and miss counters to zero.
+     */
+    void resetCounters();
+
+private:
+    NTCompatibilityCache(NTCompatibilityCache const &);
+    NTCompatibilityCache & operator=(NTCompatibilityCache const &);
+
+    void evict(size_t maxSize);
+
+    typedef std::pair<epics::pvData::StructureConstPtr, bool> entry_t;
+    typedef std::map<epics::pvData::Structure const *, entry_t> entries_t;
+
+    check_t check;
+    size_t capacity;
+    size_t hits;
+    size_t misses;
+
+    entries_t entries;
+    // insertion order, oldest first
+    std::deque<epics::pvData::Structure const *> order;
+
+    mutable epics::pvData::Mutex mutex;
+};
+
+}}
+
+#endif  /* NTCOMPATIBILITYCACHE_H */
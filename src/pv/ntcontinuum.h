@@ -17,6 +17,8 @@
 #endif
 
 #include <pv/ntfield.h>
+#include <pv/ntcompatibilityCache.h>
+#include <pv/ntprototype.h>
 
 #include <shareLib.h>
 
@@ -73,6 +75,14 @@ namespace detail {
          */
         epics::pvData::PVStructurePtr createPVStructure();
 
+        /**
+         * Creates a prototype of the <b>PVStructure</b> that represents NTContinuum,
+         * to be initialized once and cloned into many instances, see NTPrototype.
+         * This resets this instance state and allows new instance to be created.
+         * @return a new prototype.
+         */
+        NTPrototypePtr createPrototype();
+
         /**
          * Creates a <b>NTContinuum</b> instance.
          * This resets this instance state and allows new instance to be created.
@@ -184,6 +194,21 @@ public:
     static bool isCompatible(
         epics::pvData::StructureConstPtr const &structure);
 
+    /**
+     * Returns whether the specified Structure is compatible with NTContinuum
+     * and describes why not.
+     * <p>
+     * Checks the same as isCompatible(StructureConstPtr const &), but
+     * completely, collecting all the incompatibilities found.
+     *
+     * @param structure the Structure to test
+     * @param diagnostics set to the description of the incompatibilities, empty if none
+     * @return (false,true) if the specified Structure (is not, is) a compatible NTContinuum
+     */
+    static bool isCompatible(
+        epics::pvData::StructureConstPtr const &structure,
+        std::string &diagnostics);
+
     /**
      * Returns whether the specified PVStructure is compatible with NTContinuum.
      * <p>
@@ -196,6 +221,14 @@ public:
     static bool isCompatible(
         epics::pvData::PVStructurePtr const &pvStructure);
 
+    /**
+     * Returns the cache of compatibility verdicts used by
+     * isCompatible(PVStructurePtr const &) and hence by wrap().
+     *
+     * @return the NTContinuum compatibility cache
+     */
+    static NTCompatibilityCache & getCompatibilityCache();
+
     /**
      * Returns whether the wrapped structure is valid with respect to this
      * version of NTContinuum.
@@ -278,8 +311,14 @@ public:
 
 private:
     NTContinuum(epics::pvData::PVStructurePtr const & pvStructure);
+    static Result& isCompatible(Result& result);
     epics::pvData::PVStructurePtr pvNTContinuum;
     epics::pvData::PVDoubleArrayPtr pvValue;
+    epics::pvData::PVStringPtr pvDescriptor;
+    epics::pvData::PVStructurePtr pvTimeStamp;
+    epics::pvData::PVStructurePtr pvAlarm;
+    epics::pvData::PVDoubleArrayPtr pvBase;
+    epics::pvData::PVStringArrayPtr pvUnits;
 
     friend class detail::NTContinuumBuilder;
 };
@@ -17,6 +17,8 @@
 #endif
 
 #include <pv/ntfield.h>
+#include <pv/ntcompatibilityCache.h>
+#include <pv/ntprototype.h>
 
 #include <shareLib.h>
 
@@ -72,6 +74,14 @@ namespace detail {
          */
         epics::pvData::PVStructurePtr createPVStructure();
 
+        /**
+         * Creates a prototype of the <b>PVStructure</b> that represents NTEnum,
+         * to be initialized once and cloned into many instances, see NTPrototype.
+         * This resets this instance state and allows new instance to be created.
+         * @return a new prototype.
+         */
+        NTPrototypePtr createPrototype();
+
         /**
          * Creates a <b>NTEnum</b> instance.
          * This resets this instance state and allows new instance to be created.
@@ -181,6 +191,21 @@ public:
     static bool isCompatible(
         epics::pvData::StructureConstPtr const &structure);
 
+    /**
+     * Returns whether the specified Structure is compatible with NTEnum
+     * and describes why not.
+     * <p>
+     * Checks the same as isCompatible(StructureConstPtr const &), but
+     * completely, collecting all the incompatibilities found.
+     *
+     * @param structure the Structure to test
+     * @param diagnostics set to the description of the incompatibilities, empty if none
+     * @return (false,true) if the specified Structure (is not, is) a compatible NTEnum
+     */
+    static bool isCompatible(
+        epics::pvData::StructureConstPtr const &structure,
+        std::string &diagnostics);
+
     /**
      * Returns whether the specified PVStructure is compatible with NTEnum.
      * <p>
@@ -193,6 +218,14 @@ public:
     static bool isCompatible(
         epics::pvData::PVStructurePtr const &pvStructure);
 
+    /**
+     * Returns the cache of compatibility verdicts used by
+     * isCompatible(PVStructurePtr const &) and hence by wrap().
+     *
+     * @return the NTEnum compatibility cache
+     */
+    static NTCompatibilityCache & getCompatibilityCache();
+
     /**
      * Returns whether the wrapped PVStructure is valid with respect to this
      * version of NTEnum.
@@ -263,8 +296,12 @@ public:
 
 private:
     NTEnum(epics::pvData::PVStructurePtr const & pvStructure);
+    static Result& isCompatible(Result& result);
     epics::pvData::PVStructurePtr pvNTEnum;
     epics::pvData::PVStructurePtr pvValue;
+    epics::pvData::PVStringPtr pvDescriptor;
+    epics::pvData::PVStructurePtr pvTimeStamp;
+    epics::pvData::PVStructurePtr pvAlarm;
 
     friend class detail::NTEnumBuilder;
 };
@@ -0,0 +1,143 @@
+/* ntfingerprint.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTFINGERPRINT_H
+#define NTFINGERPRINT_H
+
+#include <string>
+
+#ifdef epicsExportSharedSymbols
+#   define ntfingerprintEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <epicsTypes.h>
+
+#include <pv/pvIntrospect.h>
+
+#ifdef ntfingerprintEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntfingerprintEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+/**
+ * @brief 128-bit structural hash of an introspection tree.
+ *
+ * The fingerprint covers the type, the type ID and, recursively,
+ * the names and fingerprints of the members of each node, so that
+ * structurally identical trees have equal fingerprints even if they
+ * were created independently, e.g. by two NTScalarBuilders.
+ * It is the FNV-1a 128-bit hash of an unambiguous encoding of the tree.
+ * Bounded strings and bounded or fixed size arrays are distinguished
+ * by their type IDs, e.g. "string(16)" or "double[4]".
+ */
+class epicsShareClass NTFingerprint
+{
+public:
+    /**
+     * Maximum number of fingerprints in the process-wide cache.
+     * Once full, further fingerprints are computed but not cached.
+     */
+    static const size_t CACHE_CAPACITY = 1024;
+
+    /**
+     * Returns the fingerprint of an introspection tree from the
+     * process-wide cache, computing and caching it if not yet cached.
+     * The cache is keyed on the identity of the Field and holds
+     * a reference to it. Thread safe.
+     *
+     * @param field the root of the tree.
+     * @return the fingerprint, or the null fingerprint if field is null.
+     */
+    static NTFingerprint get(epics::pvData::FieldConstPtr const & field);
+
+    /**
+     * Computes the fingerprint of an introspection tree, without caching.
+     *
+     * @param field the root of the tree.
+     * @return the fingerprint, or the null fingerprint if field is null.
+     */
+    static NTFingerprint compute(epics::pvData::FieldConstPtr const & field);
+
+    /**
+     * Returns the number of fingerprints in the process-wide cache.
+     * @return the number of cached fingerprints.
+     */
+    static size_t getCacheSize();
+
+    /**
+     * Empties the process-wide cache.
+     */
+    static void clearCache();
+
+    /**
+     * Creates the null fingerprint.
+     */
+    NTFingerprint() : high(0), low(0) {}
+
+    /**
+     * Creates a fingerprint from its two halves.
+     * @param high the upper 64 bits.
+     * @param low the lower 64 bits.
+     */
+    NTFingerprint(epicsUInt64 high, epicsUInt64 low) : high(high), low(low) {}
+
+    /**
+     * Returns the upper 64 bits.
+     * @return the upper 64 bits.
+     */
+    epicsUInt64 getHigh() const { return high; }
+
+    /**
+     * Returns the lower 64 bits, a 64-bit hash on their own.
+     * @return the lower 64 bits.
+     */
+    epicsUInt64 getLow() const { return low; }
+
+    /**
+     * Returns the fingerprint folded to a size_t, e.g. for hash tables.
+     * @return the folded fingerprint.
+     */
+    size_t hash() const { return static_cast<size_t>(low ^ (low >> 32) ^ high); }
+
+    /**
+     * Returns whether this is the null fingerprint, i.e. of no tree.
+     * @return true if null.
+     */
+    bool isNull() const { return high == 0 && low == 0; }
+
+    /**
+     * Returns the fingerprint as 32 hexadecimal digits.
+     * @return the fingerprint as a string.
+     */
+    std::string toString() const;
+
+    bool operator==(NTFingerprint const & other) const
+    {
+        return low == other.low && high == other.high;
+    }
+
+    bool operator!=(NTFingerprint const & other) const
+    {
+        return !(*this == other);
+    }
+
+    bool operator<(NTFingerprint const & other) const
+    {
+        return high < other.high || (high == other.high && low < other.low);
+    }
+
+private:
+    epicsUInt64 high;
+    epicsUInt64 low;
+};
+
+}}
+
+#endif  /* NTFINGERPRINT_H */
@@ -8,6 +8,20 @@
 
 #include <string>
 
+#ifdef epicsExportSharedSymbols
+#   define ntidEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/sharedPtr.h>
+
+#ifdef ntidEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntidEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
 namespace epics { 
 
 namespace nt {
@@ -147,6 +161,171 @@ private:
 
 };
 
+/**
+ * @brief An NT type ID parsed once, when created.
+ *
+ * Same as NTID, but all parts are located by the constructor, which
+ * keeps the ID and the offset and length of each part in it, and the
+ * object is immutable, so may be shared. The parts are returned as new
+ * strings; the version numbers are parsed once.
+ * Use get() to obtain the shared instance of an ID from a process-wide
+ * cache, which avoids parsing and allocating on every lookup.
+ */
+class epicsShareClass NTParsedID
+{
+public:
+    POINTER_DEFINITIONS(NTParsedID);
+
+    /**
+     * Maximum number of IDs in the process-wide cache.
+     * Once full, further IDs are parsed but not cached.
+     */
+    static const size_t CACHE_CAPACITY = 256;
+
+    /**
+     * Returns the parsed ID from the process-wide cache,
+     * parsing and caching it if not yet cached.
+     * Thread safe.
+     *
+     * @param id the ID to be parsed.
+     * @return the parsed ID.
+     */
+    static const_shared_pointer get(const std::string &id);
+
+    /**
+     * Returns the number of IDs in the process-wide cache.
+     * @return the number of cached IDs.
+     */
+    static size_t getCacheSize();
+
+    /**
+     * Empties the process-wide cache.
+     */
+    static void clearCache();
+
+    /**
+     * Parses the specified type ID.
+     *
+     * @param id the the ID to be parsed.
+     */
+    explicit NTParsedID(const std::string &id);
+
+    /**
+     * Returns the full name of the id, i.e. the original ID
+     * <p>
+     * For example "epics:nt/NTNDArray:1.2".
+     * @return the full name
+     */
+    const std::string &getFullName() const { return fullName; }
+
+    /**
+     * Returns the fully qualified name including namespaces, but excluding version numbers.
+     * <p>
+     * For example "epics:nt/NTNDArray".
+     * @return the fully qualified name
+     */
+    std::string getQualifiedName() const { return substr(qualifiedName); }
+
+    /**
+     * Returns the namespace
+     * <p>
+     * For example "epics:nt".
+     * @return the namespace
+     */
+    std::string getNamespace() const { return substr(namespaceStr); }
+
+    /**
+     * Returns the unqualified name, without namespace or version.
+     * <p>
+     * For example "NTNDArray".
+     * @return the unqualified name
+     */
+    std::string getName() const { return substr(name); }
+
+    /**
+     * Returns the version as a string.
+     * <p>
+     * For example "1.2".
+     * @return the the version string
+     */
+    std::string getVersion() const { return substr(version); }
+
+    /**
+     * Returns the Major version as a string.
+     * <p>
+     * For example "1".
+     * @return the Major string
+     */
+    std::string getMajorVersionString() const { return substr(majorVersionStr); }
+
+    /**
+     * Does the ID contain a major version and is it a number.
+     * <p>
+     * @return true if it contains a major version number
+     */
+    bool hasMajorVersion() const { return hasMajor; }
+
+    /**
+     * Returns the Major version as an integer.
+     * <p>
+     * For example 1.
+     * @return the Major version, 0 if none
+     */
+    int getMajorVersion() const { return majorVersion; }
+
+    /**
+     * Returns the Minor version as a string.
+     * <p>
+     * For example "2".
+     * @return the Minor string
+     */
+    std::string getMinorVersionString() const { return substr(minorVersionStr); }
+
+    /**
+     * Does the ID contain a minor version and is it a number.
+     * <p>
+     * @return true if it contains a minor version number
+     */
+    bool hasMinorVersion() const { return hasMinor; }
+
+    /**
+     * Returns the Minor version as an integer.
+     * <p>
+     * For example 2.
+     * @return the Minor version, 0 if none
+     */
+    int getMinorVersion() const { return minorVersion; }
+
+private:
+    // the offset and length of a part of the ID
+    struct Part
+    {
+        Part() : offset(0), length(0) {}
+        Part(size_t offset, size_t length) : offset(offset), length(length) {}
+
+        size_t offset;
+        size_t length;
+    };
+
+    std::string substr(Part const & part) const
+    {
+        return fullName.substr(part.offset, part.length);
+    }
+
+    std::string fullName;
+    Part qualifiedName;
+    Part namespaceStr;
+    Part name;
+    Part version;
+    Part majorVersionStr;
+    Part minorVersionStr;
+
+    bool hasMajor;
+    int majorVersion;
+    bool hasMinor;
+    int minorVersion;
+};
+
 }}
 
 #endif
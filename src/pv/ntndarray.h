@@ -23,6 +23,8 @@
 #endif
 
 #include <pv/ntfield.h>
+#include <pv/ntcompatibilityCache.h>
+#include <pv/ntprototype.h>
 
 #include <shareLib.h>
 
@@ -84,6 +86,14 @@ namespace detail {
          */
         epics::pvData::PVStructurePtr createPVStructure();
 
+        /**
+         * Creates a prototype of the <b>PVStructure</b> that represents NTNDArray,
+         * to be initialized once and cloned into many instances, see NTPrototype.
+         * This resets this instance state and allows new instance to be created.
+         * @return a new prototype.
+         */
+        NTPrototypePtr createPrototype();
+
         /**
          * Creates a <b>NTNDArray</b> instance.
          * This resets this instance state and allows new instance to be created.
@@ -104,6 +114,8 @@ namespace detail {
 
         void reset();
 
+        epics::pvData::StructureConstPtr buildStructure();
+
         bool descriptor;
         bool timeStamp;
         bool alarm;
@@ -194,6 +206,21 @@ public:
     static bool isCompatible(
         epics::pvData::StructureConstPtr const &structure);
 
+    /**
+     * Returns whether the specified Structure is compatible with NTNDArray
+     * and describes why not.
+     * <p>
+     * Checks the same as isCompatible(StructureConstPtr const &), but
+     * completely, collecting all the incompatibilities found.
+     *
+     * @param structure the Structure to test
+     * @param diagnostics set to the description of the incompatibilities, empty if none
+     * @return (false,true) if the specified Structure (is not, is) a compatible NTNDArray
+     */
+    static bool isCompatible(
+        epics::pvData::StructureConstPtr const &structure,
+        std::string &diagnostics);
+
     /**
      * Returns whether the specified PVStructure is compatible with NTNDArray.
      * <p>
@@ -205,6 +232,14 @@ public:
     static bool isCompatible(
         epics::pvData::PVStructurePtr const &pvStructure);
 
+    /**
+     * Returns the cache of compatibility verdicts used by
+     * isCompatible(PVStructurePtr const &) and hence by wrap().
+     *
+     * @return the NTNDArray compatibility cache
+     */
+    static NTCompatibilityCache & getCompatibilityCache();
+
     /**
      * Returns whether the wrapped PVStructure is valid with respect to this
      * version of NTNDArray.
@@ -339,12 +374,25 @@ public:
 
 private:
     NTNDArray(epics::pvData::PVStructurePtr const & pvStructure);
+    static Result& isCompatible(Result& result);
 
     epics::pvData::int64 getExpectedUncompressedSize();
     epics::pvData::int64 getValueSize();
     epics::pvData::int64 getValueTypeSize();
 
     epics::pvData::PVStructurePtr pvNTNDArray;
+    epics::pvData::PVUnionPtr pvValue;
+    epics::pvData::PVStructurePtr pvCodec;
+    epics::pvData::PVLongPtr pvCompressedSize;
+    epics::pvData::PVLongPtr pvUncompressedSize;
+    epics::pvData::PVStructureArrayPtr pvDimension;
+    epics::pvData::PVIntPtr pvUniqueId;
+    epics::pvData::PVStructurePtr pvDataTimeStamp;
+    epics::pvData::PVStructureArrayPtr pvAttribute;
+    epics::pvData::PVStringPtr pvDescriptor;
+    epics::pvData::PVStructurePtr pvTimeStamp;
+    epics::pvData::PVStructurePtr pvAlarm;
+    epics::pvData::PVStructurePtr pvDisplay;
 
     friend class detail::NTNDArrayBuilder;
 };
@@ -0,0 +1,98 @@
+/* ntndarrayAllocator.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTNDARRAYALLOCATOR_H
+#define NTNDARRAYALLOCATOR_H
+
+#include <stdexcept>
+
+#ifdef epicsExportSharedSymbols
+#   define ntndarrayAllocatorEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/pvData.h>
+
+#ifdef ntndarrayAllocatorEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntndarrayAllocatorEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+class NTNDArrayAllocator;
+typedef std::tr1::shared_ptr<NTNDArrayAllocator> NTNDArrayAllocatorPtr;
+
+/**
+ * @brief Allocates the memory of the values of the NTNDArrays produced
+ * by the frame processing classes, e.g. NTNDArrayRegion.
+ *
+ * The memory is released by the deleter of the returned pointer, when
+ * the last reference to the value is released, so an allocator can
+ * recycle it for the next frame, as the one created by createPool() does:
+@code
+    NTNDArrayAllocatorPtr allocator = NTNDArrayAllocator::createPool();
+    NTNDArrayRegion region(dimensions);
+    region.allocator(allocator);
+@endcode
+ * Allocators are called concurrently: their methods must be thread safe.
+ */
+class epicsShareClass NTNDArrayAllocator
+{
+public:
+    POINTER_DEFINITIONS(NTNDArrayAllocator);
+
+    /**
+     * Default maximum number of free buffers held by a pool.
+     */
+    static const size_t DEFAULT_CAPACITY = 8;
+
+    virtual ~NTNDArrayAllocator() {}
+
+    /**
+     * Allocates memory.
+     * @param size the number of bytes.
+     * @return the memory, aligned for any element type,
+     *         released by the deleter of the pointer.
+     * @throws std::bad_alloc if there is no memory.
+     */
+    virtual std::tr1::shared_ptr<void> allocate(size_t size) = 0;
+
+    /**
+     * Creates an allocator which keeps released buffers, and hands them
+     * out again for the same size, e.g. for a stream of frames of the
+     * same shape.
+     * @param capacity the maximum number of free buffers held.
+     * @return the allocator.
+     */
+    static shared_pointer createPool(size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * Allocates the elements of a value.
+     * @param allocator the allocator, or null for new[].
+     * @param count the number of elements.
+     * @return the elements, not initialized if allocated by the allocator.
+     * @throws std::runtime_error if the allocator returned no memory.
+     */
+    template<typename T>
+    static epics::pvData::shared_vector<T> allocateArray(
+        NTNDArrayAllocator * allocator, size_t count)
+    {
+        if (!allocator)
+            return epics::pvData::shared_vector<T>(count);
+
+        std::tr1::shared_ptr<void> memory(allocator->allocate(count * sizeof(T)));
+        if (!memory)
+            throw std::runtime_error("NTNDArrayAllocator returned no memory");
+        return epics::pvData::shared_vector<T>(
+            std::tr1::static_pointer_cast<T>(memory), 0, count);
+    }
+};
+
+}}
+
+#endif  /* NTNDARRAYALLOCATOR_H */
@@ -17,6 +17,8 @@
 #endif
 
 #include <pv/ntfield.h>
+#include <pv/ntcompatibilityCache.h>
+#include <pv/ntprototype.h>
 
 #include <shareLib.h>
 
@@ -79,6 +81,14 @@ namespace detail {
          */
         epics::pvData::PVStructurePtr createPVStructure();
 
+        /**
+         * Creates a prototype of the <b>PVStructure</b> that represents NTNDArrayAttribute,
+         * to be initialized once and cloned into many instances, see NTPrototype.
+         * This resets this instance state and allows new instance to be created.
+         * @return a new prototype.
+         */
+        NTPrototypePtr createPrototype();
+
         /**
          * Creates a <b>NTNDArrayAttribute</b> instance.
          * This resets this instance state and allows new instance to be created.
@@ -195,6 +205,21 @@ public:
     static bool isCompatible(
         epics::pvData::StructureConstPtr const &structure);
 
+    /**
+     * Returns whether the specified Structure is compatible with NTNDArrayAttribute
+     * and describes why not.
+     * <p>
+     * Checks the same as isCompatible(StructureConstPtr const &), but
+     * completely, collecting all the incompatibilities found.
+     *
+     * @param structure the Structure to test
+     * @param diagnostics set to the description of the incompatibilities, empty if none
+     * @return (false,true) if the specified Structure (is not, is) a compatible NTNDArrayAttribute
+     */
+    static bool isCompatible(
+        epics::pvData::StructureConstPtr const &structure,
+        std::string &diagnostics);
+
     /**
      * Returns whether the specified PVStructure is compatible with NTAttribute
      * extended as required by NTNDArray.
@@ -209,6 +234,14 @@ public:
     static bool isCompatible(
         epics::pvData::PVStructurePtr const &pvStructure);
 
+    /**
+     * Returns the cache of compatibility verdicts used by
+     * isCompatible(PVStructurePtr const &) and hence by wrap().
+     *
+     * @return the NTNDArrayAttribute compatibility cache
+     */
+    static NTCompatibilityCache & getCompatibilityCache();
+
     /**
      * Returns whether the wrapped PVStructure is valid with respect to this
      * version of NTAttribute extended as per this version of NTNDArray.
@@ -304,9 +337,17 @@ public:
 private:
     NTNDArrayAttribute(epics::pvData::PVStructurePtr const & pvStructure);
     static Result& isAttribute(Result& result);
+    static Result& isCompatible(Result& result);
 
     epics::pvData::PVStructurePtr pvNTNDArrayAttribute;
     epics::pvData::PVUnionPtr pvValue;
+    epics::pvData::PVStringPtr pvDescriptor;
+    epics::pvData::PVStructurePtr pvTimeStamp;
+    epics::pvData::PVStructurePtr pvAlarm;
+    epics::pvData::PVStringPtr pvName;
+    epics::pvData::PVStringArrayPtr pvTags;
+    epics::pvData::PVIntPtr pvSourceType;
+    epics::pvData::PVStringPtr pvSource;
 
     friend class detail::NTNDArrayAttributeBuilder;
     friend class NTNDArray;
@@ -0,0 +1,171 @@
+/* ntndarrayCodec.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTNDARRAYCODEC_H
+#define NTNDARRAYCODEC_H
+
+#include <string>
+#include <vector>
+
+#ifdef epicsExportSharedSymbols
+#   define ntndarrayCodecEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/pvData.h>
+
+#ifdef ntndarrayCodecEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntndarrayCodecEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntndarray.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+class NTNDArrayCodec;
+typedef std::tr1::shared_ptr<NTNDArrayCodec> NTNDArrayCodecPtr;
+
+/**
+ * @brief A compression codec for the value of an NTNDArray.
+ *
+ * Codecs are registered under their name, the codec.name of the
+ * NTNDArrays they compress. compress() compresses an NTNDArray in place
+ * with a registered codec, decompress() finds the codec from its
+ * codec.name, e.g.
+@code
+    NTNDArrayCodec::compress(*ntndarray, "nt-lz4");
+    ...
+    NTNDArrayCodec::decompress(*ntndarray);
+@endcode
+ * The value is split into chunks of codec.parameters.chunkSize bytes,
+ * of elements of codec.parameters.elementSize bytes,
+ * which are compressed and decompressed by a pool of threads.
+ * The compressed chunks are stored, each preceded by its size as a
+ * 32-bit little endian integer, in the value field of the element type
+ * of the uncompressed value. The last element is zero padded, so that
+ * compressedSize is the size of the value, as for uncompressed NTNDArrays.
+ * <p>
+ * The built-in codecs are:
+ * <ul>
+ * <li>"nt-lz4", the LZ4 block format.</li>
+ * <li>"nt-rle", a run length encoding of elements, for frames with
+ * uniform areas.</li>
+ * <li>"nt-delta", the differences between successive elements,
+ * compressed by LZ4, for smooth integer frames.</li>
+ * <li>"nt-bslz4", the bits of blocks of elements transposed by
+ * NTBitshuffle, then compressed by LZ4, for integer frames whose high
+ * bits vary little. Its codec.parameters has a blockSize field,
+ * the number of elements of a block.</li>
+ * </ul>
+ * A codec compresses and decompresses a chunk at a time,
+ * concurrently: its methods must be thread safe.
+ */
+class epicsShareClass NTNDArrayCodec
+{
+public:
+    POINTER_DEFINITIONS(NTNDArrayCodec);
+
+    /**
+     * The default size, in bytes, of the chunks compressed independently.
+     */
+    static const size_t DEFAULT_CHUNK_SIZE = 1 << 20;
+
+    virtual ~NTNDArrayCodec() {}
+
+    /**
+     * Returns the name of the codec.
+     * @return the codec.name of the NTNDArrays it compresses.
+     */
+    virtual std::string getName() const = 0;
+
+    /**
+     * Compresses a chunk.
+     * @param in the bytes of the elements of the chunk.
+     * @param size the number of bytes, a multiple of elementSize.
+     * @param elementSize the size in bytes of an element.
+     * @param out the compressed bytes are appended to it.
+     */
+    virtual void compress(epics::pvData::uint8 const * in, size_t size,
+        size_t elementSize, std::vector<epics::pvData::uint8> & out) const = 0;
+
+    /**
+     * Decompresses a chunk.
+     * @param in the compressed bytes.
+     * @param size the number of compressed bytes.
+     * @param elementSize the size in bytes of an element.
+     * @param out set to the bytes of the elements of the chunk.
+     * @param outSize the number of bytes of the chunk.
+     * @throws std::runtime_error if the compressed bytes are corrupt.
+     */
+    virtual void decompress(epics::pvData::uint8 const * in, size_t size,
+        size_t elementSize, epics::pvData::uint8 * out, size_t outSize) const = 0;
+
+    /**
+     * Returns the structure of codec.parameters. It has the int fields
+     * chunkSize and elementSize, set by compress(); codecs with more
+     * parameters add fields to it. The default has just these two.
+     * @return the structure.
+     */
+    virtual epics::pvData::StructureConstPtr getParametersStructure() const;
+
+    /**
+     * Sets the parameters specific to the codec, after compress() set
+     * chunkSize and elementSize. Does nothing by default.
+     * @param parameters codec.parameters.
+     */
+    virtual void putParameters(epics::pvData::PVStructure & parameters) const;
+
+    /**
+     * Registers a codec, replacing any codec of the same name.
+     * @param codec the codec.
+     */
+    static void add(NTNDArrayCodecPtr const & codec);
+
+    /**
+     * Finds a registered codec.
+     * @param name the name of the codec.
+     * @return the codec or null if there is none of that name.
+     */
+    static NTNDArrayCodecPtr find(std::string const & name);
+
+    /**
+     * Returns the names of the registered codecs.
+     * @return the names, sorted.
+     */
+    static std::vector<std::string> getNames();
+
+    /**
+     * Compresses the value of an NTNDArray, and sets its codec,
+     * compressedSize and uncompressedSize fields.
+     * @param ndarray the NTNDArray.
+     * @param name the name of a registered codec.
+     * @param chunkSize the size in bytes of the chunks, rounded down to
+     *        a multiple of the element size.
+     * @param threads the maximum number of threads compressing,
+     *        including the calling thread, 0 for the number of CPUs.
+     * @throws std::runtime_error if the codec is unknown, the NTNDArray
+     *         is already compressed or has no value.
+     */
+    static void compress(NTNDArray const & ndarray, std::string const & name,
+        size_t chunkSize = DEFAULT_CHUNK_SIZE, unsigned threads = 0);
+
+    /**
+     * Decompresses the value of an NTNDArray, if compressed, clears
+     * its codec and sets compressedSize to uncompressedSize.
+     * @param ndarray the NTNDArray.
+     * @param threads the maximum number of threads decompressing,
+     *        including the calling thread, 0 for the number of CPUs.
+     * @throws std::runtime_error if the codec is unknown or the
+     *         value is corrupt.
+     */
+    static void decompress(NTNDArray const & ndarray, unsigned threads = 0);
+};
+
+}}
+
+#endif  /* NTNDARRAYCODEC_H */
@@ -0,0 +1,117 @@
+/* ntndarrayConverter.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTNDARRAYCONVERTER_H
+#define NTNDARRAYCONVERTER_H
+
+#include <cstddef>
+
+#ifdef epicsExportSharedSymbols
+#   define ntndarrayConverterEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/pvData.h>
+
+#ifdef ntndarrayConverterEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntndarrayConverterEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntndarray.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+/**
+ * @brief Conversion of the value of an NTNDArray to another element type.
+ *
+ * The value union member is replaced by the one of the new type, e.g.
+ * ushortValue by floatValue, and compressedSize and uncompressedSize
+ * are set to the size of the new value. The dimensions are unchanged.
+@code
+    NTNDArrayConverter(pvFloat).convert(*ntndarray);
+    ...
+    NTNDArrayConverter(pvUByte).scale(255.0/4095.0).convert(*ntndarray);
+@endcode
+ * Without scale(), the elements are converted as by a C++ cast, except
+ * that floating point elements converted to an integer type are
+ * truncated and clamped to its range, NaN to its minimum, and integer
+ * elements are clamped to the range of the new type if saturate() is set.
+ * With scale(), each element x becomes x * scale + offset, computed in
+ * float for 8 and 16-bit integer and float elements and in double
+ * otherwise, then converted as a floating point element.
+ * <p>
+ * The common conversions, e.g. between ubyte, ushort and float,
+ * use SSE2 instructions when available, and large values are
+ * converted by a pool of threads.
+ */
+class epicsShareClass NTNDArrayConverter
+{
+public:
+    /**
+     * The minimum number of elements converted by more than one thread.
+     */
+    static const size_t MIN_PARALLEL_ELEMENTS = 1 << 18;
+
+    /**
+     * Constructor.
+     * @param type the new element type, a numeric or boolean scalar type.
+     * @throws std::runtime_error if the type is pvString.
+     */
+    explicit NTNDArrayConverter(epics::pvData::ScalarType type);
+
+    /**
+     * Scales the elements.
+     * @param scale the factor.
+     * @param offset added to the scaled elements.
+     * @return this converter.
+     */
+    NTNDArrayConverter & scale(double scale, double offset = 0.0);
+
+    /**
+     * Clamps the integer elements converted without scale to the range of
+     * the new type, rather than keeping their low bits.
+     * @param saturate whether to clamp them.
+     * @return this converter.
+     */
+    NTNDArrayConverter & saturate(bool saturate = true);
+
+    /**
+     * Sets the number of threads converting large values.
+     * @param threads the maximum number of threads, including the
+     *        calling thread, 0 for the number of CPUs (the default).
+     * @return this converter.
+     */
+    NTNDArrayConverter & threads(unsigned threads);
+
+    /**
+     * Returns the new element type.
+     * @return the type.
+     */
+    epics::pvData::ScalarType getType() const { return type; }
+
+    /**
+     * Converts the value of an NTNDArray.
+     * Nothing is done if it has the new type already and is not scaled.
+     * @param ndarray the NTNDArray.
+     * @throws std::runtime_error if the NTNDArray has no value or
+     *         its value is compressed.
+     */
+    void convert(NTNDArray const & ndarray) const;
+
+private:
+    epics::pvData::ScalarType type;
+    double scaleFactor;
+    double offset;
+    bool scaled;
+    bool saturating;
+    unsigned threadCount;
+};
+
+}}
+
+#endif  /* NTNDARRAYCONVERTER_H */
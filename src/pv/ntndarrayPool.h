@@ -0,0 +1,190 @@
+/* ntndarrayPool.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTNDARRAYPOOL_H
+#define NTNDARRAYPOOL_H
+
+#include <vector>
+
+#ifdef epicsExportSharedSymbols
+#   define ntndarrayPoolEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <epicsThread.h>
+
+#include <pv/pvData.h>
+#include <pv/lock.h>
+
+#ifdef ntndarrayPoolEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntndarrayPoolEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntndarray.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+class NTNDArrayPool;
+typedef std::tr1::shared_ptr<NTNDArrayPool> NTNDArrayPoolPtr;
+
+/**
+ * @brief Recycles NTNDArray instances of one structure.
+ *
+ * get() hands out an NTNDArray, whose PVStructure tree returns to the pool
+ * when its last reference, held by the NTNDArray or obtained from its
+ * getPVStructure(), is released, instead of being freed, e.g.
+@code
+    NTNDArrayPoolPtr pool = NTNDArrayPool::create(
+        NTNDArray::createBuilder()->addTimeStamp()->createStructure());
+    ...
+    NTNDArrayPtr frame = pool->get(shape);
+    // put the value, attribute values etc. and post the frame
+@endcode
+ * A returned instance is reset to the defaults of a new one, except that
+ * - the value union keeps its selected array type, with no elements,
+ *   so the frame data are released,
+ * - the dimension and attribute arrays are kept, with their elements.
+ *
+ * get(shape) sets the dimension array to new elements, as the frozen
+ * elements of a recycled instance may be shared by copies of it.
+ * <p>
+ * Each thread returns instances to a free list of its own, and gets them
+ * from it, so threads rarely contend. A thread whose list is empty takes
+ * an instance from the lists of the other threads, e.g. when frames
+ * are created and released by different threads.
+ * Once the pool holds as many free instances as its capacity, further
+ * returned instances are discarded.
+ * <p>
+ * A field of an instance must not be used after the last reference to
+ * its PVStructure is released. Thread safe.
+ */
+class epicsShareClass NTNDArrayPool
+{
+public:
+    POINTER_DEFINITIONS(NTNDArrayPool);
+
+    /**
+     * Default maximum number of free instances held.
+     */
+    static const size_t DEFAULT_CAPACITY = 64;
+
+    /**
+     * Creates a pool.
+     * @param structure the structure of the instances, as created by
+     * NTNDArrayBuilder::createStructure().
+     * @param capacity the maximum number of free instances held.
+     * @return the new pool.
+     * @throws std::runtime_error if the structure is not compatible
+     * with NTNDArray.
+     */
+    static shared_pointer create(epics::pvData::StructureConstPtr const & structure,
+                                 size_t capacity = DEFAULT_CAPACITY);
+
+    ~NTNDArrayPool();
+
+    /**
+     * Returns an instance, recycled if any is free.
+     * @return the instance.
+     */
+    NTNDArrayPtr get();
+
+    /**
+     * Returns an instance with the specified dimensions, recycled if any
+     * is free. Each dimension has the given size and fullSize, an offset
+     * of 0, a binning of 1 and is not reversed.
+     * @param shape the sizes of the dimensions.
+     * @return the instance.
+     */
+    NTNDArrayPtr get(std::vector<epics::pvData::int32> const & shape);
+
+    /**
+     * Returns the structure of the instances.
+     * @return the structure.
+     */
+    epics::pvData::StructureConstPtr const & getStructure() const { return structure; }
+
+    /**
+     * Returns the number of instances handed out which were recycled.
+     * @return the number of hits.
+     */
+    size_t getHits() const;
+
+    /**
+     * Returns the number of instances handed out which had to be created.
+     * @return the number of misses.
+     */
+    size_t getMisses() const;
+
+    /**
+     * Returns the number of returned instances which were discarded,
+     * because the pool was full.
+     * @return the number of instances discarded.
+     */
+    size_t getDiscarded() const;
+
+    /**
+     * Returns the number of free instances held.
+     * @return the number of instances.
+     */
+    size_t size() const;
+
+    /**
+     * Returns the maximum number of free instances held.
+     * @return the capacity.
+     */
+    size_t getCapacity() const { return capacity; }
+
+    /**
+     * Frees all free instances. The counters are not affected.
+     */
+    void clear();
+
+    /**
+     * Resets the hit, miss and discard counters to zero.
+     */
+    void resetCounters();
+
+private:
+    NTNDArrayPool(epics::pvData::StructureConstPtr const & structure, size_t capacity);
+    NTNDArrayPool(NTNDArrayPool const &);
+    NTNDArrayPool & operator=(NTNDArrayPool const &);
+
+    struct FreeList;
+    struct Recycler;
+    friend struct Recycler;
+
+    FreeList & getFreeList();
+    epics::pvData::PVStructure * take(FreeList & own);
+    void recycle(epics::pvData::PVStructure * instance);
+    void reset(epics::pvData::PVStructure & instance) const;
+
+    epics::pvData::StructureConstPtr structure;
+    size_t capacity;
+
+    // a new instance, from which the fields are reset
+    epics::pvData::PVStructurePtr defaults;
+    // the indexes of the top level fields to reset,
+    // all but value, dimension and attribute
+    std::vector<size_t> resetFields;
+
+    std::tr1::weak_ptr<NTNDArrayPool> self;
+
+    size_t count;
+    size_t hits;
+    size_t misses;
+    size_t discarded;
+
+    // the free list of each thread, by thread and all of them
+    epicsThreadPrivateId key;
+    std::vector<FreeList *> lists;
+    mutable epics::pvData::Mutex mutex;
+};
+
+}}
+
+#endif  /* NTNDARRAYPOOL_H */
@@ -0,0 +1,152 @@
+/* ntndarrayRegion.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTNDARRAYREGION_H
+#define NTNDARRAYREGION_H
+
+#include <vector>
+
+#ifdef epicsExportSharedSymbols
+#   define ntndarrayRegionEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/pvData.h>
+
+#ifdef ntndarrayRegionEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntndarrayRegionEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntndarray.h>
+#include <pv/ntndarrayAllocator.h>
+#include <pv/ntndarrayView.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+/**
+ * @brief Extracts a region of interest of a frame, binned and reversed,
+ * into a new NTNDArray.
+ *
+ * The region is described by an NTNDArrayDimension per dimension of
+ * the source frame, fastest varying first, relative to the source:
+ * - offset, the first element of the region,
+ * - size, its number of elements, 0 for all elements after offset,
+ * - binning, the number of elements summed into one, along the dimension,
+ * - reverse, whether the order of the elements is reversed.
+ *
+ * fullSize is ignored. Dimensions without an NTNDArrayDimension are
+ * kept whole. The size of a dimension of the result is size / binning,
+ * the remaining elements being dropped, e.g. for a 2x2 binned,
+ * vertically flipped 512x512 region of a 2048x2048 frame:
+@code
+    std::vector<NTNDArrayDimension> dimensions(2);
+    dimensions[0].offset = 256;
+    dimensions[0].size = 512;
+    dimensions[0].binning = 2;
+    dimensions[1].offset = 1024;
+    dimensions[1].size = 512;
+    dimensions[1].binning = 2;
+    dimensions[1].reverse = true;
+    NTNDArrayRegion(dimensions).extract(*frame, *roi);
+@endcode
+ * The dimension field of the result relates its elements to the full
+ * frame: the offset and reverse of the region are combined with those
+ * of the source, and its binning multiplies theirs.
+ * <p>
+ * The binned elements are summed, clamped to the range of the element
+ * type, or averaged, rounded to the nearest integer for integer types.
+ * Boolean elements are or-ed. 8 and 16-bit elements are summed in
+ * 32-bit integers, so at most 65536 rows (elements of the dimensions
+ * other than 0) may be binned into one.
+ * <p>
+ * The rows of the source are summed into a row of accumulators, which
+ * stays in the cache, by loops the compiler vectorizes, and the result
+ * is computed by a pool of threads for large frames.
+ * The elements of the result are allocated by an NTNDArrayAllocator,
+ * if set, e.g. to reuse the memory of released frames.
+ */
+class epicsShareClass NTNDArrayRegion
+{
+public:
+    /**
+     * The minimum number of source elements processed by more than one thread.
+     */
+    static const size_t MIN_PARALLEL_ELEMENTS = 1 << 18;
+
+    /**
+     * Constructor, for the whole frame, not binned nor reversed.
+     */
+    NTNDArrayRegion();
+
+    /**
+     * Constructor.
+     * @param dimensions the region of each dimension, fastest varying first.
+     */
+    explicit NTNDArrayRegion(std::vector<NTNDArrayDimension> const & dimensions);
+
+    /**
+     * Averages the binned elements, rather than summing them.
+     * @param average whether to average them.
+     * @return this region.
+     */
+    NTNDArrayRegion & average(bool average = true);
+
+    /**
+     * Sets the allocator of the elements of the result.
+     * @param allocator the allocator, null for new[] (the default).
+     * @return this region.
+     */
+    NTNDArrayRegion & allocator(NTNDArrayAllocatorPtr const & allocator);
+
+    /**
+     * Sets the number of threads processing large frames.
+     * @param threads the maximum number of threads, including the
+     *        calling thread, 0 for the number of CPUs (the default).
+     * @return this region.
+     */
+    NTNDArrayRegion & threads(unsigned threads);
+
+    /**
+     * Returns the region of each dimension.
+     * @return the regions, fastest varying first.
+     */
+    std::vector<NTNDArrayDimension> const & getDimensions() const { return dimensions; }
+
+    /**
+     * Returns the dimensions of the result for a source frame.
+     * @param source the dimensions of the source, fastest varying first.
+     * @param result set to the dimensions of the result.
+     * @throws std::runtime_error if the region does not fit the source.
+     */
+    void getResultDimensions(std::vector<NTNDArrayDimension> const & source,
+        std::vector<NTNDArrayDimension> & result) const;
+
+    /**
+     * Extracts the region of a frame.
+     * The value, dimension, codec, compressedSize, uncompressedSize,
+     * uniqueId, dataTimeStamp and attribute fields of the result are set,
+     * the other fields are left as they are.
+     * The result may be the source.
+     * @param source the source frame.
+     * @param result the NTNDArray set to the region.
+     * @throws std::runtime_error if the source has no value, its value
+     *         is compressed or does not match its dimensions, or the
+     *         region does not fit it.
+     */
+    void extract(NTNDArray const & source, NTNDArray const & result) const;
+
+private:
+    std::vector<NTNDArrayDimension> dimensions;
+    bool averaging;
+    NTNDArrayAllocatorPtr elementAllocator;
+    unsigned threadCount;
+};
+
+}}
+
+#endif  /* NTNDARRAYREGION_H */
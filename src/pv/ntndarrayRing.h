@@ -0,0 +1,259 @@
+/* ntndarrayRing.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTNDARRAYRING_H
+#define NTNDARRAYRING_H
+
+#include <deque>
+#include <vector>
+
+#ifdef epicsExportSharedSymbols
+#   define ntndarrayRingEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/pvData.h>
+#include <pv/lock.h>
+
+#ifdef ntndarrayRingEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntndarrayRingEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntndarray.h>
+#include <pv/ntndarrayAllocator.h>
+#include <pv/ntfingerprint.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+class NTNDArrayRing;
+typedef std::tr1::shared_ptr<NTNDArrayRing> NTNDArrayRingPtr;
+
+/**
+ * @brief Passes NTNDArray frames between the processes of a host through
+ * a ring of slots in shared memory, without copying their values.
+ *
+ * The producer creates the ring, and publishes frames into it. Each
+ * consumer opens the ring by its name, and reads the frames published
+ * since: the value of a frame read is a shared_vector of the slot in
+ * shared memory, and its other fields, e.g. dimension, codec, uniqueId,
+ * dataTimeStamp and attribute, are serialized next to it. E.g.
+@code
+    // producer
+    NTNDArrayRingPtr ring = NTNDArrayRing::create("/detector1",
+        structure, 8, 4096 * 4096 * 2);
+    NTNDArrayRegion region(dimensions);
+    region.allocator(ring->getAllocator()).extract(*frame, *roi);
+    ring->publish(*roi);
+
+    // consumer, in another process
+    NTNDArrayRingPtr ring = NTNDArrayRing::open("/detector1", structure);
+    while (ring->read(*frame, 1.0))
+        process(*frame);
+@endcode
+ * A value allocated by getAllocator() is already in a slot, and is
+ * published without copying it. Other values are copied into a slot.
+ * <p>
+ * A slot is reused for a new frame once no consumer holds the value
+ * read from it: the references to the value of each slot are counted
+ * in shared memory. The least recently published slot is reused first,
+ * and publish() fails if the consumers hold all of them. A consumer
+ * which reads the frames more slowly than they are published skips
+ * those whose slot was reused, which getLost() counts.
+ * <p>
+ * The ring is a POSIX shared memory object, see isSupported(). The
+ * producer and the consumers must use the same structure, and the same
+ * size_t. The counts are updated by atomic operations on the shared
+ * memory, so a consumer which terminates while holding a value leaves
+ * its slot in use until the ring is created again.
+ * Each instance is thread safe.
+ */
+class epicsShareClass NTNDArrayRing
+{
+public:
+    POINTER_DEFINITIONS(NTNDArrayRing);
+
+    /**
+     * Default number of bytes of the other fields of a frame in a slot.
+     */
+    static const size_t DEFAULT_METADATA_SIZE = 64 * 1024;
+
+    /**
+     * Returns whether rings are supported on this platform.
+     * @return true if shared memory objects are supported.
+     */
+    static bool isSupported();
+
+    /**
+     * Creates a ring, as its producer, replacing any ring of the same name.
+     * The ring is removed when the producer is destroyed: the consumers
+     * which opened it can read the frames already published.
+     * @param name the name of the shared memory object, e.g. "/detector1".
+     * @param structure the structure of the frames, as created by
+     *        NTNDArrayBuilder::createStructure().
+     * @param slots the number of frames the ring holds.
+     * @param payloadSize the maximum number of bytes of a value.
+     * @param metadataSize the maximum number of bytes of the other fields
+     *        of a frame, serialized.
+     * @return the ring.
+     * @throws std::runtime_error if the structure is not compatible with
+     *         NTNDArray, there is no slot, or the ring cannot be created.
+     */
+    static shared_pointer create(std::string const & name,
+        epics::pvData::StructureConstPtr const & structure,
+        size_t slots, size_t payloadSize,
+        size_t metadataSize = DEFAULT_METADATA_SIZE);
+
+    /**
+     * Opens a ring, as a consumer, which reads the frames published from now.
+     * @param name the name of the ring.
+     * @param structure the structure of the frames.
+     * @return the ring.
+     * @throws std::runtime_error if there is no ring of this name, or it
+     *         was created for another structure.
+     */
+    static shared_pointer open(std::string const & name,
+        epics::pvData::StructureConstPtr const & structure);
+
+    ~NTNDArrayRing();
+
+    /**
+     * Publishes a frame. Its value must not be modified afterwards,
+     * if it was allocated by getAllocator().
+     * @param frame the frame, of the structure of the ring.
+     * @return false if the consumers hold the values of all slots.
+     * @throws std::runtime_error if this is not the producer, the frame
+     *         is of another structure, has no numeric value, or its value
+     *         or other fields exceed the sizes of a slot.
+     */
+    bool publish(NTNDArray const & frame);
+
+    /**
+     * Returns an allocator of the values of slots, which publish()
+     * does not copy. Only the producer can allocate.
+     * @return the allocator, which throws std::bad_alloc if the size
+     *         exceeds the payload size, or no slot is free.
+     */
+    NTNDArrayAllocatorPtr getAllocator();
+
+    /**
+     * Reads the next frame, skipping those whose slot was reused.
+     * The value of the frame refers to the slot, which is not reused
+     * until the value is released.
+     * @param frame set to the frame, of the structure of the ring.
+     * @param timeout the maximum number of seconds to wait for a frame.
+     * @return false if no frame was published within the timeout.
+     * @throws std::runtime_error if this is the producer, or the frame is
+     *         of another structure.
+     */
+    bool read(NTNDArray const & frame, double timeout = 0.0);
+
+    /**
+     * Returns the number of frames skipped by read(), because their
+     * slot was reused before they were read. A frame whose slot the
+     * producer is about to reuse is only counted once the slot is
+     * reused: read() retries it if the producer backs off because
+     * another consumer holds the slot.
+     * @return the number of frames lost.
+     */
+    size_t getLost() const;
+
+    /**
+     * Returns the number of frames published which read() has not
+     * returned or skipped yet.
+     * @return the number of frames behind.
+     */
+    size_t getLag() const;
+
+    /**
+     * Returns the number of frames published.
+     * @return the number of frames.
+     */
+    size_t getPublished() const;
+
+    /**
+     * Returns whether this instance created the ring.
+     * @return true for the producer, false for a consumer.
+     */
+    bool isProducer() const { return producer; }
+
+    /**
+     * Returns the name of the ring.
+     * @return the name.
+     */
+    std::string const & getName() const { return name; }
+
+    /**
+     * Returns the structure of the frames.
+     * @return the structure.
+     */
+    epics::pvData::StructureConstPtr const & getStructure() const { return structure; }
+
+    /**
+     * Returns the number of slots.
+     * @return the number of slots.
+     */
+    size_t getSlots() const;
+
+    /**
+     * Returns the maximum number of bytes of a value.
+     * @return the payload size.
+     */
+    size_t getPayloadSize() const;
+
+    /**
+     * Returns the maximum number of bytes of the other fields of a frame.
+     * @return the metadata size.
+     */
+    size_t getMetadataSize() const;
+
+private:
+    NTNDArrayRing(std::string const & name,
+        epics::pvData::StructureConstPtr const & structure, bool producer);
+    NTNDArrayRing(NTNDArrayRing const &);
+    NTNDArrayRing & operator=(NTNDArrayRing const &);
+
+    struct Mapping;
+    struct Allocator;
+    struct Releaser;
+    friend struct Allocator;
+    friend struct Releaser;
+
+    // the outcome of take(): the frame was read, its slot was reused,
+    // or the producer is checking whether it can reuse its slot
+    enum TakeResult { Taken, Skipped, Busy };
+
+    void checkStructure(NTNDArray const & frame) const;
+    size_t claim();
+    void release(size_t slot);
+    TakeResult take(size_t sequence, NTNDArray const & frame);
+
+    std::string name;
+    epics::pvData::StructureConstPtr structure;
+    NTFingerprint fingerprint;
+    bool producer;
+    std::tr1::shared_ptr<Mapping> mapping;
+    std::tr1::weak_ptr<NTNDArrayRing> self;
+
+    // producer: the slots not being filled, the least recently published
+    // first, those released without being published, and for each slot
+    // whether it is being filled and whether a value allocated in it is held
+    std::deque<size_t> published;
+    std::vector<size_t> spare;
+    std::vector<bool> filling;
+    std::vector<bool> held;
+
+    // consumer: the sequence number of the next frame to read
+    size_t next;
+    size_t lost;
+
+    mutable epics::pvData::Mutex mutex;
+};
+
+}}
+
+#endif  /* NTNDARRAYRING_H */
@@ -0,0 +1,191 @@
+/* ntndarrayStatistics.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTNDARRAYSTATISTICS_H
+#define NTNDARRAYSTATISTICS_H
+
+#include <vector>
+
+#ifdef epicsExportSharedSymbols
+#   define ntndarrayStatisticsEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/pvData.h>
+
+#ifdef ntndarrayStatisticsEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntndarrayStatisticsEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntndarray.h>
+#include <pv/ntaggregate.h>
+#include <pv/nthistogram.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+/**
+ * @brief Computes the statistics and the histogram of the elements of
+ * NTNDArray frames, and publishes them as NTAggregate and NTHistogram.
+ *
+ * The elements are read once: each thread computes the statistics
+ * of a part of the frame, which are merged. E.g.
+@code
+    NTNDArrayStatistics statistics;
+    statistics.histogram(0.0, 65536.0, 256);
+    statistics.compute(*frame, *aggregate, *histogram);
+@endcode
+ * The minimum, maximum, total, mean and standard deviation (of all
+ * elements, i.e. divided by their number) are computed with SSE2
+ * for 16-bit elements, and by loops the compiler vectorizes otherwise.
+ * The histogram of 8 and 16-bit integer elements is derived from the
+ * counts of each value, which give the exact statistics too.
+ * <p>
+ * The bins of the histogram are given by their ranges: bin i counts
+ * the elements x with ranges[i] <= x < ranges[i + 1]. The elements
+ * below the first range, or from the last one, are only counted in
+ * underflow and overflow.
+ * NaN elements make the total, mean and deviation NaN, and are ignored
+ * by the minimum, maximum and histogram.
+ */
+class epicsShareClass NTNDArrayStatistics
+{
+public:
+    /**
+     * The minimum number of elements processed by more than one thread.
+     */
+    static const size_t MIN_PARALLEL_ELEMENTS = 1 << 18;
+
+    /**
+     * @brief The statistics of a frame.
+     */
+    struct Summary {
+        /** number of elements */
+        epics::pvData::int64 count;
+        /** sum of the elements */
+        double total;
+        /** mean of the elements */
+        double mean;
+        /** standard deviation of the elements */
+        double sigma;
+        /** smallest element, NaN if none */
+        double min;
+        /** largest element, NaN if none */
+        double max;
+        /** first element, NaN if none */
+        double first;
+        /** last element, NaN if none */
+        double last;
+        /** number of elements in each bin of the histogram */
+        std::vector<epics::pvData::int64> histogram;
+        /** number of elements below the first range of the histogram */
+        epics::pvData::int64 underflow;
+        /** number of elements from the last range of the histogram */
+        epics::pvData::int64 overflow;
+
+        Summary();
+    };
+
+    /**
+     * Constructor, without histogram.
+     */
+    NTNDArrayStatistics();
+
+    /**
+     * Sets a histogram of bins of the same width.
+     * @param low the start of the first bin.
+     * @param high the end of the last bin.
+     * @param bins the number of bins.
+     * @return these statistics.
+     * @throws std::runtime_error if there is no bin or low is not below high.
+     */
+    NTNDArrayStatistics & histogram(double low, double high, size_t bins);
+
+    /**
+     * Sets a histogram of any bins, or none.
+     * @param ranges the start of each bin followed by the end of the last bin,
+     *        in increasing order, empty for no histogram.
+     * @return these statistics.
+     * @throws std::runtime_error if there is a single range or they
+     *         are not increasing.
+     */
+    NTNDArrayStatistics & histogram(std::vector<double> const & ranges);
+
+    /**
+     * Sets the number of threads processing large frames.
+     * @param threads the maximum number of threads, including the
+     *        calling thread, 0 for the number of CPUs (the default).
+     * @return these statistics.
+     */
+    NTNDArrayStatistics & threads(unsigned threads);
+
+    /**
+     * Returns the ranges of the histogram.
+     * @return the ranges, empty for no histogram.
+     */
+    std::vector<double> const & getRanges() const { return ranges; }
+
+    /**
+     * Computes the statistics of a frame.
+     * @param frame the frame.
+     * @param summary set to its statistics.
+     * @throws std::runtime_error if the frame has no value or
+     *         its value is compressed.
+     */
+    void compute(NTNDArray const & frame, Summary & summary) const;
+
+    /**
+     * Computes the statistics of a frame and puts them into an NTAggregate.
+     * @param frame the frame.
+     * @param aggregate the NTAggregate, see put().
+     * @throws std::runtime_error if the frame has no value or
+     *         its value is compressed.
+     */
+    void compute(NTNDArray const & frame, NTAggregate const & aggregate) const;
+
+    /**
+     * Computes the statistics and the histogram of a frame and puts them
+     * into an NTAggregate and an NTHistogram.
+     * @param frame the frame.
+     * @param aggregate the NTAggregate, see put().
+     * @param histogram the NTHistogram, see put().
+     * @throws std::runtime_error if the frame has no value or
+     *         its value is compressed.
+     */
+    void compute(NTNDArray const & frame, NTAggregate const & aggregate,
+        NTHistogram const & histogram) const;
+
+    /**
+     * Puts the statistics of a frame into an NTAggregate: value is the
+     * mean, N the count, dispersion the standard deviation, and the
+     * optional first, last, min and max fields, if present, the elements.
+     * The optional firstTimeStamp and lastTimeStamp fields are set to
+     * the dataTimeStamp of the frame, timeStamp to its timeStamp.
+     * @param frame the frame.
+     * @param summary its statistics.
+     * @param aggregate the NTAggregate.
+     */
+    static void put(NTNDArray const & frame, Summary const & summary,
+        NTAggregate const & aggregate);
+
+    /**
+     * Puts the histogram of a frame into an NTHistogram: its ranges and
+     * the counts of the bins, converted to the type of its value.
+     * @param summary the statistics of the frame.
+     * @param histogram the NTHistogram.
+     */
+    void put(Summary const & summary, NTHistogram const & histogram) const;
+
+private:
+    std::vector<double> ranges;
+    bool uniform;
+    unsigned threadCount;
+};
+
+}}
+
+#endif  /* NTNDARRAYSTATISTICS_H */
@@ -0,0 +1,158 @@
+/* ntndarrayTransform.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTNDARRAYTRANSFORM_H
+#define NTNDARRAYTRANSFORM_H
+
+#include <vector>
+
+#ifdef epicsExportSharedSymbols
+#   define ntndarrayTransformEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/pvData.h>
+
+#ifdef ntndarrayTransformEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntndarrayTransformEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntndarray.h>
+#include <pv/ntndarrayAllocator.h>
+#include <pv/ntndarrayView.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+/**
+ * @brief Rotates, flips or transposes the images of NTNDArrays.
+ *
+ * The image is 2-D, or 3-D with a color dimension, e.g. the 3 colors
+ * of an RGB1 (3, x, y), RGB2 (x, 3, y) or RGB3 (x, y, 3) image; the
+ * color dimension is kept where it is, and the pixels of each color are
+ * transformed. By default, x and y are the dimensions 0 and 1 of a 2-D
+ * image, and the two dimensions other than the first of size 3 of a
+ * 3-D image; axes() sets them otherwise. E.g.
+@code
+    NTNDArrayTransform(NTNDArrayTransform::rotate90).apply(*frame, *rotated);
+@endcode
+ * The dimension field of the result is updated consistently: the
+ * dimension_t of x and y are swapped by the operations which swap
+ * them, and reverse is toggled for the dimensions the operation reverses.
+ * <p>
+ * The pixels are copied in tiles, which stay in the cache, using SSE2
+ * 8x8 (16-bit elements) or 4x4 (32-bit elements) block transposes when
+ * available, and by a pool of threads for large images.
+ * The elements of the result are allocated by an NTNDArrayAllocator,
+ * if set.
+ */
+class epicsShareClass NTNDArrayTransform
+{
+public:
+    /**
+     * The operations, the rotations being clockwise for an image
+     * displayed with y going down.
+     */
+    enum Operation
+    {
+        none,           ///< a copy
+        rotate90,       ///< rotation by 90 degrees
+        rotate180,      ///< rotation by 180 degrees
+        rotate270,      ///< rotation by 270 degrees
+        flipHorizontal, ///< x reversed
+        flipVertical,   ///< y reversed
+        transpose,      ///< x and y swapped
+        transverse      ///< x and y swapped and reversed
+    };
+
+    /**
+     * The minimum number of elements transformed by more than one thread.
+     */
+    static const size_t MIN_PARALLEL_ELEMENTS = 1 << 18;
+
+    /**
+     * Constructor.
+     * @param operation the operation.
+     */
+    explicit NTNDArrayTransform(Operation operation);
+
+    /**
+     * Sets the dimensions of the x and y axes of the image.
+     * @param x the dimension of x.
+     * @param y the dimension of y.
+     * @return this transform.
+     */
+    NTNDArrayTransform & axes(size_t x, size_t y);
+
+    /**
+     * Sets the allocator of the elements of the result.
+     * @param allocator the allocator, null for new[] (the default).
+     * @return this transform.
+     */
+    NTNDArrayTransform & allocator(NTNDArrayAllocatorPtr const & allocator);
+
+    /**
+     * Sets the number of threads transforming large images.
+     * @param threads the maximum number of threads, including the
+     *        calling thread, 0 for the number of CPUs (the default).
+     * @return this transform.
+     */
+    NTNDArrayTransform & threads(unsigned threads);
+
+    /**
+     * Returns the operation.
+     * @return the operation.
+     */
+    Operation getOperation() const { return operation; }
+
+    /**
+     * Returns the dimensions of the result for an image.
+     * @param source the dimensions of the image, fastest varying first.
+     * @param result set to the dimensions of the result.
+     * @throws std::runtime_error if the image is not 2-D nor 3-D,
+     *         or its axes are not valid.
+     */
+    void getResultDimensions(std::vector<NTNDArrayDimension> const & source,
+        std::vector<NTNDArrayDimension> & result) const;
+
+    /**
+     * Returns the dimensions of the x and y axes of an image.
+     * @param source the dimensions of the image, fastest varying first.
+     * @param x set to the dimension of x.
+     * @param y set to the dimension of y.
+     * @throws std::runtime_error if the image is not 2-D nor 3-D,
+     *         or the axes set are not valid.
+     */
+    void getAxes(std::vector<NTNDArrayDimension> const & source,
+        size_t & x, size_t & y) const;
+
+    /**
+     * Transforms the image of an NTNDArray.
+     * The value, dimension, codec, compressedSize, uncompressedSize,
+     * uniqueId, dataTimeStamp and attribute fields of the result are set,
+     * the other fields are left as they are.
+     * The result may be the source.
+     * @param source the image.
+     * @param result the NTNDArray set to the transformed image.
+     * @throws std::runtime_error if the source has no value, its value
+     *         is compressed or does not match its dimensions, or it is
+     *         not 2-D nor 3-D.
+     */
+    void apply(NTNDArray const & source, NTNDArray const & result) const;
+
+private:
+    Operation operation;
+    bool axesSet;
+    size_t xAxis;
+    size_t yAxis;
+    NTNDArrayAllocatorPtr elementAllocator;
+    unsigned threadCount;
+};
+
+}}
+
+#endif  /* NTNDARRAYTRANSFORM_H */
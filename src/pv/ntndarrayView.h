@@ -0,0 +1,566 @@
+/* ntndarrayView.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTNDARRAYVIEW_H
+#define NTNDARRAYVIEW_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#ifdef epicsExportSharedSymbols
+#   define ntndarrayViewEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/pvData.h>
+
+#ifdef ntndarrayViewEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntndarrayViewEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntndarray.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+/**
+ * @brief The fields of a dimension_t of an NTNDArray.
+ *
+ * The size is the number of elements along the dimension; offset,
+ * fullSize, binning and reverse relate the elements to the full,
+ * unbinned frame, e.g. of a detector: element i corresponds to
+ * getFullIndex(i) (and the following binning - 1 indexes) of the frame.
+ */
+struct epicsShareClass NTNDArrayDimension
+{
+    /**
+     * Creates a dimension of the specified size, covering the full frame.
+     * @param size the size of the dimension.
+     */
+    explicit NTNDArrayDimension(epics::pvData::int32 size = 0)
+    : size(size), offset(0), fullSize(size), binning(1), reverse(false)
+    {}
+
+    /**
+     * Returns the index in the full frame of an element.
+     * @param index the index of the element along this dimension.
+     * @return the first index of the full frame covered by the element.
+     */
+    epics::pvData::int32 getFullIndex(epics::pvData::int32 index) const
+    {
+        return offset + (reverse ? size - 1 - index : index) * binning;
+    }
+
+    bool operator==(NTNDArrayDimension const & other) const
+    {
+        return size == other.size && offset == other.offset &&
+            fullSize == other.fullSize && binning == other.binning &&
+            reverse == other.reverse;
+    }
+
+    bool operator!=(NTNDArrayDimension const & other) const
+    {
+        return !(*this == other);
+    }
+
+    /**
+     * Reads the dimension field of an NTNDArray.
+     * @param ndarray the NTNDArray.
+     * @param dimensions set to its dimensions, fastest varying first.
+     */
+    static void get(NTNDArray const & ndarray, std::vector<NTNDArrayDimension> & dimensions);
+
+    /**
+     * Sets the dimension field of an NTNDArray. Its elements are
+     * replaced by new ones, as the old ones may be shared.
+     * @param ndarray the NTNDArray.
+     * @param dimensions its new dimensions, fastest varying first.
+     */
+    static void put(NTNDArray const & ndarray, std::vector<NTNDArrayDimension> const & dimensions);
+
+    epics::pvData::int32 size;
+    epics::pvData::int32 offset;
+    epics::pvData::int32 fullSize;
+    epics::pvData::int32 binning;
+    bool reverse;
+};
+
+/**
+ * @brief A typed, N-dimensional view of the value of an NTNDArray.
+ *
+ * The view shares the (frozen) elements of the value, and describes them
+ * by a shape and a stride per dimension, dimension 0 being the fastest
+ * varying (x, e.g. the pixels of a row). Derived views, such as a plane
+ * (slice()), a region (subView()), a flipped or transposed view, share
+ * the same elements, with other strides. E.g.
+@code
+    NTNDArrayView<epics::pvData::uint16> image(*ntndarray);
+    for (size_t y = 0; y < image.getSize(1); ++y) {
+        NTNDArrayView<epics::pvData::uint16>::Row row = image.getRow(y);
+        for (size_t x = 0; x < row.size; ++x)
+            sum += row[x];
+    }
+@endcode
+ * The element type of an NTNDArray is only known at runtime;
+ * visitView() calls a visitor with the view of the right type.
+ * <p>
+ * Element accessors do not check their arguments.
+ *
+ * @tparam T the element type, e.g. epics::pvData::uint16 for ushortValue.
+ */
+template<typename T>
+class NTNDArrayView
+{
+public:
+    typedef T value_type;
+    typedef epics::pvData::PVValueArray<T> PVArray;
+    typedef epics::pvData::shared_vector<const T> const_svector;
+
+    /**
+     * The elements of the view along dimension 0, for given indexes
+     * of the other dimensions.
+     */
+    struct Row
+    {
+        T const & operator[](size_t index) const { return first[static_cast<ptrdiff_t>(index) * stride]; }
+
+        /**
+         * The first element.
+         */
+        T const * first;
+
+        /**
+         * The distance between elements, 1 if contiguous, negative if reversed.
+         */
+        ptrdiff_t stride;
+
+        /**
+         * The number of elements.
+         */
+        size_t size;
+    };
+
+    /**
+     * Creates an empty view, of rank 0.
+     */
+    NTNDArrayView() : origin(0) {}
+
+    /**
+     * Creates a view of contiguous elements.
+     * @param data the elements.
+     * @param dimensions the dimensions, fastest varying first.
+     * @throws std::runtime_error if the number of elements does not
+     *         match the dimensions.
+     */
+    NTNDArrayView(const_svector const & data, std::vector<NTNDArrayDimension> const & dimensions)
+    {
+        init(data, dimensions);
+    }
+
+    /**
+     * Creates a view of the value of an NTNDArray.
+     * An NTNDArray without dimensions is viewed as one dimension.
+     * @param ndarray the NTNDArray.
+     * @throws std::runtime_error if the value is not an array of T,
+     *         it is compressed or its number of elements does not
+     *         match the dimensions.
+     */
+    explicit NTNDArrayView(NTNDArray const & ndarray)
+    {
+        std::tr1::shared_ptr<PVArray> value = ndarray.getValue()->template get<PVArray>();
+        if (!value)
+            throw std::runtime_error("NTNDArray value is not an array of the view type");
+        if (!ndarray.getCodec()->template getSubFieldT<epics::pvData::PVString>("name")->get().empty())
+            throw std::runtime_error("NTNDArray value is compressed");
+
+        std::vector<NTNDArrayDimension> dimensions;
+        NTNDArrayDimension::get(ndarray, dimensions);
+        const_svector data(value->view());
+        if (dimensions.empty())
+            dimensions.push_back(NTNDArrayDimension(static_cast<epics::pvData::int32>(data.size())));
+        init(data, dimensions);
+    }
+
+    /**
+     * Returns whether the view has no elements.
+     * @return (false,true) if the view (has, has no) elements.
+     */
+    bool empty() const { return getNumberOfElements() == 0; }
+
+    /**
+     * Returns the number of dimensions.
+     * @return the rank.
+     */
+    size_t getRank() const { return shape.size(); }
+
+    /**
+     * Returns the number of elements along each dimension.
+     * @return the shape.
+     */
+    std::vector<size_t> const & getShape() const { return shape; }
+
+    /**
+     * Returns the number of elements along a dimension.
+     * @param dimension the dimension.
+     * @return the size.
+     */
+    size_t getSize(size_t dimension) const { return shape[dimension]; }
+
+    /**
+     * Returns the distance, in elements, between successive elements
+     * along a dimension, negative if reversed.
+     * @param dimension the dimension.
+     * @return the stride.
+     */
+    ptrdiff_t getStride(size_t dimension) const { return strides[dimension]; }
+
+    /**
+     * Returns the dimension_t fields of a dimension.
+     * @param dimension the dimension.
+     * @return the fields, whose size is the size of the dimension.
+     */
+    NTNDArrayDimension const & getDimension(size_t dimension) const { return dimensions[dimension]; }
+
+    /**
+     * Returns the dimension_t fields of all dimensions.
+     * @return the fields, fastest varying first.
+     */
+    std::vector<NTNDArrayDimension> const & getDimensions() const { return dimensions; }
+
+    /**
+     * Returns the number of elements of the view.
+     * @return the number of elements.
+     */
+    size_t getNumberOfElements() const
+    {
+        if (shape.empty())
+            return 0;
+        size_t n = 1;
+        for (size_t d = 0; d < shape.size(); ++d)
+            n *= shape[d];
+        return n;
+    }
+
+    /**
+     * Returns whether the elements of the view are contiguous, in order.
+     * @return (false,true) if the elements (are not, are) contiguous.
+     */
+    bool isContiguous() const
+    {
+        ptrdiff_t expected = 1;
+        for (size_t d = 0; d < shape.size(); ++d) {
+            if (shape[d] != 1 && strides[d] != expected)
+                return false;
+            expected *= static_cast<ptrdiff_t>(shape[d]);
+        }
+        return true;
+    }
+
+    /**
+     * Returns the elements viewed, which may include elements outside of the view.
+     * @return the elements.
+     */
+    const_svector const & getData() const { return data; }
+
+    /**
+     * Returns the element at an index of a view of rank 1.
+     */
+    T const & operator()(size_t i0) const
+    {
+        return data[origin + static_cast<ptrdiff_t>(i0) * strides[0]];
+    }
+
+    /**
+     * Returns the element at indexes of a view of rank 2.
+     */
+    T const & operator()(size_t i0, size_t i1) const
+    {
+        return data[origin + static_cast<ptrdiff_t>(i0) * strides[0]
+                           + static_cast<ptrdiff_t>(i1) * strides[1]];
+    }
+
+    /**
+     * Returns the element at indexes of a view of rank 3.
+     */
+    T const & operator()(size_t i0, size_t i1, size_t i2) const
+    {
+        return data[origin + static_cast<ptrdiff_t>(i0) * strides[0]
+                           + static_cast<ptrdiff_t>(i1) * strides[1]
+                           + static_cast<ptrdiff_t>(i2) * strides[2]];
+    }
+
+    /**
+     * Returns the element at indexes of a view of any rank.
+     * @param indexes an index per dimension.
+     */
+    T const & at(std::vector<size_t> const & indexes) const
+    {
+        ptrdiff_t offset = origin;
+        for (size_t d = 0; d < indexes.size(); ++d)
+            offset += static_cast<ptrdiff_t>(indexes[d]) * strides[d];
+        return data[offset];
+    }
+
+    /**
+     * Returns a row of a view of rank 1, 2 or 3.
+     * @param i1 the index along dimension 1, if any.
+     * @param i2 the index along dimension 2, if any.
+     * @return the row.
+     */
+    Row getRow(size_t i1 = 0, size_t i2 = 0) const
+    {
+        ptrdiff_t offset = origin;
+        if (shape.size() > 1)
+            offset += static_cast<ptrdiff_t>(i1) * strides[1];
+        if (shape.size() > 2)
+            offset += static_cast<ptrdiff_t>(i2) * strides[2];
+        return makeRow(offset);
+    }
+
+    /**
+     * Calls a function for each row of the view, of any rank,
+     * in the order of the elements.
+     * @param f called as f(row).
+     */
+    template<typename F>
+    void forEachRow(F & f) const
+    {
+        if (empty())
+            return;
+        if (shape.size() == 1) {
+            f(makeRow(origin));
+            return;
+        }
+
+        std::vector<size_t> index(shape.size(), 0);
+        ptrdiff_t offset = origin;
+        while (true) {
+            f(makeRow(offset));
+
+            // next row: increment the outer indexes like an odometer
+            size_t d = 1;
+            for (; d < shape.size(); ++d) {
+                offset += strides[d];
+                if (++index[d] < shape[d])
+                    break;
+                offset -= strides[d] * static_cast<ptrdiff_t>(shape[d]);
+                index[d] = 0;
+            }
+            if (d == shape.size())
+                return;
+        }
+    }
+
+    /**
+     * Copies the elements of the view, in order, dimension 0 fastest.
+     * @param out the destination, of at least getNumberOfElements() elements.
+     */
+    void copyTo(T * out) const
+    {
+        Copier copier(out);
+        forEachRow(copier);
+    }
+
+    /**
+     * Returns a view of rank one less, at an index along a dimension,
+     * e.g. a plane of a 3-D view or a row of a 2-D view.
+     * @param dimension the dimension removed.
+     * @param index the index along it.
+     * @return the view.
+     */
+    NTNDArrayView slice(size_t dimension, size_t index) const
+    {
+        NTNDArrayView view(*this);
+        view.origin += static_cast<ptrdiff_t>(index) * strides[dimension];
+        view.shape.erase(view.shape.begin() + dimension);
+        view.strides.erase(view.strides.begin() + dimension);
+        view.dimensions.erase(view.dimensions.begin() + dimension);
+        return view;
+    }
+
+    /**
+     * Returns a view of a range of indexes along a dimension.
+     * The dimension_t fields of the view are adjusted accordingly.
+     * @param dimension the dimension.
+     * @param start the first index.
+     * @param count the number of indexes.
+     * @return the view.
+     */
+    NTNDArrayView subView(size_t dimension, size_t start, size_t count) const
+    {
+        NTNDArrayView view(*this);
+        NTNDArrayDimension & dim = view.dimensions[dimension];
+        size_t after = shape[dimension] - start - count;
+        dim.offset += static_cast<epics::pvData::int32>((dim.reverse ? after : start) * dim.binning);
+        dim.size = static_cast<epics::pvData::int32>(count);
+        view.origin += static_cast<ptrdiff_t>(start) * strides[dimension];
+        view.shape[dimension] = count;
+        return view;
+    }
+
+    /**
+     * Returns a view reversed along a dimension.
+     * @param dimension the dimension.
+     * @return the view.
+     */
+    NTNDArrayView flip(size_t dimension) const
+    {
+        NTNDArrayView view(*this);
+        if (shape[dimension] > 0)
+            view.origin += static_cast<ptrdiff_t>(shape[dimension] - 1) * strides[dimension];
+        view.strides[dimension] = -strides[dimension];
+        view.dimensions[dimension].reverse = !dimensions[dimension].reverse;
+        return view;
+    }
+
+    /**
+     * Returns a view with two dimensions swapped, e.g. the transpose
+     * of a 2-D view.
+     * @param a a dimension.
+     * @param b another dimension.
+     * @return the view.
+     */
+    NTNDArrayView swap(size_t a, size_t b) const
+    {
+        NTNDArrayView view(*this);
+        std::swap(view.shape[a], view.shape[b]);
+        std::swap(view.strides[a], view.strides[b]);
+        std::swap(view.dimensions[a], view.dimensions[b]);
+        return view;
+    }
+
+private:
+    struct Copier
+    {
+        explicit Copier(T * out) : out(out) {}
+
+        void operator()(Row const & row)
+        {
+            if (row.stride == 1) {
+                std::memcpy(out, row.first, row.size * sizeof(T));
+                out += row.size;
+            } else {
+                for (size_t i = 0; i < row.size; ++i)
+                    *out++ = row[i];
+            }
+        }
+
+        T * out;
+    };
+
+    void init(const_svector const & data, std::vector<NTNDArrayDimension> const & dimensions)
+    {
+        size_t n = 1;
+        for (size_t d = 0; d < dimensions.size(); ++d) {
+            if (dimensions[d].size < 0)
+                throw std::runtime_error("negative NTNDArray dimension size");
+            n *= static_cast<size_t>(dimensions[d].size);
+        }
+        if (dimensions.empty() ? !data.empty() : n != data.size())
+            throw std::runtime_error("NTNDArray value does not match its dimensions");
+
+        this->data = data;
+        this->dimensions = dimensions;
+        origin = 0;
+        shape.resize(dimensions.size());
+        strides.resize(dimensions.size());
+        ptrdiff_t stride = 1;
+        for (size_t d = 0; d < dimensions.size(); ++d) {
+            shape[d] = static_cast<size_t>(dimensions[d].size);
+            strides[d] = stride;
+            stride *= static_cast<ptrdiff_t>(shape[d]);
+        }
+    }
+
+    Row makeRow(ptrdiff_t offset) const
+    {
+        Row row;
+        row.first = data.data() + offset;
+        row.stride = strides[0];
+        row.size = shape[0];
+        return row;
+    }
+
+    const_svector data;
+    ptrdiff_t origin;
+    std::vector<size_t> shape;
+    std::vector<ptrdiff_t> strides;
+    std::vector<NTNDArrayDimension> dimensions;
+};
+
+/**
+ * Calls a visitor with the view of the value of an NTNDArray,
+ * of the element type of the value, e.g.
+@code
+    struct Sum {
+        double sum;
+        template<typename T>
+        void operator()(NTNDArrayView<T> const & view) { ... }
+    };
+@endcode
+ * @param ndarray the NTNDArray.
+ * @param visitor called with the NTNDArrayView<T> of the value.
+ * @return false, without calling the visitor, if no value array is
+ *         selected or it is compressed.
+ * @throws std::runtime_error if the value does not match the dimensions.
+ */
+template<typename V>
+bool visitView(NTNDArray const & ndarray, V & visitor)
+{
+    epics::pvData::PVScalarArrayPtr value =
+        ndarray.getValue()->template get<epics::pvData::PVScalarArray>();
+    if (!value)
+        return false;
+    if (!ndarray.getCodec()->template getSubFieldT<epics::pvData::PVString>("name")->get().empty())
+        return false;
+
+    switch (value->getScalarArray()->getElementType())
+    {
+    case epics::pvData::pvBoolean:
+        visitor(NTNDArrayView<epics::pvData::boolean>(ndarray));
+        return true;
+    case epics::pvData::pvByte:
+        visitor(NTNDArrayView<epics::pvData::int8>(ndarray));
+        return true;
+    case epics::pvData::pvUByte:
+        visitor(NTNDArrayView<epics::pvData::uint8>(ndarray));
+        return true;
+    case epics::pvData::pvShort:
+        visitor(NTNDArrayView<epics::pvData::int16>(ndarray));
+        return true;
+    case epics::pvData::pvUShort:
+        visitor(NTNDArrayView<epics::pvData::uint16>(ndarray));
+        return true;
+    case epics::pvData::pvInt:
+        visitor(NTNDArrayView<epics::pvData::int32>(ndarray));
+        return true;
+    case epics::pvData::pvUInt:
+        visitor(NTNDArrayView<epics::pvData::uint32>(ndarray));
+        return true;
+    case epics::pvData::pvLong:
+        visitor(NTNDArrayView<epics::pvData::int64>(ndarray));
+        return true;
+    case epics::pvData::pvULong:
+        visitor(NTNDArrayView<epics::pvData::uint64>(ndarray));
+        return true;
+    case epics::pvData::pvFloat:
+        visitor(NTNDArrayView<float>(ndarray));
+        return true;
+    case epics::pvData::pvDouble:
+        visitor(NTNDArrayView<double>(ndarray));
+        return true;
+    default:
+        return false;
+    }
+}
+
+}}
+
+#endif  /* NTNDARRAYVIEW_H */
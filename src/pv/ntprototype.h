@@ -0,0 +1,107 @@
+/* ntprototype.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTPROTOTYPE_H
+#define NTPROTOTYPE_H
+
+#include <vector>
+
+#ifdef epicsExportSharedSymbols
+#   define ntprototypeEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/pvData.h>
+#include <pv/lock.h>
+
+#ifdef ntprototypeEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntprototypeEpicsExportSharedSymbols
+#endif
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+class NTPrototype;
+typedef std::tr1::shared_ptr<NTPrototype> NTPrototypePtr;
+
+/**
+ * @brief A fully initialized PVStructure from which instances are cloned.
+ *
+ * Creating many instances of the same normative type, e.g. one per
+ * record of an IOC, by setting up each one from a builder repeats the
+ * same work for every instance. A prototype is set up once, e.g.
+@code
+    NTPrototypePtr prototype = NTEnum::createBuilder()->addAlarm()->createPrototype();
+    NTEnumPtr ntEnum = NTEnum::wrapUnsafe(prototype->getPVStructure());
+    // fill in the choices, limits etc.
+    ...
+    NTEnumPtr instance = NTEnum::wrapUnsafe(prototype->create());
+@endcode
+ * An instance is cloned from the prototype in a single walk of its tree,
+ * each field being created with the value of the prototype's, instead of
+ * creating an instance with the default values and copying the prototype
+ * into it. Only the fields which do not hold their default values in the
+ * prototype are copied. Scalar arrays share their (frozen) data with the
+ * prototype; elements of structure and union arrays, and the values of
+ * unions, are cloned.
+ * <p>
+ * The prototype may be modified until its first instance is created.
+ * It must not be modified afterwards.
+ * create() is thread safe once the prototype is no longer modified.
+ */
+class epicsShareClass NTPrototype
+{
+public:
+    POINTER_DEFINITIONS(NTPrototype);
+
+    /**
+     * Creates a prototype holding a copy of a PVStructure.
+     * @param pvStructure the PVStructure to copy.
+     */
+    explicit NTPrototype(epics::pvData::PVStructurePtr const & pvStructure);
+
+    /**
+     * Returns the PVStructure of the prototype, to be initialized
+     * before the first instance is created.
+     * @return the PVStructure.
+     */
+    epics::pvData::PVStructurePtr const & getPVStructure() const { return prototype; }
+
+    /**
+     * Creates a new instance of the prototype.
+     * @return a new PVStructure, with the values of the prototype.
+     */
+    epics::pvData::PVStructurePtr create();
+
+    /**
+     * Returns the number of fields which are copied from the prototype
+     * when an instance is created, e.g. for diagnostics.
+     * @return the number of fields copied.
+     */
+    size_t getCopiedFieldCount();
+
+private:
+    NTPrototype(NTPrototype const &);
+    NTPrototype & operator=(NTPrototype const &);
+
+    void prepare();
+    epics::pvData::PVFieldPtr create(epics::pvData::PVField const & from) const;
+
+    epics::pvData::PVStructurePtr prototype;
+
+    // whether each field, by offset, is copied from the prototype
+    std::vector<bool> copied;
+    size_t count;
+
+    // set by the first create()
+    int prepared;
+    epics::pvData::Mutex mutex;
+};
+
+}}
+
+#endif  /* NTPROTOTYPE_H */
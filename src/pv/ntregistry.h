@@ -0,0 +1,206 @@
+/* ntregistry.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTREGISTRY_H
+#define NTREGISTRY_H
+
+#include <string>
+
+#ifdef epicsExportSharedSymbols
+#   define ntregistryEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <pv/pvData.h>
+
+#ifdef ntregistryEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntregistryEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntscalar.h>
+#include <pv/ntscalarArray.h>
+#include <pv/ntnameValue.h>
+#include <pv/nttable.h>
+#include <pv/ntndarray.h>
+#include <pv/ntmultiChannel.h>
+#include <pv/ntscalarMultiChannel.h>
+#include <pv/ntmatrix.h>
+#include <pv/ntenum.h>
+#include <pv/ntunion.h>
+#include <pv/ntaggregate.h>
+#include <pv/ntattribute.h>
+#include <pv/ntcontinuum.h>
+#include <pv/nthistogram.h>
+#include <pv/nturi.h>
+#include <pv/ntndarrayAttribute.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+/**
+ * The normative types known to NTRegistry.
+ */
+enum NTType {
+    ntUnknown,
+    ntScalar,
+    ntScalarArray,
+    ntNameValue,
+    ntTable,
+    ntNDArray,
+    ntMultiChannel,
+    ntScalarMultiChannel,
+    ntMatrix,
+    ntEnum,
+    ntUnion,
+    ntAggregate,
+    ntAttribute,
+    ntContinuum,
+    ntHistogram,
+    ntURI,
+    ntNDArrayAttribute
+};
+
+/**
+ * @brief Receives the wrapper created by NTRegistry::wrap().
+ *
+ * Override the methods for the types of interest, the others do nothing.
+ */
+class epicsShareClass NTVisitor
+{
+public:
+    virtual ~NTVisitor() {}
+
+    virtual void visit(NTScalarPtr const &) {}
+    virtual void visit(NTScalarArrayPtr const &) {}
+    virtual void visit(NTNameValuePtr const &) {}
+    virtual void visit(NTTablePtr const &) {}
+    virtual void visit(NTNDArrayPtr const &) {}
+    virtual void visit(NTMultiChannelPtr const &) {}
+    virtual void visit(NTScalarMultiChannelPtr const &) {}
+    virtual void visit(NTMatrixPtr const &) {}
+    virtual void visit(NTEnumPtr const &) {}
+    virtual void visit(NTUnionPtr const &) {}
+    virtual void visit(NTAggregatePtr const &) {}
+    virtual void visit(NTAttributePtr const &) {}
+    virtual void visit(NTContinuumPtr const &) {}
+    virtual void visit(NTHistogramPtr const &) {}
+    virtual void visit(NTURIPtr const &) {}
+    virtual void visit(NTNDArrayAttributePtr const &) {}
+};
+
+/**
+ * @brief Identifies the normative type of a structure in a single lookup.
+ *
+ * Identification is by type ID, following the rules of NTUtils::is_a(),
+ * i.e. names and major versions must match. The lookup is a single probe
+ * of a hash table and does not allocate.
+ * NTNDArrayAttribute shares its type ID with NTAttribute; a structure
+ * with that ID is identified as an NTNDArrayAttribute if it is compatible
+ * with it, otherwise as an NTAttribute.
+ */
+class epicsShareClass NTRegistry
+{
+public:
+    /**
+     * Number of entries of NTType, including ntUnknown.
+     */
+    static const size_t TYPE_COUNT = ntNDArrayAttribute + 1;
+
+    /**
+     * @brief The description of a normative type.
+     */
+    struct Entry {
+        /** the type */
+        NTType type;
+        /** the class name, e.g. "NTScalar" */
+        const char * name;
+        /** the type ID of the current version, e.g. NTScalar::URI */
+        std::string const * uri;
+        /** the (uncached) compatibility check, e.g. NTScalar::isCompatible */
+        bool (*isCompatible)(epics::pvData::StructureConstPtr const & structure);
+        /** the compatibility check using the type's NTCompatibilityCache */
+        bool (*isCompatibleCached)(epics::pvData::StructureConstPtr const & structure);
+        /** wraps a PVStructure and passes the wrapper to a visitor */
+        bool (*wrap)(epics::pvData::PVStructurePtr const & pvStructure,
+                     NTVisitor & visitor, bool checkCompatible);
+        /** the type's NTCompatibilityCache, e.g. NTScalar::getCompatibilityCache */
+        NTCompatibilityCache & (*getCompatibilityCache)();
+    };
+
+    /**
+     * Returns the entry of a type.
+     * @param type the type.
+     * @return the entry, or null for ntUnknown.
+     */
+    static Entry const * getEntry(NTType type);
+
+    /**
+     * Returns the class name of a type.
+     * @param type the type.
+     * @return the name, e.g. "NTScalar", or "unknown".
+     */
+    static const char * getName(NTType type);
+
+    /**
+     * Finds the normative type reported by a type ID.
+     * @param id the type ID, e.g. "epics:nt/NTScalar:1.0".
+     * @return the entry, or null if the ID is not a known normative type.
+     */
+    static Entry const * find(std::string const & id);
+
+    /**
+     * Identifies the normative type reported by a type ID.
+     * @param id the type ID, e.g. "epics:nt/NTScalar:1.0".
+     * @return the type, ntUnknown if the ID is not a known normative type.
+     */
+    static NTType identify(std::string const & id);
+
+    /**
+     * Identifies the normative type a Structure reports to be.
+     * @param structure the Structure to identify.
+     * @return the type, ntUnknown if not a known normative type.
+     */
+    static NTType identify(epics::pvData::StructureConstPtr const & structure);
+
+    /**
+     * Identifies the normative type a PVStructure reports to be.
+     * @param pvStructure the PVStructure to identify.
+     * @return the type, ntUnknown if not a known normative type.
+     */
+    static NTType identify(epics::pvData::PVStructurePtr const & pvStructure);
+
+    /**
+     * Identifies a Structure and checks that it is compatible with
+     * the identified type.
+     * @param structure the Structure to identify.
+     * @param cached whether to use the type's NTCompatibilityCache.
+     * @return the type, ntUnknown if not a compatible normative type.
+     */
+    static NTType identifyCompatible(epics::pvData::StructureConstPtr const & structure,
+                                     bool cached = true);
+
+    /**
+     * Identifies a PVStructure and passes it, wrapped by the wrapper
+     * class of its type, to a visitor.
+     * @param pvStructure the PVStructure to wrap.
+     * @param visitor the visitor.
+     * @param checkCompatible whether to check (using the type's
+     * NTCompatibilityCache) that the PVStructure is compatible,
+     * as NTScalar::wrap() does, or not, as NTScalar::wrapUnsafe() does.
+     * @return the type, ntUnknown if not wrapped.
+     */
+    static NTType wrap(epics::pvData::PVStructurePtr const & pvStructure,
+                       NTVisitor & visitor, bool checkCompatible = true);
+
+private:
+    // disable object creation
+    NTRegistry() {}
+};
+
+}}
+
+#endif  /* NTREGISTRY_H */
@@ -0,0 +1,187 @@
+/* ntstatistics.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTSTATISTICS_H
+#define NTSTATISTICS_H
+
+#ifdef epicsExportSharedSymbols
+#   define ntstatisticsEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <epicsTypes.h>
+#include <epicsTime.h>
+#include <epicsAtomic.h>
+
+#ifdef ntstatisticsEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef ntstatisticsEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntregistry.h>
+
+#include <shareLib.h>
+
+namespace epics { namespace nt {
+
+/**
+ * @brief Optional per-type statistics of wrap(), isCompatible() and isValid().
+ *
+ * When enabled, every call of NT*::wrap(), NT*::isCompatible(StructureConstPtr)
+ * (i.e. a validation not answered by the compatibility cache) and
+ * NT*::isValid() is counted, together with its failures and its duration.
+ * Counters are kept per thread, so updating them does not contend,
+ * and summed by getSnapshot(). The counters of an EPICS thread which
+ * exits are kept, and its storage is reused by the next thread.
+ * Statistics are disabled by default; when disabled, the cost of a call
+ * is that of reading a flag.
+ */
+class epicsShareClass NTStatistics
+{
+public:
+    /**
+     * The instrumented operations.
+     */
+    enum Operation {
+        opWrap,
+        opIsCompatible,
+        opIsValid
+    };
+
+    /**
+     * Number of entries of Operation.
+     */
+    static const size_t OPERATION_COUNT = opIsValid + 1;
+
+    /**
+     * @brief The statistics of an operation.
+     */
+    struct Counters {
+        /** number of calls */
+        epicsUInt64 calls;
+        /** number of calls which failed, i.e. returned false or null */
+        epicsUInt64 failures;
+        /** cumulative duration of the calls */
+        epicsUInt64 nanoseconds;
+
+        Counters() : calls(0), failures(0), nanoseconds(0) {}
+    };
+
+    /**
+     * @brief The statistics of all types, indexed by NTType.
+     */
+    struct Snapshot {
+        /** the statistics of each operation */
+        Counters counters[NTRegistry::TYPE_COUNT][OPERATION_COUNT];
+        /** the hits of each type's NTCompatibilityCache */
+        epicsUInt64 cacheHits[NTRegistry::TYPE_COUNT];
+        /** the misses of each type's NTCompatibilityCache */
+        epicsUInt64 cacheMisses[NTRegistry::TYPE_COUNT];
+
+        Snapshot();
+    };
+
+    /**
+     * Enables or disables collecting statistics.
+     * @param enable true to enable.
+     */
+    static void setEnabled(bool enable);
+
+    /**
+     * Returns whether statistics are collected.
+     * @return true if enabled.
+     */
+    static bool isEnabled()
+    {
+        return epics::atomic::get(enabled) != 0;
+    }
+
+    /**
+     * Takes a snapshot of the statistics.
+     * The counters of calls in progress may or may not be included.
+     * @param snapshot set to the current statistics.
+     */
+    static void getSnapshot(Snapshot & snapshot);
+
+    /**
+     * Resets all statistics, including the counters of the
+     * compatibility caches, to zero.
+     */
+    static void reset();
+
+    /**
+     * Creates an NTTable holding a snapshot, one row per type.
+     * <p>
+     * The columns are "type", then "calls", "failures" and "nanoseconds"
+     * of each operation, prefixed with "wrap", "isCompatible" and "isValid"
+     * (e.g. "wrapCalls"), and "cacheHits" and "cacheMisses".
+     * @param snapshot the statistics.
+     * @return the NTTable.
+     */
+    static NTTablePtr createTable(Snapshot const & snapshot);
+
+    /**
+     * Records a call, used by Probe.
+     * @param type the type.
+     * @param operation the operation.
+     * @param failed whether the call failed.
+     * @param nanoseconds the duration of the call.
+     */
+    static void record(NTType type, Operation operation, bool failed,
+                       epicsUInt64 nanoseconds);
+
+    /**
+     * @brief Records the call of the scope it is declared in.
+     *
+     * A call fails if a result passed to result() is false.
+     */
+    class Probe
+    {
+    public:
+        Probe(NTType type, Operation operation)
+        : type(type), operation(operation), failed(false), start(0)
+        {
+            if (isEnabled())
+                start = epicsMonotonicGet();
+        }
+
+        ~Probe()
+        {
+            if (start)
+                record(type, operation, failed, epicsMonotonicGet() - start);
+        }
+
+        /**
+         * Records the result of the call.
+         * @param ok the result.
+         * @return ok.
+         */
+        bool result(bool ok)
+        {
+            if (!ok)
+                failed = true;
+            return ok;
+        }
+
+    private:
+        Probe(Probe const &);
+        Probe & operator=(Probe const &);
+
+        NTType type;
+        Operation operation;
+        bool failed;
+        epicsUInt64 start;
+    };
+
+private:
+    // disable object creation
+    NTStatistics() {}
+
+    static int enabled;
+};
+
+}}
+
+#endif  /* NTSTATISTICS_H */
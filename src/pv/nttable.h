@@ -23,6 +23,8 @@
 #endif
 
 #include <pv/ntfield.h>
+#include <pv/ntcompatibilityCache.h>
+#include <pv/ntprototype.h>
 
 #include <shareLib.h>
 
@@ -87,6 +89,14 @@ namespace detail {
          */
         epics::pvData::PVStructurePtr createPVStructure();
 
+        /**
+         * Creates a prototype of the <b>PVStructure</b> that represents NTTable,
+         * to be initialized once and cloned into many instances, see NTPrototype.
+         * This resets this instance state and allows new instance to be created.
+         * @return a new prototype.
+         */
+        NTPrototypePtr createPrototype();
+
         /**
          * Creates a <b>NTTable</b> instance.
          * The returned NTTable will wrap a PVStructure which will have
@@ -203,6 +213,21 @@ public:
     static bool isCompatible(
         epics::pvData::StructureConstPtr const &structure);
 
+    /**
+     * Returns whether the specified Structure is compatible with NTTable
+     * and describes why not.
+     * <p>
+     * Checks the same as isCompatible(StructureConstPtr const &), but
+     * completely, collecting all the incompatibilities found.
+     *
+     * @param structure the Structure to test
+     * @param diagnostics set to the description of the incompatibilities, empty if none
+     * @return (false,true) if the specified Structure (is not, is) a compatible NTTable
+     */
+    static bool isCompatible(
+        epics::pvData::StructureConstPtr const &structure,
+        std::string &diagnostics);
+
     /**
      * Returns whether the specified PVStructure is compatible with NTTable.
      *
@@ -215,6 +240,14 @@ public:
     static bool isCompatible(
         epics::pvData::PVStructurePtr const &pvStructure);
 
+    /**
+     * Returns the cache of compatibility verdicts used by
+     * isCompatible(PVStructurePtr const &) and hence by wrap().
+     *
+     * @return the NTTable compatibility cache
+     */
+    static NTCompatibilityCache & getCompatibilityCache();
+
     /**
      * Returns whether the specified structure is a valid NTTable.
      * <p>
@@ -315,10 +348,108 @@ public:
             return std::tr1::shared_ptr<PVT>();
     }
 
+    /**
+     * Value returned by getColumnIndex() if there is no such column.
+     */
+    static const size_t npos = static_cast<size_t>(-1);
+
+    /**
+     * Returns the number of columns of the table.
+     * @return the number of columns.
+     */
+    size_t getNumberColumns() const { return columnIndex.size(); }
+
+    /**
+     * Returns the position of the column with the specified name,
+     * looked up in an index built when wrapped.
+     * @param columnName the name of the column.
+     * @return the position of the column, in the order of getColumnNames(),
+     *         or npos if the column does not exist.
+     */
+    size_t getColumnIndex(std::string const & columnName) const;
+
+    /**
+     * Returns the column at the specified position.
+     * @param index the position of the column.
+     * @return the field for the column or null if index is out of range.
+     */
+    epics::pvData::PVFieldPtr getColumn(size_t index) const
+    {
+        return index < columnIndex.size() ?
+            pvValue->getPVFields()[index] : epics::pvData::PVFieldPtr();
+    }
+
+    /**
+     * Returns the column at the specified position and of a specified
+     * expected type (for example, PVDoubleArray).
+     * @tparam PVT the expected type of the column which should be
+     *             be PVScalarArray or a derived class.
+     * @param index the position of the column.
+     * @return the field for the column or null if index is out of range
+     *         or the column is not of the specified type.
+     */
+    template<typename PVT>
+    std::tr1::shared_ptr<PVT> getColumn(size_t index) const
+    {
+        return std::tr1::dynamic_pointer_cast<PVT>(getColumn(index));
+    }
+
+    /**
+     * Returns the values of the column at the specified position.
+     * If the column has elements of type T (for example, double), they are
+     * returned without a copy, otherwise they are converted to T.
+     * @tparam T the element type to return.
+     * @param index the position of the column.
+     * @return the values, empty if index is out of range or the column
+     *         is not a scalar array.
+     */
+    template<typename T>
+    epics::pvData::shared_vector<const T> getColumnView(size_t index) const
+    {
+        epics::pvData::shared_vector<const T> values;
+        if (index >= columnIndex.size())
+            return values;
+        epics::pvData::PVField const & field = *pvValue->getPVFields()[index];
+        if (field.getField()->getType() != epics::pvData::scalarArray)
+            return values;
+
+        epics::pvData::PVScalarArray const & column =
+            static_cast<epics::pvData::PVScalarArray const &>(field);
+        if (column.getScalarArray()->getElementType() ==
+            static_cast<epics::pvData::ScalarType>(epics::pvData::ScalarTypeID<T>::value))
+            values = static_cast<epics::pvData::PVValueArray<T> const &>(column).view();
+        else
+            column.getAs<T>(values);
+        return values;
+    }
+
+    /**
+     * Returns the values of the column with the specified name, as
+     * getColumnView(size_t) does.
+     * @tparam T the element type to return.
+     * @param columnName the name of the column.
+     * @return the values, empty if the column does not exist
+     *         or is not a scalar array.
+     */
+    template<typename T>
+    epics::pvData::shared_vector<const T> getColumnView(std::string const & columnName) const
+    {
+        return getColumnView<T>(getColumnIndex(columnName));
+    }
+
 private:
     NTTable(epics::pvData::PVStructurePtr const & pvStructure);
+    static Result& isCompatible(Result& result);
     epics::pvData::PVStructurePtr pvNTTable;
     epics::pvData::PVStructurePtr pvValue;
+    epics::pvData::PVStringPtr pvDescriptor;
+    epics::pvData::PVStructurePtr pvTimeStamp;
+    epics::pvData::PVStructurePtr pvAlarm;
+    epics::pvData::PVStringArrayPtr pvLabels;
+
+    // the positions of the columns, sorted by name
+    std::vector<std::pair<std::string const *, size_t> > columnIndex;
+
     friend class detail::NTTableBuilder;
 };
 
@@ -0,0 +1,469 @@
+/* nttyped.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTTYPED_H
+#define NTTYPED_H
+
+#ifdef epicsExportSharedSymbols
+#   define nttypedEpicsExportSharedSymbols
+#   undef epicsExportSharedSymbols
+#endif
+
+#include <epicsAssert.h>
+
+#include <pv/pvData.h>
+
+#ifdef nttypedEpicsExportSharedSymbols
+#   define epicsExportSharedSymbols
+#	undef nttypedEpicsExportSharedSymbols
+#endif
+
+#include <pv/ntscalar.h>
+#include <pv/ntscalarArray.h>
+
+namespace epics { namespace nt {
+
+/**
+ * Option of the typed wrappers, adding the descriptor field.
+ */
+struct WithDescriptor {};
+
+/**
+ * Option of the typed wrappers, adding the alarm field.
+ */
+struct WithAlarm {};
+
+/**
+ * Option of the typed wrappers, adding the timeStamp field.
+ */
+struct WithTimeStamp {};
+
+/**
+ * Option of the typed wrappers, adding the display field.
+ */
+struct WithDisplay {};
+
+/**
+ * Option of the typed wrappers, adding the control field.
+ */
+struct WithControl {};
+
+namespace detail {
+
+    struct NoOption {};
+
+    template<typename A, typename B>
+    struct IsSame { enum { value = 0 }; };
+
+    template<typename A>
+    struct IsSame<A, A> { enum { value = 1 }; };
+
+    template<typename O, typename O1, typename O2, typename O3, typename O4, typename O5>
+    struct HasOption
+    {
+        enum { value = IsSame<O, O1>::value || IsSame<O, O2>::value ||
+                       IsSame<O, O3>::value || IsSame<O, O4>::value ||
+                       IsSame<O, O5>::value };
+    };
+
+    /**
+     * @brief The optional fields of the typed wrappers, chosen at compile time.
+     *
+     * The fields are looked up once, when wrapped; accessing a field
+     * which was not chosen does not compile.
+     */
+    template<typename O1, typename O2, typename O3, typename O4, typename O5>
+    class NTOptionalFields
+    {
+    public:
+        enum {
+            hasDescriptor = HasOption<WithDescriptor, O1, O2, O3, O4, O5>::value,
+            hasAlarm = HasOption<WithAlarm, O1, O2, O3, O4, O5>::value,
+            hasTimeStamp = HasOption<WithTimeStamp, O1, O2, O3, O4, O5>::value,
+            hasDisplay = HasOption<WithDisplay, O1, O2, O3, O4, O5>::value,
+            hasControl = HasOption<WithControl, O1, O2, O3, O4, O5>::value
+        };
+
+        /**
+         * Returns the descriptor field.
+         * @return the descriptor field.
+         */
+        epics::pvData::PVString & getDescriptor() const
+        {
+            STATIC_ASSERT(hasDescriptor);
+            return *pvDescriptor;
+        }
+
+        /**
+         * Returns the alarm field.
+         * @return the alarm field.
+         */
+        epics::pvData::PVStructure & getAlarm() const
+        {
+            STATIC_ASSERT(hasAlarm);
+            return *pvAlarm;
+        }
+
+        /**
+         * Returns the timeStamp field.
+         * @return the timeStamp field.
+         */
+        epics::pvData::PVStructure & getTimeStamp() const
+        {
+            STATIC_ASSERT(hasTimeStamp);
+            return *pvTimeStamp;
+        }
+
+        /**
+         * Returns the display field.
+         * @return the display field.
+         */
+        epics::pvData::PVStructure & getDisplay() const
+        {
+            STATIC_ASSERT(hasDisplay);
+            return *pvDisplay;
+        }
+
+        /**
+         * Returns the control field.
+         * @return the control field.
+         */
+        epics::pvData::PVStructure & getControl() const
+        {
+            STATIC_ASSERT(hasControl);
+            return *pvControl;
+        }
+
+    protected:
+        explicit NTOptionalFields(epics::pvData::PVStructure & pvStructure)
+        : pvDescriptor(hasDescriptor ?
+              pvStructure.getSubFieldT<epics::pvData::PVString>("descriptor").get() : 0),
+          pvAlarm(hasAlarm ?
+              pvStructure.getSubFieldT<epics::pvData::PVStructure>("alarm").get() : 0),
+          pvTimeStamp(hasTimeStamp ?
+              pvStructure.getSubFieldT<epics::pvData::PVStructure>("timeStamp").get() : 0),
+          pvDisplay(hasDisplay ?
+              pvStructure.getSubFieldT<epics::pvData::PVStructure>("display").get() : 0),
+          pvControl(hasControl ?
+              pvStructure.getSubFieldT<epics::pvData::PVStructure>("control").get() : 0)
+        {}
+
+        template<typename B>
+        static void addTo(B const & builder)
+        {
+            if (hasDescriptor)
+                builder->addDescriptor();
+            if (hasAlarm)
+                builder->addAlarm();
+            if (hasTimeStamp)
+                builder->addTimeStamp();
+            if (hasDisplay)
+                builder->addDisplay();
+            if (hasControl)
+                builder->addControl();
+        }
+
+        static bool hasFields(epics::pvData::PVStructure const & pvStructure)
+        {
+            return (!hasDescriptor || pvStructure.getSubField<epics::pvData::PVString>("descriptor")) &&
+                   (!hasAlarm || pvStructure.getSubField<epics::pvData::PVStructure>("alarm")) &&
+                   (!hasTimeStamp || pvStructure.getSubField<epics::pvData::PVStructure>("timeStamp")) &&
+                   (!hasDisplay || pvStructure.getSubField<epics::pvData::PVStructure>("display")) &&
+                   (!hasControl || pvStructure.getSubField<epics::pvData::PVStructure>("control"));
+        }
+
+    private:
+        epics::pvData::PVString * pvDescriptor;
+        epics::pvData::PVStructure * pvAlarm;
+        epics::pvData::PVStructure * pvTimeStamp;
+        epics::pvData::PVStructure * pvDisplay;
+        epics::pvData::PVStructure * pvControl;
+    };
+}
+
+/**
+ * @brief NTScalar with its value type and optional fields chosen at compile time.
+ *
+ * The structure is created once per template instance, and the fields
+ * are looked up once, when wrapped, so the accessors need no casts or
+ * string lookups, e.g.
+@code
+    typedef NTScalarT<double, WithAlarm, WithTimeStamp> NTDouble;
+    NTDouble::shared_pointer ntDouble = NTDouble::create();
+    ntDouble->put(1.5);
+    ntDouble->getAlarm().getSubFieldT<PVInt>("severity")->put(0);
+@endcode
+ * The value type is one of the types of pvData scalars, e.g.
+ * epics::pvData::int32, double or std::string.
+ * The options are WithDescriptor, WithAlarm, WithTimeStamp, WithDisplay
+ * and WithControl, in any order.
+ */
+template<typename T,
+         typename O1 = detail::NoOption, typename O2 = detail::NoOption,
+         typename O3 = detail::NoOption, typename O4 = detail::NoOption,
+         typename O5 = detail::NoOption>
+class NTScalarT : public detail::NTOptionalFields<O1, O2, O3, O4, O5>
+{
+    typedef detail::NTOptionalFields<O1, O2, O3, O4, O5> options_t;
+
+public:
+    POINTER_DEFINITIONS(NTScalarT);
+
+    typedef T value_t;
+    typedef epics::pvData::PVScalarValue<T> PVValue;
+
+    /**
+     * Returns the structure of this type, created on first use.
+     * @return the structure.
+     */
+    static epics::pvData::StructureConstPtr const & getStructure()
+    {
+        static const epics::pvData::StructureConstPtr structure(createStructure());
+        return structure;
+    }
+
+    /**
+     * Creates an instance.
+     * @return the new instance.
+     */
+    static shared_pointer create()
+    {
+        return shared_pointer(new NTScalarT(
+            epics::pvData::getPVDataCreate()->createPVStructure(getStructure())));
+    }
+
+    /**
+     * Wraps a PVStructure, if compatible.
+     * @param pvStructure the PVStructure to wrap.
+     * @return the wrapper, or null if not compatible.
+     */
+    static shared_pointer wrap(epics::pvData::PVStructurePtr const & pvStructure)
+    {
+        if (!isCompatible(pvStructure))
+            return shared_pointer();
+        return wrapUnsafe(pvStructure);
+    }
+
+    /**
+     * Wraps a PVStructure without checking its compatibility.
+     * @param pvStructure the PVStructure to wrap.
+     * @return the wrapper.
+     * @throws std::runtime_error if a field of this type is missing
+     * or has a different type.
+     */
+    static shared_pointer wrapUnsafe(epics::pvData::PVStructurePtr const & pvStructure)
+    {
+        return shared_pointer(new NTScalarT(pvStructure));
+    }
+
+    /**
+     * Returns whether a PVStructure is an NTScalar with the value type
+     * and the optional fields of this type.
+     * @param pvStructure the PVStructure to test.
+     * @return (false,true) if (is not, is) compatible.
+     */
+    static bool isCompatible(epics::pvData::PVStructurePtr const & pvStructure)
+    {
+        if (!pvStructure)
+            return false;
+        if (pvStructure->getStructure() == getStructure())
+            return true;
+        return NTScalar::isCompatible(pvStructure) &&
+               pvStructure->getSubField<PVValue>("value") &&
+               options_t::hasFields(*pvStructure);
+    }
+
+    /**
+     * Returns the PVStructure wrapped.
+     * @return the PVStructure.
+     */
+    epics::pvData::PVStructurePtr const & getPVStructure() const { return pvStructure; }
+
+    /**
+     * Returns the generic wrapper of the PVStructure.
+     * @return the NTScalar.
+     */
+    NTScalarPtr getNTScalar() const { return NTScalar::wrapUnsafe(pvStructure); }
+
+    /**
+     * Returns the value field.
+     * @return the value field.
+     */
+    PVValue & getValue() const { return *pvValue; }
+
+    /**
+     * Returns the value.
+     * @return the value.
+     */
+    T get() const { return pvValue->get(); }
+
+    /**
+     * Sets the value.
+     * @param value the new value.
+     */
+    void put(T const & value) const { pvValue->put(value); }
+
+private:
+    explicit NTScalarT(epics::pvData::PVStructurePtr const & pvStructure)
+    : options_t(*pvStructure),
+      pvStructure(pvStructure),
+      pvValue(pvStructure->getSubFieldT<PVValue>("value").get())
+    {}
+
+    static epics::pvData::StructureConstPtr createStructure()
+    {
+        NTScalarBuilderPtr builder = NTScalar::createBuilder();
+        builder->value(static_cast<epics::pvData::ScalarType>(
+            epics::pvData::ScalarTypeID<T>::value));
+        options_t::addTo(builder);
+        return builder->createStructure();
+    }
+
+    epics::pvData::PVStructurePtr pvStructure;
+    PVValue * pvValue;
+};
+
+/**
+ * @brief NTScalarArray with its element type and optional fields chosen
+ * at compile time.
+ *
+ * Works like NTScalarT, e.g.
+@code
+    typedef NTScalarArrayT<epics::pvData::int32, WithTimeStamp> NTInts;
+    NTInts::shared_pointer ntInts = NTInts::create();
+    NTInts::svector values(3, 0);
+    ntInts->replace(freeze(values));
+@endcode
+ */
+template<typename T,
+         typename O1 = detail::NoOption, typename O2 = detail::NoOption,
+         typename O3 = detail::NoOption, typename O4 = detail::NoOption,
+         typename O5 = detail::NoOption>
+class NTScalarArrayT : public detail::NTOptionalFields<O1, O2, O3, O4, O5>
+{
+    typedef detail::NTOptionalFields<O1, O2, O3, O4, O5> options_t;
+
+public:
+    POINTER_DEFINITIONS(NTScalarArrayT);
+
+    typedef T value_t;
+    typedef epics::pvData::PVValueArray<T> PVValue;
+    typedef typename PVValue::svector svector;
+    typedef typename PVValue::const_svector const_svector;
+
+    /**
+     * Returns the structure of this type, created on first use.
+     * @return the structure.
+     */
+    static epics::pvData::StructureConstPtr const & getStructure()
+    {
+        static const epics::pvData::StructureConstPtr structure(createStructure());
+        return structure;
+    }
+
+    /**
+     * Creates an instance.
+     * @return the new instance.
+     */
+    static shared_pointer create()
+    {
+        return shared_pointer(new NTScalarArrayT(
+            epics::pvData::getPVDataCreate()->createPVStructure(getStructure())));
+    }
+
+    /**
+     * Wraps a PVStructure, if compatible.
+     * @param pvStructure the PVStructure to wrap.
+     * @return the wrapper, or null if not compatible.
+     */
+    static shared_pointer wrap(epics::pvData::PVStructurePtr const & pvStructure)
+    {
+        if (!isCompatible(pvStructure))
+            return shared_pointer();
+        return wrapUnsafe(pvStructure);
+    }
+
+    /**
+     * Wraps a PVStructure without checking its compatibility.
+     * @param pvStructure the PVStructure to wrap.
+     * @return the wrapper.
+     * @throws std::runtime_error if a field of this type is missing
+     * or has a different type.
+     */
+    static shared_pointer wrapUnsafe(epics::pvData::PVStructurePtr const & pvStructure)
+    {
+        return shared_pointer(new NTScalarArrayT(pvStructure));
+    }
+
+    /**
+     * Returns whether a PVStructure is an NTScalarArray with the element
+     * type and the optional fields of this type.
+     * @param pvStructure the PVStructure to test.
+     * @return (false,true) if (is not, is) compatible.
+     */
+    static bool isCompatible(epics::pvData::PVStructurePtr const & pvStructure)
+    {
+        if (!pvStructure)
+            return false;
+        if (pvStructure->getStructure() == getStructure())
+            return true;
+        return NTScalarArray::isCompatible(pvStructure) &&
+               pvStructure->getSubField<PVValue>("value") &&
+               options_t::hasFields(*pvStructure);
+    }
+
+    /**
+     * Returns the PVStructure wrapped.
+     * @return the PVStructure.
+     */
+    epics::pvData::PVStructurePtr const & getPVStructure() const { return pvStructure; }
+
+    /**
+     * Returns the generic wrapper of the PVStructure.
+     * @return the NTScalarArray.
+     */
+    NTScalarArrayPtr getNTScalarArray() const { return NTScalarArray::wrapUnsafe(pvStructure); }
+
+    /**
+     * Returns the value field.
+     * @return the value field.
+     */
+    PVValue & getValue() const { return *pvValue; }
+
+    /**
+     * Returns the elements of the value.
+     * @return the elements.
+     */
+    const_svector view() const { return pvValue->view(); }
+
+    /**
+     * Replaces the elements of the value.
+     * @param values the new elements.
+     */
+    void replace(const_svector const & values) const { pvValue->replace(values); }
+
+private:
+    explicit NTScalarArrayT(epics::pvData::PVStructurePtr const & pvStructure)
+    : options_t(*pvStructure),
+      pvStructure(pvStructure),
+      pvValue(pvStructure->getSubFieldT<PVValue>("value").get())
+    {}
+
+    static epics::pvData::StructureConstPtr createStructure()
+    {
+        NTScalarArrayBuilderPtr builder = NTScalarArray::createBuilder();
+        builder->value(static_cast<epics::pvData::ScalarType>(
+            epics::pvData::ScalarTypeID<T>::value));
+        options_t::addTo(builder);
+        return builder->createStructure();
+    }
+
+    epics::pvData::PVStructurePtr pvStructure;
+    PVValue * pvValue;
+};
+
+}}
+
+#endif  /* NTTYPED_H */
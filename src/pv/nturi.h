@@ -20,6 +20,8 @@
 #endif
 
 #include <pv/ntfield.h>
+#include <pv/ntcompatibilityCache.h>
+#include <pv/ntprototype.h>
 
 #include <shareLib.h>
 
@@ -88,6 +90,14 @@ namespace detail {
          */
         epics::pvData::PVStructurePtr createPVStructure();
 
+        /**
+         * Creates a prototype of the <b>PVStructure</b> that represents NTURI,
+         * to be initialized once and cloned into many instances, see NTPrototype.
+         * This resets this instance state and allows new instance to be created.
+         * @return a new prototype.
+         */
+        NTPrototypePtr createPrototype();
+
         /**
          * Creates a <b>NTURI</b> instance.
          * The returned NTURI will wrap a PVStructure which will have
@@ -202,6 +212,21 @@ public:
     static bool isCompatible(
         epics::pvData::StructureConstPtr const &structure);
 
+    /**
+     * Returns whether the specified Structure is compatible with NTURI
+     * and describes why not.
+     * <p>
+     * Checks the same as isCompatible(StructureConstPtr const &), but
+     * completely, collecting all the incompatibilities found.
+     *
+     * @param structure the Structure to test
+     * @param diagnostics set to the description of the incompatibilities, empty if none
+     * @return (false,true) if the specified Structure (is not, is) a compatible NTURI
+     */
+    static bool isCompatible(
+        epics::pvData::StructureConstPtr const &structure,
+        std::string &diagnostics);
+
     /**
      * Returns whether the specified PVStructure is compatible with NTURI.
      * <p>
@@ -214,6 +239,14 @@ public:
     static bool isCompatible(
         epics::pvData::PVStructurePtr const &pvStructure);
 
+    /**
+     * Returns the cache of compatibility verdicts used by
+     * isCompatible(PVStructurePtr const &) and hence by wrap().
+     *
+     * @return the NTURI compatibility cache
+     */
+    static NTCompatibilityCache & getCompatibilityCache();
+
     /**
      * Returns whether the wrapped PVStructure is a valid NTURI.
      * <p>
@@ -269,7 +302,7 @@ public:
      * Returns the names of the query fields for the URI.
      * For each name, calling getQueryField should return
      * the query field, which should not be null.
-     * @return The query field names.
+     * @return The query field names, empty if there is no query field.
      */
     epics::pvData::StringArray const & getQueryNames() const;
 
@@ -301,7 +334,12 @@ public:
 
 private:
     NTURI(epics::pvData::PVStructurePtr const & pvStructure);
+    static Result& isCompatible(Result& result);
     epics::pvData::PVStructurePtr pvNTURI;
+    epics::pvData::PVStringPtr pvScheme;
+    epics::pvData::PVStringPtr pvAuthority;
+    epics::pvData::PVStringPtr pvPath;
+    epics::pvData::PVStructurePtr pvQuery;
     friend class detail::NTURIBuilder;
 };
 
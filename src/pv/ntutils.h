@@ -7,6 +7,7 @@
 #define NTUTILS_H
 
 #include <string>
+#include <cstring>
 #include <shareLib.h>
 
 namespace epics { namespace nt {
@@ -28,11 +29,73 @@ public:
      */
     static bool is_a(const std::string &u1, const std::string &u2);
 
+    /**
+     * Checks whether NT types are compatible by checking their IDs,
+     * i.e. their names and major version must match.
+     * Does not allocate.
+     * @param u1 the first URI.
+     * @param n1 the length of the first URI.
+     * @param u2 the second URI.
+     * @param n2 the length of the second URI.
+     * @return true if URIs are compatible, false otherwise.
+     */
+    static bool is_a(const char *u1, size_t n1, const char *u2, size_t n2);
+
+    /**
+     * Returns the length of the part of a URI that must match for
+     * is_a(), i.e. the URI without its minor version.
+     * @param u the URI.
+     * @param n the length of the URI.
+     * @return the length of the major-qualified name.
+     */
+    static size_t majorLength(const char *u, size_t n)
+    {
+        for (size_t i = n; i > 0; --i)
+            if (u[i - 1] == '.')
+                return i - 1;
+        return n;
+    }
+
 private:
     // disable object creation
     NTUtils() {}
 };
 
+/**
+ * @brief The major-qualified name of an NT type ID, e.g. "epics:nt/NTScalar:1",
+ * precomputed so that is_a tests against it cost a length check and a memcmp.
+ */
+class epicsShareClass NTTypeKey {
+public:
+    /**
+     * Creates the key of a type ID.
+     * @param uri the type ID, e.g. NTScalar::URI.
+     */
+    explicit NTTypeKey(const std::string &uri);
+
+    /**
+     * Checks whether a type ID is compatible with this key,
+     * the same as NTUtils::is_a() with the URI of this key does.
+     * Does not allocate.
+     * @param id the type ID to check.
+     * @return true if compatible, false otherwise.
+     */
+    bool is_a(const std::string &id) const
+    {
+        size_t n = NTUtils::majorLength(id.data(), id.size());
+        return n == key.size() && std::memcmp(id.data(), key.data(), n) == 0;
+    }
+
+    /**
+     * Returns the major-qualified name.
+     * @return the key.
+     */
+    const std::string &str() const { return key; }
+
+private:
+    std::string key;
+};
+
 }}
 
 #endif  /* NTUTILS_H */
@@ -0,0 +1,26 @@
+/* simd.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef SIMD_H
+#define SIMD_H
+
+/*
+ * NT_SSE2 is defined if SSE2 instructions are available at compile time.
+ * NT_AVX2 is defined if functions can be compiled for AVX2 with
+ * __attribute__((target("avx2"))), to be chosen at runtime
+ * if __builtin_cpu_supports("avx2").
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define NT_SSE2
+#  include <emmintrin.h>
+#endif
+
+#if defined(NT_SSE2) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#  define NT_AVX2
+#  include <immintrin.h>
+#endif
+
+#endif  /* SIMD_H */
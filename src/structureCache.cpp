@@ -0,0 +1,81 @@
+/* structureCache.cpp */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <map>
+
+#include <epicsThread.h>
+#include <pv/lock.h>
+
+#include "structureCache.h"
+
+using namespace epics::pvData;
+
+namespace epics { namespace nt {
+
+namespace detail {
+
+    const size_t StructureCache::CAPACITY;
+
+    namespace {
+        typedef std::map<std::string, StructureConstPtr> structures_t;
+
+        struct Structures
+        {
+            Mutex mutex;
+            structures_t structures;
+        };
+
+        Structures * structures = 0;
+        epicsThreadOnceId structuresOnce = EPICS_THREAD_ONCE_INIT;
+
+        void createStructures(void *)
+        {
+            structures = new Structures();
+        }
+
+        Structures & getStructures()
+        {
+            epicsThreadOnce(&structuresOnce, &createStructures, 0);
+            return *structures;
+        }
+    }
+
+    StructureConstPtr StructureCache::find(StructureKey const & key)
+    {
+        Structures & cache = getStructures();
+        Lock xx(cache.mutex);
+        structures_t::const_iterator it = cache.structures.find(key.str());
+        return it != cache.structures.end() ? it->second : StructureConstPtr();
+    }
+
+    StructureConstPtr StructureCache::insert(StructureKey const & key,
+        StructureConstPtr const & structure)
+    {
+        Structures & cache = getStructures();
+        Lock xx(cache.mutex);
+        if (cache.structures.size() < CAPACITY)
+            return cache.structures.insert(
+                structures_t::value_type(key.str(), structure)).first->second;
+        structures_t::const_iterator it = cache.structures.find(key.str());
+        return it != cache.structures.end() ? it->second : structure;
+    }
+
+    size_t StructureCache::size()
+    {
+        Structures & cache = getStructures();
+        Lock xx(cache.mutex);
+        return cache.structures.size();
+    }
+
+    void StructureCache::clear()
+    {
+        Structures & cache = getStructures();
+        Lock xx(cache.mutex);
+        cache.structures.clear();
+    }
+}
+
+}}
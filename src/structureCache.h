@@ -0,0 +1,114 @@
+/* structureCache.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef STRUCTURECACHE_H
+#define STRUCTURECACHE_H
+
+#include <string>
+#include <vector>
+
+#include <pv/pvIntrospect.h>
+
+namespace epics { namespace nt {
+
+namespace detail {
+
+    /**
+     * The choices an NT builder made for a structure: the type ID,
+     * followed by the value types, optional field flags and extra fields,
+     * in an order fixed by each builder.
+     * Fields given by the user (e.g. extra fields) are keyed on their
+     * identity; the cached structure holds a reference to each of them,
+     * so their addresses can not be reused while the entry exists.
+     */
+    class StructureKey
+    {
+    public:
+        explicit StructureKey(std::string const & id)
+        {
+            add(id);
+        }
+
+        StructureKey & add(bool flag)
+        {
+            key += flag ? '1' : '0';
+            return *this;
+        }
+
+        StructureKey & add(epics::pvData::ScalarType type)
+        {
+            key += static_cast<char>('a' + type);
+            return *this;
+        }
+
+        StructureKey & add(std::string const & name)
+        {
+            addSize(name.size());
+            key += name;
+            return *this;
+        }
+
+        template<typename F>
+        StructureKey & add(std::tr1::shared_ptr<F> const & field)
+        {
+            epics::pvData::Field const * p = field.get();
+            key.append(reinterpret_cast<const char *>(&p), sizeof(p));
+            return *this;
+        }
+
+        template<typename T>
+        StructureKey & add(epics::pvData::StringArray const & names,
+                           std::vector<T> const & values)
+        {
+            addSize(names.size());
+            for (size_t i = 0; i < names.size(); ++i)
+                add(names[i]).add(values[i]);
+            return *this;
+        }
+
+        std::string const & str() const { return key; }
+
+    private:
+        void addSize(size_t size)
+        {
+            key.append(reinterpret_cast<const char *>(&size), sizeof(size));
+        }
+
+        std::string key;
+    };
+
+    /**
+     * Process-wide cache of the structures created by the NT builders,
+     * so that repeated createStructure() calls with the same choices
+     * return the same Structure instead of building it again.
+     * Once full, further structures are built but not cached.
+     * Thread safe.
+     */
+    class StructureCache
+    {
+    public:
+        static const size_t CAPACITY = 1024;
+
+        /**
+         * Returns the cached structure, or null if not cached.
+         */
+        static epics::pvData::StructureConstPtr find(StructureKey const & key);
+
+        /**
+         * Caches a structure, unless another thread cached one for the
+         * same key meanwhile. Returns the cached structure.
+         */
+        static epics::pvData::StructureConstPtr insert(StructureKey const & key,
+            epics::pvData::StructureConstPtr const & structure);
+
+        static size_t size();
+
+        static void clear();
+    };
+}
+
+}}
+
+#endif  /* STRUCTURECACHE_H */
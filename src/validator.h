@@ -9,11 +9,95 @@
 #include <string>
 #include <set>
 #include <algorithm>
+#include <sstream>
 
 #include <pv/pvIntrospect.h>
 
 namespace epics { namespace nt {
 
+struct Result;
+class ValidationPlan;
+
+namespace detail {
+
+    /**
+     * A single step of a compiled ValidationPlan.
+     */
+    struct Instruction {
+        enum Op {
+            Is,     // field is of type 'T'
+            IsId,   // field is of type 'T' with ID 'arg'
+            Has,    // field has (optional) subfield 'arg' of type 'T'
+            Each,   // every subfield of field is of type 'T'
+        } op;
+
+        bool (*test)(epics::pvData::Field const *);
+        std::string arg;
+        bool optional;
+
+        // for Has: index one past the rule applied to the subfield
+        size_t end;
+
+        Instruction(Op op, bool (*test)(epics::pvData::Field const *),
+                    std::string const & arg = std::string(), bool optional = false)
+        : op(op), test(test), arg(arg), optional(optional), end(0) {}
+    };
+
+    typedef std::vector<Instruction> Program;
+
+    /**
+     * Maps an introspection interface 'T' to its pvData Type.
+     *
+     * Only the interfaces below can be tested for.
+     */
+    template<typename T>
+    struct TypeOf;
+
+    template<>
+    struct TypeOf<epics::pvData::Scalar> {
+        static const epics::pvData::Type type = epics::pvData::scalar;
+    };
+
+    template<>
+    struct TypeOf<epics::pvData::ScalarArray> {
+        static const epics::pvData::Type type = epics::pvData::scalarArray;
+    };
+
+    template<>
+    struct TypeOf<epics::pvData::Structure> {
+        static const epics::pvData::Type type = epics::pvData::structure;
+    };
+
+    template<>
+    struct TypeOf<epics::pvData::StructureArray> {
+        static const epics::pvData::Type type = epics::pvData::structureArray;
+    };
+
+    template<>
+    struct TypeOf<epics::pvData::Union> {
+        static const epics::pvData::Type type = epics::pvData::union_;
+    };
+
+    template<>
+    struct TypeOf<epics::pvData::UnionArray> {
+        static const epics::pvData::Type type = epics::pvData::unionArray;
+    };
+
+    /**
+     * Test that a field is of type 'T', without using RTTI.
+     */
+    template<typename T>
+    inline bool isType(epics::pvData::Field const * field) {
+        return field && field->getType() == TypeOf<T>::type;
+    }
+
+    // any field is a Field
+    template<>
+    inline bool isType<epics::pvData::Field>(epics::pvData::Field const * field) {
+        return field != NULL;
+    }
+}
+
 /**
  * @brief Validation methods for NT types.
  *
@@ -59,9 +143,9 @@ struct Result {
     } result;
 
     Result(const epics::pvData::FieldConstPtr& field, const std::string& path = std::string())
-    : field(field), path(path), errors(), result(Pass) {}
+    : field(field), path(path), errors(), result(Pass), program(NULL) {}
 
-    Result() {}
+    Result() : program(NULL) {}
 
     Result& operator|=(const Result& other) {
         result = std::max(result, other.result);
@@ -87,7 +171,12 @@ struct Result {
      */
     template<typename T>
     Result& is(void) {
-        if (!dynamic_cast<T const *>(field.get())) {
+        if (program) {
+            program->push_back(detail::Instruction(detail::Instruction::Is, &detail::isType<T>));
+            return *this;
+        }
+
+        if (!detail::isType<T>(field.get())) {
             result = Fail;
             errors.push_back(Error(path, Error::IncorrectType));
         }
@@ -106,11 +195,15 @@ struct Result {
      */
     template<typename T>
     Result& is(const std::string& id) {
-        T const *s = dynamic_cast<T const *>(field.get());
-        if (!s) {
+        if (program) {
+            program->push_back(detail::Instruction(detail::Instruction::IsId, &detail::isType<T>, id));
+            return *this;
+        }
+
+        if (!detail::isType<T>(field.get())) {
             result = Fail;
             errors.push_back(Error(path, Error::IncorrectType));
-        } else if (s->getID() != id) {
+        } else if (field->getID() != id) {
             result = Fail;
             errors.push_back(Error(path, Error::IncorrectId));
         }
@@ -217,6 +310,92 @@ struct Result {
         return has<T>(name, true, NULL);
     }
 
+    /**
+     * Test that every subfield of this Result's field is of type 'T'.
+     *
+     * Appends an Error::Type::IncorrectType if the field is not one of
+     * Structure, StructureArray, Union, UnionArray.
+     * Appends an Error::Type::IncorrectType for every subfield that is
+     * not of type 'T'.
+     *
+     * @return itself
+     */
+    template<typename T>
+    Result& each(void) {
+        if (program) {
+            program->push_back(detail::Instruction(detail::Instruction::Each, &detail::isType<T>));
+            return *this;
+        }
+
+        epics::pvData::StringArray const * names;
+        epics::pvData::FieldConstPtrArray const * fields;
+
+        if (!members(field.get(), names, fields)) {
+            // Expected a structure-like Field
+            result = Fail;
+            errors.push_back(Error(path, Error::IncorrectType));
+            return *this;
+        }
+
+        for (size_t i = 0; i < names->size(); ++i) {
+            if (!detail::isType<T>((*fields)[i].get())) {
+                result = Fail;
+                errors.push_back(Error(path.empty() ? (*names)[i] : path + "." + (*names)[i],
+                                       Error::IncorrectType));
+            }
+        }
+
+        return *this;
+    }
+
+    /**
+     * Get the subfield names and types of a structure-like Field.
+     *
+     * @return false if the field is not one of Structure, StructureArray,
+     * Union, UnionArray.
+     */
+    static bool members(epics::pvData::Field const * field,
+                        epics::pvData::StringArray const * & names,
+                        epics::pvData::FieldConstPtrArray const * & fields) {
+        epics::pvData::Structure const * s = NULL;
+        epics::pvData::Union const * u = NULL;
+
+        switch(field->getType()) {
+            case epics::pvData::structure:
+                s = static_cast<epics::pvData::Structure const *>(field);
+                break;
+            case epics::pvData::structureArray:
+                s = static_cast<epics::pvData::StructureArray const *>(field)->getStructure().get();
+                break;
+            case epics::pvData::union_:
+                u = static_cast<epics::pvData::Union const *>(field);
+                break;
+            case epics::pvData::unionArray:
+                u = static_cast<epics::pvData::UnionArray const *>(field)->getUnion().get();
+                break;
+            default:
+                return false;
+        }
+
+        if (s) {
+            names = &s->getFieldNames();
+            fields = &s->getFields();
+        } else {
+            names = &u->getFieldNames();
+            fields = &u->getFields();
+        }
+        return true;
+    }
+
+    /**
+     * Returns the errors found by the tests.
+     *
+     * @return the errors.
+     */
+    std::vector<Error> const & getErrors(void) const {
+        return errors;
+    }
+
     std::ostream& dump(std::ostream& os) const {
         os << "Result(valid=" << (result == Pass) << ", errors=[ ";
 
@@ -230,8 +409,25 @@ struct Result {
     }
 
 private:
+    friend class ValidationPlan;
+
+    // when set, checks are recorded into the program instead of being run
+    detail::Program * program;
+
     template<typename T>
     Result& has(const std::string& name, bool optional, Result& (*check)(Result&) = NULL) {
+        if (program) {
+            size_t index = program->size();
+            program->push_back(detail::Instruction(detail::Instruction::Has, &detail::isType<T>, name, optional));
+            if (check) {
+                Result r;
+                r.program = program;
+                check(r);
+            }
+            (*program)[index].end = program->size();
+            return *this;
+        }
+
         epics::pvData::FieldConstPtr subField;
 
         switch(field->getType()) {
@@ -254,24 +450,239 @@ private:
                 return *this;
         }
 
-        std::string subFieldPath(path.empty() ? name : path + "." + name);
-
         if (!subField) {
             if (!optional) {
                 result = Fail;
-                errors.push_back(Error(subFieldPath, Error::MissingField));
+                errors.push_back(Error(subPath(name), Error::MissingField));
             }
-        } else if (!dynamic_cast<T const *>(subField.get())) {
+        } else if (!detail::isType<T>(subField.get())) {
             result = Fail;
-            errors.push_back(Error(subFieldPath, Error::IncorrectType));
+            errors.push_back(Error(subPath(name), Error::IncorrectType));
         } else if (check) {
-            Result r(subField, subFieldPath);
+            Result r(subField, subPath(name));
             *this |= check(r);
         }
 
         return *this;
     }
+
+    std::string subPath(const std::string& name) const {
+        return path.empty() ? name : path + "." + name;
+    }
 };
+
+/**
+ * Rule testing that a field is of type 'T' and applying the rule 'fn' to it.
+ */
+template<typename T, Result& (*fn)(Result&)>
+Result& isA(Result& result) {
+    return fn(result.is<T>());
+}
+
+/**
+ * Apply the rule 'fn' to a Structure and describe the errors found.
+ *
+ * @param structure the Structure to test, may be null.
+ * @param diagnostics set to the dump of the Result if there are errors,
+ * cleared otherwise.
+ * @return true if all tests passed, false otherwise.
+ */
+inline bool diagnose(epics::pvData::StructureConstPtr const & structure,
+                     Result& (*fn)(Result&), std::string & diagnostics) {
+    Result result(structure);
+    if (structure)
+        fn(result);
+    else
+        result.is<epics::pvData::Structure>();
+
+    diagnostics.clear();
+    if (!result.valid()) {
+        std::ostringstream os;
+        result.dump(os);
+        diagnostics = os.str();
+    }
+    return result.valid();
+}
+
+/**
+ * @brief A validation rule compiled into a flat instruction table.
+ *
+ * The rule (a function applying Result checks, as passed to Result::has())
+ * is recorded once, when the plan is constructed. Running the plan gives
+ * the same verdict and the same errors as applying the rule to a Result,
+ * but the Field tree is walked without creating child Results and paths
+ * are only built for errors, so a passing validation does not allocate.
+ * Pass/fail-only validation stops at the first failure and builds no
+ * Errors at all.
+ * A plan is immutable once constructed and may be shared between threads.
+ */
+class ValidationPlan {
+public:
+    typedef Result& (*rule_t)(Result&);
+
+    explicit ValidationPlan(rule_t rule) {
+        Result r;
+        r.program = &program;
+        rule(r);
+    }
+
+    /**
+     * Validate a field against the compiled rule, stopping at the
+     * first failure.
+     *
+     * @return true if all tests passed, false otherwise.
+     */
+    bool validate(const epics::pvData::FieldConstPtr& field) const {
+        Frame root(NULL, NULL);
+        return run(0, program.size(), field.get(), root, NULL);
+    }
+
+    /**
+     * Validate a field against the compiled rule.
+     *
+     * A passing field is validated without collecting errors; the
+     * errors of a failing one are collected by running the plan again.
+     *
+     * @return the Result
+     */
+    Result check(const epics::pvData::FieldConstPtr& field) const {
+        Result result(field);
+        if (!validate(field))
+            validate(result);
+        return result;
+    }
+
+    /**
+     * Apply the compiled rule to a Result.
+     *
+     * Equivalent to calling the rule on the Result.
+     *
+     * @return the Result
+     */
+    Result& validate(Result& result) const {
+        Frame root(NULL, &result.path);
+        if (!run(0, program.size(), result.field.get(), root, &result.errors))
+            result.result = Result::Fail;
+        return result;
+    }
+
+    /**
+     * Returns the number of instructions in the plan.
+     */
+    size_t size() const { return program.size(); }
+
+private:
+    // the path to a field as a chain of names on the stack
+    struct Frame {
+        Frame const * parent;
+        std::string const * name;
+
+        Frame(Frame const * parent, std::string const * name)
+        : parent(parent), name(name) {}
+
+        std::string path() const {
+            if (!parent)
+                return name ? *name : std::string();
+            std::string p(parent->path());
+            return p.empty() ? *name : p + "." + *name;
+        }
+    };
+
+    static bool fail(Frame const & frame, Result::Error::Type type,
+                     std::vector<Result::Error> * errors) {
+        if (errors)
+            errors->push_back(Result::Error(frame.path(), type));
+        return false;
+    }
+
+    static bool find(epics::pvData::Field const * field, std::string const & name,
+                     epics::pvData::FieldConstPtr & subField) {
+        switch(field->getType()) {
+            case epics::pvData::structure:
+                subField = static_cast<epics::pvData::Structure const *>(field)->getField(name);
+                return true;
+            case epics::pvData::structureArray:
+                subField = static_cast<epics::pvData::StructureArray const *>(field)->getStructure()->getField(name);
+                return true;
+            case epics::pvData::union_:
+                subField = static_cast<epics::pvData::Union const *>(field)->getField(name);
+                return true;
+            case epics::pvData::unionArray:
+                subField = static_cast<epics::pvData::UnionArray const *>(field)->getUnion()->getField(name);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool run(size_t pc, size_t end, epics::pvData::Field const * field,
+             Frame const & frame, std::vector<Result::Error> * errors) const {
+        bool valid = true;
+
+        // with no errors to collect, the first failure decides
+        while (pc < end && (valid || errors)) {
+            detail::Instruction const & ins = program[pc];
+
+            switch (ins.op) {
+                case detail::Instruction::Is:
+                    if (!ins.test(field))
+                        valid = fail(frame, Result::Error::IncorrectType, errors);
+                    ++pc;
+                    break;
+
+                case detail::Instruction::IsId:
+                    if (!ins.test(field))
+                        valid = fail(frame, Result::Error::IncorrectType, errors);
+                    else if (field->getID() != ins.arg)
+                        valid = fail(frame, Result::Error::IncorrectId, errors);
+                    ++pc;
+                    break;
+
+                case detail::Instruction::Has: {
+                    epics::pvData::FieldConstPtr subField;
+                    if (!find(field, ins.arg, subField)) {
+                        // Expected a structure-like Field
+                        valid = fail(frame, Result::Error::IncorrectType, errors);
+                    } else {
+                        Frame sub(&frame, &ins.arg);
+                        if (!subField) {
+                            if (!ins.optional)
+                                valid = fail(sub, Result::Error::MissingField, errors);
+                        } else if (!ins.test(subField.get())) {
+                            valid = fail(sub, Result::Error::IncorrectType, errors);
+                        } else if (!run(pc + 1, ins.end, subField.get(), sub, errors)) {
+                            valid = false;
+                        }
+                    }
+                    pc = ins.end;
+                    break;
+                }
+
+                case detail::Instruction::Each: {
+                    epics::pvData::StringArray const * names;
+                    epics::pvData::FieldConstPtrArray const * fields;
+                    if (!Result::members(field, names, fields)) {
+                        // Expected a structure-like Field
+                        valid = fail(frame, Result::Error::IncorrectType, errors);
+                    } else {
+                        for (size_t i = 0; i < names->size() && (valid || errors); ++i) {
+                            if (!ins.test((*fields)[i].get()))
+                                valid = fail(Frame(&frame, &(*names)[i]),
+                                             Result::Error::IncorrectType, errors);
+                        }
+                    }
+                    ++pc;
+                    break;
+                }
+            }
+        }
+
+        return valid;
+    }
+
+    detail::Program program;
+};
+
 }}
 
 #endif
@@ -0,0 +1,205 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <stdio.h>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+#include <epicsAtomic.h>
+
+#include <pv/nt.h>
+#include <pv/ntbatchValidator.h>
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+static FieldCreatePtr fieldCreate = getFieldCreate();
+
+static size_t checks = 0;
+
+static bool isGood(StructureConstPtr const & structure)
+{
+    epics::atomic::increment(checks);
+    return structure->getID() == "good";
+}
+
+static bool describeGood(StructureConstPtr const & structure, std::string & diagnostics)
+{
+    epics::atomic::increment(checks);
+    bool good = structure->getID() == "good";
+    diagnostics = good ? "" : structure->getID();
+    return good;
+}
+
+// 'distinct' structures, half of them good, each repeated 'repeat' times
+static void makeStructures(size_t distinct, size_t repeat,
+    std::vector<StructureConstPtr> & structures)
+{
+    std::vector<StructureConstPtr> unique;
+    for (size_t i = 0; i < distinct; ++i) {
+        char name[32];
+        sprintf(name, "f%u", (unsigned)i);
+        unique.push_back(fieldCreate->createFieldBuilder()->
+            setId(i % 2 ? "bad" : "good")->
+            add(name, pvInt)->
+            createStructure());
+    }
+
+    structures.clear();
+    for (size_t r = 0; r < repeat; ++r)
+        structures.insert(structures.end(), unique.begin(), unique.end());
+}
+
+static bool expected(std::vector<bool> const & verdicts)
+{
+    for (size_t i = 0; i < verdicts.size(); ++i)
+        if (verdicts[i] != (i % 2 == 0))
+            return false;
+    return true;
+}
+
+void test_serial()
+{
+    testDiag("test_serial");
+
+    std::vector<StructureConstPtr> structures;
+    makeStructures(10, 3, structures);
+
+    std::vector<bool> verdicts;
+    checks = 0;
+    testOk1(NTBatchValidator::isCompatible(structures, &isGood, verdicts, 1) == 10);
+    testOk1(verdicts.size() == 30);
+    testOk1(expected(verdicts));
+    testOk1(checks == 10);
+
+    // few distinct structures are checked by the calling thread only
+    checks = 0;
+    testOk1(NTBatchValidator::isCompatible(structures, &isGood, verdicts, 8) == 10);
+    testOk1(expected(verdicts));
+    testOk1(checks == 10);
+
+    structures.clear();
+    testOk1(NTBatchValidator::isCompatible(structures, &isGood, verdicts) == 0);
+    testOk1(verdicts.empty());
+}
+
+void test_parallel()
+{
+    testDiag("test_parallel");
+
+    std::vector<StructureConstPtr> structures;
+    makeStructures(1000, 5, structures);
+
+    std::vector<bool> verdicts;
+    checks = 0;
+    testOk1(NTBatchValidator::isCompatible(structures, &isGood, verdicts, 4) == 1000);
+    testOk1(verdicts.size() == 5000);
+    testOk1(expected(verdicts));
+    testOk1(checks == 1000);
+
+    std::vector<std::string> diagnostics;
+    checks = 0;
+    testOk1(NTBatchValidator::isCompatible(structures, &describeGood,
+        verdicts, diagnostics, 4) == 1000);
+    testOk1(expected(verdicts));
+    testOk1(checks == 1000);
+    testOk1(diagnostics.size() == 5000);
+    testOk1(diagnostics[0].empty() && diagnostics[1] == "bad" && diagnostics[4999] == "bad");
+}
+
+void test_nulls()
+{
+    testDiag("test_nulls");
+
+    std::vector<StructureConstPtr> structures;
+    makeStructures(2, 1, structures);
+    structures.push_back(StructureConstPtr());
+    structures.push_back(structures[0]);
+
+    std::vector<bool> verdicts;
+    std::vector<std::string> diagnostics;
+    checks = 0;
+    testOk1(NTBatchValidator::isCompatible(structures, &describeGood,
+        verdicts, diagnostics) == 2);
+    testOk1(checks == 2);
+    testOk1(verdicts[0] && !verdicts[1] && !verdicts[2] && verdicts[3]);
+    testOk1(!diagnostics[2].empty());
+}
+
+static bool throwOnBad(StructureConstPtr const & structure, std::string & diagnostics)
+{
+    if (structure->getID() == "bad")
+        throw 42;
+    return describeGood(structure, diagnostics);
+}
+
+void test_identical()
+{
+    testDiag("test_identical");
+
+    // created independently, the first two are structurally identical
+    std::vector<StructureConstPtr> structures;
+    structures.push_back(fieldCreate->createFieldBuilder()->
+        setId("good")->add("f0", pvInt)->createStructure());
+    structures.push_back(fieldCreate->createFieldBuilder()->
+        setId("good")->add("f0", pvInt)->createStructure());
+    structures.push_back(fieldCreate->createFieldBuilder()->
+        setId("good")->add("f1", pvInt)->createStructure());
+    structures.push_back(fieldCreate->createFieldBuilder()->
+        setId("bad")->add("f0", pvInt)->createStructure());
+
+    std::vector<bool> verdicts;
+    std::vector<std::string> diagnostics;
+    checks = 0;
+    testOk1(NTBatchValidator::isCompatible(structures, &describeGood,
+        verdicts, diagnostics) == 3);
+    testOk1(checks == 3);
+    testOk1(verdicts[0] && verdicts[1] && verdicts[2] && !verdicts[3]);
+
+    // a check which throws anything fails the structure
+    checks = 0;
+    testOk1(NTBatchValidator::isCompatible(structures, &throwOnBad,
+        verdicts, diagnostics) == 3);
+    testOk1(checks == 2);
+    testOk1(verdicts[0] && !verdicts[3]);
+    testOk1(diagnostics[3] == "unknown exception");
+}
+
+void test_nt()
+{
+    testDiag("test_nt");
+
+    std::vector<StructureConstPtr> structures;
+    structures.push_back(NTScalar::createBuilder()->
+        value(pvDouble)->addAlarm()->createStructure());
+    structures.push_back(NTScalarArray::createBuilder()->
+        value(pvDouble)->createStructure());
+
+    std::vector<bool> verdicts;
+    testOk1(NTBatchValidator::isCompatible(structures, &NTScalar::isCompatible, verdicts) == 2);
+    testOk1(verdicts[0] && !verdicts[1]);
+
+    std::vector<std::string> diagnostics;
+    testOk1(NTBatchValidator::isCompatible(structures, &NTScalar::isCompatible,
+        verdicts, diagnostics) == 2);
+    testOk1(verdicts[0] && !verdicts[1]);
+    testOk1(diagnostics[0].empty());
+    testOk(!diagnostics[1].empty(), "%s", diagnostics[1].c_str());
+
+    std::string single;
+    testOk1(!NTScalar::isCompatible(structures[1], single) && single == diagnostics[1]);
+    testOk1(!NTScalar::isCompatible(StructureConstPtr(), single) && !single.empty());
+}
+
+MAIN(testNTBatchValidator) {
+    testPlan(37);
+    test_serial();
+    test_parallel();
+    test_nulls();
+    test_identical();
+    test_nt();
+    return testDone();
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+/*
+ * Microbenchmark of the bit transposition of integer frames and of the
+ * nt-bslz4 codec.
+ *
+ * Measures the throughput of NTBitshuffle::shuffle() and unshuffle()
+ * with each kernel, then of compressing and decompressing 16-bit and
+ * 32-bit frames with one thread, and their compression ratio.
+ *
+ * Built with the tests, but not run by them. Usage:
+ *   ntbitshuffleBench [megabytes]
+ */
+
+#include <stdlib.h>
+#include <vector>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+#include <epicsTypes.h>
+#include <epicsTime.h>
+
+#include <pv/nt.h>
+#include <pv/ntbitshuffle.h>
+#include <pv/ntndarrayCodec.h>
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+namespace {
+
+unsigned seed = 1;
+
+// detector counts, a background with a little noise
+unsigned count()
+{
+    seed = seed * 1103515245u + 12345u;
+    return 100 + ((seed >> 16) & 31);
+}
+
+// GB per second
+double rate(epicsUInt64 start, size_t bytes)
+{
+    epicsUInt64 ns = epicsMonotonicGet() - start;
+    return ns ? double(bytes) / ns : 0.0;
+}
+
+const char * kernelName(NTBitshuffle::Kernel kernel)
+{
+    switch (kernel)
+    {
+    case NTBitshuffle::sse2: return "sse2";
+    case NTBitshuffle::avx2: return "avx2";
+    default: return "scalar";
+    }
+}
+
+template<typename T>
+void benchKernels(size_t bytes)
+{
+    std::vector<T> in(bytes / sizeof(T));
+    for (size_t i = 0; i < in.size(); ++i)
+        in[i] = static_cast<T>(count());
+    std::vector<T> out(in.size());
+    std::vector<T> back(in.size());
+
+    uint8 const * pin = reinterpret_cast<uint8 const *>(&in[0]);
+    uint8 * pout = reinterpret_cast<uint8 *>(&out[0]);
+    uint8 * pback = reinterpret_cast<uint8 *>(&back[0]);
+    size_t blockSize = NTBitshuffle::getDefaultBlockSize(sizeof(T));
+
+    for (int k = NTBitshuffle::scalar; k <= NTBitshuffle::getKernel(); ++k)
+    {
+        NTBitshuffle::Kernel kernel = NTBitshuffle::Kernel(k);
+
+        epicsUInt64 start = epicsMonotonicGet();
+        NTBitshuffle::shuffle(pin, pout, in.size(), sizeof(T), blockSize, kernel);
+        double shuffled = rate(start, bytes);
+
+        start = epicsMonotonicGet();
+        NTBitshuffle::unshuffle(pout, pback, in.size(), sizeof(T), blockSize, kernel);
+        double unshuffled = rate(start, bytes);
+
+        testOk(back == in, "%u-bit %-8s shuffle %6.2f GB/s, unshuffle %6.2f GB/s",
+            (unsigned)(8 * sizeof(T)), kernelName(kernel), shuffled, unshuffled);
+    }
+}
+
+template<typename PVT>
+void benchCodec(std::string const & field, size_t bytes)
+{
+    typedef typename PVT::value_type T;
+    NTNDArrayPtr ntndarray = NTNDArray::createBuilder()->create();
+    typename PVT::svector data(bytes / sizeof(T));
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<T>(count());
+    ntndarray->getValue()->select<PVT>(field)->replace(freeze(data));
+
+    epicsUInt64 start = epicsMonotonicGet();
+    NTNDArrayCodec::compress(*ntndarray, "nt-bslz4", NTNDArrayCodec::DEFAULT_CHUNK_SIZE, 1);
+    double compressed = rate(start, bytes);
+    double ratio = double(bytes) / ntndarray->getCompressedDataSize()->get();
+
+    start = epicsMonotonicGet();
+    NTNDArrayCodec::decompress(*ntndarray, 1);
+    double decompressed = rate(start, bytes);
+
+    testOk(ntndarray->getCompressedDataSize()->get() == (int64)bytes,
+        "%-12s compress %6.2f GB/s, decompress %6.2f GB/s, ratio %5.2f",
+        field.c_str(), compressed, decompressed, ratio);
+}
+
+}
+
+MAIN(ntbitshuffleBench)
+{
+    size_t megabytes = 64;
+    if (argc > 1)
+        megabytes = strtoul(argv[1], NULL, 0);
+    size_t bytes = megabytes << 20;
+
+    testPlan(0);
+    testDiag("%u MB, best kernel %s", (unsigned)megabytes,
+        kernelName(NTBitshuffle::getKernel()));
+
+    benchKernels<uint16>(bytes);
+    benchKernels<uint32>(bytes);
+    benchCodec<PVUShortArray>("ushortValue", bytes);
+    benchCodec<PVUIntArray>("uintValue", bytes);
+
+    return testDone();
+}
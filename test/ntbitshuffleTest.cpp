@@ -0,0 +1,175 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/nt.h>
+#include <pv/ntbitshuffle.h>
+#include <pv/ntndarrayCodec.h>
+#include <pv/ntndarrayView.h>
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+static unsigned seed = 1;
+
+static uint8 random8()
+{
+    seed = seed * 1103515245u + 12345u;
+    return static_cast<uint8>(seed >> 16);
+}
+
+void test_blockSize()
+{
+    testDiag("test_blockSize");
+
+    testOk1(NTBitshuffle::getDefaultBlockSize(1) == 8192);
+    testOk1(NTBitshuffle::getDefaultBlockSize(2) == 4096);
+    testOk1(NTBitshuffle::getDefaultBlockSize(3) == 2728);
+    testOk1(NTBitshuffle::getDefaultBlockSize(8) == 1024);
+
+    uint8 in[16] = { 0 };
+    uint8 out[16];
+    try {
+        NTBitshuffle::shuffle(in, out, 16, 1, 12);
+        testFail("block size 12 accepted");
+    } catch (std::runtime_error &) {
+        testPass("block size 12 rejected");
+    }
+}
+
+void test_layout()
+{
+    testDiag("test_layout");
+
+    // the bit j of byte b of all elements is row 8*b + j
+    std::vector<uint8> in(8*2, 0);
+    std::vector<uint8> out(in.size());
+    in[0] = 0x01;       // element 0, bit 0
+    in[2*3 + 1] = 0x80; // element 3, bit 15
+    for (int kernel = NTBitshuffle::scalar; kernel <= NTBitshuffle::avx2; ++kernel)
+    {
+        NTBitshuffle::shuffle(&in[0], &out[0], 8, 2, 8, NTBitshuffle::Kernel(kernel));
+        testOk(out[0] == 0x01 && out[15] == 0x08 && out[7] == 0 && out[8] == 0,
+            "layout of kernel %d", kernel);
+    }
+
+    // the last count % 8 elements are copied
+    std::vector<uint8> odd(11, 0xa5);
+    std::vector<uint8> shuffled(odd.size());
+    NTBitshuffle::shuffle(&odd[0], &shuffled[0], 11, 1, 8);
+    testOk1(shuffled[8] == 0xa5 && shuffled[9] == 0xa5 && shuffled[10] == 0xa5);
+    testOk1(shuffled[0] == 0xff && shuffled[1] == 0 && shuffled[2] == 0xff);
+}
+
+void test_kernels()
+{
+    testDiag("test_kernels, best %d", NTBitshuffle::getKernel());
+
+    size_t elementSizes[] = { 1, 2, 3, 4, 8 };
+    size_t counts[] = { 0, 7, 8, 100, 1000, 4099 };
+    size_t blockSizes[] = { 8, 64, 1024 };
+
+    for (size_t e = 0; e < sizeof(elementSizes)/sizeof(elementSizes[0]); ++e)
+    {
+        size_t elementSize = elementSizes[e];
+        bool same = true;
+        bool roundTrip = true;
+        for (size_t c = 0; c < sizeof(counts)/sizeof(counts[0]); ++c)
+        for (size_t b = 0; b < sizeof(blockSizes)/sizeof(blockSizes[0]); ++b)
+        {
+            size_t count = counts[c];
+            std::vector<uint8> in(count * elementSize + 1);
+            for (size_t i = 0; i < in.size(); ++i)
+                in[i] = random8();
+
+            std::vector<uint8> reference(in.size());
+            NTBitshuffle::shuffle(&in[0], &reference[0], count, elementSize,
+                blockSizes[b], NTBitshuffle::scalar);
+
+            for (int kernel = NTBitshuffle::scalar; kernel <= NTBitshuffle::avx2; ++kernel)
+            {
+                std::vector<uint8> out(in.size());
+                std::vector<uint8> back(in.size());
+                NTBitshuffle::shuffle(&in[0], &out[0], count, elementSize,
+                    blockSizes[b], NTBitshuffle::Kernel(kernel));
+                NTBitshuffle::unshuffle(&out[0], &back[0], count, elementSize,
+                    blockSizes[b], NTBitshuffle::Kernel(kernel));
+                same = same && std::equal(out.begin(), out.end() - 1, reference.begin());
+                roundTrip = roundTrip && std::equal(back.begin(), back.end() - 1, in.begin());
+            }
+        }
+        testOk(same, "kernels agree for %u byte elements", (unsigned)elementSize);
+        testOk(roundTrip, "round trips of %u byte elements", (unsigned)elementSize);
+    }
+}
+
+template<typename PVT>
+static NTNDArrayPtr createFrame(std::string const & field)
+{
+    NTNDArrayPtr ntndarray = NTNDArray::createBuilder()->create();
+
+    // counts with little entropy in the high bits
+    typename PVT::svector data(512*256);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<typename PVT::value_type>(100 + (random8() & 15));
+    ntndarray->getValue()->select<PVT>(field)->replace(freeze(data));
+
+    std::vector<NTNDArrayDimension> dimensions;
+    dimensions.push_back(NTNDArrayDimension(512));
+    dimensions.push_back(NTNDArrayDimension(256));
+    NTNDArrayDimension::put(*ntndarray, dimensions);
+
+    int64 size = 512*256*sizeof(typename PVT::value_type);
+    ntndarray->getCompressedDataSize()->put(size);
+    ntndarray->getUncompressedDataSize()->put(size);
+    return ntndarray;
+}
+
+template<typename PVT>
+void test_codec(std::string const & field)
+{
+    testDiag("test_codec %s", field.c_str());
+
+    NTNDArrayPtr frame = createFrame<PVT>(field);
+    typename PVT::const_svector original(frame->getValue()->get<PVT>()->view());
+    size_t elementSize = sizeof(typename PVT::value_type);
+    int64 size = frame->getUncompressedDataSize()->get();
+    testOk1(frame->isValid());
+
+    NTNDArrayCodec::compress(*frame, "nt-bslz4");
+    PVStructurePtr parameters = frame->getCodec()->getSubFieldT<PVUnion>("parameters")->get<PVStructure>();
+    testOk1(parameters && parameters->getSubFieldT<PVInt>("elementSize")->get() == (int32)elementSize);
+    testOk1(parameters && parameters->getSubFieldT<PVInt>("blockSize")->get() ==
+        (int32)NTBitshuffle::getDefaultBlockSize(elementSize));
+    testOk1(frame->isValid());
+    testOk(frame->getCompressedDataSize()->get() < size,
+        "compressed to %lld of %lld bytes",
+        (long long)frame->getCompressedDataSize()->get(), (long long)size);
+
+    NTNDArrayCodec::decompress(*frame);
+    testOk1(frame->isValid());
+    testOk1(frame->getCompressedDataSize()->get() == size);
+    typename PVT::const_svector values(frame->getValue()->get<PVT>()->view());
+    testOk1(values.size() == original.size() &&
+        std::equal(values.begin(), values.end(), original.begin()));
+}
+
+MAIN(testNTBitshuffle) {
+    testPlan(44);
+    test_blockSize();
+    test_layout();
+    test_kernels();
+    test_codec<PVUShortArray>("ushortValue");
+    test_codec<PVUIntArray>("uintValue");
+    test_codec<PVUByteArray>("ubyteValue");
+    return testDone();
+}
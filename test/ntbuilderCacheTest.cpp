@@ -0,0 +1,162 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/nt.h>
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+static FieldCreatePtr fieldCreate = getFieldCreate();
+
+void test_scalar()
+{
+    testDiag("test_scalar");
+
+    StructureConstPtr s1 = NTScalar::createBuilder()->
+        value(pvDouble)->addAlarm()->addTimeStamp()->createStructure();
+    StructureConstPtr s2 = NTScalar::createBuilder()->
+        value(pvDouble)->addAlarm()->addTimeStamp()->createStructure();
+    testOk1(s1.get() == s2.get());
+
+    // the same builder, reused
+    NTScalarBuilderPtr builder = NTScalar::createBuilder();
+    s2 = builder->value(pvDouble)->addAlarm()->addTimeStamp()->createStructure();
+    testOk1(s1.get() == s2.get());
+    s2 = builder->value(pvDouble)->addAlarm()->addTimeStamp()->createStructure();
+    testOk1(s1.get() == s2.get());
+
+    testOk1(s1.get() != NTScalar::createBuilder()->
+        value(pvFloat)->addAlarm()->addTimeStamp()->createStructure().get());
+    testOk1(s1.get() != NTScalar::createBuilder()->
+        value(pvDouble)->addAlarm()->createStructure().get());
+    testOk1(s1.get() != NTScalar::createBuilder()->
+        value(pvDouble)->addAlarm()->addTimeStamp()->addDisplay()->createStructure().get());
+
+    // created instances are independent
+    NTScalarPtr a = NTScalar::createBuilder()->value(pvInt)->create();
+    NTScalarPtr b = NTScalar::createBuilder()->value(pvInt)->create();
+    testOk1(a->getPVStructure()->getStructure() == b->getPVStructure()->getStructure());
+    a->getValue<PVInt>()->put(1);
+    b->getValue<PVInt>()->put(2);
+    testOk1(a->getValue<PVInt>()->get() == 1);
+}
+
+void test_extra()
+{
+    testDiag("test_extra");
+
+    FieldConstPtr extra = fieldCreate->createScalar(pvString);
+
+    StructureConstPtr s1 = NTScalarArray::createBuilder()->
+        value(pvInt)->add("extra", extra)->createStructure();
+    StructureConstPtr s2 = NTScalarArray::createBuilder()->
+        value(pvInt)->add("extra", extra)->createStructure();
+    testOk1(s1.get() == s2.get());
+    testOk1(s1->getField("extra").get() == extra.get());
+
+    // a different name
+    testOk1(s1.get() != NTScalarArray::createBuilder()->
+        value(pvInt)->add("other", extra)->createStructure().get());
+
+    // a different field
+    StructureConstPtr s3 = NTScalarArray::createBuilder()->
+        value(pvInt)->add("extra", fieldCreate->createScalar(pvDouble))->createStructure();
+    testOk1(s1.get() != s3.get());
+    testOk1(s3->getField<Scalar>("extra")->getScalarType() == pvDouble);
+
+    // no extra field
+    testOk1(s1.get() != NTScalarArray::createBuilder()->
+        value(pvInt)->createStructure().get());
+}
+
+void test_types()
+{
+    testDiag("test_types");
+
+    testOk1(NTTable::createBuilder()->addColumn("a", pvInt)->addColumn("b", pvDouble)->
+                createStructure().get() ==
+            NTTable::createBuilder()->addColumn("a", pvInt)->addColumn("b", pvDouble)->
+                createStructure().get());
+    testOk1(NTTable::createBuilder()->addColumn("a", pvInt)->addColumn("b", pvDouble)->
+                createStructure().get() !=
+            NTTable::createBuilder()->addColumn("b", pvDouble)->addColumn("a", pvInt)->
+                createStructure().get());
+    testOk1(NTTable::createBuilder()->addColumn("a", pvInt)->
+                createStructure().get() !=
+            NTTable::createBuilder()->addColumn("a", pvLong)->
+                createStructure().get());
+
+    testOk1(NTURI::createBuilder()->addQueryString("q")->addQueryInt("n")->
+                createStructure().get() ==
+            NTURI::createBuilder()->addQueryString("q")->addQueryInt("n")->
+                createStructure().get());
+    testOk1(NTURI::createBuilder()->addQueryString("q")->
+                createStructure().get() !=
+            NTURI::createBuilder()->addQueryString("q")->addAuthority()->
+                createStructure().get());
+
+    UnionConstPtr u = fieldCreate->createFieldBuilder()->
+        add("a", pvInt)->add("b", pvString)->createUnion();
+    testOk1(NTMultiChannel::createBuilder()->value(u)->createStructure().get() ==
+            NTMultiChannel::createBuilder()->value(u)->createStructure().get());
+    testOk1(NTMultiChannel::createBuilder()->value(u)->createStructure().get() !=
+            NTMultiChannel::createBuilder()->createStructure().get());
+    testOk1(NTUnion::createBuilder()->value(u)->addAlarm()->createStructure().get() ==
+            NTUnion::createBuilder()->value(u)->addAlarm()->createStructure().get());
+
+    testOk1(NTScalarMultiChannel::createBuilder()->value(pvDouble)->addSeverity()->
+                createStructure().get() ==
+            NTScalarMultiChannel::createBuilder()->value(pvDouble)->addSeverity()->
+                createStructure().get());
+    testOk1(NTScalarMultiChannel::createBuilder()->value(pvDouble)->addSeverity()->
+                createStructure().get() !=
+            NTScalarMultiChannel::createBuilder()->value(pvDouble)->addStatus()->
+                createStructure().get());
+}
+
+void test_all()
+{
+    testDiag("test_all");
+
+    testOk1(NTNameValue::createBuilder()->value(pvInt)->createStructure() ==
+            NTNameValue::createBuilder()->value(pvInt)->createStructure());
+    testOk1(NTMatrix::createBuilder()->addDim()->createStructure() ==
+            NTMatrix::createBuilder()->addDim()->createStructure());
+    testOk1(NTMatrix::createBuilder()->addDim()->createStructure() !=
+            NTMatrix::createBuilder()->createStructure());
+    testOk1(NTEnum::createBuilder()->addAlarm()->createStructure() ==
+            NTEnum::createBuilder()->addAlarm()->createStructure());
+    testOk1(NTAggregate::createBuilder()->addMin()->addMax()->createStructure() ==
+            NTAggregate::createBuilder()->addMin()->addMax()->createStructure());
+    testOk1(NTAggregate::createBuilder()->addMin()->createStructure() !=
+            NTAggregate::createBuilder()->addMax()->createStructure());
+    testOk1(NTAttribute::createBuilder()->addTags()->createStructure() ==
+            NTAttribute::createBuilder()->addTags()->createStructure());
+    testOk1(NTContinuum::createBuilder()->createStructure() ==
+            NTContinuum::createBuilder()->createStructure());
+    testOk1(NTHistogram::createBuilder()->value(pvInt)->createStructure() ==
+            NTHistogram::createBuilder()->value(pvInt)->createStructure());
+    testOk1(NTHistogram::createBuilder()->value(pvInt)->createStructure() !=
+            NTHistogram::createBuilder()->value(pvLong)->createStructure());
+    testOk1(NTNDArrayAttribute::createBuilder()->addTimeStamp()->createStructure() ==
+            NTNDArrayAttribute::createBuilder()->addTimeStamp()->createStructure());
+
+    // the structures of different types differ even with the same choices
+    testOk1(NTEnum::createBuilder()->createStructure() !=
+            NTContinuum::createBuilder()->createStructure());
+}
+
+MAIN(testNTBuilderCache) {
+    testPlan(36);
+    test_scalar();
+    test_extra();
+    test_types();
+    test_all();
+    return testDone();
+}
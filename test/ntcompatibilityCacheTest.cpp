@@ -0,0 +1,131 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/nt.h>
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+static FieldCreatePtr fieldCreate = getFieldCreate();
+
+static size_t checks = 0;
+
+static bool countingCheck(StructureConstPtr const & structure)
+{
+    ++checks;
+    return NTScalar::isCompatible(structure);
+}
+
+void test_cache()
+{
+    testDiag("test_cache");
+
+    NTCompatibilityCache cache(&countingCheck, 2);
+    checks = 0;
+
+    StructureConstPtr scalar = NTScalar::createBuilder()->
+        value(pvDouble)->addAlarm()->createStructure();
+    StructureConstPtr array = NTScalarArray::createBuilder()->
+        value(pvDouble)->createStructure();
+
+    testOk1(!cache.isCompatible(StructureConstPtr()));
+    testOk1(cache.getHits() == 0 && cache.getMisses() == 0);
+
+    testOk1(cache.isCompatible(scalar));
+    testOk1(cache.isCompatible(scalar));
+    testOk1(!cache.isCompatible(array));
+    testOk1(!cache.isCompatible(array));
+
+    testOk1(checks == 2);
+    testOk1(cache.getHits() == 2);
+    testOk1(cache.getMisses() == 2);
+    testOk1(cache.size() == 2);
+
+    cache.resetCounters();
+    testOk1(cache.getHits() == 0 && cache.getMisses() == 0);
+    testOk1(cache.size() == 2);
+
+    cache.clear();
+    testOk1(cache.size() == 0);
+    testOk1(cache.isCompatible(scalar));
+    testOk1(checks == 3);
+}
+
+void test_bounded()
+{
+    testDiag("test_bounded");
+
+    NTCompatibilityCache cache(&countingCheck, 2);
+    checks = 0;
+
+    StructureConstPtr s1 = NTScalar::createBuilder()->
+        value(pvDouble)->createStructure();
+    StructureConstPtr s2 = NTScalar::createBuilder()->
+        value(pvInt)->createStructure();
+    StructureConstPtr s3 = NTScalar::createBuilder()->
+        value(pvString)->createStructure();
+
+    cache.isCompatible(s1);
+    cache.isCompatible(s2);
+    cache.isCompatible(s3);
+    testOk1(cache.size() == 2);
+    testOk1(cache.getCapacity() == 2);
+
+    // s1 is the oldest entry and must have been evicted
+    cache.isCompatible(s3);
+    testOk1(checks == 3);
+    cache.isCompatible(s1);
+    testOk1(checks == 4);
+
+    cache.setCapacity(1);
+    testOk1(cache.size() == 1);
+
+    cache.setCapacity(0);
+    testOk1(cache.size() == 0);
+    cache.isCompatible(s1);
+    cache.isCompatible(s1);
+    testOk1(cache.size() == 0);
+    testOk1(checks == 6);
+}
+
+void test_wrap()
+{
+    testDiag("test_wrap");
+
+    NTCompatibilityCache & cache = NTScalar::getCompatibilityCache();
+    cache.clear();
+    cache.resetCounters();
+
+    PVStructurePtr pvStructure = NTScalar::createBuilder()->
+        value(pvDouble)->addTimeStamp()->createPVStructure();
+
+    testOk1(NTScalar::wrap(pvStructure).get() != 0);
+    testOk1(cache.getMisses() == 1);
+    testOk1(cache.getHits() == 0);
+
+    testOk1(NTScalar::wrap(pvStructure).get() != 0);
+    testOk1(cache.getMisses() == 1);
+    testOk1(cache.getHits() == 1);
+
+    PVStructurePtr pvTimeStamp = getPVDataCreate()->createPVStructure(
+        NTField::get()->createTimeStamp());
+
+    testOk1(NTScalar::wrap(pvTimeStamp).get() == 0);
+    testOk1(NTScalar::wrap(pvTimeStamp).get() == 0);
+    testOk1(cache.getMisses() == 2);
+    testOk1(cache.getHits() == 2);
+}
+
+MAIN(testNTCompatibilityCache) {
+    testPlan(33);
+    test_cache();
+    test_bounded();
+    test_wrap();
+    return testDone();
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+/*
+ * Microbenchmark of structural fingerprints on deep introspection trees
+ * (NTNDArray with all optional fields, NTMultiChannel with all optional
+ * fields).
+ *
+ * Compares computing the fingerprint, looking it up in the cache and
+ * comparing two independently built trees with Field::operator==
+ * (which is cheap if pvData has deduplicated them).
+ *
+ * Built with the tests, but not run by them. Usage:
+ *   ntfingerprintBench [iterations]
+ */
+
+#include <stdlib.h>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+#include <epicsTypes.h>
+#include <epicsTime.h>
+
+#include <pv/nt.h>
+#include <pv/ntfingerprint.h>
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+namespace {
+
+StructureConstPtr createNDArray()
+{
+    return NTNDArray::createBuilder()->
+        addDescriptor()->addTimeStamp()->addAlarm()->addDisplay()->
+        createStructure();
+}
+
+StructureConstPtr createMultiChannel()
+{
+    return NTMultiChannel::createBuilder()->
+        addDescriptor()->addAlarm()->addTimeStamp()->addSeverity()->
+        addStatus()->addMessage()->addSecondsPastEpoch()->addNanoseconds()->
+        addUserTag()->addIsConnected()->
+        createStructure();
+}
+
+// thousand calls per second
+double rate(epicsUInt64 start, size_t calls)
+{
+    epicsUInt64 ns = epicsMonotonicGet() - start;
+    return ns ? calls * 1e6 / ns : 0.0;
+}
+
+void bench(const char * name, StructureConstPtr const & a, StructureConstPtr const & b,
+           size_t iterations, size_t & sink)
+{
+    epicsUInt64 start = epicsMonotonicGet();
+    for (size_t i = 0; i < iterations; ++i)
+        sink += NTFingerprint::compute(a).getLow() & 1;
+    double computed = rate(start, iterations);
+
+    NTFingerprint::get(a);
+    start = epicsMonotonicGet();
+    for (size_t i = 0; i < iterations; ++i)
+        sink += NTFingerprint::get(a).getLow() & 1;
+    double cached = rate(start, iterations);
+
+    start = epicsMonotonicGet();
+    for (size_t i = 0; i < iterations; ++i)
+        sink += *a == *b;
+    double compared = rate(start, iterations);
+
+    testDiag("%-16s %10.1f %10.1f %10.1f", name, computed, cached, compared);
+}
+
+}
+
+MAIN(ntfingerprintBench)
+{
+    size_t iterations = 100000;
+    if (argc > 1)
+        iterations = strtoul(argv[1], NULL, 0);
+
+    testPlan(2);
+
+    StructureConstPtr ndArray1 = createNDArray(), ndArray2 = createNDArray();
+    StructureConstPtr multiChannel1 = createMultiChannel(), multiChannel2 = createMultiChannel();
+
+    testOk1(NTFingerprint::compute(ndArray1) == NTFingerprint::get(ndArray2));
+    testOk1(NTFingerprint::compute(multiChannel1) == NTFingerprint::get(multiChannel2));
+
+    testDiag("%u iterations, thousand calls per second", (unsigned)iterations);
+    testDiag("%-16s %10s %10s %10s", "type", "compute", "get", "operator==");
+
+    size_t sink = 0;
+    bench("NTNDArray", ndArray1, ndArray2, iterations, sink);
+    bench("NTMultiChannel", multiChannel1, multiChannel2, iterations, sink);
+    testDiag("(%u)", (unsigned)(sink & 1));
+
+    return testDone();
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <set>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/nt.h>
+#include <pv/ntfingerprint.h>
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+static FieldCreatePtr fieldCreate = getFieldCreate();
+
+static NTFingerprint fingerprint(FieldConstPtr const & field)
+{
+    return NTFingerprint::compute(field);
+}
+
+void test_basic()
+{
+    testDiag("test_basic");
+
+    NTFingerprint null;
+    testOk1(null.isNull());
+    testOk1(fingerprint(FieldConstPtr()).isNull());
+    testOk1(NTFingerprint::get(FieldConstPtr()).isNull());
+
+    NTFingerprint f(1, 2);
+    testOk1(f.getHigh() == 1 && f.getLow() == 2);
+    testOk1(!f.isNull());
+    testOk1(f == NTFingerprint(1, 2));
+    testOk1(f != NTFingerprint(2, 1));
+    testOk1(f < NTFingerprint(2, 1) && NTFingerprint(1, 1) < f);
+    testOk1(f.toString() == "00000000000000010000000000000002");
+}
+
+void test_identical()
+{
+    testDiag("test_identical");
+
+    StructureConstPtr s1 = NTScalar::createBuilder()->
+        value(pvDouble)->addAlarm()->addTimeStamp()->createStructure();
+    StructureConstPtr s2 = NTScalar::createBuilder()->
+        value(pvDouble)->addAlarm()->addTimeStamp()->createStructure();
+    testOk1(fingerprint(s1) == fingerprint(s2));
+    testOk1(NTFingerprint::get(s1) == fingerprint(s1));
+    testOk1(NTFingerprint::get(s2) == NTFingerprint::get(s1));
+
+    StructureConstPtr a1 = NTNDArray::createBuilder()->
+        addDescriptor()->addTimeStamp()->addAlarm()->addDisplay()->createStructure();
+    StructureConstPtr a2 = NTNDArray::createBuilder()->
+        addDescriptor()->addTimeStamp()->addAlarm()->addDisplay()->createStructure();
+    testOk1(fingerprint(a1) == fingerprint(a2));
+
+    // built by hand, with the same members
+    StructureConstPtr h1 = fieldCreate->createFieldBuilder()->
+        setId("custom")->
+        add("x", pvInt)->
+        addNestedStructureArray("points")->add("a", pvFloat)->endNested()->
+        createStructure();
+    StructureConstPtr h2 = fieldCreate->createFieldBuilder()->
+        setId("custom")->
+        add("x", pvInt)->
+        addNestedStructureArray("points")->add("a", pvFloat)->endNested()->
+        createStructure();
+    testOk1(fingerprint(h1) == fingerprint(h2));
+}
+
+void test_different()
+{
+    testDiag("test_different");
+
+    NTFingerprint base = fingerprint(NTScalar::createBuilder()->
+        value(pvDouble)->addAlarm()->createStructure());
+
+    // value type
+    testOk1(base != fingerprint(NTScalar::createBuilder()->
+        value(pvFloat)->addAlarm()->createStructure()));
+    // optional field
+    testOk1(base != fingerprint(NTScalar::createBuilder()->
+        value(pvDouble)->createStructure()));
+    testOk1(base != fingerprint(NTScalar::createBuilder()->
+        value(pvDouble)->addAlarm()->addDescriptor()->createStructure()));
+    // scalar vs scalar array
+    testOk1(base != fingerprint(NTScalarArray::createBuilder()->
+        value(pvDouble)->addAlarm()->createStructure()));
+
+    FieldBuilderPtr fb = fieldCreate->createFieldBuilder();
+
+    // ID
+    testOk1(fingerprint(fb->setId("a")->add("x", pvInt)->createStructure()) !=
+            fingerprint(fb->setId("b")->add("x", pvInt)->createStructure()));
+    // field name
+    testOk1(fingerprint(fb->add("x", pvInt)->createStructure()) !=
+            fingerprint(fb->add("y", pvInt)->createStructure()));
+    // field order
+    testOk1(fingerprint(fb->add("x", pvInt)->add("y", pvLong)->createStructure()) !=
+            fingerprint(fb->add("y", pvLong)->add("x", pvInt)->createStructure()));
+    // structure vs union with the same members
+    testOk1(fingerprint(fb->add("x", pvInt)->createStructure()) !=
+            fingerprint(fb->add("x", pvInt)->createUnion()));
+    // structure vs structure array
+    StructureConstPtr s = fb->add("x", pvInt)->createStructure();
+    testOk1(fingerprint(s) != fingerprint(fieldCreate->createStructureArray(s)));
+    // bounded string
+    testOk1(fingerprint(fb->add("x", pvString)->createStructure()) !=
+            fingerprint(fb->addBoundedString("x", 16)->createStructure()));
+    // nesting, names that would run together without their lengths
+    testOk1(fingerprint(fb->add("ab", pvInt)->add("c", pvInt)->createStructure()) !=
+            fingerprint(fb->add("a", pvInt)->add("bc", pvInt)->createStructure()));
+    testOk1(fingerprint(fb->addNestedStructure("a")->add("b", pvInt)->endNested()->
+                add("c", pvInt)->createStructure()) !=
+            fingerprint(fb->addNestedStructure("a")->add("b", pvInt)->
+                add("c", pvInt)->endNested()->createStructure()));
+    // variant union vs regular union
+    testOk1(fingerprint(fieldCreate->createVariantUnion()) !=
+            fingerprint(fb->add("x", pvInt)->createUnion()));
+}
+
+void test_collisions()
+{
+    testDiag("test_collisions");
+
+    std::set<NTFingerprint> fingerprints;
+    std::set<epicsUInt64> lows;
+    size_t count = 0;
+
+    // every NTScalar and NTScalarArray variant
+    for (int t = pvBoolean; t <= pvString; ++t) {
+        ScalarType type = static_cast<ScalarType>(t);
+        for (int options = 0; options < 32; ++options) {
+            NTScalarBuilderPtr scalar = NTScalar::createBuilder();
+            NTScalarArrayBuilderPtr array = NTScalarArray::createBuilder();
+            scalar->value(type);
+            array->value(type);
+            if (options & 1) { scalar->addDescriptor(); array->addDescriptor(); }
+            if (options & 2) { scalar->addAlarm(); array->addAlarm(); }
+            if (options & 4) { scalar->addTimeStamp(); array->addTimeStamp(); }
+            if (options & 8) { scalar->addDisplay(); array->addDisplay(); }
+            if (options & 16) { scalar->addControl(); array->addControl(); }
+
+            NTFingerprint f = fingerprint(scalar->createStructure());
+            fingerprints.insert(f);
+            lows.insert(f.getLow());
+            f = fingerprint(array->createStructure());
+            fingerprints.insert(f);
+            lows.insert(f.getLow());
+            count += 2;
+        }
+    }
+
+    // NTTables with one to three columns of every type
+    for (int t1 = pvBoolean; t1 <= pvString; ++t1) {
+        for (int t2 = pvBoolean; t2 <= pvString; ++t2) {
+            for (int columns = 1; columns <= 3; ++columns) {
+                NTTableBuilderPtr builder = NTTable::createBuilder();
+                builder->addColumn("a", static_cast<ScalarType>(t1));
+                if (columns > 1)
+                    builder->addColumn("b", static_cast<ScalarType>(t2));
+                if (columns > 2)
+                    builder->addColumn("c", pvDouble);
+                NTFingerprint f = fingerprint(builder->createStructure());
+                fingerprints.insert(f);
+                lows.insert(f.getLow());
+                ++count;
+            }
+        }
+    }
+
+    // identical single column tables are built for every t2
+    size_t duplicates = (pvString - pvBoolean + 1) * (pvString - pvBoolean);
+    testOk(fingerprints.size() == count - duplicates, "%u distinct fingerprints",
+        (unsigned)fingerprints.size());
+    testOk1(lows.size() == fingerprints.size());
+}
+
+void test_cache()
+{
+    testDiag("test_cache");
+
+    NTFingerprint::clearCache();
+    testOk1(NTFingerprint::getCacheSize() == 0);
+
+    StructureConstPtr s = NTMultiChannel::createBuilder()->
+        addDescriptor()->addSeverity()->addIsConnected()->createStructure();
+    NTFingerprint f = NTFingerprint::get(s);
+    testOk1(NTFingerprint::getCacheSize() == 1);
+    testOk1(NTFingerprint::get(s) == f);
+    testOk1(NTFingerprint::getCacheSize() == 1);
+    testOk1(f == fingerprint(s));
+
+    NTFingerprint::get(s->getField("value"));
+    testOk1(NTFingerprint::getCacheSize() == 2);
+
+    NTFingerprint::clearCache();
+    testOk1(NTFingerprint::getCacheSize() == 0);
+    testOk1(NTFingerprint::get(s) == f);
+}
+
+MAIN(testNTFingerprint) {
+    testPlan(37);
+    test_basic();
+    test_identical();
+    test_different();
+    test_collisions();
+    test_cache();
+    return testDone();
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <stdio.h>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/ntid.h>
+
+
+using namespace epics::nt;
+
+void test_parse()
+{
+    testDiag("test_parse");
+
+    NTParsedID id("epics:nt/NTNDArray:1.2");
+    testOk1(id.getFullName() == "epics:nt/NTNDArray:1.2");
+    testOk1(id.getQualifiedName() == "epics:nt/NTNDArray");
+    testOk1(id.getNamespace() == "epics:nt");
+    testOk1(id.getName() == "NTNDArray");
+    testOk1(id.getVersion() == "1.2");
+    testOk1(id.getMajorVersionString() == "1");
+    testOk1(id.hasMajorVersion());
+    testOk1(id.getMajorVersion() == 1);
+    testOk1(id.getMinorVersionString() == "2");
+    testOk1(id.hasMinorVersion());
+    testOk1(id.getMinorVersion() == 2);
+}
+
+void test_parse_partial()
+{
+    testDiag("test_parse_partial");
+
+    NTParsedID noMinor("epics:nt/NTTable:3");
+    testOk1(noMinor.getName() == "NTTable");
+    testOk1(noMinor.getVersion() == "3");
+    testOk1(noMinor.hasMajorVersion() && noMinor.getMajorVersion() == 3);
+    testOk1(noMinor.getMinorVersionString() == "");
+    testOk1(!noMinor.hasMinorVersion() && noMinor.getMinorVersion() == 0);
+
+    NTParsedID noVersion("epics:nt/NTTable");
+    testOk1(noVersion.getQualifiedName() == "epics:nt/NTTable");
+    testOk1(noVersion.getNamespace() == "epics:nt");
+    testOk1(noVersion.getName() == "NTTable");
+    testOk1(noVersion.getVersion() == "");
+    testOk1(!noVersion.hasMajorVersion() && !noVersion.hasMinorVersion());
+
+    NTParsedID noNamespace("NTTable:1.0");
+    testOk1(noNamespace.getNamespace() == "");
+    testOk1(noNamespace.getName() == "NTTable");
+    testOk1(noNamespace.getQualifiedName() == "NTTable");
+    testOk1(noNamespace.getMajorVersion() == 1 && noNamespace.hasMinorVersion());
+
+    NTParsedID bad("epics:nt/NTTable:x.y");
+    testOk1(bad.getMajorVersionString() == "x" && !bad.hasMajorVersion());
+    testOk1(bad.getMinorVersionString() == "y" && !bad.hasMinorVersion());
+
+    NTParsedID plain("structure");
+    testOk1(plain.getName() == "structure");
+    testOk1(plain.getQualifiedName() == "structure");
+    testOk1(plain.getNamespace() == "" && plain.getVersion() == "");
+}
+
+void test_same_as_ntid()
+{
+    testDiag("test_same_as_ntid");
+
+    const char * ids[] = {
+        "epics:nt/NTNDArray:1.2",
+        "epics:nt/NTTable:3",
+        "epics:nt/NTTable",
+        "NTTable:1.0",
+        "epics:nt/NTTable:x.y",
+        "structure",
+    };
+
+    for (size_t i = 0; i < sizeof(ids)/sizeof(ids[0]); ++i) {
+        NTID id(ids[i]);
+        NTParsedID parsed(ids[i]);
+        testOk(id.getFullName() == parsed.getFullName() &&
+               id.getQualifiedName() == parsed.getQualifiedName() &&
+               id.getNamespace() == parsed.getNamespace() &&
+               id.getVersion() == parsed.getVersion() &&
+               id.getMajorVersionString() == parsed.getMajorVersionString() &&
+               id.hasMajorVersion() == parsed.hasMajorVersion() &&
+               id.getMajorVersion() == parsed.getMajorVersion() &&
+               id.getMinorVersionString() == parsed.getMinorVersionString() &&
+               id.hasMinorVersion() == parsed.hasMinorVersion() &&
+               id.getMinorVersion() == parsed.getMinorVersion(),
+               "NTID(\"%s\") == NTParsedID(\"%s\")", ids[i], ids[i]);
+    }
+}
+
+void test_cache()
+{
+    testDiag("test_cache");
+
+    NTParsedID::clearCache();
+    testOk1(NTParsedID::getCacheSize() == 0);
+
+    NTParsedID::const_shared_pointer a = NTParsedID::get("epics:nt/NTScalar:1.0");
+    NTParsedID::const_shared_pointer b = NTParsedID::get("epics:nt/NTScalar:1.0");
+    NTParsedID::const_shared_pointer c = NTParsedID::get("epics:nt/NTScalar:1.1");
+    testOk1(a.get() != 0 && a.get() == b.get());
+    testOk1(a.get() != c.get());
+    testOk1(a->getName() == "NTScalar" && c->getMinorVersion() == 1);
+    testOk1(NTParsedID::getCacheSize() == 2);
+
+    NTParsedID::clearCache();
+    testOk1(NTParsedID::getCacheSize() == 0);
+    testOk1(a->getFullName() == "epics:nt/NTScalar:1.0");
+
+    // bounded
+    char id[32];
+    for (size_t i = 0; i < NTParsedID::CACHE_CAPACITY + 10; ++i) {
+        sprintf(id, "epics:nt/NTScalar:1.%u", (unsigned)i);
+        NTParsedID::get(id);
+    }
+    testOk1(NTParsedID::getCacheSize() == NTParsedID::CACHE_CAPACITY);
+    testOk1(NTParsedID::get(id)->getMinorVersion() == int(NTParsedID::CACHE_CAPACITY + 9));
+    NTParsedID::clearCache();
+}
+
+MAIN(testNTID) {
+    testPlan(45);
+    test_parse();
+    test_parse_partial();
+    test_same_as_ntid();
+    test_cache();
+    return testDone();
+}
@@ -0,0 +1,245 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <stdexcept>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/nt.h>
+#include <pv/ntndarrayCodec.h>
+#include <pv/ntndarrayView.h>
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+static const int32 WIDTH = 640;
+static const int32 HEIGHT = 480;
+
+// a 16-bit frame, smooth with some noise
+static NTNDArrayPtr createFrame()
+{
+    NTNDArrayPtr ntndarray = NTNDArray::createBuilder()->create();
+
+    PVUShortArray::svector data(WIDTH*HEIGHT);
+    unsigned noise = 1;
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        noise = noise * 1103515245u + 12345u;
+        data[i] = static_cast<uint16>(1000 + (i % WIDTH) / 4 + ((noise >> 16) & 3));
+    }
+    ntndarray->getValue()->select<PVUShortArray>("ushortValue")->replace(freeze(data));
+
+    std::vector<NTNDArrayDimension> dimensions;
+    dimensions.push_back(NTNDArrayDimension(WIDTH));
+    dimensions.push_back(NTNDArrayDimension(HEIGHT));
+    NTNDArrayDimension::put(*ntndarray, dimensions);
+
+    ntndarray->getCompressedDataSize()->put(WIDTH*HEIGHT*2);
+    ntndarray->getUncompressedDataSize()->put(WIDTH*HEIGHT*2);
+    return ntndarray;
+}
+
+static bool sameValue(NTNDArrayPtr const & a, NTNDArrayPtr const & b)
+{
+    return *a->getValue() == *b->getValue();
+}
+
+void test_registry()
+{
+    testDiag("test_registry");
+
+    std::vector<std::string> names = NTNDArrayCodec::getNames();
+    testOk1(names.size() >= 3);
+    testOk1(NTNDArrayCodec::find("nt-lz4").get() != 0);
+    testOk1(NTNDArrayCodec::find("nt-rle")->getName() == "nt-rle");
+    testOk1(NTNDArrayCodec::find("nt-delta").get() != 0);
+    testOk1(NTNDArrayCodec::find("unknown").get() == 0);
+}
+
+void test_codec(std::string const & name, size_t chunkSize, bool smaller)
+{
+    testDiag("test_codec %s, chunks of %u bytes", name.c_str(), (unsigned)chunkSize);
+
+    NTNDArrayPtr frame = createFrame();
+    NTNDArrayPtr original = createFrame();
+
+    NTNDArrayCodec::compress(*frame, name, chunkSize);
+    testOk1(frame->getCodec()->getSubFieldT<PVString>("name")->get() == name);
+    PVStructurePtr parameters = frame->getCodec()->getSubFieldT<PVUnion>("parameters")->get<PVStructure>();
+    testOk1(parameters && parameters->getSubFieldT<PVInt>("chunkSize")->get() == (int32)chunkSize);
+    testOk1(parameters && parameters->getSubFieldT<PVInt>("elementSize")->get() == 2);
+    testOk1(frame->getValue()->getSelectedFieldName() == "ushortValue");
+    testOk1(frame->getUncompressedDataSize()->get() == WIDTH*HEIGHT*2);
+    testOk1(frame->getCompressedDataSize()->get() ==
+        (int64)frame->getValue()->get<PVUShortArray>()->getLength() * 2);
+    if (smaller)
+        testOk1(frame->getCompressedDataSize()->get() < WIDTH*HEIGHT*2);
+    else
+        testPass("compressed size %lld", (long long)frame->getCompressedDataSize()->get());
+    testOk1(frame->isValid());
+
+    NTNDArrayCodec::decompress(*frame);
+    testOk1(frame->getCodec()->getSubFieldT<PVString>("name")->get().empty());
+    testOk1(!frame->getCodec()->getSubFieldT<PVUnion>("parameters")->get());
+    testOk1(frame->getCompressedDataSize()->get() == WIDTH*HEIGHT*2);
+    testOk1(sameValue(frame, original));
+    testOk1(frame->isValid());
+}
+
+void test_types()
+{
+    testDiag("test_types");
+
+    // other element types, including an odd number of bytes
+    NTNDArrayPtr ntndarray = NTNDArray::createBuilder()->create();
+    PVDoubleArray::svector doubles(1001);
+    for (size_t i = 0; i < doubles.size(); ++i)
+        doubles[i] = i * 0.5;
+    ntndarray->getValue()->select<PVDoubleArray>("doubleValue")->replace(freeze(doubles));
+    NTNDArrayDimension::put(*ntndarray, std::vector<NTNDArrayDimension>(1, NTNDArrayDimension(1001)));
+    ntndarray->getUncompressedDataSize()->put(1001*8);
+
+    NTNDArrayCodec::compress(*ntndarray, "nt-delta", 1000);
+    // rounded down to whole elements
+    testOk1(ntndarray->getCodec()->getSubFieldT<PVUnion>("parameters")->get<PVStructure>()->
+        getSubFieldT<PVInt>("chunkSize")->get() == 1000);
+    NTNDArrayCodec::decompress(*ntndarray);
+    PVDoubleArray::const_svector values(ntndarray->getValue()->get<PVDoubleArray>()->view());
+    testOk1(values.size() == 1001 && values[1000] == 500.0);
+
+    PVByteArray::svector bytes(77, 5);
+    ntndarray->getValue()->select<PVByteArray>("byteValue")->replace(freeze(bytes));
+    NTNDArrayCodec::compress(*ntndarray, "nt-rle", 10);
+    testOk1(ntndarray->getUncompressedDataSize()->get() == 77);
+    NTNDArrayCodec::decompress(*ntndarray);
+    testOk1(ntndarray->getValue()->get<PVByteArray>()->view().size() == 77);
+
+    // empty
+    ntndarray->getValue()->select<PVIntArray>("intValue");
+    NTNDArrayCodec::compress(*ntndarray, "nt-lz4");
+    testOk1(ntndarray->getUncompressedDataSize()->get() == 0);
+    NTNDArrayCodec::decompress(*ntndarray);
+    testOk1(ntndarray->getValue()->get<PVIntArray>()->getLength() == 0);
+}
+
+void test_threads()
+{
+    testDiag("test_threads");
+
+    NTNDArrayPtr original = createFrame();
+    NTNDArrayPtr single = createFrame();
+    NTNDArrayPtr multi = createFrame();
+
+    // the result does not depend on the number of threads
+    NTNDArrayCodec::compress(*single, "nt-lz4", 4096, 1);
+    NTNDArrayCodec::compress(*multi, "nt-lz4", 4096, 8);
+    testOk1(sameValue(single, multi));
+
+    NTNDArrayCodec::decompress(*multi, 8);
+    testOk1(sameValue(multi, original));
+    NTNDArrayCodec::decompress(*single, 1);
+    testOk1(sameValue(single, original));
+}
+
+// stores chunks as they are
+class CopyCodec : public NTNDArrayCodec
+{
+public:
+    virtual std::string getName() const { return "copy"; }
+
+    virtual void compress(uint8 const * in, size_t size,
+        size_t /*elementSize*/, std::vector<uint8> & out) const
+    {
+        out.insert(out.end(), in, in + size);
+    }
+
+    virtual void decompress(uint8 const * in, size_t size,
+        size_t /*elementSize*/, uint8 * out, size_t outSize) const
+    {
+        if (size != outSize)
+            throw std::runtime_error("corrupt copy chunk");
+        std::copy(in, in + size, out);
+    }
+};
+
+void test_errors()
+{
+    testDiag("test_errors");
+
+    NTNDArrayPtr frame = createFrame();
+
+    try {
+        NTNDArrayCodec::compress(*frame, "unknown");
+        testFail("unknown codec accepted");
+    } catch (std::runtime_error &) {
+        testPass("unknown codec rejected");
+    }
+
+    NTNDArrayCodec::add(NTNDArrayCodecPtr(new CopyCodec()));
+    testOk1(NTNDArrayCodec::find("copy").get() != 0);
+    NTNDArrayCodec::compress(*frame, "copy", 1 << 16);
+    testOk1(frame->getCompressedDataSize()->get() == WIDTH*HEIGHT*2 + 10*4);
+
+    try {
+        NTNDArrayCodec::compress(*frame, "nt-lz4");
+        testFail("compressed twice");
+    } catch (std::runtime_error &) {
+        testPass("compressing a compressed NTNDArray rejected");
+    }
+
+    // a compressed value is not viewed
+    try {
+        NTNDArrayView<uint16> view(*frame);
+        testFail("view of compressed value created");
+    } catch (std::runtime_error &) {
+        testPass("view of compressed value rejected");
+    }
+
+    // truncated
+    PVUShortArray::const_svector value(frame->getValue()->get<PVUShortArray>()->view());
+    PVUShortArray::svector truncated(thaw(value));
+    truncated.resize(truncated.size() / 2);
+    frame->getValue()->get<PVUShortArray>()->replace(freeze(truncated));
+    try {
+        NTNDArrayCodec::decompress(*frame);
+        testFail("truncated value decompressed");
+    } catch (std::runtime_error &) {
+        testPass("truncated value rejected");
+    }
+    testOk1(frame->getCodec()->getSubFieldT<PVString>("name")->get() == "copy");
+
+    frame->getCodec()->getSubFieldT<PVString>("name")->put("unknown");
+    try {
+        NTNDArrayCodec::decompress(*frame);
+        testFail("unknown codec decompressed");
+    } catch (std::runtime_error &) {
+        testPass("unknown codec rejected");
+    }
+
+    NTNDArrayPtr empty = NTNDArray::createBuilder()->create();
+    try {
+        NTNDArrayCodec::compress(*empty, "nt-lz4");
+        testFail("NTNDArray without value compressed");
+    } catch (std::runtime_error &) {
+        testPass("NTNDArray without value rejected");
+    }
+    NTNDArrayCodec::decompress(*empty);
+    testPass("uncompressed NTNDArray left as is");
+}
+
+MAIN(testNTNDArrayCodec) {
+    testPlan(76);
+    test_registry();
+    test_codec("nt-lz4", NTNDArrayCodec::DEFAULT_CHUNK_SIZE, true);
+    test_codec("nt-lz4", 10000, true);
+    test_codec("nt-rle", 65536, false);
+    test_codec("nt-delta", 65536, true);
+    test_types();
+    test_threads();
+    test_errors();
+    return testDone();
+}
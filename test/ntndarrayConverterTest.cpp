@@ -0,0 +1,211 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/nt.h>
+#include <pv/ntndarrayCodec.h>
+#include <pv/ntndarrayConverter.h>
+#include <pv/ntndarrayView.h>
+
+#include "ntndarrayTestFrame.h"
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+static NTNDArrayPtr createCounts(size_t width, size_t height)
+{
+    PVUShortArray::svector data(width * height);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint16>(i % 4096);
+    return createFrame<PVUShortArray>("ushortValue", data, static_cast<int32>(width));
+}
+
+// -300, -250, ..., 650
+static NTNDArrayPtr createShorts()
+{
+    PVShortArray::svector data(20);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<int16>(static_cast<int>(i) * 50 - 300);
+    return createFrame<PVShortArray>("shortValue", data, 20);
+}
+
+void test_convert()
+{
+    testDiag("test_convert");
+
+    NTNDArrayPtr frame = createCounts(100, 30);
+    NTNDArrayConverter(pvFloat).convert(*frame);
+    testOk1(frame->getValue()->getSelectedFieldName() == "floatValue");
+    testOk1(frame->getUncompressedDataSize()->get() == 100*30*4);
+    testOk1(frame->getCompressedDataSize()->get() == 100*30*4);
+    testOk1(frame->isValid());
+
+    std::vector<NTNDArrayDimension> dimensions;
+    NTNDArrayDimension::get(*frame, dimensions);
+    testOk1(dimensions.size() == 2 && dimensions[0].size == 100 && dimensions[1].size == 30);
+
+    NTNDArrayView<float> view(*frame);
+    testOk1(view(0, 0) == 0.0f && view(99, 0) == 99.0f && view(99, 29) == 2999.0f);
+
+    // and back
+    NTNDArrayConverter(pvUShort).convert(*frame);
+    NTNDArrayPtr original = createCounts(100, 30);
+    testOk1(*frame->getValue() == *original->getValue());
+    testOk1(frame->getUncompressedDataSize()->get() == 100*30*2);
+
+    // to the same type, left as is
+    PVUShortArray::const_svector before(frame->getValue()->get<PVUShortArray>()->view());
+    NTNDArrayConverter(pvUShort).convert(*frame);
+    testOk1(frame->getValue()->get<PVUShortArray>()->view().data() == before.data());
+
+    // to and from booleans
+    NTNDArrayConverter(pvBoolean).convert(*frame);
+    PVBooleanArray::const_svector booleans(frame->getValue()->get<PVBooleanArray>()->view());
+    testOk1(booleans.size() == 3000 && !booleans[0] && booleans[1] && booleans[2999]);
+    NTNDArrayConverter(pvDouble).convert(*frame);
+    PVDoubleArray::const_svector doubles(frame->getValue()->get<PVDoubleArray>()->view());
+    testOk1(doubles[0] == 0.0 && doubles[1] == 1.0);
+    testOk1(frame->getUncompressedDataSize()->get() == 3000*8);
+}
+
+void test_scale()
+{
+    testDiag("test_scale");
+
+    // 12-bit counts for display
+    NTNDArrayPtr frame = createCounts(4096, 2);
+    NTNDArrayConverter(pvUByte).scale(1.0/16.0).convert(*frame);
+    PVUByteArray::const_svector bytes(frame->getValue()->get<PVUByteArray>()->view());
+    testOk1(bytes.size() == 8192);
+    testOk1(bytes[0] == 0 && bytes[4095] == 255 && bytes[2048] == 128 && bytes[31] == 1);
+    testOk1(frame->getUncompressedDataSize()->get() == 8192);
+
+    // clamped to the range of the new type
+    frame = createCounts(4096, 2);
+    NTNDArrayConverter(pvUByte).scale(-1.0, 200.0).convert(*frame);
+    bytes = frame->getValue()->get<PVUByteArray>()->view();
+    testOk1(bytes[0] == 200 && bytes[150] == 50 && bytes[200] == 0 && bytes[4000] == 0);
+
+    frame = createCounts(4096, 1);
+    NTNDArrayConverter(pvFloat).scale(0.5, -1.0).convert(*frame);
+    PVFloatArray::const_svector floats(frame->getValue()->get<PVFloatArray>()->view());
+    testOk1(floats[0] == -1.0f && floats[3] == 0.5f && floats[4095] == 2046.5f);
+
+    // floating point elements are truncated, clamped, NaN to the minimum
+    PVFloatArray::svector special(16, 1.5f);
+    special[1] = -3.0f;
+    special[2] = 70000.0f;
+    special[3] = std::numeric_limits<float>::quiet_NaN();
+    special[4] = std::numeric_limits<float>::infinity();
+    special[5] = 65534.9f;
+    frame = createFrame<PVFloatArray>("floatValue", special, 4);
+    NTNDArrayConverter(pvUShort).convert(*frame);
+    PVUShortArray::const_svector shorts(frame->getValue()->get<PVUShortArray>()->view());
+    testOk1(shorts[0] == 1 && shorts[1] == 0 && shorts[2] == 65535 && shorts[3] == 0);
+    testOk1(shorts[4] == 65535 && shorts[5] == 65534 && shorts[15] == 1);
+}
+
+void test_saturate()
+{
+    testDiag("test_saturate");
+
+    // the low bits are kept
+    NTNDArrayPtr frame = createShorts();
+    NTNDArrayConverter(pvUByte).convert(*frame);
+    PVUByteArray::const_svector bytes(frame->getValue()->get<PVUByteArray>()->view());
+    testOk1(bytes[0] == static_cast<uint8>(-300) && bytes[19] == static_cast<uint8>(650));
+
+    frame = createShorts();
+    NTNDArrayConverter(pvUByte).saturate().convert(*frame);
+    bytes = frame->getValue()->get<PVUByteArray>()->view();
+    testOk1(bytes[0] == 0 && bytes[6] == 0 && bytes[7] == 50 && bytes[11] == 250 && bytes[12] == 255);
+
+    frame = createShorts();
+    NTNDArrayConverter(pvByte).saturate().convert(*frame);
+    PVByteArray::const_svector signedBytes(frame->getValue()->get<PVByteArray>()->view());
+    testOk1(signedBytes[0] == -128 && signedBytes[4] == -100 && signedBytes[19] == 127);
+
+    // ushort to ubyte, long enough for the vector kernels
+    frame = createCounts(64, 8);
+    NTNDArrayConverter(pvUByte).saturate().convert(*frame);
+    bytes = frame->getValue()->get<PVUByteArray>()->view();
+    bool clamped = true;
+    for (size_t i = 0; i < bytes.size(); ++i)
+        clamped = clamped && bytes[i] == (i < 255 ? i : 255);
+    testOk1(clamped);
+
+    frame = createCounts(64, 8);
+    NTNDArrayConverter(pvUByte).convert(*frame);
+    bytes = frame->getValue()->get<PVUByteArray>()->view();
+    bool wrapped = true;
+    for (size_t i = 0; i < bytes.size(); ++i)
+        wrapped = wrapped && bytes[i] == (i & 255);
+    testOk1(wrapped);
+}
+
+void test_threads()
+{
+    testDiag("test_threads");
+
+    // the result does not depend on the number of threads
+    NTNDArrayPtr single = createCounts(1024, 1024);
+    NTNDArrayPtr multi = createCounts(1024, 1024);
+    NTNDArrayConverter(pvFloat).scale(0.25, 1.0).threads(1).convert(*single);
+    NTNDArrayConverter(pvFloat).scale(0.25, 1.0).threads(8).convert(*multi);
+    testOk1(*single->getValue() == *multi->getValue());
+
+    NTNDArrayConverter(pvUByte).scale(0.0625).threads(1).convert(*single);
+    NTNDArrayConverter(pvUByte).scale(0.0625).threads(8).convert(*multi);
+    testOk1(*single->getValue() == *multi->getValue());
+    PVUByteArray::const_svector bytes(multi->getValue()->get<PVUByteArray>()->view());
+    testOk1(bytes.size() == 1024*1024 && bytes[4095] == 64 && bytes[1024*1024 - 1] == 64);
+}
+
+void test_errors()
+{
+    testDiag("test_errors");
+
+    try {
+        NTNDArrayConverter converter(pvString);
+        testFail("conversion to strings accepted");
+    } catch (std::runtime_error &) {
+        testPass("conversion to strings rejected");
+    }
+
+    NTNDArrayPtr empty = NTNDArray::createBuilder()->create();
+    try {
+        NTNDArrayConverter(pvFloat).convert(*empty);
+        testFail("NTNDArray without value converted");
+    } catch (std::runtime_error &) {
+        testPass("NTNDArray without value rejected");
+    }
+
+    NTNDArrayPtr frame = createCounts(640, 480);
+    NTNDArrayCodec::compress(*frame, "nt-lz4");
+    try {
+        NTNDArrayConverter(pvFloat).convert(*frame);
+        testFail("compressed value converted");
+    } catch (std::runtime_error &) {
+        testPass("compressed value rejected");
+    }
+    testOk1(frame->getValue()->getSelectedFieldName() == "ushortValue");
+}
+
+MAIN(testNTNDArrayConverter) {
+    testPlan(31);
+    test_convert();
+    test_scale();
+    test_saturate();
+    test_threads();
+    test_errors();
+    return testDone();
+}
@@ -0,0 +1,272 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <stdexcept>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+#include <epicsThread.h>
+
+#include <pv/nt.h>
+#include <pv/ntndarrayPool.h>
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+static PVDataCreatePtr pvDataCreate = getPVDataCreate();
+
+static StructureConstPtr createStructure()
+{
+    return NTNDArray::createBuilder()->addTimeStamp()->addDescriptor()->createStructure();
+}
+
+void test_create()
+{
+    testDiag("test_create");
+
+    NTNDArrayPoolPtr pool = NTNDArrayPool::create(createStructure());
+    testOk1(pool->getCapacity() == NTNDArrayPool::DEFAULT_CAPACITY);
+    testOk1(pool->getStructure() == createStructure());
+    testOk1(pool->size() == 0);
+
+    try {
+        NTNDArrayPool::create(NTScalar::createBuilder()->value(pvInt)->createStructure());
+        testFail("incompatible structure accepted");
+    } catch (std::runtime_error &) {
+        testPass("incompatible structure rejected");
+    }
+}
+
+void test_recycle()
+{
+    testDiag("test_recycle");
+
+    NTNDArrayPoolPtr pool = NTNDArrayPool::create(createStructure());
+
+    NTNDArrayPtr a = pool->get();
+    testOk1(a->getPVStructure()->getStructure() == pool->getStructure());
+    testOk1(pool->getMisses() == 1 && pool->getHits() == 0);
+    PVStructure * tree = a->getPVStructure().get();
+
+    a.reset();
+    testOk1(pool->size() == 1);
+
+    NTNDArrayPtr b = pool->get();
+    testOk1(b->getPVStructure().get() == tree);
+    testOk1(pool->getMisses() == 1 && pool->getHits() == 1);
+    testOk1(pool->size() == 0);
+
+    // the instance returns once all its references are released
+    NTNDArrayPtr c = b;
+    b.reset();
+    testOk1(pool->size() == 0);
+    c.reset();
+    testOk1(pool->size() == 1);
+
+    // a reference to its PVStructure keeps it out of the pool as well
+    NTNDArrayPtr d = pool->get();
+    PVStructurePtr pvStructure = d->getPVStructure();
+    d.reset();
+    testOk1(pool->size() == 0);
+    testOk1(NTNDArray::wrap(pvStructure).get() != 0);
+    pvStructure.reset();
+    testOk1(pool->size() == 1);
+
+    pool->resetCounters();
+    testOk1(pool->getMisses() == 0 && pool->getHits() == 0);
+    pool->clear();
+    testOk1(pool->size() == 0);
+    pool->get();
+    testOk1(pool->getMisses() == 1);
+}
+
+void test_reset()
+{
+    testDiag("test_reset");
+
+    NTNDArrayPoolPtr pool = NTNDArrayPool::create(createStructure());
+
+    NTNDArrayPtr a = pool->get();
+    a->getUniqueId()->put(42);
+    a->getCompressedDataSize()->put(100);
+    a->getDescriptor()->put("frame");
+    a->getTimeStamp()->getSubFieldT<PVLong>("secondsPastEpoch")->put(1000);
+    a->getCodec()->getSubFieldT<PVString>("name")->put("lz4");
+
+    PVUByteArray::svector data(100, 7);
+    PVUByteArrayPtr value = a->getValue()->select<PVUByteArray>("ubyteValue");
+    value->replace(freeze(data));
+
+    PVStructureArrayPtr attributes = a->getAttribute();
+    PVStructureArray::svector elements(1);
+    elements[0] = pvDataCreate->createPVStructure(
+        attributes->getStructureArray()->getStructure());
+    elements[0]->getSubFieldT<PVString>("name")->put("gain");
+    attributes->replace(freeze(elements));
+
+    a.reset();
+    a = pool->get();
+    testOk1(a->getUniqueId()->get() == 0);
+    testOk1(a->getCompressedDataSize()->get() == 0);
+    testOk1(a->getDescriptor()->get().empty());
+    testOk1(a->getTimeStamp()->getSubFieldT<PVLong>("secondsPastEpoch")->get() == 0);
+    testOk1(a->getCodec()->getSubFieldT<PVString>("name")->get().empty());
+
+    // the selected array is kept, its data released
+    testOk1(a->getValue()->getSelectedFieldName() == "ubyteValue");
+    testOk1(a->getValue()->get<PVUByteArray>() == value);
+    testOk1(value->getLength() == 0);
+
+    // the attributes are kept
+    PVStructureArray::const_svector kept(a->getAttribute()->view());
+    testOk1(kept.size() == 1 && kept[0] == elements[0]);
+    testOk1(a->getAttribute()->view()[0]->getSubFieldT<PVString>("name")->get() == "gain");
+}
+
+void test_shape()
+{
+    testDiag("test_shape");
+
+    NTNDArrayPoolPtr pool = NTNDArrayPool::create(createStructure());
+
+    std::vector<int32> shape(2);
+    shape[0] = 640;
+    shape[1] = 480;
+
+    NTNDArrayPtr a = pool->get(shape);
+    PVStructureArray::const_svector dims(a->getDimension()->view());
+    testOk1(dims.size() == 2);
+    testOk1(dims[0]->getSubFieldT<PVInt>("size")->get() == 640);
+    testOk1(dims[1]->getSubFieldT<PVInt>("fullSize")->get() == 480);
+    testOk1(dims[1]->getSubFieldT<PVInt>("binning")->get() == 1);
+
+    // the same number of dimensions, the old elements left unchanged
+    a.reset();
+    shape[0] = 320;
+    a = pool->get(shape);
+    PVStructureArray::const_svector again(a->getDimension()->view());
+    testOk1(again.size() == 2 && again[0] != dims[0]);
+    testOk1(again[0]->getSubFieldT<PVInt>("size")->get() == 320);
+    testOk1(dims[0]->getSubFieldT<PVInt>("size")->get() == 640);
+
+    // another number of dimensions
+    a.reset();
+    shape.push_back(3);
+    a = pool->get(shape);
+    testOk1(a->getDimension()->view().size() == 3);
+    testOk1(a->getDimension()->view()[2]->getSubFieldT<PVInt>("size")->get() == 3);
+
+    // no dimensions
+    a.reset();
+    a = pool->get(std::vector<int32>());
+    testOk1(a->getDimension()->view().size() == 0);
+}
+
+void test_capacity()
+{
+    testDiag("test_capacity");
+
+    NTNDArrayPoolPtr pool = NTNDArrayPool::create(createStructure(), 2);
+    testOk1(pool->getCapacity() == 2);
+
+    std::vector<NTNDArrayPtr> held;
+    for (int i = 0; i < 3; ++i)
+        held.push_back(pool->get());
+    held.clear();
+    testOk1(pool->size() == 2);
+    testOk1(pool->getDiscarded() == 1);
+
+    // instances outliving their pool are freed
+    NTNDArrayPtr a = pool->get();
+    pool.reset();
+    a->getUniqueId()->put(1);
+    a.reset();
+    testPass("instance released after its pool");
+}
+
+class Producer : public epicsThreadRunable
+{
+public:
+    Producer(NTNDArrayPoolPtr const & pool, int count, bool release)
+    : pool(pool), count(count), release(release) {}
+
+    virtual void run()
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            NTNDArrayPtr instance = pool->get();
+            instance->getUniqueId()->put(i);
+            if (!release)
+                held.push_back(instance);
+        }
+    }
+
+    NTNDArrayPoolPtr pool;
+    int count;
+    bool release;
+    std::vector<NTNDArrayPtr> held;
+};
+
+void run(std::vector<Producer *> const & producers)
+{
+    std::vector<epicsThread *> threads;
+    for (size_t i = 0; i < producers.size(); ++i)
+    {
+        threads.push_back(new epicsThread(*producers[i], "ntndarrayPoolTest",
+            epicsThreadGetStackSize(epicsThreadStackSmall)));
+        threads.back()->start();
+    }
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        threads[i]->exitWait();
+        delete threads[i];
+    }
+}
+
+void test_threads()
+{
+    testDiag("test_threads");
+
+    NTNDArrayPoolPtr pool = NTNDArrayPool::create(createStructure(), 16);
+
+    // created by one thread, released by another
+    std::vector<Producer *> producers(1, new Producer(pool, 10, false));
+    run(producers);
+    testOk1(pool->getMisses() == 10);
+    producers[0]->held.clear();
+    testOk1(pool->size() == 10);
+
+    // and taken by a third one
+    Producer taker(pool, 10, false);
+    run(std::vector<Producer *>(1, &taker));
+    testOk1(pool->getHits() == 10 && pool->getMisses() == 10);
+    testOk1(pool->size() == 0);
+    taker.held.clear();
+    delete producers[0];
+
+    // concurrently
+    pool->resetCounters();
+    producers.clear();
+    for (int i = 0; i < 4; ++i)
+        producers.push_back(new Producer(pool, 1000, true));
+    run(producers);
+    testOk1(pool->getHits() + pool->getMisses() == 4000);
+    testOk1(pool->getMisses() <= 4 + 10);
+    testOk1(pool->size() <= pool->getCapacity());
+    for (size_t i = 0; i < producers.size(); ++i)
+        delete producers[i];
+}
+
+MAIN(testNTNDArrayPool) {
+    testPlan(49);
+    test_create();
+    test_recycle();
+    test_reset();
+    test_shape();
+    test_capacity();
+    test_threads();
+    return testDone();
+}
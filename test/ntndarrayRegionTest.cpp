@@ -0,0 +1,352 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <stdexcept>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/nt.h>
+#include <pv/ntndarrayCodec.h>
+#include <pv/ntndarrayRegion.h>
+#include <pv/ntndarrayView.h>
+
+#include "ntndarrayTestFrame.h"
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+static NTNDArrayBuilderPtr builder = NTNDArray::createBuilder();
+
+// element (x, y) is x + 100 * y
+static NTNDArrayPtr createImage(int32 width, int32 height)
+{
+    PVUShortArray::svector data(width * height);
+    for (int32 y = 0; y < height; ++y)
+        for (int32 x = 0; x < width; ++x)
+            data[x + width * y] = static_cast<uint16>(x + 100 * y);
+    std::vector<int32> shape;
+    shape.push_back(width);
+    shape.push_back(height);
+    return createFrame<PVUShortArray>("ushortValue", data, shape);
+}
+
+static NTNDArrayDimension region(int32 offset, int32 size, int32 binning = 1, bool reverse = false)
+{
+    NTNDArrayDimension dimension(size);
+    dimension.offset = offset;
+    dimension.binning = binning;
+    dimension.reverse = reverse;
+    return dimension;
+}
+
+void test_dimensions()
+{
+    testDiag("test_dimensions");
+
+    // a source which is already a binned, reversed region of a detector
+    std::vector<NTNDArrayDimension> source(2, NTNDArrayDimension(100));
+    source[0].offset = 10;
+    source[0].fullSize = 1000;
+    source[0].binning = 2;
+    source[0].reverse = true;
+    source[1].fullSize = 100;
+
+    std::vector<NTNDArrayDimension> regions;
+    regions.push_back(region(20, 31, 3));
+    NTNDArrayRegion roi(regions);
+    std::vector<NTNDArrayDimension> result;
+    roi.getResultDimensions(source, result);
+
+    testOk1(result.size() == 2);
+    // 10 elements binned by 3, the last element dropped, 50 source elements after them
+    testOk1(result[0].size == 10 && result[0].binning == 6 && result[0].fullSize == 1000);
+    testOk1(result[0].offset == 10 + 50 * 2 && result[0].reverse);
+    testOk1(result[1] == source[1]);
+
+    // the first element of the result bins the source elements 20 to 22,
+    // 22 being the first in the full frame
+    testOk1(result[0].getFullIndex(0) == source[0].getFullIndex(22));
+
+    regions[0] = region(90, 0, 1, true);
+    NTNDArrayRegion(regions).getResultDimensions(source, result);
+    testOk1(result[0].size == 10 && !result[0].reverse && result[0].offset == 10);
+}
+
+void test_copy()
+{
+    testDiag("test_copy");
+
+    NTNDArrayPtr frame = createImage(8, 6);
+    frame->getUniqueId()->put(42);
+    NTNDArrayPtr roi = builder->create();
+
+    std::vector<NTNDArrayDimension> regions;
+    regions.push_back(region(2, 4));
+    regions.push_back(region(1, 3));
+    NTNDArrayRegion(regions).extract(*frame, *roi);
+
+    NTNDArrayView<uint16> view(*roi);
+    testOk1(view.getSize(0) == 4 && view.getSize(1) == 3);
+    testOk1(view(0, 0) == 102 && view(3, 0) == 105 && view(0, 2) == 302 && view(3, 2) == 305);
+    testOk1(roi->getCompressedDataSize()->get() == 4*3*2);
+    testOk1(roi->getUncompressedDataSize()->get() == 4*3*2);
+    testOk1(roi->getUniqueId()->get() == 42);
+    testOk1(roi->isValid());
+    testOk1(view.getDimension(0).offset == 2 && view.getDimension(1).offset == 1);
+
+    // the whole frame
+    NTNDArrayRegion().extract(*frame, *roi);
+    testOk1(*roi->getValue() == *frame->getValue());
+}
+
+void test_reverse()
+{
+    testDiag("test_reverse");
+
+    NTNDArrayPtr frame = createImage(8, 6);
+    NTNDArrayPtr roi = builder->create();
+
+    std::vector<NTNDArrayDimension> regions;
+    regions.push_back(region(1, 3, 1, true));
+    regions.push_back(region(0, 0, 1, true));
+    NTNDArrayRegion(regions).extract(*frame, *roi);
+
+    NTNDArrayView<uint16> view(*roi);
+    testOk1(view.getSize(0) == 3 && view.getSize(1) == 6);
+    testOk1(view(0, 0) == 503 && view(2, 0) == 501 && view(0, 5) == 3);
+    testOk1(view.getDimension(0).reverse && view.getDimension(1).reverse);
+
+    // in place
+    regions.resize(1);
+    regions[0] = region(0, 0, 1, true);
+    NTNDArrayRegion(regions).extract(*frame, *frame);
+    NTNDArrayView<uint16> flipped(*frame);
+    testOk1(flipped(0, 0) == 7 && flipped(7, 5) == 500);
+}
+
+void test_binning()
+{
+    testDiag("test_binning");
+
+    NTNDArrayPtr frame = createImage(8, 6);
+    NTNDArrayPtr roi = builder->create();
+
+    std::vector<NTNDArrayDimension> regions;
+    regions.push_back(region(0, 0, 2));
+    regions.push_back(region(0, 0, 3));
+    NTNDArrayRegion(regions).extract(*frame, *roi);
+    NTNDArrayView<uint16> sums(*roi);
+    testOk1(sums.getSize(0) == 4 && sums.getSize(1) == 2);
+    // (0 + 1) * 3 + (0 + 100 + 200) * 2
+    testOk1(sums(0, 0) == 603);
+    testOk1(sums(3, 1) == (6 + 7) * 3 + (300 + 400 + 500) * 2);
+    testOk1(sums.getDimension(0).binning == 2 && sums.getDimension(1).binning == 3);
+
+    NTNDArrayRegion(regions).average().extract(*frame, *roi);
+    NTNDArrayView<uint16> averages(*roi);
+    // 100.5 rounded up
+    testOk1(averages(0, 0) == 101 && averages(3, 1) == 407);
+
+    // the sums are clamped
+    PVUByteArray::svector bytes(16, 200);
+    std::vector<int32> shape(1, 16);
+    frame = createFrame<PVUByteArray>("ubyteValue", bytes, shape);
+    regions.resize(1);
+    regions[0] = region(0, 0, 4);
+    NTNDArrayRegion(regions).extract(*frame, *roi);
+    PVUByteArray::const_svector clamped(roi->getValue()->get<PVUByteArray>()->view());
+    testOk1(clamped.size() == 4 && clamped[0] == 255 && clamped[3] == 255);
+
+    // signed averages round halves away from zero
+    PVShortArray::svector shorts(4);
+    shorts[0] = -3;
+    shorts[1] = 0;
+    shorts[2] = 3;
+    shorts[3] = 4;
+    shape[0] = 4;
+    frame = createFrame<PVShortArray>("shortValue", shorts, shape);
+    regions[0] = region(0, 0, 2);
+    NTNDArrayRegion(regions).average().extract(*frame, *roi);
+    PVShortArray::const_svector rounded(roi->getValue()->get<PVShortArray>()->view());
+    testOk1(rounded.size() == 2 && rounded[0] == -2 && rounded[1] == 4);
+
+    // binnings which are not a power of 2
+    regions[0] = region(0, 3, 3);
+    NTNDArrayRegion(regions).average().extract(*frame, *roi);
+    rounded = roi->getValue()->get<PVShortArray>()->view();
+    testOk1(rounded.size() == 1 && rounded[0] == 0);
+}
+
+void test_types()
+{
+    testDiag("test_types");
+
+    NTNDArrayPtr roi = builder->create();
+    std::vector<NTNDArrayDimension> regions;
+
+    // 3-D
+    PVFloatArray::svector floats(4*4*4);
+    for (size_t i = 0; i < floats.size(); ++i)
+        floats[i] = static_cast<float>(i);
+    std::vector<int32> shape(3, 4);
+    NTNDArrayPtr frame = createFrame<PVFloatArray>("floatValue", floats, shape);
+    regions.push_back(region(0, 0, 2));
+    regions.push_back(region(0, 0, 2));
+    regions.push_back(region(2, 2, 2, true));
+    NTNDArrayRegion(regions).average().extract(*frame, *roi);
+    NTNDArrayView<float> cube(*roi);
+    testOk1(cube.getRank() == 3 && cube.getSize(2) == 1);
+    // the mean of 32, 33, 36, 37, 48, 49, 52 and 53
+    testOk1(cube(0, 0, 0) == 42.5f);
+    testOk1(roi->getUncompressedDataSize()->get() == 2*2*1*4);
+
+    // booleans are or-ed
+    PVBooleanArray::svector booleans(6, false);
+    booleans[4] = true;
+    shape.resize(1);
+    shape[0] = 6;
+    frame = createFrame<PVBooleanArray>("booleanValue", booleans, shape);
+    regions.resize(1);
+    regions[0] = region(0, 0, 3);
+    NTNDArrayRegion(regions).extract(*frame, *roi);
+    PVBooleanArray::const_svector ored(roi->getValue()->get<PVBooleanArray>()->view());
+    testOk1(ored.size() == 2 && !ored[0] && ored[1]);
+
+    // empty
+    regions[0] = region(6, 0);
+    NTNDArrayRegion(regions).extract(*frame, *roi);
+    testOk1(roi->getValue()->get<PVBooleanArray>()->getLength() == 0);
+}
+
+void test_threads()
+{
+    testDiag("test_threads");
+
+    NTNDArrayPtr frame = createImage(1000, 1000);
+    NTNDArrayPtr single = builder->create();
+    NTNDArrayPtr multi = builder->create();
+
+    // the result does not depend on the number of threads
+    std::vector<NTNDArrayDimension> regions;
+    regions.push_back(region(1, 998, 3, true));
+    regions.push_back(region(3, 990, 2));
+    NTNDArrayRegion(regions).average().threads(1).extract(*frame, *single);
+    NTNDArrayRegion(regions).average().threads(8).extract(*frame, *multi);
+    testOk1(*single->getValue() == *multi->getValue());
+    NTNDArrayView<uint16> view(*multi);
+    testOk1(view.getSize(0) == 332 && view.getSize(1) == 495);
+    // the last bin of row 0 reversed, elements 1 to 3 of rows 3 and 4
+    testOk1(view(331, 0) == 352);
+}
+
+// counts the allocations
+class CountingAllocator : public NTNDArrayAllocator
+{
+public:
+    CountingAllocator() : count(0) {}
+
+    virtual std::tr1::shared_ptr<void> allocate(size_t size)
+    {
+        ++count;
+        return std::tr1::shared_ptr<void>(new double[(size + 7) / 8], Deleter());
+    }
+
+    struct Deleter
+    {
+        void operator()(void * p) { delete[] static_cast<double *>(p); }
+    };
+
+    size_t count;
+};
+
+void test_allocator()
+{
+    testDiag("test_allocator");
+
+    NTNDArrayPtr frame = createImage(64, 64);
+    NTNDArrayPtr roi = builder->create();
+    std::vector<NTNDArrayDimension> regions(1, region(0, 0, 2));
+
+    std::tr1::shared_ptr<CountingAllocator> counting(new CountingAllocator());
+    NTNDArrayRegion(regions).allocator(counting).extract(*frame, *roi);
+    testOk1(counting->count == 1);
+    testOk1(roi->getValue()->get<PVUShortArray>()->getLength() == 32*64);
+
+    // the pool hands out the memory of a released value again
+    NTNDArrayRegion binned(regions);
+    binned.allocator(NTNDArrayAllocator::createPool());
+    binned.extract(*frame, *roi);
+    uint16 const * first = roi->getValue()->get<PVUShortArray>()->view().data();
+    roi->getValue()->get<PVUShortArray>()->replace(PVUShortArray::const_svector());
+    binned.extract(*frame, *roi);
+    testOk1(roi->getValue()->get<PVUShortArray>()->view().data() == first);
+
+    // the value is held while referenced
+    PVUShortArray::const_svector held(roi->getValue()->get<PVUShortArray>()->view());
+    binned.extract(*frame, *roi);
+    testOk1(roi->getValue()->get<PVUShortArray>()->view().data() != held.data());
+}
+
+void test_errors()
+{
+    testDiag("test_errors");
+
+    NTNDArrayPtr frame = createImage(8, 6);
+    NTNDArrayPtr roi = builder->create();
+
+    std::vector<NTNDArrayDimension> regions(1, region(4, 5));
+    try {
+        NTNDArrayRegion(regions).extract(*frame, *roi);
+        testFail("region outside of the frame extracted");
+    } catch (std::runtime_error &) {
+        testPass("region outside of the frame rejected");
+    }
+
+    regions[0] = region(0, 0, 0);
+    try {
+        NTNDArrayRegion(regions).extract(*frame, *roi);
+        testFail("binning 0 accepted");
+    } catch (std::runtime_error &) {
+        testPass("binning 0 rejected");
+    }
+
+    regions.assign(3, NTNDArrayDimension());
+    try {
+        NTNDArrayRegion(regions).extract(*frame, *roi);
+        testFail("region of rank 3 of a 2-D frame extracted");
+    } catch (std::runtime_error &) {
+        testPass("region of rank 3 of a 2-D frame rejected");
+    }
+
+    NTNDArrayCodec::compress(*frame, "nt-lz4");
+    try {
+        NTNDArrayRegion().extract(*frame, *roi);
+        testFail("compressed frame extracted");
+    } catch (std::runtime_error &) {
+        testPass("compressed frame rejected");
+    }
+
+    try {
+        NTNDArrayRegion().extract(*builder->create(), *roi);
+        testFail("NTNDArray without value extracted");
+    } catch (std::runtime_error &) {
+        testPass("NTNDArray without value rejected");
+    }
+}
+
+MAIN(testNTNDArrayRegion) {
+    testPlan(43);
+    test_dimensions();
+    test_copy();
+    test_reverse();
+    test_binning();
+    test_types();
+    test_threads();
+    test_allocator();
+    test_errors();
+    return testDone();
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+/*
+ * Throughput benchmark of NTNDArrayRing.
+ *
+ * A producer publishes 16-bit frames into a ring, which a consumer thread,
+ * with its own mapping of the ring as in another process, reads and
+ * releases. The frames are filled by the producer, then either copied
+ * into a slot by publish(), or filled in a slot allocated from the ring
+ * and published in place. Reports the frames and bytes per second
+ * received, and the frames lost by the consumer.
+ *
+ * Built with the tests, but not run by them. Usage:
+ *   ntndarrayRingBench [size [frames [slots]]]
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+#include <new>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <unistd.h>
+#endif
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+#include <epicsAtomic.h>
+#include <epicsThread.h>
+#include <epicsTypes.h>
+#include <epicsTime.h>
+
+#include <pv/nt.h>
+#include <pv/ntndarrayRing.h>
+#include <pv/ntndarrayView.h>
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+namespace {
+
+// unique per process, so that concurrent runs do not share the ring
+std::string createName()
+{
+    std::ostringstream name;
+    name << "/ntndarrayRingBench";
+#if defined(__unix__) || defined(__APPLE__)
+    name << '.' << getpid();
+#endif
+    return name.str();
+}
+
+const std::string NAME(createName());
+
+// seconds
+double elapsed(epicsUInt64 start)
+{
+    return (epicsMonotonicGet() - start) * 1e-9;
+}
+
+class Consumer : public epicsThreadRunable
+{
+public:
+    explicit Consumer(StructureConstPtr const & structure)
+    : ring(NTNDArrayRing::open(NAME, structure)),
+      frame(NTNDArray::wrapUnsafe(getPVDataCreate()->createPVStructure(structure))),
+      done(0), frames(0), bytes(0), checksum(0),
+      thread(*this, "ntndarrayRingBench", epicsThreadGetStackSize(epicsThreadStackSmall))
+    {
+        thread.start();
+    }
+
+    virtual void run()
+    {
+        while (!epics::atomic::get(done) || ring->getLag())
+        {
+            if (!ring->read(*frame, 0.1))
+                continue;
+            PVUShortArray::const_svector data(frame->getValue()->get<PVUShortArray>()->view());
+            ++frames;
+            bytes += data.size() * sizeof(uint16);
+            checksum += data.empty() ? 0 : data[data.size() - 1];
+        }
+        // releases the last slot
+        if (PVUShortArrayPtr value = frame->getValue()->get<PVUShortArray>())
+            value->replace(PVUShortArray::const_svector());
+    }
+
+    void finish()
+    {
+        epics::atomic::set(done, 1);
+        thread.exitWait();
+    }
+
+    NTNDArrayRingPtr ring;
+    NTNDArrayPtr frame;
+    int done;
+    size_t frames;
+    double bytes;
+    double checksum;
+    epicsThread thread;
+};
+
+NTNDArrayPtr createFrame(StructureConstPtr const & structure, size_t size)
+{
+    NTNDArrayPtr frame = NTNDArray::wrapUnsafe(getPVDataCreate()->createPVStructure(structure));
+    std::vector<NTNDArrayDimension> dimensions(2, NTNDArrayDimension(static_cast<int32>(size)));
+    NTNDArrayDimension::put(*frame, dimensions);
+    return frame;
+}
+
+void fill(PVUShortArray::svector & data, int32 id)
+{
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint16>(id + i);
+}
+
+void bench(StructureConstPtr const & structure, size_t size, size_t count,
+    size_t slots, bool inPlace)
+{
+    NTNDArrayRingPtr ring = NTNDArrayRing::create(NAME, structure, slots,
+        size * size * sizeof(uint16));
+    NTNDArrayAllocatorPtr allocator = ring->getAllocator();
+    Consumer consumer(structure);
+
+    NTNDArrayPtr frame = createFrame(structure, size);
+    PVUShortArrayPtr value = frame->getValue()->select<PVUShortArray>("ushortValue");
+    size_t full = 0;
+
+    epicsUInt64 start = epicsMonotonicGet();
+    for (size_t i = 0; i < count; ++i)
+    {
+        PVUShortArray::svector data;
+        if (inPlace) {
+            // waits for a free slot
+            for (;;) {
+                try {
+                    data = NTNDArrayAllocator::allocateArray<uint16>(allocator.get(), size * size);
+                    break;
+                } catch (std::bad_alloc &) {
+                    ++full;
+                    epicsThreadSleep(0.0);
+                }
+            }
+        } else {
+            data.resize(size * size);
+        }
+        fill(data, static_cast<int32>(i));
+        value->replace(freeze(data));
+        frame->getUniqueId()->put(static_cast<int32>(i));
+        while (!ring->publish(*frame)) {
+            ++full;
+            epicsThreadSleep(0.0);
+        }
+        // releases the slot of an allocated value
+        value->replace(PVUShortArray::const_svector());
+    }
+    consumer.finish();
+    double seconds = elapsed(start);
+
+    testOk(consumer.frames + consumer.ring->getLost() == count,
+        "%-8s %6.0f frames/s, %6.2f GB/s received, %u lost, %u waits",
+        inPlace ? "in place" : "copied", consumer.frames / seconds,
+        consumer.bytes / seconds * 1e-9, (unsigned)consumer.ring->getLost(), (unsigned)full);
+}
+
+}
+
+MAIN(ntndarrayRingBench)
+{
+    size_t size = 2048;
+    size_t count = 500;
+    size_t slots = 8;
+    if (argc > 1)
+        size = strtoul(argv[1], NULL, 0);
+    if (argc > 2)
+        count = strtoul(argv[2], NULL, 0);
+    if (argc > 3)
+        slots = strtoul(argv[3], NULL, 0);
+
+    testPlan(0);
+    if (!NTNDArrayRing::isSupported()) {
+        testDiag("NTNDArrayRing not supported on this platform");
+        return testDone();
+    }
+    testDiag("%u frames of %ux%u 16-bit elements, %u slots",
+        (unsigned)count, (unsigned)size, (unsigned)size, (unsigned)slots);
+
+    StructureConstPtr structure = NTNDArray::createBuilder()->addTimeStamp()->createStructure();
+    bench(structure, size, count, slots, false);
+    bench(structure, size, count, slots, true);
+
+    return testDone();
+}
@@ -0,0 +1,349 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <unistd.h>
+#endif
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/nt.h>
+#include <pv/ntndarrayRing.h>
+#include <pv/ntndarrayView.h>
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+static PVDataCreatePtr pvDataCreate = getPVDataCreate();
+static StructureConstPtr frameStructure = NTNDArray::createBuilder()->
+    addDescriptor()->addTimeStamp()->createStructure();
+
+// unique per process, so that concurrent runs do not share the ring
+static std::string createName()
+{
+    std::ostringstream name;
+    name << "/ntndarrayRingTest";
+#if defined(__unix__) || defined(__APPLE__)
+    name << '.' << getpid();
+#endif
+    return name.str();
+}
+
+static const std::string NAME(createName());
+
+static NTNDArrayPtr createFrame()
+{
+    return NTNDArray::wrapUnsafe(pvDataCreate->createPVStructure(frameStructure));
+}
+
+// a 10x10 frame of the elements id to id + 99
+static NTNDArrayPtr createFrame(int32 id)
+{
+    NTNDArrayPtr frame = createFrame();
+    PVUShortArray::svector data(100);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint16>(id + i);
+    frame->getValue()->select<PVUShortArray>("ushortValue")->replace(freeze(data));
+    NTNDArrayDimension::put(*frame, std::vector<NTNDArrayDimension>(2, NTNDArrayDimension(10)));
+    frame->getUniqueId()->put(id);
+    return frame;
+}
+
+static bool sameValue(NTNDArray const & a, NTNDArray const & b)
+{
+    PVUShortArrayPtr va = a.getValue()->get<PVUShortArray>();
+    PVUShortArrayPtr vb = b.getValue()->get<PVUShortArray>();
+    return va && vb && va->view().size() == vb->view().size() &&
+        std::equal(va->view().begin(), va->view().end(), vb->view().begin());
+}
+
+void test_publish()
+{
+    testDiag("test_publish");
+
+    NTNDArrayRingPtr producer = NTNDArrayRing::create(NAME, frameStructure, 4, 200, 4096);
+    NTNDArrayRingPtr consumer = NTNDArrayRing::open(NAME, frameStructure);
+    testOk1(producer->isProducer() && !consumer->isProducer());
+    testOk1(consumer->getSlots() == 4 && consumer->getPayloadSize() == 200 &&
+            consumer->getMetadataSize() == 4096);
+
+    NTNDArrayPtr received = createFrame();
+    testOk1(!consumer->read(*received));
+    testOk1(!consumer->read(*received, 0.01));
+
+    NTNDArrayPtr frame = createFrame(7);
+    frame->getDataTimeStamp()->getSubFieldT<PVLong>("secondsPastEpoch")->put(1234);
+    frame->getTimeStamp()->getSubFieldT<PVInt>("nanoseconds")->put(5678);
+    frame->getCodec()->getSubFieldT<PVString>("name")->put("test");
+    frame->getCompressedDataSize()->put(200);
+
+    PVStructureArrayPtr attributes = frame->getAttribute();
+    PVStructureArray::svector elements(1);
+    elements[0] = pvDataCreate->createPVStructure(
+        attributes->getStructureArray()->getStructure());
+    elements[0]->getSubFieldT<PVString>("name")->put("gain");
+    PVDoublePtr gain = pvDataCreate->createPVScalar<PVDouble>();
+    gain->put(2.5);
+    elements[0]->getSubFieldT<PVUnion>("value")->set(gain);
+    attributes->replace(freeze(elements));
+
+    testOk1(producer->publish(*frame));
+    testOk1(producer->getPublished() == 1 && consumer->getLag() == 1);
+
+    testOk1(consumer->read(*received));
+    testOk1(sameValue(*received, *frame));
+    // in the shared memory
+    testOk1(received->getValue()->get<PVUShortArray>()->view().data() !=
+            frame->getValue()->get<PVUShortArray>()->view().data());
+
+    std::vector<NTNDArrayDimension> dimensions;
+    NTNDArrayDimension::get(*received, dimensions);
+    testOk1(dimensions.size() == 2 && dimensions[1] == NTNDArrayDimension(10));
+    testOk1(received->getUniqueId()->get() == 7);
+    testOk1(received->getDataTimeStamp()->getSubFieldT<PVLong>("secondsPastEpoch")->get() == 1234);
+    testOk1(received->getTimeStamp()->getSubFieldT<PVInt>("nanoseconds")->get() == 5678);
+    testOk1(received->getCodec()->getSubFieldT<PVString>("name")->get() == "test");
+    testOk1(received->getCompressedDataSize()->get() == 200);
+
+    PVStructureArray::const_svector read(received->getAttribute()->view());
+    testOk1(read.size() == 1 && read[0]->getSubFieldT<PVString>("name")->get() == "gain");
+    PVDoublePtr readGain = read.size() == 1 ?
+        read[0]->getSubFieldT<PVUnion>("value")->get<PVDouble>() : PVDoublePtr();
+    testOk1(readGain && readGain->get() == 2.5);
+
+    testOk1(!consumer->read(*received));
+    testOk1(consumer->getLag() == 0 && consumer->getLost() == 0);
+
+    // other element types
+    PVDoubleArray::svector doubles(25, 0.5);
+    frame->getValue()->select<PVDoubleArray>("doubleValue")->replace(freeze(doubles));
+    testOk1(producer->publish(*frame) && consumer->read(*received));
+    PVDoubleArrayPtr readDoubles = received->getValue()->get<PVDoubleArray>();
+    testOk1(readDoubles && readDoubles->getLength() == 25 && readDoubles->view()[24] == 0.5);
+
+    // the values read outlive the ring
+    producer.reset();
+    consumer.reset();
+    testOk1(readDoubles->view()[0] == 0.5);
+    try {
+        NTNDArrayRing::open(NAME, frameStructure);
+        testFail("removed ring opened");
+    } catch (std::runtime_error &) {
+        testPass("removed ring not opened");
+    }
+}
+
+void test_allocator()
+{
+    testDiag("test_allocator");
+
+    NTNDArrayRingPtr producer = NTNDArrayRing::create(NAME, frameStructure, 2, 200, 4096);
+    NTNDArrayRingPtr consumer = NTNDArrayRing::open(NAME, frameStructure);
+    NTNDArrayAllocatorPtr allocator = producer->getAllocator();
+
+    // a value in each slot
+    NTNDArrayPtr frames[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        PVUShortArray::svector data(NTNDArrayAllocator::allocateArray<uint16>(allocator.get(), 100));
+        std::fill(data.begin(), data.end(), static_cast<uint16>(i + 1));
+        frames[i] = createFrame(i);
+        frames[i]->getValue()->select<PVUShortArray>("ushortValue")->replace(freeze(data));
+    }
+
+    try {
+        allocator->allocate(100);
+        testFail("allocated without a free slot");
+    } catch (std::bad_alloc &) {
+        testPass("no allocation without a free slot");
+    }
+    testOk1(!producer->publish(*createFrame(2)));
+
+    // the allocated values are published in place
+    testOk1(producer->publish(*frames[1]));
+    testOk1(producer->publish(*frames[0]));
+
+    NTNDArrayPtr received = createFrame();
+    testOk1(consumer->read(*received) && received->getUniqueId()->get() == 1);
+    testOk1(sameValue(*received, *frames[1]));
+    testOk1(consumer->read(*received) && sameValue(*received, *frames[0]));
+
+    // a slot is free once the producer and the consumers release its value
+    testOk1(!producer->publish(*createFrame(2)));
+    frames[0].reset();
+    frames[1].reset();
+    testOk1(producer->publish(*createFrame(2)));
+
+    try {
+        allocator->allocate(201);
+        testFail("allocated more than the payload size");
+    } catch (std::bad_alloc &) {
+        testPass("no allocation of more than the payload size");
+    }
+
+    // a value allocated and released is not published
+    allocator->allocate(200);
+    testOk1(producer->publish(*createFrame(3)) && producer->getPublished() == 4);
+}
+
+void test_references()
+{
+    testDiag("test_references");
+
+    NTNDArrayRingPtr producer = NTNDArrayRing::create(NAME, frameStructure, 2, 200, 4096);
+    NTNDArrayRingPtr consumer = NTNDArrayRing::open(NAME, frameStructure);
+
+    NTNDArrayPtr first = createFrame();
+    NTNDArrayPtr second = createFrame();
+    testOk1(producer->publish(*createFrame(1)) && producer->publish(*createFrame(2)));
+    testOk1(consumer->read(*first) && consumer->read(*second));
+
+    // the consumer holds both slots
+    testOk1(!producer->publish(*createFrame(3)));
+
+    first.reset();
+    testOk1(producer->publish(*createFrame(3)));
+    testOk1(sameValue(*second, *createFrame(2)));
+
+    // a frame read replaces the value, releasing the previous slot
+    testOk1(consumer->read(*second) && second->getUniqueId()->get() == 3);
+    testOk1(producer->publish(*createFrame(4)));
+    testOk1(consumer->getLost() == 0);
+}
+
+void test_lag()
+{
+    testDiag("test_lag");
+
+    NTNDArrayRingPtr producer = NTNDArrayRing::create(NAME, frameStructure, 4, 200, 4096);
+    NTNDArrayRingPtr consumer = NTNDArrayRing::open(NAME, frameStructure);
+
+    for (int32 i = 0; i < 10; ++i)
+        producer->publish(*createFrame(i));
+    testOk1(consumer->getLag() == 10);
+
+    // the slots of the first 6 frames were reused
+    NTNDArrayPtr received = createFrame();
+    testOk1(consumer->read(*received) && received->getUniqueId()->get() == 6);
+    testOk1(consumer->getLost() == 6 && consumer->getLag() == 3);
+    testOk1(sameValue(*received, *createFrame(6)));
+
+    int32 last = 6;
+    while (consumer->read(*received))
+        last = received->getUniqueId()->get();
+    testOk1(last == 9 && consumer->getLost() == 6);
+
+    // a consumer opened later reads the frames published since
+    NTNDArrayRingPtr late = NTNDArrayRing::open(NAME, frameStructure);
+    testOk1(!late->read(*received));
+    producer->publish(*createFrame(10));
+    testOk1(late->read(*received) && received->getUniqueId()->get() == 10);
+}
+
+void test_errors()
+{
+    testDiag("test_errors");
+
+    try {
+        NTNDArrayRing::open("/ntndarrayRingMissing", frameStructure);
+        testFail("missing ring opened");
+    } catch (std::runtime_error &) {
+        testPass("missing ring not opened");
+    }
+
+    try {
+        NTNDArrayRing::create("ntndarrayRingTest", frameStructure, 4, 200);
+        testFail("name without / accepted");
+    } catch (std::runtime_error &) {
+        testPass("name without / rejected");
+    }
+
+    try {
+        NTNDArrayRing::create(NAME, frameStructure, 0, 200);
+        testFail("ring without slot created");
+    } catch (std::runtime_error &) {
+        testPass("ring without slot rejected");
+    }
+
+    NTNDArrayRingPtr producer = NTNDArrayRing::create(NAME, frameStructure, 2, 100, 256);
+    try {
+        NTNDArrayRing::open(NAME, NTNDArray::createBuilder()->createStructure());
+        testFail("ring of another structure opened");
+    } catch (std::runtime_error &) {
+        testPass("ring of another structure not opened");
+    }
+
+    NTNDArrayRingPtr consumer = NTNDArrayRing::open(NAME, frameStructure);
+    try {
+        producer->publish(*createFrame(1));
+        testFail("value larger than the payload size published");
+    } catch (std::runtime_error &) {
+        testPass("value larger than the payload size rejected");
+    }
+
+    NTNDArrayPtr frame = createFrame(1);
+    PVUByteArray::svector bytes(100);
+    frame->getValue()->select<PVUByteArray>("ubyteValue")->replace(freeze(bytes));
+    frame->getDescriptor()->put(std::string(300, 'x'));
+    try {
+        producer->publish(*frame);
+        testFail("fields larger than the metadata size published");
+    } catch (std::runtime_error &) {
+        testPass("fields larger than the metadata size rejected");
+    }
+
+    try {
+        producer->publish(*NTNDArray::wrapUnsafe(pvDataCreate->createPVStructure(frameStructure)));
+        testFail("frame without value published");
+    } catch (std::runtime_error &) {
+        testPass("frame without value rejected");
+    }
+
+    try {
+        producer->publish(*NTNDArray::createBuilder()->create());
+        testFail("frame of another structure published");
+    } catch (std::runtime_error &) {
+        testPass("frame of another structure rejected");
+    }
+
+    try {
+        consumer->publish(*frame);
+        testFail("consumer published");
+    } catch (std::runtime_error &) {
+        testPass("consumer cannot publish");
+    }
+
+    try {
+        producer->read(*frame);
+        testFail("producer read");
+    } catch (std::runtime_error &) {
+        testPass("producer cannot read");
+    }
+
+    // the slot of a rejected frame is reused
+    frame->getDescriptor()->put("");
+    testOk1(producer->publish(*frame) && producer->publish(*frame) && producer->publish(*frame));
+    testOk1(consumer->getLag() == 3);
+}
+
+MAIN(testNTNDArrayRing) {
+    testPlan(61);
+    if (!NTNDArrayRing::isSupported()) {
+        testSkip(61, "NTNDArrayRing not supported on this platform");
+        return testDone();
+    }
+    test_publish();
+    test_allocator();
+    test_references();
+    test_lag();
+    test_errors();
+    return testDone();
+}
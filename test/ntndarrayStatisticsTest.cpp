@@ -0,0 +1,289 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/nt.h>
+#include <pv/ntndarrayCodec.h>
+#include <pv/ntndarrayStatistics.h>
+#include <pv/ntndarrayView.h>
+
+#include "ntndarrayTestFrame.h"
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+static NTNDArrayBuilderPtr builder = NTNDArray::createBuilder();
+
+// the elements 1 to 12
+template<typename PVT>
+static NTNDArrayPtr createCounting(std::string const & field)
+{
+    typename PVT::svector data(12);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<typename PVT::value_type>(i + 1);
+    return createFrame<PVT>(field, data);
+}
+
+static bool near(double a, double b)
+{
+    return std::fabs(a - b) <= 1e-9 * std::max(1.0, std::fabs(b));
+}
+
+static bool operator==(NTNDArrayStatistics::Summary const & a, NTNDArrayStatistics::Summary const & b)
+{
+    return a.count == b.count && a.total == b.total && a.mean == b.mean &&
+        a.sigma == b.sigma && a.min == b.min && a.max == b.max &&
+        a.first == b.first && a.last == b.last && a.histogram == b.histogram &&
+        a.underflow == b.underflow && a.overflow == b.overflow;
+}
+
+void test_summary()
+{
+    testDiag("test_summary");
+
+    NTNDArrayStatistics::Summary summary;
+    NTNDArrayStatistics statistics;
+    statistics.compute(*createCounting<PVUShortArray>("ushortValue"), summary);
+    testOk1(summary.count == 12 && summary.total == 78.0 && summary.mean == 6.5);
+    testOk1(near(summary.sigma, std::sqrt(143.0 / 12)));
+    testOk1(summary.min == 1.0 && summary.max == 12.0);
+    testOk1(summary.first == 1.0 && summary.last == 12.0);
+    testOk1(summary.histogram.empty() && summary.underflow == 0 && summary.overflow == 0);
+
+    NTNDArrayStatistics::Summary other;
+    statistics.compute(*createCounting<PVDoubleArray>("doubleValue"), other);
+    testOk1(other == summary);
+    statistics.compute(*createCounting<PVIntArray>("intValue"), other);
+    testOk1(other == summary);
+
+    PVByteArray::svector bytes(3);
+    bytes[0] = -128;
+    bytes[1] = 127;
+    bytes[2] = -2;
+    statistics.compute(*createFrame<PVByteArray>("byteValue", bytes), summary);
+    testOk1(summary.min == -128.0 && summary.max == 127.0 && summary.total == -3.0);
+
+    PVBooleanArray::svector bits(4);
+    bits[1] = true;
+    statistics.compute(*createFrame<PVBooleanArray>("booleanValue", bits), summary);
+    testOk1(summary.mean == 0.25 && summary.max == 1.0);
+
+    // NaN is ignored by the minimum and maximum
+    PVFloatArray::svector floats(3);
+    floats[0] = 1.0f;
+    floats[1] = std::numeric_limits<float>::quiet_NaN();
+    floats[2] = 3.0f;
+    statistics.compute(*createFrame<PVFloatArray>("floatValue", floats), summary);
+    testOk1(summary.count == 3 && summary.mean != summary.mean);
+    testOk1(summary.min == 1.0 && summary.max == 3.0);
+
+    // empty
+    PVUShortArray::svector none;
+    statistics.compute(*createFrame<PVUShortArray>("ushortValue", none), summary);
+    testOk1(summary.count == 0 && summary.total == 0.0);
+    testOk1(summary.mean != summary.mean && summary.min != summary.min && summary.first != summary.first);
+}
+
+void test_histogram()
+{
+    testDiag("test_histogram");
+
+    NTNDArrayStatistics::Summary summary;
+    NTNDArrayStatistics statistics;
+    statistics.histogram(0.0, 12.0, 4);
+    testOk1(statistics.getRanges().size() == 5 && statistics.getRanges()[1] == 3.0);
+
+    // [0, 3) [3, 6) [6, 9) [9, 12), 12 above
+    statistics.compute(*createCounting<PVUShortArray>("ushortValue"), summary);
+    testOk1(summary.histogram.size() == 4);
+    testOk1(summary.histogram[0] == 2 && summary.histogram[1] == 3 &&
+            summary.histogram[2] == 3 && summary.histogram[3] == 3);
+    testOk1(summary.underflow == 0 && summary.overflow == 1);
+    testOk1(summary.count == 12 && summary.mean == 6.5 && summary.min == 1.0 && summary.max == 12.0);
+    testOk1(near(summary.sigma, std::sqrt(143.0 / 12)));
+
+    // the same from the counts of the values and from the elements
+    NTNDArrayStatistics::Summary other;
+    statistics.compute(*createCounting<PVDoubleArray>("doubleValue"), other);
+    testOk1(other == summary);
+
+    std::vector<double> ranges;
+    ranges.push_back(2.0);
+    ranges.push_back(5.0);
+    ranges.push_back(10.0);
+    statistics.histogram(ranges);
+    statistics.compute(*createCounting<PVByteArray>("byteValue"), summary);
+    testOk1(summary.histogram.size() == 2 && summary.histogram[0] == 3 && summary.histogram[1] == 5);
+    testOk1(summary.underflow == 1 && summary.overflow == 3);
+    statistics.compute(*createCounting<PVUIntArray>("uintValue"), other);
+    testOk1(other == summary);
+
+    // NaN is not counted
+    PVDoubleArray::svector doubles(3);
+    doubles[0] = 1.0;
+    doubles[1] = std::numeric_limits<double>::quiet_NaN();
+    doubles[2] = 3.0;
+    statistics.compute(*createFrame<PVDoubleArray>("doubleValue", doubles), summary);
+    testOk1(summary.histogram[0] == 1 && summary.underflow == 1 && summary.overflow == 0);
+
+    // no histogram
+    statistics.histogram(std::vector<double>());
+    statistics.compute(*createCounting<PVUShortArray>("ushortValue"), summary);
+    testOk1(summary.histogram.empty());
+}
+
+template<typename PVT>
+static NTNDArrayPtr createLarge(std::string const & field)
+{
+    typename PVT::svector data(1000 * 1000);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<typename PVT::value_type>(100 + (i * 7919) % 4093);
+    return createFrame<PVT>(field, data);
+}
+
+void test_threads()
+{
+    testDiag("test_threads");
+
+    // the statistics do not depend on the number of threads
+    NTNDArrayStatistics::Summary single;
+    NTNDArrayStatistics::Summary multi;
+    NTNDArrayStatistics statistics;
+    statistics.histogram(0.0, 4096.0, 64);
+
+    NTNDArrayPtr frame = createLarge<PVUShortArray>("ushortValue");
+    statistics.threads(1).compute(*frame, single);
+    statistics.threads(8).compute(*frame, multi);
+    testOk1(single == multi);
+    testOk1(single.count == 1000000 && single.min == 100.0 && single.max == 4192.0);
+    // the elements 4096 to 4192
+    testOk1(single.underflow == 0 && single.overflow == 23699);
+
+    frame = createLarge<PVFloatArray>("floatValue");
+    statistics.threads(1).compute(*frame, single);
+    statistics.threads(8).compute(*frame, multi);
+    testOk1(single == multi);
+
+    statistics.histogram(std::vector<double>());
+    frame = createLarge<PVShortArray>("shortValue");
+    statistics.threads(1).compute(*frame, single);
+    statistics.threads(8).compute(*frame, multi);
+    testOk1(single == multi);
+}
+
+void test_aggregate()
+{
+    testDiag("test_aggregate");
+
+    NTNDArrayPtr frame = createCounting<PVUShortArray>("ushortValue");
+    frame->getDataTimeStamp()->getSubField<PVLong>("secondsPastEpoch")->put(1234);
+
+    NTAggregatePtr aggregate = NTAggregate::createBuilder()->
+        addDispersion()->addFirst()->addFirstTimeStamp()->addLast()->
+        addLastTimeStamp()->addMax()->addMin()->create();
+    NTHistogramPtr histogram = NTHistogram::createBuilder()->value(pvInt)->create();
+
+    NTNDArrayStatistics statistics;
+    statistics.histogram(0.0, 12.0, 4).compute(*frame, *aggregate, *histogram);
+
+    testOk1(aggregate->getValue()->get() == 6.5 && aggregate->getN()->get() == 12);
+    testOk1(near(aggregate->getDispersion()->get(), std::sqrt(143.0 / 12)));
+    testOk1(aggregate->getMin()->get() == 1.0 && aggregate->getMax()->get() == 12.0);
+    testOk1(aggregate->getFirst()->get() == 1.0 && aggregate->getLast()->get() == 12.0);
+    testOk1(aggregate->getFirstTimeStamp()->getSubField<PVLong>("secondsPastEpoch")->get() == 1234);
+    testOk1(aggregate->getLastTimeStamp()->getSubField<PVLong>("secondsPastEpoch")->get() == 1234);
+    testOk1(aggregate->isValid());
+
+    PVIntArray::const_svector counts(histogram->getValue<PVIntArray>()->view());
+    testOk1(histogram->getRanges()->getLength() == 5 && counts.size() == 4);
+    testOk1(counts[0] == 2 && counts[3] == 3);
+    testOk1(histogram->isValid());
+
+    // without the optional fields
+    aggregate = NTAggregate::createBuilder()->create();
+    statistics.compute(*frame, *aggregate);
+    testOk1(aggregate->getValue()->get() == 6.5 && aggregate->getN()->get() == 12);
+}
+
+void test_errors()
+{
+    testDiag("test_errors");
+
+    NTNDArrayStatistics statistics;
+    try {
+        statistics.histogram(1.0, 1.0, 4);
+        testFail("empty histogram range accepted");
+    } catch (std::runtime_error &) {
+        testPass("empty histogram range rejected");
+    }
+
+    try {
+        statistics.histogram(0.0, 1.0, 0);
+        testFail("histogram without bin accepted");
+    } catch (std::runtime_error &) {
+        testPass("histogram without bin rejected");
+    }
+
+    std::vector<double> ranges(2, 1.0);
+    try {
+        statistics.histogram(ranges);
+        testFail("ranges not increasing accepted");
+    } catch (std::runtime_error &) {
+        testPass("ranges not increasing rejected");
+    }
+
+    ranges.resize(1);
+    try {
+        statistics.histogram(ranges);
+        testFail("single range accepted");
+    } catch (std::runtime_error &) {
+        testPass("single range rejected");
+    }
+
+    // a summary with a histogram put with other ranges
+    NTNDArrayStatistics::Summary summary;
+    NTNDArrayStatistics(statistics).histogram(0.0, 1.0, 2).compute(
+        *createCounting<PVUShortArray>("ushortValue"), summary);
+    try {
+        statistics.put(summary, *NTHistogram::createBuilder()->value(pvLong)->create());
+        testFail("histogram of other ranges put");
+    } catch (std::runtime_error &) {
+        testPass("histogram of other ranges rejected");
+    }
+
+    NTNDArrayPtr frame = createCounting<PVUShortArray>("ushortValue");
+    NTNDArrayCodec::compress(*frame, "nt-lz4");
+    try {
+        statistics.compute(*frame, summary);
+        testFail("compressed frame computed");
+    } catch (std::runtime_error &) {
+        testPass("compressed frame rejected");
+    }
+
+    try {
+        statistics.compute(*builder->create(), summary);
+        testFail("NTNDArray without value computed");
+    } catch (std::runtime_error &) {
+        testPass("NTNDArray without value rejected");
+    }
+}
+
+MAIN(testNTNDArrayStatistics) {
+    testPlan(48);
+    test_summary();
+    test_histogram();
+    test_threads();
+    test_aggregate();
+    test_errors();
+    return testDone();
+}
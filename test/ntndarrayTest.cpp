@@ -5,6 +5,7 @@
 
 #include <epicsUnitTest.h>
 #include <testMain.h>
+#include <epicsThread.h>
 
 #include <pv/nt.h>
 
@@ -76,6 +77,13 @@ void test_all()
             createPVStructure();
     testOk1(NTNDArray::is_a(pvStructure)==true);
     testOk1(NTNDArray::isCompatible(pvStructure)==true);
+
+    // the subfields are looked up when wrapped
+    NTNDArrayPtr ptr = NTNDArray::wrapUnsafe(pvStructure);
+    testOk1(ptr->getCodec() == pvStructure->getSubField<PVStructure>("codec"));
+    testOk1(ptr->getDimension() == pvStructure->getSubField<PVStructureArray>("dimension"));
+    testOk1(ptr->getDescriptor() == pvStructure->getSubField<PVString>("descriptor"));
+    testOk1(ptr->getDisplay() == pvStructure->getSubField<PVStructure>("display"));
 }
 
 
@@ -111,12 +119,89 @@ void test_wrap()
     testOk(ptr.get() != 0, "wrapUnsafe OK");
 }
 
+class Creator : public epicsThreadRunable
+{
+public:
+    Creator(FieldConstPtr const & extra) : extra(extra), same(true) {}
+
+    virtual void run()
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            StructureConstPtr s = NTNDArray::createBuilder()->
+                addDescriptor()->addDisplay()->createStructure();
+            StructureConstPtr e = NTNDArray::createBuilder()->
+                addDescriptor()->add("extra", extra)->createStructure();
+            if (i == 0)
+            {
+                structure = s;
+                extended = e;
+            }
+            same = same && s == structure && e == extended;
+        }
+    }
+
+    FieldConstPtr extra;
+    StructureConstPtr structure;
+    StructureConstPtr extended;
+    bool same;
+};
+
+void test_cache()
+{
+    testDiag("test_cache");
+
+    StructureConstPtr s1 = NTNDArray::createBuilder()->addTimeStamp()->createStructure();
+    StructureConstPtr s2 = NTNDArray::createBuilder()->addTimeStamp()->createStructure();
+    testOk1(s1 == s2);
+    testOk1(s1 != NTNDArray::createBuilder()->createStructure());
+
+    // extended structures are cached by extra field
+    FieldConstPtr extra = fieldCreate->createScalar(pvInt);
+    StructureConstPtr e1 = NTNDArray::createBuilder()->
+        addAlarm()->add("extra", extra)->createStructure();
+    StructureConstPtr e2 = NTNDArray::createBuilder()->
+        addAlarm()->add("extra", extra)->createStructure();
+    testOk1(e1 == e2);
+    testOk1(e1->getField("extra") == extra);
+    testOk1(e1 != NTNDArray::createBuilder()->
+        addAlarm()->add("extra", fieldCreate->createScalar(pvDouble))->createStructure());
+
+    // created concurrently
+    std::vector<Creator *> creators;
+    std::vector<epicsThread *> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        creators.push_back(new Creator(extra));
+        threads.push_back(new epicsThread(*creators.back(), "ntndarrayTest",
+            epicsThreadGetStackSize(epicsThreadStackSmall)));
+        threads.back()->start();
+    }
+
+    bool same = true;
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        threads[i]->exitWait();
+        same = same && creators[i]->same &&
+            creators[i]->structure == creators[0]->structure &&
+            creators[i]->extended == creators[0]->extended;
+        delete threads[i];
+    }
+    testOk1(same);
+    testOk1(creators[0]->structure->getField("display").get() != 0 &&
+            creators[0]->extended->getField("extra") == extra);
+
+    for (size_t i = 0; i < creators.size(); ++i)
+        delete creators[i];
+}
+
 MAIN(testNTNDArray) {
-    testPlan(60);
+    testPlan(71);
     test_builder(true);
     test_builder(false);
     test_builder(false); // called twice to test caching
     test_all();
     test_wrap();
+    test_cache();
     return testDone();
 }
@@ -0,0 +1,64 @@
+/* ntndarrayTestFrame.h */
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#ifndef NTNDARRAYTESTFRAME_H
+#define NTNDARRAYTESTFRAME_H
+
+#include <string>
+#include <vector>
+
+#include <pv/nt.h>
+#include <pv/ntndarrayView.h>
+
+/*
+ * The frames of the tests of the NTNDArray operations: an NTNDArray of
+ * the given data, selected as the given value field, with the given
+ * dimensions, and uncompressed.
+ */
+
+template<typename PVT>
+epics::nt::NTNDArrayPtr createFrame(std::string const & field,
+    typename PVT::svector & data, std::vector<epics::pvData::int32> const & shape)
+{
+    using namespace epics::nt;
+    using namespace epics::pvData;
+
+    NTNDArrayPtr ntndarray = NTNDArray::createBuilder()->create();
+    size_t size = data.size();
+    ntndarray->getValue()->select<PVT>(field)->replace(freeze(data));
+
+    std::vector<NTNDArrayDimension> dimensions;
+    for (size_t d = 0; d < shape.size(); ++d)
+        dimensions.push_back(NTNDArrayDimension(shape[d]));
+    NTNDArrayDimension::put(*ntndarray, dimensions);
+
+    int64 bytes = static_cast<int64>(size * sizeof(typename PVT::value_type));
+    ntndarray->getCompressedDataSize()->put(bytes);
+    ntndarray->getUncompressedDataSize()->put(bytes);
+    return ntndarray;
+}
+
+// an image of the given width
+template<typename PVT>
+epics::nt::NTNDArrayPtr createFrame(std::string const & field,
+    typename PVT::svector & data, epics::pvData::int32 width)
+{
+    std::vector<epics::pvData::int32> shape;
+    shape.push_back(width);
+    shape.push_back(static_cast<epics::pvData::int32>(data.size() / width));
+    return createFrame<PVT>(field, data, shape);
+}
+
+// a single dimension
+template<typename PVT>
+epics::nt::NTNDArrayPtr createFrame(std::string const & field,
+    typename PVT::svector & data)
+{
+    std::vector<epics::pvData::int32> shape(1,
+        static_cast<epics::pvData::int32>(data.size()));
+    return createFrame<PVT>(field, data, shape);
+}
+
+#endif  /* NTNDARRAYTESTFRAME_H */
@@ -0,0 +1,112 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+/*
+ * Microbenchmark of the rotation and transposition of 16-bit images.
+ *
+ * Measures the time taken by a naive loop, reading the columns of the
+ * source for each row of the result, then by NTNDArrayTransform with
+ * one thread and with all CPUs, for each operation swapping x and y.
+ *
+ * Built with the tests, but not run by them. Usage:
+ *   ntndarrayTransformBench [size]
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+#include <epicsTypes.h>
+#include <epicsTime.h>
+
+#include <pv/nt.h>
+#include <pv/ntndarrayTransform.h>
+#include <pv/ntndarrayView.h>
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+namespace {
+
+// milliseconds
+double elapsed(epicsUInt64 start)
+{
+    return (epicsMonotonicGet() - start) * 1e-6;
+}
+
+const char * operationName(NTNDArrayTransform::Operation operation)
+{
+    switch (operation)
+    {
+    case NTNDArrayTransform::rotate90: return "rotate90";
+    case NTNDArrayTransform::rotate270: return "rotate270";
+    case NTNDArrayTransform::transpose: return "transpose";
+    case NTNDArrayTransform::transverse: return "transverse";
+    default: return "other";
+    }
+}
+
+void bench(NTNDArrayPtr const & frame, NTNDArrayTransform::Operation operation)
+{
+    NTNDArrayView<uint16> source(*frame);
+    size_t size = source.getSize(0);
+
+    // the view of the source in the order of the result
+    NTNDArrayView<uint16> view(source.swap(0, 1));
+    if (operation == NTNDArrayTransform::rotate90 || operation == NTNDArrayTransform::transverse)
+        view = view.flip(0);
+    if (operation == NTNDArrayTransform::rotate270 || operation == NTNDArrayTransform::transverse)
+        view = view.flip(1);
+
+    std::vector<uint16> naive(size * size);
+    epicsUInt64 start = epicsMonotonicGet();
+    for (size_t y = 0; y < size; ++y)
+        for (size_t x = 0; x < size; ++x)
+            naive[x + size * y] = view(x, y);
+    double naiveTime = elapsed(start);
+
+    NTNDArrayPtr result = NTNDArray::createBuilder()->create();
+    start = epicsMonotonicGet();
+    NTNDArrayTransform(operation).threads(1).apply(*frame, *result);
+    double single = elapsed(start);
+
+    start = epicsMonotonicGet();
+    NTNDArrayTransform(operation).apply(*frame, *result);
+    double multi = elapsed(start);
+
+    PVUShortArray::const_svector out(result->getValue()->get<PVUShortArray>()->view());
+    testOk(std::equal(out.begin(), out.end(), naive.begin()),
+        "%-10s naive %7.2f ms, tiled %7.2f ms, threaded %7.2f ms",
+        operationName(operation), naiveTime, single, multi);
+}
+
+}
+
+MAIN(ntndarrayTransformBench)
+{
+    size_t size = 4096;
+    if (argc > 1)
+        size = strtoul(argv[1], NULL, 0);
+
+    testPlan(0);
+    testDiag("%ux%u 16-bit image", (unsigned)size, (unsigned)size);
+
+    PVUShortArray::svector data(size * size);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint16>(i * 2654435761u >> 16);
+    NTNDArrayPtr frame = NTNDArray::createBuilder()->create();
+    frame->getValue()->select<PVUShortArray>("ushortValue")->replace(freeze(data));
+    std::vector<NTNDArrayDimension> dimensions(2, NTNDArrayDimension(static_cast<int32>(size)));
+    NTNDArrayDimension::put(*frame, dimensions);
+
+    bench(frame, NTNDArrayTransform::transpose);
+    bench(frame, NTNDArrayTransform::rotate90);
+    bench(frame, NTNDArrayTransform::rotate270);
+    bench(frame, NTNDArrayTransform::transverse);
+
+    return testDone();
+}
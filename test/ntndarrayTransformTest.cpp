@@ -0,0 +1,354 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <stdexcept>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/nt.h>
+#include <pv/ntndarrayCodec.h>
+#include <pv/ntndarrayTransform.h>
+#include <pv/ntndarrayView.h>
+
+#include "ntndarrayTestFrame.h"
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+static NTNDArrayBuilderPtr builder = NTNDArray::createBuilder();
+
+// element i is i0 + 10 * i1 + 100 * i2 for the indexes of its dimensions
+template<typename PVT>
+static NTNDArrayPtr createImage(std::string const & field,
+    int32 size0, int32 size1, int32 size2 = 0)
+{
+    typedef typename PVT::value_type T;
+    typename PVT::svector data(size0 * size1 * (size2 ? size2 : 1));
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<T>(i % size0 + 10 * (i / size0 % size1) + 100 * (i / size0 / size1));
+    std::vector<int32> shape;
+    shape.push_back(size0);
+    shape.push_back(size1);
+    if (size2)
+        shape.push_back(size2);
+    return createFrame<PVT>(field, data, shape);
+}
+
+// whether a transformed image is the view of the source in the same order
+template<typename T>
+static bool sameImage(NTNDArrayView<T> const & image, NTNDArrayView<T> const & expected)
+{
+    if (image.getShape() != expected.getShape() ||
+        image.getDimensions() != expected.getDimensions())
+        return false;
+    size_t size2 = image.getRank() == 3 ? image.getSize(2) : 1;
+    for (size_t i2 = 0; i2 < size2; ++i2)
+        for (size_t i1 = 0; i1 < image.getSize(1); ++i1)
+            for (size_t i0 = 0; i0 < image.getSize(0); ++i0)
+                if (image.getRank() == 3 ? image(i0, i1, i2) != expected(i0, i1, i2)
+                                         : image(i0, i1) != expected(i0, i1))
+                    return false;
+    return true;
+}
+
+// pixel (x, y) is x + 10 * y
+void test_operations()
+{
+    testDiag("test_operations");
+
+    NTNDArrayPtr frame = createImage<PVUShortArray>("ushortValue", 5, 3);
+    frame->getUniqueId()->put(42);
+    NTNDArrayPtr image = builder->create();
+
+    NTNDArrayTransform(NTNDArrayTransform::none).apply(*frame, *image);
+    NTNDArrayView<uint16> view(*image);
+    testOk1(view.getSize(0) == 5 && view.getSize(1) == 3);
+    testOk1(view(0, 0) == 0 && view(1, 0) == 1 && view(0, 1) == 10);
+    testOk1(image->getCompressedDataSize()->get() == 5*3*2);
+    testOk1(image->getUncompressedDataSize()->get() == 5*3*2);
+    testOk1(image->getUniqueId()->get() == 42);
+    testOk1(image->isValid());
+
+    NTNDArrayTransform(NTNDArrayTransform::flipHorizontal).apply(*frame, *image);
+    view = NTNDArrayView<uint16>(*image);
+    testOk1(view.getSize(0) == 5 && view(0, 0) == 4 && view(1, 0) == 3 && view(0, 1) == 14);
+
+    NTNDArrayTransform(NTNDArrayTransform::flipVertical).apply(*frame, *image);
+    view = NTNDArrayView<uint16>(*image);
+    testOk1(view.getSize(0) == 5 && view(0, 0) == 20 && view(1, 0) == 21 && view(0, 1) == 10);
+
+    NTNDArrayTransform(NTNDArrayTransform::rotate180).apply(*frame, *image);
+    view = NTNDArrayView<uint16>(*image);
+    testOk1(view.getSize(0) == 5 && view(0, 0) == 24 && view(1, 0) == 23 && view(0, 1) == 14);
+
+    NTNDArrayTransform(NTNDArrayTransform::transpose).apply(*frame, *image);
+    view = NTNDArrayView<uint16>(*image);
+    testOk1(view.getSize(0) == 3 && view.getSize(1) == 5);
+    testOk1(view(0, 0) == 0 && view(1, 0) == 10 && view(0, 1) == 1);
+
+    // clockwise, the bottom left pixel going to the top left
+    NTNDArrayTransform(NTNDArrayTransform::rotate90).apply(*frame, *image);
+    view = NTNDArrayView<uint16>(*image);
+    testOk1(view.getSize(0) == 3 && view(0, 0) == 20 && view(1, 0) == 10 && view(0, 1) == 21);
+
+    NTNDArrayTransform(NTNDArrayTransform::rotate270).apply(*frame, *image);
+    view = NTNDArrayView<uint16>(*image);
+    testOk1(view.getSize(0) == 3 && view(0, 0) == 4 && view(1, 0) == 14 && view(0, 1) == 3);
+
+    NTNDArrayTransform(NTNDArrayTransform::transverse).apply(*frame, *image);
+    view = NTNDArrayView<uint16>(*image);
+    testOk1(view.getSize(0) == 3 && view(0, 0) == 24 && view(1, 0) == 14 && view(0, 1) == 23);
+}
+
+void test_dimensions()
+{
+    testDiag("test_dimensions");
+
+    // a binned region of a detector
+    std::vector<NTNDArrayDimension> source(2);
+    source[0].size = 5;
+    source[0].offset = 10;
+    source[1].size = 3;
+    source[1].offset = 20;
+    source[1].binning = 2;
+
+    std::vector<NTNDArrayDimension> result;
+    NTNDArrayTransform(NTNDArrayTransform::rotate90).getResultDimensions(source, result);
+    testOk1(result.size() == 2);
+    testOk1(result[0].size == 3 && result[0].offset == 20 && result[0].binning == 2 && result[0].reverse);
+    testOk1(result[1].size == 5 && result[1].offset == 10 && !result[1].reverse);
+
+    // pixel (0, 0) of the result is pixel (0, 2) of the source
+    testOk1(result[0].getFullIndex(0) == source[1].getFullIndex(2));
+    testOk1(result[1].getFullIndex(0) == source[0].getFullIndex(0));
+
+    NTNDArrayTransform(NTNDArrayTransform::flipHorizontal).getResultDimensions(source, result);
+    testOk1(result[0].reverse && result[0].offset == 10 && result[1] == source[1]);
+
+    // the dimensions of the image are those of the view in the same order
+    NTNDArrayPtr frame = createImage<PVUShortArray>("ushortValue", 5, 3);
+    NTNDArrayDimension::put(*frame, source);
+    NTNDArrayPtr image = builder->create();
+    NTNDArrayTransform(NTNDArrayTransform::rotate270).apply(*frame, *image);
+    testOk1(sameImage(NTNDArrayView<uint16>(*image), NTNDArrayView<uint16>(*frame).swap(0, 1).flip(1)));
+}
+
+void test_color()
+{
+    testDiag("test_color");
+
+    NTNDArrayPtr image = builder->create();
+    size_t x, y;
+
+    // RGB1, the color of each pixel kept together
+    NTNDArrayPtr frame = createImage<PVUByteArray>("ubyteValue", 3, 4, 2);
+    NTNDArrayTransform rotate90(NTNDArrayTransform::rotate90);
+    rotate90.getAxes(NTNDArrayView<uint8>(*frame).getDimensions(), x, y);
+    testOk1(x == 1 && y == 2);
+    rotate90.apply(*frame, *image);
+    NTNDArrayView<uint8> view(*image);
+    testOk1(view.getSize(0) == 3 && view.getSize(1) == 2 && view.getSize(2) == 4);
+    testOk1(view(1, 0, 0) == 101 && view(2, 1, 3) == 32);
+    testOk1(sameImage(view, NTNDArrayView<uint8>(*frame).swap(1, 2).flip(1)));
+
+    // RGB2
+    frame = createImage<PVUByteArray>("ubyteValue", 4, 3, 2);
+    NTNDArrayTransform transpose(NTNDArrayTransform::transpose);
+    transpose.getAxes(NTNDArrayView<uint8>(*frame).getDimensions(), x, y);
+    testOk1(x == 0 && y == 2);
+    transpose.apply(*frame, *image);
+    testOk1(sameImage(NTNDArrayView<uint8>(*image), NTNDArrayView<uint8>(*frame).swap(0, 2)));
+
+    // RGB3
+    frame = createImage<PVUByteArray>("ubyteValue", 4, 2, 3);
+    NTNDArrayTransform transverse(NTNDArrayTransform::transverse);
+    transverse.getAxes(NTNDArrayView<uint8>(*frame).getDimensions(), x, y);
+    testOk1(x == 0 && y == 1);
+    transverse.apply(*frame, *image);
+    testOk1(sameImage(NTNDArrayView<uint8>(*image),
+        NTNDArrayView<uint8>(*frame).swap(0, 1).flip(0).flip(1)));
+
+    // a stack of images of width 3, the axes set
+    frame = createImage<PVIntArray>("intValue", 3, 4, 5);
+    transpose.axes(0, 1).apply(*frame, *image);
+    NTNDArrayView<int32> stack(*image);
+    testOk1(stack.getSize(0) == 4 && stack.getSize(1) == 3 && stack.getSize(2) == 5);
+    testOk1(sameImage(stack, NTNDArrayView<int32>(*frame).swap(0, 1)));
+}
+
+void test_types()
+{
+    testDiag("test_types");
+
+    NTNDArrayPtr image = builder->create();
+
+    // sizes which are not multiples of the tiles nor of the blocks
+    NTNDArrayPtr frame = createImage<PVShortArray>("shortValue", 77, 69);
+    NTNDArrayTransform(NTNDArrayTransform::rotate90).apply(*frame, *image);
+    testOk1(sameImage(NTNDArrayView<int16>(*image), NTNDArrayView<int16>(*frame).swap(0, 1).flip(0)));
+
+    frame = createImage<PVUIntArray>("uintValue", 69, 77);
+    NTNDArrayTransform(NTNDArrayTransform::rotate270).apply(*frame, *image);
+    testOk1(sameImage(NTNDArrayView<uint32>(*image), NTNDArrayView<uint32>(*frame).swap(0, 1).flip(1)));
+
+    frame = createImage<PVFloatArray>("floatValue", 13, 9);
+    NTNDArrayTransform(NTNDArrayTransform::transverse).apply(*frame, *image);
+    testOk1(sameImage(NTNDArrayView<float>(*image),
+        NTNDArrayView<float>(*frame).swap(0, 1).flip(0).flip(1)));
+
+    frame = createImage<PVDoubleArray>("doubleValue", 13, 9);
+    NTNDArrayTransform(NTNDArrayTransform::transpose).apply(*frame, *image);
+    testOk1(sameImage(NTNDArrayView<double>(*image), NTNDArrayView<double>(*frame).swap(0, 1)));
+
+    frame = createImage<PVLongArray>("longValue", 13, 9);
+    NTNDArrayTransform(NTNDArrayTransform::rotate180).apply(*frame, *image);
+    testOk1(sameImage(NTNDArrayView<int64>(*image), NTNDArrayView<int64>(*frame).flip(0).flip(1)));
+
+    frame = createImage<PVByteArray>("byteValue", 7, 5);
+    NTNDArrayTransform(NTNDArrayTransform::rotate90).apply(*frame, *image);
+    testOk1(sameImage(NTNDArrayView<int8>(*image), NTNDArrayView<int8>(*frame).swap(0, 1).flip(0)));
+
+    PVBooleanArray::svector bits(6);
+    bits[1] = bits[5] = true;
+    std::vector<int32> shape(2);
+    shape[0] = 2;
+    shape[1] = 3;
+    frame = createFrame<PVBooleanArray>("booleanValue", bits, shape);
+    NTNDArrayTransform(NTNDArrayTransform::transpose).apply(*frame, *image);
+    testOk1(sameImage(NTNDArrayView<boolean>(*image), NTNDArrayView<boolean>(*frame).swap(0, 1)));
+
+    // empty
+    frame = createImage<PVUShortArray>("ushortValue", 0, 3);
+    NTNDArrayTransform(NTNDArrayTransform::rotate90).apply(*frame, *image);
+    NTNDArrayView<uint16> empty(*image);
+    testOk1(empty.getSize(0) == 3 && empty.getSize(1) == 0 && empty.empty());
+}
+
+void test_threads()
+{
+    testDiag("test_threads");
+
+    NTNDArrayPtr frame = createImage<PVUShortArray>("ushortValue", 1000, 999);
+    NTNDArrayPtr single = builder->create();
+    NTNDArrayPtr multi = builder->create();
+
+    // the result does not depend on the number of threads
+    NTNDArrayTransform(NTNDArrayTransform::rotate90).threads(1).apply(*frame, *single);
+    NTNDArrayTransform(NTNDArrayTransform::rotate90).threads(8).apply(*frame, *multi);
+    testOk1(*single->getValue() == *multi->getValue());
+    testOk1(sameImage(NTNDArrayView<uint16>(*multi), NTNDArrayView<uint16>(*frame).swap(0, 1).flip(0)));
+}
+
+void test_roundTrip()
+{
+    testDiag("test_roundTrip");
+
+    NTNDArrayPtr frame = createImage<PVUShortArray>("ushortValue", 300, 200);
+    NTNDArrayPtr image = builder->create();
+
+    NTNDArrayTransform(NTNDArrayTransform::rotate90).apply(*frame, *image);
+    NTNDArrayTransform(NTNDArrayTransform::rotate270).apply(*image, *image);
+    testOk1(*image->getValue() == *frame->getValue());
+    testOk1(*image->getDimension() == *frame->getDimension());
+
+    // in place
+    NTNDArrayTransform(NTNDArrayTransform::transverse).apply(*image, *image);
+    NTNDArrayTransform(NTNDArrayTransform::transverse).apply(*image, *image);
+    testOk1(*image->getValue() == *frame->getValue());
+}
+
+// counts the allocations
+class CountingAllocator : public NTNDArrayAllocator
+{
+public:
+    CountingAllocator() : count(0) {}
+
+    virtual std::tr1::shared_ptr<void> allocate(size_t size)
+    {
+        ++count;
+        return std::tr1::shared_ptr<void>(new double[(size + 7) / 8], Deleter());
+    }
+
+    struct Deleter
+    {
+        void operator()(void * p) { delete[] static_cast<double *>(p); }
+    };
+
+    size_t count;
+};
+
+void test_allocator()
+{
+    testDiag("test_allocator");
+
+    NTNDArrayPtr frame = createImage<PVUShortArray>("ushortValue", 64, 32);
+    NTNDArrayPtr image = builder->create();
+
+    std::tr1::shared_ptr<CountingAllocator> counting(new CountingAllocator());
+    NTNDArrayTransform(NTNDArrayTransform::transpose).allocator(counting).apply(*frame, *image);
+    testOk1(counting->count == 1);
+    testOk1(sameImage(NTNDArrayView<uint16>(*image), NTNDArrayView<uint16>(*frame).swap(0, 1)));
+}
+
+void test_errors()
+{
+    testDiag("test_errors");
+
+    NTNDArrayPtr image = builder->create();
+
+    PVUShortArray::svector data(8);
+    NTNDArrayPtr frame = createFrame<PVUShortArray>("ushortValue", data, std::vector<int32>(1, 8));
+    try {
+        NTNDArrayTransform(NTNDArrayTransform::rotate90).apply(*frame, *image);
+        testFail("1-D frame transformed");
+    } catch (std::runtime_error &) {
+        testPass("1-D frame rejected");
+    }
+
+    frame = createImage<PVUShortArray>("ushortValue", 8, 6);
+    try {
+        NTNDArrayTransform(NTNDArrayTransform::rotate90).axes(1, 1).apply(*frame, *image);
+        testFail("same x and y axes accepted");
+    } catch (std::runtime_error &) {
+        testPass("same x and y axes rejected");
+    }
+
+    try {
+        NTNDArrayTransform(NTNDArrayTransform::rotate90).axes(0, 2).apply(*frame, *image);
+        testFail("axis outside of the image accepted");
+    } catch (std::runtime_error &) {
+        testPass("axis outside of the image rejected");
+    }
+
+    NTNDArrayCodec::compress(*frame, "nt-lz4");
+    try {
+        NTNDArrayTransform(NTNDArrayTransform::rotate90).apply(*frame, *image);
+        testFail("compressed frame transformed");
+    } catch (std::runtime_error &) {
+        testPass("compressed frame rejected");
+    }
+
+    try {
+        NTNDArrayTransform(NTNDArrayTransform::rotate90).apply(*builder->create(), *image);
+        testFail("NTNDArray without value transformed");
+    } catch (std::runtime_error &) {
+        testPass("NTNDArray without value rejected");
+    }
+}
+
+MAIN(testNTNDArrayTransform) {
+    testPlan(51);
+    test_operations();
+    test_dimensions();
+    test_color();
+    test_types();
+    test_threads();
+    test_roundTrip();
+    test_allocator();
+    test_errors();
+    return testDone();
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <stdexcept>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/nt.h>
+#include <pv/ntndarrayView.h>
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+typedef NTNDArrayView<uint16> View;
+
+// a 4x3x2 NTNDArray of ushort, element (x,y,z) = 100*z + 10*y + x
+static NTNDArrayPtr createNTNDArray()
+{
+    NTNDArrayPtr ntndarray = NTNDArray::createBuilder()->create();
+
+    PVUShortArray::svector data(4*3*2);
+    for (size_t z = 0; z < 2; ++z)
+        for (size_t y = 0; y < 3; ++y)
+            for (size_t x = 0; x < 4; ++x)
+                data[x + 4*y + 12*z] = static_cast<uint16>(100*z + 10*y + x);
+    ntndarray->getValue()->select<PVUShortArray>("ushortValue")->replace(freeze(data));
+
+    std::vector<NTNDArrayDimension> dimensions;
+    dimensions.push_back(NTNDArrayDimension(4));
+    dimensions.push_back(NTNDArrayDimension(3));
+    dimensions.push_back(NTNDArrayDimension(2));
+    dimensions[0].offset = 8;
+    dimensions[0].fullSize = 16;
+    dimensions[0].binning = 2;
+    NTNDArrayDimension::put(*ntndarray, dimensions);
+    return ntndarray;
+}
+
+void test_dimensions()
+{
+    testDiag("test_dimensions");
+
+    NTNDArrayPtr ntndarray = createNTNDArray();
+    PVStructureArray::const_svector elements(ntndarray->getDimension()->view());
+    testOk1(elements.size() == 3);
+    testOk1(elements[0]->getSubFieldT<PVInt>("binning")->get() == 2);
+    testOk1(elements[2]->getSubFieldT<PVInt>("fullSize")->get() == 2);
+
+    std::vector<NTNDArrayDimension> dimensions;
+    NTNDArrayDimension::get(*ntndarray, dimensions);
+    testOk1(dimensions.size() == 3);
+    testOk1(dimensions[0].size == 4 && dimensions[0].offset == 8 && dimensions[0].binning == 2);
+    testOk1(dimensions[1] == NTNDArrayDimension(3));
+    testOk1(dimensions[0].getFullIndex(1) == 10);
+
+    // the old elements are left unchanged
+    dimensions[1].reverse = true;
+    NTNDArrayDimension::put(*ntndarray, dimensions);
+    testOk1(!elements[1]->getSubFieldT<PVBoolean>("reverse")->get());
+    testOk1(ntndarray->getDimension()->view()[1]->getSubFieldT<PVBoolean>("reverse")->get());
+    testOk1(dimensions[1].getFullIndex(0) == 2);
+}
+
+void test_view()
+{
+    testDiag("test_view");
+
+    NTNDArrayPtr ntndarray = createNTNDArray();
+    View view(*ntndarray);
+    testOk1(view.getRank() == 3);
+    testOk1(view.getSize(0) == 4 && view.getSize(1) == 3 && view.getSize(2) == 2);
+    testOk1(view.getStride(0) == 1 && view.getStride(1) == 4 && view.getStride(2) == 12);
+    testOk1(view.getNumberOfElements() == 24);
+    testOk1(view.isContiguous());
+    testOk1(view.getDimension(0).binning == 2);
+
+    // the elements are shared
+    testOk1(view.getData().data() ==
+        ntndarray->getValue()->get<PVUShortArray>()->view().data());
+
+    testOk1(view(3, 2, 1) == 123);
+    std::vector<size_t> indexes(3);
+    indexes[0] = 1;
+    indexes[1] = 2;
+    indexes[2] = 0;
+    testOk1(view.at(indexes) == 21);
+
+    View::Row row = view.getRow(1, 1);
+    testOk1(row.size == 4 && row.stride == 1);
+    testOk1(row[0] == 110 && row[3] == 113);
+}
+
+void test_derived()
+{
+    testDiag("test_derived");
+
+    View view(*createNTNDArray());
+
+    View plane = view.slice(2, 1);
+    testOk1(plane.getRank() == 2);
+    testOk1(plane.isContiguous());
+    testOk1(plane(2, 1) == 112);
+
+    View column = plane.slice(0, 3);
+    testOk1(column.getRank() == 1 && column.getSize(0) == 3);
+    testOk1(column.getStride(0) == 4);
+    testOk1(!column.isContiguous());
+    testOk1(column(2) == 123);
+
+    View region = plane.subView(0, 1, 2);
+    testOk1(region.getSize(0) == 2 && region(0, 0) == 101);
+    testOk1(!region.isContiguous());
+    testOk1(region.getDimension(0).size == 2 && region.getDimension(0).offset == 10);
+
+    View flipped = plane.flip(1);
+    testOk1(flipped.getStride(1) == -4);
+    testOk1(flipped(0, 0) == 120 && flipped(3, 2) == 103);
+    testOk1(flipped.getDimension(1).reverse);
+
+    // a region of a reversed dimension is at the other end of the frame
+    View flippedRegion = flipped.subView(1, 0, 2);
+    testOk1(flippedRegion(0, 0) == 120);
+    testOk1(flippedRegion.getDimension(1).offset == 1);
+    testOk1(flippedRegion.getDimension(1).getFullIndex(0) == 2);
+
+    View transposed = plane.swap(0, 1);
+    testOk1(transposed.getSize(0) == 3 && transposed.getSize(1) == 4);
+    testOk1(transposed(2, 1) == 121);
+    testOk1(transposed.getDimension(1).binning == 2);
+}
+
+struct RowCounter
+{
+    RowCounter() : rows(0), sum(0) {}
+
+    void operator()(View::Row const & row)
+    {
+        ++rows;
+        for (size_t i = 0; i < row.size; ++i)
+            sum += row[i];
+    }
+
+    size_t rows;
+    size_t sum;
+};
+
+void test_rows()
+{
+    testDiag("test_rows");
+
+    View view(*createNTNDArray());
+
+    RowCounter counter;
+    view.forEachRow(counter);
+    testOk1(counter.rows == 6);
+    testOk1(counter.sum == 2*4*(0+10+20) + 3*4*100 + 6*(0+1+2+3));
+
+    std::vector<uint16> copy(12);
+    view.slice(2, 0).swap(0, 1).copyTo(&copy[0]);
+    testOk1(copy[0] == 0 && copy[1] == 10 && copy[2] == 20 && copy[3] == 1);
+    testOk1(copy[11] == 23);
+
+    view.slice(2, 1).flip(0).copyTo(&copy[0]);
+    testOk1(copy[0] == 103 && copy[3] == 100 && copy[4] == 113);
+
+    RowCounter empty;
+    View().forEachRow(empty);
+    testOk1(empty.rows == 0);
+}
+
+void test_errors()
+{
+    testDiag("test_errors");
+
+    NTNDArrayPtr ntndarray = createNTNDArray();
+
+    try {
+        NTNDArrayView<float> view(*ntndarray);
+        testFail("view of another element type created");
+    } catch (std::runtime_error &) {
+        testPass("view of another element type rejected");
+    }
+
+    ntndarray->getCodec()->getSubFieldT<PVString>("name")->put("lz4");
+    try {
+        View view(*ntndarray);
+        testFail("view of compressed value created");
+    } catch (std::runtime_error &) {
+        testPass("view of compressed value rejected");
+    }
+    ntndarray->getCodec()->getSubFieldT<PVString>("name")->put("");
+
+    std::vector<NTNDArrayDimension> dimensions(1, NTNDArrayDimension(5));
+    NTNDArrayDimension::put(*ntndarray, dimensions);
+    testOk1(ntndarray->getDimension()->view().size() == 1);
+    try {
+        View view(*ntndarray);
+        testFail("view of mismatched dimensions created");
+    } catch (std::runtime_error &) {
+        testPass("view of mismatched dimensions rejected");
+    }
+
+    // no dimensions, a single one
+    NTNDArrayDimension::put(*ntndarray, std::vector<NTNDArrayDimension>());
+    View flat(*ntndarray);
+    testOk1(flat.getRank() == 1 && flat.getSize(0) == 24);
+}
+
+struct TypeVisitor
+{
+    TypeVisitor() : type(pvString), elements(0) {}
+
+    template<typename T>
+    void operator()(NTNDArrayView<T> const & view)
+    {
+        type = static_cast<ScalarType>(ScalarTypeID<T>::value);
+        elements = view.getNumberOfElements();
+    }
+
+    ScalarType type;
+    size_t elements;
+};
+
+void test_visit()
+{
+    testDiag("test_visit");
+
+    NTNDArrayPtr ntndarray = createNTNDArray();
+    TypeVisitor visitor;
+    testOk1(visitView(*ntndarray, visitor));
+    testOk1(visitor.type == pvUShort && visitor.elements == 24);
+
+    PVDoubleArray::svector data(24);
+    ntndarray->getValue()->select<PVDoubleArray>("doubleValue")->replace(freeze(data));
+    testOk1(visitView(*ntndarray, visitor));
+    testOk1(visitor.type == pvDouble);
+
+    ntndarray->getCodec()->getSubFieldT<PVString>("name")->put("lz4");
+    testOk1(!visitView(*ntndarray, visitor));
+
+    TypeVisitor unselected;
+    testOk1(!visitView(*NTNDArray::createBuilder()->create(), unselected));
+    testOk1(unselected.elements == 0);
+}
+
+MAIN(testNTNDArrayView) {
+    testPlan(58);
+    test_dimensions();
+    test_view();
+    test_derived();
+    test_rows();
+    test_errors();
+    test_visit();
+    return testDone();
+}
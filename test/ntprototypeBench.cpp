@@ -0,0 +1,145 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+/*
+ * Microbenchmark of creating initialized instances of NTScalar, NTTable
+ * and NTNDArray.
+ *
+ * Compares creating each instance from its builder and filling it in
+ * (display limits, table labels, NDArray attributes), copying it from
+ * an instance that was filled in once with createPVStructure(), which
+ * creates an instance with the default values and copies into it,
+ * and cloning it from a prototype that was filled in once.
+ *
+ * Built with the tests, but not run by them. Usage:
+ *   ntprototypeBench [iterations]
+ */
+
+#include <stdlib.h>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+#include <epicsTypes.h>
+#include <epicsTime.h>
+
+#include <pv/nt.h>
+#include <pv/ntprototype.h>
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+namespace {
+
+PVDataCreatePtr pvDataCreate = getPVDataCreate();
+
+void fillScalar(PVStructurePtr const & pvStructure)
+{
+    NTScalarPtr ntScalar = NTScalar::wrapUnsafe(pvStructure);
+    PVStructurePtr display = ntScalar->getDisplay();
+    display->getSubFieldT<PVDouble>("limitLow")->put(-10.0);
+    display->getSubFieldT<PVDouble>("limitHigh")->put(10.0);
+    display->getSubFieldT<PVString>("units")->put("mm");
+}
+
+PVStructurePtr createScalar()
+{
+    PVStructurePtr pvStructure = NTScalar::createBuilder()->
+        value(pvDouble)->addDescriptor()->addAlarm()->addTimeStamp()->
+        addDisplay()->addControl()->createPVStructure();
+    fillScalar(pvStructure);
+    return pvStructure;
+}
+
+PVStructurePtr createTable()
+{
+    // the builder fills in the labels
+    return NTTable::createBuilder()->
+        addColumn("x", pvDouble)->addColumn("y", pvDouble)->
+        addColumn("z", pvDouble)->addColumn("name", pvString)->
+        addDescriptor()->addAlarm()->addTimeStamp()->createPVStructure();
+}
+
+void fillNDArray(PVStructurePtr const & pvStructure)
+{
+    NTNDArrayPtr ntndarray = NTNDArray::wrapUnsafe(pvStructure);
+    ntndarray->getDescriptor()->put("detector");
+
+    PVStructureArrayPtr attributes = ntndarray->getAttribute();
+    StructureConstPtr attribute = attributes->getStructureArray()->getStructure();
+    PVStructureArray::svector elements(4);
+    for (size_t i = 0; i < elements.size(); ++i)
+    {
+        elements[i] = pvDataCreate->createPVStructure(attribute);
+        elements[i]->getSubFieldT<PVString>("name")->put("attribute");
+    }
+    attributes->replace(freeze(elements));
+}
+
+PVStructurePtr createNDArray()
+{
+    PVStructurePtr pvStructure = NTNDArray::createBuilder()->
+        addDescriptor()->addTimeStamp()->addAlarm()->addDisplay()->
+        createPVStructure();
+    fillNDArray(pvStructure);
+    return pvStructure;
+}
+
+// thousand instances per second
+double rate(epicsUInt64 start, size_t calls)
+{
+    epicsUInt64 ns = epicsMonotonicGet() - start;
+    return ns ? calls * 1e6 / ns : 0.0;
+}
+
+void bench(const char * name, PVStructurePtr (*create)(),
+           size_t iterations, size_t & sink)
+{
+    epicsUInt64 start = epicsMonotonicGet();
+    for (size_t i = 0; i < iterations; ++i)
+        sink += create()->getNumberFields();
+    double built = rate(start, iterations);
+
+    PVStructurePtr filled = create();
+    start = epicsMonotonicGet();
+    for (size_t i = 0; i < iterations; ++i)
+        sink += pvDataCreate->createPVStructure(filled)->getNumberFields();
+    double copied = rate(start, iterations);
+
+    NTPrototype prototype(filled);
+    prototype.create();
+    start = epicsMonotonicGet();
+    for (size_t i = 0; i < iterations; ++i)
+        sink += prototype.create()->getNumberFields();
+    double cloned = rate(start, iterations);
+
+    testDiag("%-12s %10.1f %10.1f %10.1f %8u", name, built, copied, cloned,
+        (unsigned)prototype.getCopiedFieldCount());
+}
+
+}
+
+MAIN(ntprototypeBench)
+{
+    size_t iterations = 100000;
+    if (argc > 1)
+        iterations = strtoul(argv[1], NULL, 0);
+
+    testPlan(3);
+
+    testOk1(*NTPrototype(createScalar()).create() == *createScalar());
+    testOk1(*NTPrototype(createTable()).create() == *createTable());
+    testOk1(*NTPrototype(createNDArray()).create() == *createNDArray());
+
+    testDiag("%u iterations, thousand instances per second", (unsigned)iterations);
+    testDiag("%-12s %10s %10s %10s %8s", "type", "builder", "copy", "prototype", "copied");
+
+    size_t sink = 0;
+    bench("NTScalar", createScalar, iterations, sink);
+    bench("NTTable", createTable, iterations, sink);
+    bench("NTNDArray", createNDArray, iterations, sink);
+    testDiag("(%u)", (unsigned)(sink & 1));
+
+    return testDone();
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/nt.h>
+#include <pv/ntprototype.h>
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+static PVDataCreatePtr pvDataCreate = getPVDataCreate();
+
+void test_scalar()
+{
+    testDiag("test_scalar");
+
+    NTPrototypePtr prototype = NTScalar::createBuilder()->
+        value(pvDouble)->addDisplay()->addAlarm()->createPrototype();
+    testOk1(prototype->getPVStructure()->getStructure() ==
+        NTScalar::createBuilder()->value(pvDouble)->addDisplay()->addAlarm()->
+            createStructure());
+
+    NTScalarPtr ntScalar = NTScalar::wrapUnsafe(prototype->getPVStructure());
+    ntScalar->getValue<PVDouble>()->put(1.5);
+    ntScalar->getDisplay()->getSubFieldT<PVString>("units")->put("mm");
+    ntScalar->getDisplay()->getSubFieldT<PVDouble>("limitHigh")->put(10.0);
+
+    testOk1(prototype->getCopiedFieldCount() == 3);
+
+    NTScalarPtr a = NTScalar::wrapUnsafe(prototype->create());
+    NTScalarPtr b = NTScalar::wrapUnsafe(prototype->create());
+    testOk1(a->getPVStructure()->getStructure() == prototype->getPVStructure()->getStructure());
+    testOk1(*a->getPVStructure() == *prototype->getPVStructure());
+    testOk1(a->getValue<PVDouble>()->get() == 1.5);
+    testOk1(a->getDisplay()->getSubFieldT<PVString>("units")->get() == "mm");
+    testOk1(a->getDisplay()->getSubFieldT<PVDouble>("limitHigh")->get() == 10.0);
+
+    // instances are independent of each other and of the prototype
+    testOk1(a->getPVStructure() != b->getPVStructure());
+    a->getValue<PVDouble>()->put(2.5);
+    testOk1(b->getValue<PVDouble>()->get() == 1.5);
+    testOk1(ntScalar->getValue<PVDouble>()->get() == 1.5);
+}
+
+void test_defaults()
+{
+    testDiag("test_defaults");
+
+    // nothing to copy
+    NTPrototypePtr prototype = NTScalarArray::createBuilder()->
+        value(pvInt)->addAlarm()->createPrototype();
+    testOk1(prototype->getCopiedFieldCount() == 0);
+    PVStructurePtr instance = prototype->create();
+    testOk1(*instance == *prototype->getPVStructure());
+
+    // the prototype holds a copy of the structure given
+    PVStructurePtr pvStructure = NTScalar::createBuilder()->value(pvInt)->createPVStructure();
+    NTPrototype copy(pvStructure);
+    pvStructure->getSubFieldT<PVInt>("value")->put(7);
+    testOk1(copy.getPVStructure() != pvStructure);
+    testOk1(copy.getPVStructure()->getSubFieldT<PVInt>("value")->get() == 0);
+}
+
+void test_table()
+{
+    testDiag("test_table");
+
+    NTPrototypePtr prototype = NTTable::createBuilder()->
+        addColumn("x", pvDouble)->addColumn("y", pvDouble)->createPrototype();
+
+    // the labels are filled in by the builder
+    testOk1(prototype->getCopiedFieldCount() == 1);
+
+    NTTablePtr a = NTTable::wrapUnsafe(prototype->create());
+    NTTablePtr b = NTTable::wrapUnsafe(prototype->create());
+    PVStringArray::const_svector labels(a->getLabels()->view());
+    testOk1(labels.size() == 2 && labels[0] == "x" && labels[1] == "y");
+
+    // frozen arrays are shared, not copied
+    PVStringArray::const_svector prototypeLabels(
+        NTTable::wrapUnsafe(prototype->getPVStructure())->getLabels()->view());
+    testOk1(labels.data() == prototypeLabels.data());
+    testOk1(b->getLabels()->view().data() == prototypeLabels.data());
+
+    // replacing the labels of an instance leaves the others alone
+    PVStringArray::svector other(1, "z");
+    a->getLabels()->replace(freeze(other));
+    testOk1(b->getLabels()->view().size() == 2);
+}
+
+void test_ndarray()
+{
+    testDiag("test_ndarray");
+
+    NTPrototypePtr prototype = NTNDArray::createBuilder()->
+        addDescriptor()->addTimeStamp()->createPrototype();
+    NTNDArrayPtr ntndarray = NTNDArray::wrapUnsafe(prototype->getPVStructure());
+    ntndarray->getDescriptor()->put("detector");
+
+    PVStructureArrayPtr attributes = ntndarray->getAttribute();
+    PVStructureArray::svector elements(1);
+    elements[0] = pvDataCreate->createPVStructure(
+        attributes->getStructureArray()->getStructure());
+    elements[0]->getSubFieldT<PVString>("name")->put("gain");
+    attributes->replace(freeze(elements));
+
+    testOk1(prototype->getCopiedFieldCount() == 2);
+
+    NTNDArrayPtr a = NTNDArray::wrapUnsafe(prototype->create());
+    NTNDArrayPtr b = NTNDArray::wrapUnsafe(prototype->create());
+    testOk1(a->getDescriptor()->get() == "detector");
+
+    // elements of structure arrays are copied
+    PVStructureArray::const_svector copies(a->getAttribute()->view());
+    testOk1(copies.size() == 1);
+    testOk1(copies[0] != attributes->view()[0]);
+    testOk1(copies[0]->getSubFieldT<PVString>("name")->get() == "gain");
+
+    copies[0]->getSubFieldT<PVString>("name")->put("offset");
+    testOk1(b->getAttribute()->view()[0]->getSubFieldT<PVString>("name")->get() == "gain");
+    testOk1(attributes->view()[0]->getSubFieldT<PVString>("name")->get() == "gain");
+
+    testOk1(a->isValid());
+}
+
+void test_enum()
+{
+    testDiag("test_enum");
+
+    NTPrototypePtr prototype = NTEnum::createBuilder()->addAlarm()->createPrototype();
+    NTEnumPtr ntEnum = NTEnum::wrapUnsafe(prototype->getPVStructure());
+    PVStringArray::svector choices(3);
+    choices[0] = "off";
+    choices[1] = "on";
+    choices[2] = "fault";
+    ntEnum->getValue()->getSubFieldT<PVStringArray>("choices")->replace(freeze(choices));
+
+    for (int i = 0; i < 3; ++i)
+    {
+        NTEnumPtr instance = NTEnum::wrapUnsafe(prototype->create());
+        PVStringArray::const_svector c(
+            instance->getValue()->getSubFieldT<PVStringArray>("choices")->view());
+        testOk(c.size() == 3 && c[2] == "fault", "instance %d", i);
+        testOk1(instance->getValue()->getSubFieldT<PVInt>("index")->get() == 0);
+    }
+}
+
+void test_union()
+{
+    testDiag("test_union");
+
+    NTPrototypePtr prototype = NTUnion::createBuilder()->addDescriptor()->createPrototype();
+    NTUnionPtr ntUnion = NTUnion::wrapUnsafe(prototype->getPVStructure());
+    PVStringPtr value = pvDataCreate->createPVScalar<PVString>();
+    value->put("selected");
+    ntUnion->getValue()->set(value);
+
+    testOk1(prototype->getCopiedFieldCount() == 1);
+
+    PVStructurePtr instance = prototype->create();
+    testOk1(instance->getStructure() == prototype->getPVStructure()->getStructure());
+    testOk1(*instance == *prototype->getPVStructure());
+
+    // the value of a union is cloned
+    PVStringPtr clone = NTUnion::wrapUnsafe(instance)->getValue()->get<PVString>();
+    testOk1(clone && clone != value && clone->get() == "selected");
+    clone->put("changed");
+    testOk1(value->get() == "selected");
+}
+
+MAIN(testNTPrototype) {
+    testPlan(38);
+    test_scalar();
+    test_defaults();
+    test_table();
+    test_ndarray();
+    test_enum();
+    test_union();
+    return testDone();
+}
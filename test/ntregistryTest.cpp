@@ -0,0 +1,172 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/nt.h>
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+static FieldCreatePtr fieldCreate = getFieldCreate();
+
+void test_entries()
+{
+    testDiag("test_entries");
+
+    testOk1(NTRegistry::getEntry(ntUnknown) == 0);
+    testOk1(std::string(NTRegistry::getName(ntUnknown)) == "unknown");
+
+    bool ok = true;
+    for (size_t i = 1; i < NTRegistry::TYPE_COUNT; ++i) {
+        NTType type = static_cast<NTType>(i);
+        NTRegistry::Entry const * entry = NTRegistry::getEntry(type);
+        if (!entry || entry->type != type ||
+            std::string(NTRegistry::getName(type)) != entry->name ||
+            entry->uri->compare(0, 9, "epics:nt/") != 0)
+            ok = false;
+    }
+    testOk(ok, "all %u entries", (unsigned)(NTRegistry::TYPE_COUNT - 1));
+
+    testOk1(std::string(NTRegistry::getName(ntNDArray)) == "NTNDArray");
+    testOk1(NTRegistry::getEntry(ntNDArray)->uri == &NTNDArray::URI);
+}
+
+void test_identify_id()
+{
+    testDiag("test_identify_id");
+
+    testOk1(NTRegistry::identify(NTScalar::URI) == ntScalar);
+    testOk1(NTRegistry::identify(NTScalarArray::URI) == ntScalarArray);
+    testOk1(NTRegistry::identify(NTNameValue::URI) == ntNameValue);
+    testOk1(NTRegistry::identify(NTTable::URI) == ntTable);
+    testOk1(NTRegistry::identify(NTNDArray::URI) == ntNDArray);
+    testOk1(NTRegistry::identify(NTMultiChannel::URI) == ntMultiChannel);
+    testOk1(NTRegistry::identify(NTScalarMultiChannel::URI) == ntScalarMultiChannel);
+    testOk1(NTRegistry::identify(NTMatrix::URI) == ntMatrix);
+    testOk1(NTRegistry::identify(NTEnum::URI) == ntEnum);
+    testOk1(NTRegistry::identify(NTUnion::URI) == ntUnion);
+    testOk1(NTRegistry::identify(NTAggregate::URI) == ntAggregate);
+    testOk1(NTRegistry::identify(NTAttribute::URI) == ntAttribute);
+    testOk1(NTRegistry::identify(NTContinuum::URI) == ntContinuum);
+    testOk1(NTRegistry::identify(NTHistogram::URI) == ntHistogram);
+    testOk1(NTRegistry::identify(NTURI::URI) == ntURI);
+
+    // same rules as NTUtils::is_a
+    testOk1(NTRegistry::identify("epics:nt/NTTable:1.1") == ntTable);
+    testOk1(NTRegistry::identify("epics:nt/NTTable:1") == ntTable);
+    testOk1(NTRegistry::identify("epics:nt/NTTable:2.0") == ntUnknown);
+    testOk1(NTRegistry::identify("epics:nt/NTTable:11.0") == ntUnknown);
+    testOk1(NTRegistry::identify("epics:nt/NTTables:1.0") == ntUnknown);
+    testOk1(NTRegistry::identify("NTTable") == ntUnknown);
+    testOk1(NTRegistry::identify("") == ntUnknown);
+    testOk1(NTRegistry::identify("structure") == ntUnknown);
+
+    testOk1(NTRegistry::find(NTTable::URI) == NTRegistry::getEntry(ntTable));
+    testOk1(NTRegistry::find("epics:nt/NTFoo:1.0") == 0);
+}
+
+void test_identify_structure()
+{
+    testDiag("test_identify_structure");
+
+    StructureConstPtr scalar = NTScalar::createBuilder()->
+        value(pvDouble)->addAlarm()->createStructure();
+    testOk1(NTRegistry::identify(scalar) == ntScalar);
+    testOk1(NTRegistry::identifyCompatible(scalar) == ntScalar);
+    testOk1(NTRegistry::identifyCompatible(scalar, false) == ntScalar);
+
+    StructureConstPtr table = NTTable::createBuilder()->
+        addColumn("x", pvDouble)->createStructure();
+    testOk1(NTRegistry::identify(table) == ntTable);
+
+    // claims to be an NTScalar, but is not compatible
+    StructureConstPtr fake = fieldCreate->createFieldBuilder()->
+        setId(NTScalar::URI)->
+        add("x", pvDouble)->
+        createStructure();
+    testOk1(NTRegistry::identify(fake) == ntScalar);
+    testOk1(NTRegistry::identifyCompatible(fake) == ntUnknown);
+    testOk1(NTRegistry::identifyCompatible(fake, false) == ntUnknown);
+
+    StructureConstPtr plain = fieldCreate->createFieldBuilder()->
+        add("value", pvDouble)->
+        createStructure();
+    testOk1(NTRegistry::identify(plain) == ntUnknown);
+    testOk1(NTRegistry::identify(StructureConstPtr()) == ntUnknown);
+    testOk1(NTRegistry::identify(PVStructurePtr()) == ntUnknown);
+
+    // NTNDArrayAttribute and NTAttribute share their ID
+    StructureConstPtr attribute = NTAttribute::createBuilder()->
+        addTags()->createStructure();
+    StructureConstPtr ndattribute = NTNDArrayAttribute::createBuilder()->
+        addTags()->createStructure();
+    testOk1(attribute->getID() == ndattribute->getID());
+    testOk1(NTRegistry::identify(attribute) == ntAttribute);
+    testOk1(NTRegistry::identify(ndattribute) == ntNDArrayAttribute);
+    testOk1(NTRegistry::identifyCompatible(ndattribute) == ntNDArrayAttribute);
+}
+
+class CountingVisitor : public NTVisitor
+{
+public:
+    CountingVisitor() : scalars(0), tables(0) {}
+
+    virtual void visit(NTScalarPtr const & nt) {
+        if (nt) ++scalars;
+    }
+
+    virtual void visit(NTTablePtr const & nt) {
+        if (nt) ++tables;
+    }
+
+    int scalars;
+    int tables;
+};
+
+void test_wrap()
+{
+    testDiag("test_wrap");
+
+    CountingVisitor visitor;
+
+    PVStructurePtr scalar = NTScalar::createBuilder()->
+        value(pvInt)->createPVStructure();
+    testOk1(NTRegistry::wrap(scalar, visitor) == ntScalar);
+    testOk1(visitor.scalars == 1 && visitor.tables == 0);
+
+    PVStructurePtr table = NTTable::createBuilder()->
+        addColumn("x", pvDouble)->createPVStructure();
+    testOk1(NTRegistry::wrap(table, visitor) == ntTable);
+    testOk1(visitor.scalars == 1 && visitor.tables == 1);
+
+    // not visited by this visitor, but wrapped
+    PVStructurePtr enumeration = NTEnum::createBuilder()->createPVStructure();
+    testOk1(NTRegistry::wrap(enumeration, visitor) == ntEnum);
+    testOk1(visitor.scalars == 1 && visitor.tables == 1);
+
+    PVStructurePtr fake = getPVDataCreate()->createPVStructure(
+        fieldCreate->createFieldBuilder()->
+            setId(NTScalar::URI)->
+            add("x", pvDouble)->
+            createStructure());
+    testOk1(NTRegistry::wrap(fake, visitor) == ntUnknown);
+    testOk1(visitor.scalars == 1);
+    testOk1(NTRegistry::wrap(fake, visitor, false) == ntScalar);
+    testOk1(visitor.scalars == 2);
+
+    testOk1(NTRegistry::wrap(PVStructurePtr(), visitor) == ntUnknown);
+}
+
+MAIN(testNTRegistry) {
+    testPlan(55);
+    test_entries();
+    test_identify_id();
+    test_identify_structure();
+    test_wrap();
+    return testDone();
+}
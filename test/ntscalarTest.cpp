@@ -224,10 +224,14 @@ void test_wrap()
 
     ptr = NTScalar::wrapUnsafe(pvStructure);
     testOk(ptr.get() != 0, "wrapUnsafe OK");
+
+    // the subfields are looked up when wrapped
+    testOk1(ptr->getValue() == pvStructure->getSubField("value"));
+    testOk1(!ptr->getDescriptor() && !ptr->getAlarm() && !ptr->getTimeStamp());
 }
 
 MAIN(testNTScalar) {
-    testPlan(37);
+    testPlan(39);
     test_builder();
     test_ntscalar();
     test_wrap();
@@ -0,0 +1,225 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <vector>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+#include <epicsThread.h>
+
+#include <pv/nt.h>
+#include <pv/ntstatistics.h>
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+static NTStatistics::Counters const & counters(NTStatistics::Snapshot const & snapshot,
+    NTType type, NTStatistics::Operation operation)
+{
+    return snapshot.counters[type][operation];
+}
+
+void test_disabled()
+{
+    testDiag("test_disabled");
+
+    testOk1(!NTStatistics::isEnabled());
+
+    NTStatistics::reset();
+    PVStructurePtr pvStructure = NTScalar::createBuilder()->
+        value(pvDouble)->createPVStructure();
+    testOk1(NTScalar::wrap(pvStructure).get() != 0);
+
+    NTStatistics::Snapshot snapshot;
+    NTStatistics::getSnapshot(snapshot);
+    testOk1(counters(snapshot, ntScalar, NTStatistics::opWrap).calls == 0);
+    testOk1(counters(snapshot, ntScalar, NTStatistics::opIsCompatible).calls == 0);
+
+    // the compatibility caches count regardless
+    testOk1(snapshot.cacheHits[ntScalar] + snapshot.cacheMisses[ntScalar] == 1);
+}
+
+void test_counts()
+{
+    testDiag("test_counts");
+
+    NTStatistics::setEnabled(true);
+    testOk1(NTStatistics::isEnabled());
+    NTStatistics::reset();
+
+    StructureConstPtr structure = NTScalar::createBuilder()->
+        value(pvInt)->addAlarm()->createStructure();
+    StructureConstPtr other = NTScalarArray::createBuilder()->
+        value(pvInt)->createStructure();
+
+    NTScalarPtr scalar;
+    for (int i = 0; i < 3; ++i)
+        scalar = NTScalar::wrap(getPVDataCreate()->createPVStructure(structure));
+    testOk1(scalar.get() != 0);
+    testOk1(!NTScalar::wrap(getPVDataCreate()->createPVStructure(other)));
+    testOk1(scalar->isValid());
+
+    NTStatistics::Snapshot snapshot;
+    NTStatistics::getSnapshot(snapshot);
+
+    NTStatistics::Counters const & wrap = counters(snapshot, ntScalar, NTStatistics::opWrap);
+    testOk1(wrap.calls == 4);
+    testOk1(wrap.failures == 1);
+
+    // the cache runs the check once per distinct structure
+    NTStatistics::Counters const & compatible =
+        counters(snapshot, ntScalar, NTStatistics::opIsCompatible);
+    testOk1(compatible.calls == 2);
+    testOk1(compatible.failures == 1);
+    testOk1(compatible.nanoseconds > 0);
+    testOk1(snapshot.cacheHits[ntScalar] == 2);
+    testOk1(snapshot.cacheMisses[ntScalar] == 2);
+
+    NTStatistics::Counters const & valid = counters(snapshot, ntScalar, NTStatistics::opIsValid);
+    testOk1(valid.calls == 1);
+    testOk1(valid.failures == 0);
+
+    testOk1(counters(snapshot, ntScalarArray, NTStatistics::opWrap).calls == 0);
+    testOk1(counters(snapshot, ntUnknown, NTStatistics::opWrap).calls == 0);
+
+    // direct checks are counted as well
+    testOk1(!NTTable::isCompatible(StructureConstPtr()));
+    NTStatistics::getSnapshot(snapshot);
+    testOk1(counters(snapshot, ntTable, NTStatistics::opIsCompatible).calls == 1);
+    testOk1(counters(snapshot, ntTable, NTStatistics::opIsCompatible).failures == 1);
+
+    NTStatistics::reset();
+    NTStatistics::getSnapshot(snapshot);
+    testOk1(counters(snapshot, ntScalar, NTStatistics::opWrap).calls == 0);
+    testOk1(counters(snapshot, ntScalar, NTStatistics::opIsCompatible).nanoseconds == 0);
+    testOk1(snapshot.cacheHits[ntScalar] == 0 && snapshot.cacheMisses[ntScalar] == 0);
+
+    NTStatistics::setEnabled(false);
+}
+
+void test_wide()
+{
+    testDiag("test_wide");
+
+    NTStatistics::reset();
+
+    // the durations accumulate beyond 32 bits
+    const epicsUInt64 ns = 3000000000u;
+    for (int i = 0; i < 3; ++i)
+        NTStatistics::record(ntEnum, NTStatistics::opIsValid, false, ns);
+
+    NTStatistics::Snapshot snapshot;
+    NTStatistics::getSnapshot(snapshot);
+    testOk1(counters(snapshot, ntEnum, NTStatistics::opIsValid).calls == 3);
+    testOk1(counters(snapshot, ntEnum, NTStatistics::opIsValid).nanoseconds == 3 * ns);
+
+    NTStatistics::reset();
+}
+
+class Wrapper : public epicsThreadRunable
+{
+public:
+    Wrapper(PVStructurePtr const & pvStructure, int count)
+    : pvStructure(pvStructure), count(count) {}
+
+    virtual void run()
+    {
+        for (int i = 0; i < count; ++i)
+            NTNDArrayAttribute::wrap(pvStructure);
+    }
+
+private:
+    PVStructurePtr pvStructure;
+    int count;
+};
+
+void test_threads()
+{
+    testDiag("test_threads");
+
+    NTStatistics::setEnabled(true);
+    NTStatistics::reset();
+
+    PVStructurePtr pvStructure = NTNDArrayAttribute::createBuilder()->
+        createPVStructure();
+
+    const int threads = 4;
+    const int count = 1000;
+
+    // the second round reuses the counters of the threads of the first
+    Wrapper wrapper(pvStructure, count);
+    for (int round = 1; round <= 2; ++round) {
+        std::vector<epicsThread *> pool;
+        for (int i = 0; i < threads; ++i) {
+            pool.push_back(new epicsThread(wrapper, "ntstatisticsTest",
+                epicsThreadGetStackSize(epicsThreadStackSmall)));
+            pool.back()->start();
+        }
+        for (size_t i = 0; i < pool.size(); ++i) {
+            pool[i]->exitWait();
+            delete pool[i];
+        }
+
+        // counters of exited threads are kept
+        epicsUInt64 expected = round * threads * count;
+        NTStatistics::Snapshot snapshot;
+        NTStatistics::getSnapshot(snapshot);
+        NTStatistics::Counters const & wrap =
+            counters(snapshot, ntNDArrayAttribute, NTStatistics::opWrap);
+        testOk(wrap.calls == expected, "%u calls", (unsigned)wrap.calls);
+        testOk1(wrap.failures == 0);
+        testOk1(snapshot.cacheHits[ntNDArrayAttribute] +
+                snapshot.cacheMisses[ntNDArrayAttribute] == expected);
+    }
+
+    // reset() applies to the counters of exited threads as well
+    NTStatistics::reset();
+    NTStatistics::Snapshot snapshot;
+    NTStatistics::getSnapshot(snapshot);
+    testOk1(counters(snapshot, ntNDArrayAttribute, NTStatistics::opWrap).calls == 0);
+
+    NTStatistics::setEnabled(false);
+}
+
+void test_table()
+{
+    testDiag("test_table");
+
+    NTStatistics::Snapshot snapshot;
+    snapshot.counters[ntTable][NTStatistics::opWrap].calls = 7;
+    snapshot.counters[ntTable][NTStatistics::opWrap].failures = 2;
+    snapshot.counters[ntURI][NTStatistics::opIsValid].nanoseconds = 12345;
+    snapshot.cacheHits[ntEnum] = 3;
+    snapshot.cacheMisses[ntEnum] = 1;
+
+    NTTablePtr table = NTStatistics::createTable(snapshot);
+    testOk1(table.get() != 0);
+    testOk1(table->isValid());
+    testOk1(table->getTimeStamp().get() != 0);
+    testOk1(table->getColumnNames().size() == 12);
+
+    PVStringArray::const_svector types =
+        table->getColumn<PVStringArray>("type")->view();
+    testOk1(types.size() == NTRegistry::TYPE_COUNT - 1);
+    testOk1(types[ntTable - 1] == "NTTable");
+
+    testOk1(table->getColumn<PVULongArray>("wrapCalls")->view()[ntTable - 1] == 7);
+    testOk1(table->getColumn<PVULongArray>("wrapFailures")->view()[ntTable - 1] == 2);
+    testOk1(table->getColumn<PVULongArray>("wrapCalls")->view()[ntScalar - 1] == 0);
+    testOk1(table->getColumn<PVULongArray>("isValidNanoseconds")->view()[ntURI - 1] == 12345);
+    testOk1(table->getColumn<PVULongArray>("cacheHits")->view()[ntEnum - 1] == 3);
+    testOk1(table->getColumn<PVULongArray>("cacheMisses")->view()[ntEnum - 1] == 1);
+}
+
+MAIN(testNTStatistics) {
+    testPlan(47);
+    test_disabled();
+    test_counts();
+    test_wide();
+    test_threads();
+    test_table();
+    return testDone();
+}
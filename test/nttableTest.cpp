@@ -237,11 +237,59 @@ void test_wrap()
     testOk(ptr.get() != 0, "wrapUnsafe OK");
 }
 
+void test_columns()
+{
+    testDiag("test_columns");
+
+    NTTablePtr ntTable = NTTable::createBuilder()->
+            addColumn("x", pvDouble)->
+            addColumn("name", pvString)->
+            addColumn("count", pvInt)->
+            addColumn("a", pvDouble)->
+            create();
+
+    testOk1(ntTable->getNumberColumns() == 4);
+    testOk1(ntTable->getColumnIndex("x") == 0);
+    testOk1(ntTable->getColumnIndex("name") == 1);
+    testOk1(ntTable->getColumnIndex("count") == 2);
+    testOk1(ntTable->getColumnIndex("a") == 3);
+    testOk1(ntTable->getColumnIndex("y") == NTTable::npos);
+    testOk1(ntTable->getColumnIndex("") == NTTable::npos);
+
+    testOk1(ntTable->getColumn(1) == ntTable->getColumn("name"));
+    testOk1(ntTable->getColumn(4).get() == 0);
+    testOk1(ntTable->getColumn("y").get() == 0);
+    testOk1(ntTable->getColumn<PVIntArray>(2).get() != 0);
+    testOk1(ntTable->getColumn<PVDoubleArray>(2).get() == 0);
+    testOk1(ntTable->getColumn<PVScalarArray>(2).get() != 0);
+
+    PVDoubleArray::svector x(3);
+    x[0] = 1.0; x[1] = 2.0; x[2] = 3.0;
+    ntTable->getColumn<PVDoubleArray>(0)->replace(freeze(x));
+    PVIntArray::svector count(2, 7);
+    ntTable->getColumn<PVIntArray>("count")->replace(freeze(count));
+
+    // the elements are shared if the type matches
+    shared_vector<const double> xs = ntTable->getColumnView<double>("x");
+    testOk1(xs.size() == 3 && xs[2] == 3.0);
+    testOk1(xs.data() == ntTable->getColumn<PVDoubleArray>(0)->view().data());
+
+    // and converted otherwise
+    shared_vector<const double> counts = ntTable->getColumnView<double>(2);
+    testOk1(counts.size() == 2 && counts[0] == 7.0);
+    shared_vector<const std::string> names = ntTable->getColumnView<std::string>(0);
+    testOk1(names.size() == 3 && !names[0].empty());
+
+    testOk1(ntTable->getColumnView<double>("y").empty());
+    testOk1(ntTable->getColumnView<double>(4).empty());
+}
+
 MAIN(testNTTable) {
-    testPlan(50);
+    testPlan(69);
     test_builder();
     test_labels();
     test_nttable();
     test_wrap();
+    test_columns();
     return testDone();
 }
@@ -0,0 +1,127 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/nt.h>
+#include <pv/nttyped.h>
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+typedef NTScalarT<double, WithAlarm, WithTimeStamp> NTDouble;
+typedef NTScalarT<std::string, WithDescriptor> NTString;
+typedef NTScalarArrayT<int32, WithDisplay, WithControl> NTInts;
+
+void test_scalar()
+{
+    testDiag("test_scalar");
+
+    StructureConstPtr structure = NTDouble::getStructure();
+    testOk1(structure.get() == NTDouble::getStructure().get());
+    testOk1(structure == NTScalar::createBuilder()->
+        value(pvDouble)->addAlarm()->addTimeStamp()->createStructure());
+
+    // the order of the options does not matter
+    testOk1((NTScalarT<double, WithTimeStamp, WithAlarm>::getStructure() == structure));
+
+    NTDouble::shared_pointer ntDouble = NTDouble::create();
+    testOk1(ntDouble->getPVStructure()->getStructure() == structure);
+
+    ntDouble->put(1.5);
+    testOk1(ntDouble->get() == 1.5);
+    testOk1(ntDouble->getPVStructure()->getSubFieldT<PVDouble>("value")->get() == 1.5);
+    PVDouble & value = ntDouble->getValue();
+    value.put(2.5);
+    testOk1(ntDouble->getNTScalar()->getValue<PVDouble>()->get() == 2.5);
+
+    ntDouble->getAlarm().getSubFieldT<PVInt>("severity")->put(2);
+    testOk1(ntDouble->getNTScalar()->getAlarm()->getSubFieldT<PVInt>("severity")->get() == 2);
+    testOk1(&ntDouble->getTimeStamp() == ntDouble->getNTScalar()->getTimeStamp().get());
+
+    testOk1(NTDouble::hasAlarm && NTDouble::hasTimeStamp);
+    testOk1(!NTDouble::hasDescriptor && !NTDouble::hasDisplay && !NTDouble::hasControl);
+
+    NTString::shared_pointer ntString = NTString::create();
+    ntString->put("text");
+    ntString->getDescriptor().put("a string");
+    testOk1(ntString->get() == "text");
+    testOk1(ntString->getNTScalar()->getDescriptor()->get() == "a string");
+}
+
+void test_wrap()
+{
+    testDiag("test_wrap");
+
+    // the same structure
+    PVStructurePtr pvStructure = NTScalar::createBuilder()->
+        value(pvDouble)->addAlarm()->addTimeStamp()->createPVStructure();
+    testOk1(NTDouble::isCompatible(pvStructure));
+    NTDouble::shared_pointer ntDouble = NTDouble::wrap(pvStructure);
+    testOk1(ntDouble.get() != 0);
+    ntDouble->put(3.0);
+    testOk1(pvStructure->getSubFieldT<PVDouble>("value")->get() == 3.0);
+
+    // more optional fields than the type
+    pvStructure = NTScalar::createBuilder()->
+        value(pvDouble)->addAlarm()->addTimeStamp()->addDisplay()->createPVStructure();
+    testOk1(NTDouble::isCompatible(pvStructure));
+    testOk1(NTDouble::wrap(pvStructure).get() != 0);
+
+    // a missing optional field
+    pvStructure = NTScalar::createBuilder()->
+        value(pvDouble)->addAlarm()->createPVStructure();
+    testOk1(!NTDouble::isCompatible(pvStructure));
+    testOk1(NTDouble::wrap(pvStructure).get() == 0);
+
+    // another value type
+    pvStructure = NTScalar::createBuilder()->
+        value(pvFloat)->addAlarm()->addTimeStamp()->createPVStructure();
+    testOk1(!NTDouble::isCompatible(pvStructure));
+    testOk1(NTDouble::wrap(pvStructure).get() == 0);
+
+    // not an NTScalar
+    testOk1(!NTDouble::isCompatible(NTInts::create()->getPVStructure()));
+    testOk1(!NTDouble::isCompatible(PVStructurePtr()));
+}
+
+void test_array()
+{
+    testDiag("test_array");
+
+    testOk1(NTInts::getStructure() == NTScalarArray::createBuilder()->
+        value(pvInt)->addDisplay()->addControl()->createStructure());
+
+    NTInts::shared_pointer ntInts = NTInts::create();
+    testOk1(ntInts->view().size() == 0);
+
+    NTInts::svector values(3);
+    values[0] = 1;
+    values[1] = 2;
+    values[2] = 3;
+    ntInts->replace(freeze(values));
+    testOk1(ntInts->view().size() == 3 && ntInts->view()[2] == 3);
+    testOk1(ntInts->getNTScalarArray()->getValue<PVIntArray>()->view().size() == 3);
+    testOk1(&ntInts->getValue() == ntInts->getPVStructure()->getSubField<PVIntArray>("value").get());
+
+    ntInts->getDisplay().getSubFieldT<PVString>("units")->put("counts");
+    testOk1(ntInts->getNTScalarArray()->getDisplay()->getSubFieldT<PVString>("units")->get() == "counts");
+    testOk1(&ntInts->getControl() == ntInts->getNTScalarArray()->getControl().get());
+
+    PVStructurePtr pvStructure = NTScalarArray::createBuilder()->
+        value(pvDouble)->addDisplay()->addControl()->createPVStructure();
+    testOk1(!NTInts::isCompatible(pvStructure));
+    testOk1((NTScalarArrayT<double, WithControl>::isCompatible(pvStructure)));
+}
+
+MAIN(testNTTyped) {
+    testPlan(33);
+    test_scalar();
+    test_wrap();
+    test_array();
+    return testDone();
+}
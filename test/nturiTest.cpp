@@ -0,0 +1,68 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+#include <epicsUnitTest.h>
+#include <testMain.h>
+
+#include <pv/nt.h>
+
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+void test_query()
+{
+    testDiag("test_query");
+
+    NTURIPtr ntURI = NTURI::createBuilder()->
+            addAuthority()->
+            addQueryString("name")->
+            addQueryDouble("limit")->
+            create();
+    testOk1(ntURI.get() != 0);
+    if (!ntURI)
+        return;
+
+    testOk1(NTURI::is_a(ntURI->getPVStructure()));
+    testOk1(NTURI::isCompatible(ntURI->getPVStructure()));
+    testOk1(ntURI->getScheme().get() != 0);
+    testOk1(ntURI->getAuthority().get() != 0);
+    testOk1(ntURI->getPath().get() != 0);
+    testOk1(ntURI->getQuery().get() != 0);
+
+    StringArray const & names = ntURI->getQueryNames();
+    testOk1(names.size() == 2);
+    testOk1(names.size() == 2 && names[0] == "name" && names[1] == "limit");
+    testOk1(ntURI->getQueryField<PVString>("name").get() != 0);
+    testOk1(ntURI->getQueryField<PVDouble>("limit").get() != 0);
+    testOk1(ntURI->getQueryField<PVInt>("limit").get() == 0);
+    testOk1(ntURI->getQueryField("other").get() == 0);
+}
+
+void test_noQuery()
+{
+    testDiag("test_noQuery");
+
+    PVStructurePtr pvStructure = NTURI::createBuilder()->
+            createPVStructure();
+    testOk1(pvStructure->getSubField("query").get() == 0);
+
+    NTURIPtr ntURI = NTURI::wrap(pvStructure);
+    testOk1(ntURI.get() != 0);
+    if (!ntURI)
+        return;
+
+    testOk1(ntURI->getAuthority().get() == 0);
+    testOk1(ntURI->getQuery().get() == 0);
+    testOk1(ntURI->getQueryNames().empty());
+    testOk1(ntURI->getQueryField("name").get() == 0);
+    testOk1(ntURI->getQueryField<PVString>("name").get() == 0);
+}
+
+MAIN(testNTURI) {
+    testPlan(20);
+    test_query();
+    test_noQuery();
+    return testDone();
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+/*
+ * Microbenchmark of the is_a type ID tests of every normative type.
+ *
+ * Compares the former substr based NTUtils::is_a with the current
+ * one, with NTTypeKey::is_a and with the NT*::is_a methods.
+ *
+ * Built with the tests, but not run by them. Usage:
+ *   ntutilsBench [iterations]
+ */
+
+#include <stdlib.h>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+#include <epicsTypes.h>
+#include <epicsTime.h>
+
+#include <pv/nt.h>
+#include <pv/ntutils.h>
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+namespace {
+
+typedef bool (*is_a_t)(StructureConstPtr const &);
+
+struct Type {
+    const char * name;
+    std::string const * uri;
+    is_a_t is_a;
+};
+
+const Type types[] = {
+    { "NTScalar", &NTScalar::URI, &NTScalar::is_a },
+    { "NTScalarArray", &NTScalarArray::URI, &NTScalarArray::is_a },
+    { "NTNameValue", &NTNameValue::URI, &NTNameValue::is_a },
+    { "NTTable", &NTTable::URI, &NTTable::is_a },
+    { "NTNDArray", &NTNDArray::URI, &NTNDArray::is_a },
+    { "NTMultiChannel", &NTMultiChannel::URI, &NTMultiChannel::is_a },
+    { "NTScalarMultiChannel", &NTScalarMultiChannel::URI, &NTScalarMultiChannel::is_a },
+    { "NTMatrix", &NTMatrix::URI, &NTMatrix::is_a },
+    { "NTEnum", &NTEnum::URI, &NTEnum::is_a },
+    { "NTUnion", &NTUnion::URI, &NTUnion::is_a },
+    { "NTAggregate", &NTAggregate::URI, &NTAggregate::is_a },
+    { "NTAttribute", &NTAttribute::URI, &NTAttribute::is_a },
+    { "NTContinuum", &NTContinuum::URI, &NTContinuum::is_a },
+    { "NTHistogram", &NTHistogram::URI, &NTHistogram::is_a },
+    { "NTURI", &NTURI::URI, &NTURI::is_a },
+    { "NTNDArrayAttribute", &NTNDArrayAttribute::URI, &NTNDArrayAttribute::is_a },
+};
+
+const size_t typeCount = sizeof(types) / sizeof(types[0]);
+
+// NTUtils::is_a as it was, allocating two substrings
+bool substrIs_a(const std::string &u1, const std::string &u2)
+{
+    size_t pos1 = u1.find_last_of('.');
+    std::string su1 = (pos1 == std::string::npos) ? u1 : u1.substr(0, pos1);
+
+    size_t pos2 = u2.find_last_of('.');
+    std::string su2 = (pos2 == std::string::npos) ? u2 : u2.substr(0, pos2);
+
+    return su2 == su1;
+}
+
+// million calls per second
+double rate(epicsUInt64 start, size_t calls)
+{
+    epicsUInt64 ns = epicsMonotonicGet() - start;
+    return ns ? calls * 1e3 / ns : 0.0;
+}
+
+}
+
+MAIN(ntutilsBench)
+{
+    size_t iterations = 1000000;
+    if (argc > 1)
+        iterations = strtoul(argv[1], NULL, 0);
+
+    testPlan(1);
+
+    // a different minor version, which must still match
+    std::vector<std::string> ids;
+    std::vector<StructureConstPtr> structures;
+    for (size_t t = 0; t < typeCount; ++t) {
+        ids.push_back(types[t].uri->substr(0, types[t].uri->find_last_of('.')) + ".7");
+        structures.push_back(getFieldCreate()->createFieldBuilder()->
+            setId(*types[t].uri)->createStructure());
+    }
+
+    bool ok = true;
+    for (size_t t = 0; t < typeCount; ++t) {
+        NTTypeKey key(*types[t].uri);
+        ok = ok && substrIs_a(ids[t], *types[t].uri) &&
+            NTUtils::is_a(ids[t], *types[t].uri) &&
+            key.is_a(ids[t]) && types[t].is_a(structures[t]);
+    }
+    testOk(ok, "all is_a agree for %u types", (unsigned)typeCount);
+
+    testDiag("%u iterations, million calls per second", (unsigned)iterations);
+    testDiag("%-22s %10s %10s %10s %10s", "type", "substr", "NTUtils", "NTTypeKey", "NT::is_a");
+
+    size_t sink = 0;
+    for (size_t t = 0; t < typeCount; ++t) {
+        std::string const & uri = *types[t].uri;
+        std::string const & id = ids[t];
+        NTTypeKey key(uri);
+
+        epicsUInt64 start = epicsMonotonicGet();
+        for (size_t i = 0; i < iterations; ++i)
+            sink += substrIs_a(id, uri);
+        double substr = rate(start, iterations);
+
+        start = epicsMonotonicGet();
+        for (size_t i = 0; i < iterations; ++i)
+            sink += NTUtils::is_a(id, uri);
+        double utils = rate(start, iterations);
+
+        start = epicsMonotonicGet();
+        for (size_t i = 0; i < iterations; ++i)
+            sink += key.is_a(id);
+        double keyed = rate(start, iterations);
+
+        start = epicsMonotonicGet();
+        for (size_t i = 0; i < iterations; ++i)
+            sink += types[t].is_a(structures[t]);
+        double nt = rate(start, iterations);
+
+        testDiag("%-22s %10.1f %10.1f %10.1f %10.1f", types[t].name, substr, utils, keyed, nt);
+    }
+    testDiag("(%u)", (unsigned)(sink & 1));
+
+    return testDone();
+}
@@ -28,8 +28,43 @@ void test_is_a()
     testOk1(!NTUtils::is_a("epics:nt/NTTable:1.0", "epics:nt/NTMatrix:1.0"));
 }
 
+void test_is_a_ranges()
+{
+    testDiag("test_is_a_ranges");
+
+    const char *u = "epics:nt/NTTable:1.0 trailing";
+    testOk1(NTUtils::is_a(u, 20, "epics:nt/NTTable:1.1", 20));
+    testOk1(NTUtils::is_a(u, 18, "epics:nt/NTTable:1", 18));
+    testOk1(!NTUtils::is_a(u, 17, "epics:nt/NTTable:1", 18));
+    testOk1(!NTUtils::is_a(u, 20, "epics:nt/NTTable:2.0", 20));
+    testOk1(NTUtils::is_a("", 0, "", 0));
+
+    testOk1(NTUtils::majorLength("epics:nt/NTTable:1.0", 20) == 18);
+    testOk1(NTUtils::majorLength("epics:nt/NTTable:1", 18) == 18);
+    testOk1(NTUtils::majorLength("a.b.c", 5) == 3);
+    testOk1(NTUtils::majorLength("", 0) == 0);
+}
+
+void test_type_key()
+{
+    testDiag("test_type_key");
+
+    NTTypeKey key("epics:nt/NTTable:1.0");
+    testOk1(key.str() == "epics:nt/NTTable:1");
+
+    testOk1(key.is_a("epics:nt/NTTable:1.0"));
+    testOk1(key.is_a("epics:nt/NTTable:1.1"));
+    testOk1(key.is_a("epics:nt/NTTable:1"));
+    testOk1(!key.is_a("epics:nt/NTTable:2.0"));
+    testOk1(!key.is_a("epics:nt/NTTable:11.0"));
+    testOk1(!key.is_a("epics:nt/NTMatrix:1.0"));
+    testOk1(!key.is_a(""));
+}
+
 MAIN(testNTUtils) {
-    testPlan(10);
+    testPlan(27);
     test_is_a();
+    test_is_a_ranges();
+    test_type_key();
     return testDone();
 }
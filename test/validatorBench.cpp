@@ -0,0 +1,138 @@
+/*
+ * Copyright information and license terms for this software can be
+ * found in the file LICENSE that is included with the distribution
+ */
+
+/*
+ * Microbenchmark of the validator on the deep NTNDArray introspection
+ * tree (value union, codec, dimension, attribute).
+ *
+ * Compares classifying nodes by dynamic_cast with classifying them by
+ * their pvData Type, as the validator does, and times the complete
+ * NTNDArray::isCompatible check.
+ *
+ * Built with the tests, but not run by them. Usage:
+ *   validatorBench [iterations]
+ */
+
+#include <stdlib.h>
+#include <vector>
+
+#include <epicsUnitTest.h>
+#include <testMain.h>
+#include <epicsTypes.h>
+#include <epicsTime.h>
+
+#include "../src/validator.h"
+#include <pv/ntndarray.h>
+
+using namespace epics::nt;
+using namespace epics::pvData;
+
+namespace {
+
+typedef std::vector<Field const *> Nodes;
+
+void collect(Field const * field, Nodes & nodes)
+{
+    nodes.push_back(field);
+
+    StringArray const * names;
+    FieldConstPtrArray const * fields;
+    if (Result::members(field, names, fields)) {
+        for (size_t i = 0; i < fields->size(); ++i)
+            collect((*fields)[i].get(), nodes);
+    }
+}
+
+template<typename T>
+size_t countCast(Nodes const & nodes)
+{
+    size_t n = 0;
+    for (Nodes::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
+        if (dynamic_cast<T const *>(*it))
+            ++n;
+    return n;
+}
+
+template<typename T>
+size_t countType(Nodes const & nodes)
+{
+    size_t n = 0;
+    for (Nodes::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
+        if (epics::nt::detail::isType<T>(*it))
+            ++n;
+    return n;
+}
+
+size_t classifyCast(Nodes const & nodes)
+{
+    return countCast<Scalar>(nodes) + countCast<ScalarArray>(nodes)
+         + countCast<Structure>(nodes) + countCast<StructureArray>(nodes)
+         + countCast<Union>(nodes) + countCast<UnionArray>(nodes);
+}
+
+size_t classifyType(Nodes const & nodes)
+{
+    return countType<Scalar>(nodes) + countType<ScalarArray>(nodes)
+         + countType<Structure>(nodes) + countType<StructureArray>(nodes)
+         + countType<Union>(nodes) + countType<UnionArray>(nodes);
+}
+
+// nanoseconds per call of fn
+template<typename F>
+double timeIt(F fn, Nodes const & nodes, size_t iterations, size_t & sink)
+{
+    epicsUInt64 start = epicsMonotonicGet();
+    for (size_t i = 0; i < iterations; ++i)
+        sink += fn(nodes);
+    epicsUInt64 stop = epicsMonotonicGet();
+    return double(stop - start) / iterations;
+}
+
+double timeIsCompatible(StructureConstPtr const & structure, size_t iterations, size_t & sink)
+{
+    epicsUInt64 start = epicsMonotonicGet();
+    for (size_t i = 0; i < iterations; ++i)
+        sink += NTNDArray::isCompatible(structure);
+    epicsUInt64 stop = epicsMonotonicGet();
+    return double(stop - start) / iterations;
+}
+
+}
+
+MAIN(validatorBench)
+{
+    size_t iterations = 100000;
+    if (argc > 1)
+        iterations = strtoul(argv[1], NULL, 0);
+
+    testPlan(2);
+
+    StructureConstPtr structure = NTNDArray::createBuilder()->
+        addDescriptor()->
+        addTimeStamp()->
+        addAlarm()->
+        addDisplay()->
+        createStructure();
+
+    Nodes nodes;
+    collect(structure.get(), nodes);
+
+    testOk(classifyCast(nodes) == classifyType(nodes),
+           "both classify all %u nodes alike", (unsigned)nodes.size());
+    testOk1(NTNDArray::isCompatible(structure));
+
+    size_t sink = 0;
+    double cast = timeIt(&classifyCast, nodes, iterations, sink);
+    double type = timeIt(&classifyType, nodes, iterations, sink);
+    double check = timeIsCompatible(structure, iterations, sink);
+
+    testDiag("%u iterations over %u nodes", (unsigned)iterations, (unsigned)nodes.size());
+    testDiag("classify by dynamic_cast:    %10.1f ns", cast);
+    testDiag("classify by Type:            %10.1f ns (%.1fx)", type, type > 0 ? cast / type : 0.0);
+    testDiag("NTNDArray::isCompatible:     %10.1f ns", check);
+    testDiag("(%u)", (unsigned)(sink & 1));
+
+    return testDone();
+}
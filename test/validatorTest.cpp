@@ -3,6 +3,8 @@
  * found in the file LICENSE that is included with the distribution
  */
 
+#include <sstream>
+
 #include <epicsUnitTest.h>
 #include <testMain.h>
 
@@ -299,13 +301,246 @@ void test_has_fn()
     }
 }
 
+void test_each()
+{
+    testDiag("test_each");
+
+    FieldBuilderPtr FB(FieldBuilder::begin());
+
+    {
+        // Test that all fields of a Structure are ScalarArrays
+        Result result(FB->
+            addArray("A", pvInt)->
+            addArray("B", pvString)->
+            createStructure());
+        result.each<ScalarArray>();
+        testOk(result.valid(), "Result(Structure{A:int[],B:string[]}).each<ScalarArray>().valid()");
+    }
+
+    {
+        // Test that 'each' reports every field of the wrong type
+        Result result(FB->
+            add("A", pvInt)->
+            addArray("B", pvString)->
+            add("C", pvString)->
+            createStructure(), "value");
+        result.each<ScalarArray>();
+        testOk(!result.valid(), "!Result(Structure{A:int,B:string[],C:string}).each<ScalarArray>().valid()");
+        testOk1(result.errors.size() == 2);
+        testOk1(result.errors.at(0) == Result::Error("value.A", Result::Error::IncorrectType));
+        testOk1(result.errors.at(1) == Result::Error("value.C", Result::Error::IncorrectType));
+    }
+
+    {
+        // Test that 'each' is valid for an empty Structure
+        Result result(FB->createStructure());
+        result.each<ScalarArray>();
+        testOk(result.valid(), "Result(Structure{}).each<ScalarArray>().valid()");
+    }
+
+    {
+        // Test that 'each' fails for non-structure-like Fields
+        Result result(FC->createScalar(pvByte));
+        result.each<Scalar>();
+        testOk(!result.valid(), "!Result(Scalar<pvByte>).each<Scalar>().valid()");
+        testOk1(result.errors.at(0) == Result::Error("", Result::Error::IncorrectType));
+    }
+}
+
+Result& isScalar(Result& result) { return result.is<Scalar>(); }
+Result& isScalarArray(Result& result) { return result.is<ScalarArray>(); }
+Result& isTestStructure(Result& result) { return result.is<Structure>("TEST_ID"); }
+Result& isTestUnion(Result& result) { return result.is<Union>("TEST_ID"); }
+Result& isAnyUnion(Result& result) { return result.is<Union>(Union::ANY_ID); }
+Result& isSomeStructure(Result& result) { return result.is<Structure>("SOME_ID"); }
+
+Result& hasAB(Result& result) { return result.has<Scalar>("A").has<Scalar>("B"); }
+Result& hasAArrayB(Result& result) { return result.has<Scalar>("A").has<ScalarArray>("B"); }
+Result& hasAC(Result& result) { return result.has<Scalar>("A").has<Scalar>("C"); }
+Result& hasX(Result& result) { return result.has<Scalar>("X"); }
+
+Result& maybeHasAB(Result& result) { return result.maybeHas<Scalar>("A").maybeHas<Scalar>("B"); }
+Result& maybeHasAArrayB(Result& result) { return result.maybeHas<Scalar>("A").maybeHas<ScalarArray>("B"); }
+Result& maybeHasAC(Result& result) { return result.maybeHas<Scalar>("A").maybeHas<Scalar>("C"); }
+Result& maybeHasX(Result& result) { return result.maybeHas<Scalar>("X"); }
+
+Result& hasInner(Result& result) { return result.has<&isStructABC>("inner"); }
+
+Result& eachScalarArray(Result& result) { return result.each<ScalarArray>(); }
+Result& eachScalar(Result& result) { return result.each<Scalar>(); }
+Result& isTable(Result& result)
+{
+    return result
+        .is<Structure>()
+        .has<&eachScalarArray, Structure>("value")
+        .maybeHas<&isStructABC, Structure>("abc")
+        .has<ScalarArray>("labels");
+}
+
+// Test that the compiled plan of 'rule' gives the same Result as 'rule'
+void testSamePlan(FieldConstPtr const & field, Result& (*rule)(Result&),
+                  const char * desc, std::string const & path = std::string())
+{
+    ValidationPlan plan(rule);
+
+    Result expected(field, path);
+    rule(expected);
+
+    Result actual(field, path);
+    plan.validate(actual);
+
+    testOk(actual.result == expected.result &&
+           actual.errors == expected.errors &&
+           plan.validate(field) == expected.valid(),
+           "plan(%s) == %s (%u errors)", desc, desc, (unsigned)expected.errors.size());
+}
+
+void test_plan()
+{
+    testDiag("test_plan");
+
+    FieldBuilderPtr FB(FieldBuilder::begin());
+
+    // test_is
+    for(int i = pvBoolean; i <= pvString; ++i) {
+        ScalarType t = static_cast<ScalarType>(i);
+        testSamePlan(FC->createScalar(t), &isScalar, "isScalar");
+        testSamePlan(FC->createScalarArray(t), &isScalarArray, "isScalarArray");
+    }
+    testSamePlan(FC->createScalarArray(pvInt), &isScalar, "isScalar");
+    testSamePlan(FC->createScalar(pvInt), &isScalarArray, "isScalarArray");
+
+    // test_is_id
+    testSamePlan(FB->setId("TEST_ID")->createStructure(), &isTestStructure, "isTestStructure");
+    testSamePlan(FB->setId("TEST_ID")->add("A", pvInt)->add("B", pvString)->createUnion(),
+        &isTestUnion, "isTestUnion");
+    testSamePlan(FB->createUnion(), &isAnyUnion, "isAnyUnion");
+    testSamePlan(FB->setId("TEST_ID")->createStructure(), &isTestUnion, "isTestUnion");
+    testSamePlan(FB->setId("WRONG_ID")->createStructure(), &isTestStructure, "isTestStructure");
+    testSamePlan(FC->createScalar(pvDouble), &isSomeStructure, "isSomeStructure");
+
+    // test_has, test_maybe_has
+    StructureConstPtr struc(FB->
+        add("A", pvInt)->
+        add("B", pvString)->
+        createStructure()
+    );
+    FieldConstPtr scalar(FC->createScalar(pvByte));
+
+    testSamePlan(struc, &hasAB, "hasAB");
+    testSamePlan(struc, &hasAArrayB, "hasAArrayB");
+    testSamePlan(struc, &hasAC, "hasAC");
+    testSamePlan(scalar, &hasX, "hasX");
+    testSamePlan(struc, &maybeHasAB, "maybeHasAB");
+    testSamePlan(struc, &maybeHasAArrayB, "maybeHasAArrayB");
+    testSamePlan(struc, &maybeHasAC, "maybeHasAC");
+    testSamePlan(scalar, &maybeHasX, "maybeHasX");
+
+    // test_has_fn
+    StructureConstPtr inner[] = {
+        FB->setId("ABC")->add("A", pvInt)->addArray("B", pvDouble)->add("C", pvString)->createStructure(),
+        FB->setId("ABC")->add("A", pvInt)->addArray("B", pvDouble)->createStructure(),
+        FB->setId("XYZ")->add("A", pvInt)->addArray("B", pvDouble)->createStructure(),
+        FB->setId("XYZ")->add("A", pvInt)->add("B", pvDouble)->createStructure(),
+    };
+    for (size_t i = 0; i < sizeof(inner)/sizeof(inner[0]); ++i) {
+        StructureConstPtr outer(FB->add("inner", inner[i])->createStructure());
+        testSamePlan(outer, &hasInner, "hasInner");
+        testSamePlan(outer, &hasInner, "hasInner", "root");
+    }
+
+    // test_each
+    testSamePlan(FB->addArray("A", pvInt)->addArray("B", pvString)->createStructure(),
+        &eachScalarArray, "eachScalarArray");
+    testSamePlan(FB->add("A", pvInt)->addArray("B", pvString)->add("C", pvString)->createStructure(),
+        &eachScalarArray, "eachScalarArray", "value");
+    testSamePlan(FB->add("A", pvInt)->add("B", pvString)->createUnion(), &eachScalar, "eachScalar");
+    testSamePlan(scalar, &eachScalar, "eachScalar");
+
+    // nested rules, several errors at different depths
+    StructureConstPtr table(FB->
+        addNestedStructure("value")->
+            addArray("x", pvDouble)->
+            add("y", pvDouble)->
+            endNested()->
+        add("abc", inner[3])->
+        add("labels", pvString)->
+        createStructure()
+    );
+    testSamePlan(table, &isTable, "isTable");
+    testSamePlan(table, &isTable, "isTable", "table");
+    testSamePlan(FB->
+        addNestedStructure("value")->
+            addArray("x", pvDouble)->
+            endNested()->
+        addArray("labels", pvString)->
+        createStructure(), &isTable, "isTable");
+    testSamePlan(scalar, &isTable, "isTable");
+}
+
+void test_check()
+{
+    testDiag("test_check");
+
+    FieldBuilderPtr FB(FieldBuilder::begin());
+    ValidationPlan plan(&isTable);
+
+    {
+        // Test that a passing check has no errors
+        Result result(plan.check(FB->
+            addNestedStructure("value")->
+                addArray("x", pvDouble)->
+                endNested()->
+            addArray("labels", pvString)->
+            createStructure()));
+        testOk(result.valid(), "plan(isTable).check(valid).valid()");
+        testOk1(result.getErrors().empty());
+    }
+
+    {
+        // Test that the errors of a failing check are collected
+        StructureConstPtr table(FB->
+            addNestedStructure("value")->
+                addArray("x", pvDouble)->
+                add("y", pvDouble)->
+                endNested()->
+            add("labels", pvString)->
+            createStructure()
+        );
+
+        Result expected(table);
+        isTable(expected);
+
+        Result result(plan.check(table));
+        testOk(!result.valid(), "!plan(isTable).check(invalid).valid()");
+        testOk1(!result.errors.empty());
+        testOk1(result.getErrors() == expected.errors);
+        testOk1(result.errors == expected.errors);
+        testOk1(result.getErrors() == expected.errors);
+
+        std::ostringstream checked, applied;
+        plan.check(table).dump(checked);
+        expected.dump(applied);
+        testOk(checked.str() == applied.str(), "%s", checked.str().c_str());
+
+        // Test that collected errors are merged
+        Result merged(table);
+        merged |= plan.check(table);
+        testOk1(!merged.valid());
+        testOk1(merged.errors == expected.errors);
+    }
+}
+
 MAIN(testValidator) {
-    testPlan(56);
+    testPlan(130);
     FC = epics::pvData::getFieldCreate();
     test_is();
     test_is_id();
     test_has();
     test_maybe_has();
     test_has_fn();
+    test_each();
+    test_plan();
+    test_check();
     return testDone();
 }